@@ -6,33 +6,262 @@
 #define FP_TX_PIN 17
 #define FP_RX_PIN 16
 #define FP_BAUDRATE 57600
+#define FP_ENROLL_STEP_TIMEOUT_MS 20000UL // chờ đặt / nhấc tay mỗi bước enroll
+#define FP_REMOVE_TIMEOUT_MS 10000UL      // chờ nhấc tay sau khi quét
 
 // Servo and door sensor
 #define SERVO_PIN 5
 #define SENSOR_PIN 15
 
+// Door actuator: chọn cơ cấu chốt lúc compile (có thể override bằng build_flags)
+#define DOOR_ACTUATOR_SERVO 0
+#define DOOR_ACTUATOR_RELAY 1
+#define DOOR_ACTUATOR_SOLENOID 2
+#ifndef DOOR_ACTUATOR
+#define DOOR_ACTUATOR DOOR_ACTUATOR_SERVO
+#endif
+#define SERVO_MS_PER_60DEG 170     // tốc độ servo theo datasheet (MG996R ~170, SG90 ~100)
+#define SERVO_SETTLE_MS 150        // cộng thêm trước khi detach
+#define LOCK_RELAY_PIN SERVO_PIN   // relay / solenoid dùng chung chân điều khiển
+#define LOCK_RELAY_ACTIVE_LEVEL HIGH
+#define SOLENOID_PULSE_MS 500      // thời gian cấp điện cho solenoid khi mở
+
+// Door FSM (ms). Hai timeout đầu là mặc định của config_store (auto_lock_ms, held_open_ms)
+#define AUTO_LOCK_TIMEOUT 10000      // unlock mà không mở cửa -> tự khoá lại
+#define DOOR_HELD_OPEN_TIMEOUT 30000 // cửa mở quá lâu -> alarm held_open
+#define DOOR_SENSOR_DEBOUNCE 200     // cảm biến phải ổn định mới tính (cũng là ngưỡng forced_open)
+#define DOOR_SEQ_BLOCK 64            // số event giữa 2 lần ghi mốc seq vào NVS
+
 #define LCD_ADDR 0x27
 #define LCD_COLS 16
 #define LCD_ROWS 2
-// Wifi
-#define WIFI_SSID "IT Hoc Bach Khoa"
-#define WIFI_PASS "chungtalamotgiadinh"
+#define LCD_MIN_SHOW_MS 800 // tin ưu tiên thấp hơn chỉ được thay tin đang hiện sau chừng này
+#define LCD_WIFI_WEAK_RSSI -75 // dưới mức này màn hình chờ hiện glyph WiFi yếu
+// Thông tin đăng nhập không nằm trong repo: mặc định rỗng, giá trị thật lấy từ
+// secrets.h (không commit, xem secrets.h.example) hoặc build_flags
+// (-DWIFI_SSID=\"...\"). SSID rỗng = thiết bị ở chế độ provisioning, chờ
+// config_set qua console Serial (lib/provision).
+#if __has_include("secrets.h")
+#include "secrets.h"
+#endif
+
+// Wifi: mặc định khi NVS chưa có (config_set wifi_ssid / wifi_pass)
+#ifndef WIFI_SSID
+#define WIFI_SSID ""
+#endif
+#ifndef WIFI_PASS
+#define WIFI_PASS ""
+#endif
+#define NET_CONNECT_TIMEOUT_MS 10000 // 1 lần thử kết nối tối đa
+#define NET_BACKOFF_MIN_MS 500       // reconnect: chờ tăng gấp đôi từ min tới max
+#define NET_BACKOFF_MAX_MS 30000
+#define NET_FAST_CONNECT_TIMEOUT_MS 3000 // thử kết nối thẳng tới AP đã cache
+#define NET_FAST_STATIC_IP 0             // 1 = dùng lại IP lease cũ, bỏ DHCP (router phải giữ IP cho thiết bị)
 
-// MQTT
+// NTP
+#define NTP_SERVER "in.pool.ntp.org"
+#define NTP_SERVER_2 "pool.ntp.org"
+#define NTP_GMT_OFFSET_SEC 25200 // GMT+7 cho Vietnam (7 * 3600)
+#define NTP_DAYLIGHT_OFFSET_SEC 0
+#define TIME_SYNC_INTERVAL_MS 3600000UL             // SNTP tự resync mỗi giờ (slew, không nhảy giờ)
+#define TIME_SYNC_STALE_MS (3 * TIME_SYNC_INTERVAL_MS) // quá 3 chu kỳ không sync -> tq = "stale"
+
+// MQTT: mặc định của config_store (mqtt_host, mqtt_port, ...)
+#ifndef MQTT_BROKER
 #define MQTT_BROKER "broker.emqx.io"
+#endif
 #define MQTT_PORT 1883
 #define MQTT_TOPIC_BASE "esp32/vmh-test"
-#define MQTT_USERNAME "emqx-vmh-test"
-#define MQTT_PASSWORD "public"
+#ifndef MQTT_USERNAME
+#define MQTT_USERNAME "" // rỗng = kết nối không xác thực
+#endif
+#ifndef MQTT_PASSWORD
+#define MQTT_PASSWORD ""
+#endif
+#define MQTT_KEEPALIVE_S 30 // broker phát Last Will "offline" sau ~1.5 lần keepalive không nghe thấy
+
+// Telemetry heartbeat (device_status)
+#define TELEMETRY_HB_MIN_MS 60000UL  // sau khi kết nối / khi có thay đổi
+#define TELEMETRY_HB_MAX_MS 900000UL // ổn định lâu: tối đa 15 phút / lần
+#define TELEMETRY_RSSI_DELTA 10      // dB
+#define TELEMETRY_HEAP_DELTA 4096    // min free heap giảm thêm chừng này byte
+
+// RUNTIME CONFIG (lib/config_store)
+#define CONFIG_SCHEMA_VERSION 1       // tăng khi đổi ý nghĩa / đơn vị của một key đã có
+#define CONFIG_NET_TRIAL_MS 120000UL  // WiFi / MQTT mới phải lên broker trong thời gian này, không thì quay lại
+#define PROVISION_LINE_MAX 384        // một dòng JSON trên console provisioning
+#define PROVISION_POLL_MS 100
 
 // SYSTEM
 #define DEVICE_ID "esp32_door_001"
-// FREERTOS
-#define TASK_FP_STACK_SIZE 4096
+#ifndef FW_VERSION
+#define FW_VERSION "1.0.0" // ghi đè bằng -DFW_VERSION=\"x.y.z\" khi build bản phát hành
+#endif
+// TRACE (-DTRACE_ENABLED=1): số record mỗi core, lũy thừa của 2, 12 byte / record
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 512
+#endif
+
+// LOG (-DLOG_LEVEL=LOG_LEVEL_DEBUG / _WARN ... xem log.h)
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 32 // record ~110 byte
+#endif
+#define LOG_LINE_BYTES 160
+
+// MEMORY PROFILER
+#define MEMPROF_INTERVAL_MS 300000UL // báo cáo mem_report mỗi 5 phút
+#define MEMPROF_STACK_WARN_BYTES 256 // stack còn trống ít hơn -> log cảnh báo
+
+// ================== BẢNG TASK (FREERTOS) ==================
+// Mỗi task: core / priority / stack (byte). TASK_PROFILE chọn cách chia core:
+//  - SINGLE_CORE: mọi task ứng dụng trên core 1, core 0 chỉ có WiFi / lwIP
+//    và các task nền (cách bố trí cũ).
+//  - DUAL_CORE: core 1 chỉ dành cho kiểm soát ra vào (vân tay, cửa, app, LCD);
+//    ba task MQTT sang core 0 cạnh stack WiFi, nên TLS / JSON / socket không
+//    còn tranh CPU với quét vân tay và mở cửa.
+// So sánh hai profile bằng cpu0 / cpu1 và unlock_ms trong heartbeat.
+#define TASK_PROFILE_SINGLE_CORE 0
+#define TASK_PROFILE_DUAL_CORE 1
+#ifndef TASK_PROFILE
+#define TASK_PROFILE TASK_PROFILE_DUAL_CORE
+#endif
+
+#define CORE_ACCESS 1 // vân tay, cửa, app, LCD
+#define CORE_BG 0     // WiFi manager, log, memprof
+#if TASK_PROFILE == TASK_PROFILE_DUAL_CORE
+#define CORE_NET 0 // MQTT
+#else
+#define CORE_NET 1
+#endif
+
+#define TASK_FP_CORE CORE_ACCESS
 #define TASK_FP_PRIORITY 3
+#define TASK_FP_STACK_SIZE 4096
 
-#define TASK_DOOR_STACK_SIZE 2048
+#define TASK_DOOR_CORE CORE_ACCESS
 #define TASK_DOOR_PRIORITY 2
+#define TASK_DOOR_STACK_SIZE 2048
+
+// Task App (main.cpp): subscriber BUS_SUB_APP của event bus, cao hơn door để
+// lệnh mở cửa sau khi khớp vân tay không phải chờ
+#define TASK_APP_CORE CORE_ACCESS
+#define TASK_APP_PRIORITY 3
+#define TASK_APP_STACK_SIZE 3072
+
+#define TASK_LCD_CORE CORE_ACCESS
+#define TASK_LCD_PRIORITY 1
+#define TASK_LCD_STACK_SIZE 3072
+
+// Trước msg_pool: 8198 / 6144 (MqttMsg, StaticJsonDocument, payload[1024] trên stack).
+// 4096 ước lượng từ sizeof, chưa đo trên board: kiểm tra stack_free của "MQTT Cmd" /
+// "MQTT Pub" trong mem_report trước khi giảm thêm
+#define TASK_MQTT_CMD_CORE CORE_NET
+#define TASK_MQTT_CMD_PRIORITY 1
+#define TASK_MQTT_CMD_STACK_SIZE 4096
+
+#define TASK_MQTT_LOOP_CORE CORE_NET
+#define TASK_MQTT_LOOP_PRIORITY 2
+#define TASK_MQTT_LOOP_STACK_SIZE 4096
+
+#define TASK_MQTT_PUB_CORE CORE_NET
+#define TASK_MQTT_PUB_PRIORITY 1
+#define TASK_MQTT_PUB_STACK_SIZE 4096
+
+#define TASK_NET_CORE CORE_BG
+#define TASK_NET_PRIORITY 1
+#define TASK_NET_STACK_SIZE 3072
+
+#define TASK_LOG_CORE CORE_BG
+#define TASK_LOG_PRIORITY 1 // tskIDLE_PRIORITY + 1
+#define TASK_LOG_STACK_SIZE 3072
+
+#define TASK_ATT_CORE CORE_BG
+#define TASK_ATT_PRIORITY 1
+#define TASK_ATT_STACK_SIZE 4096
+
+// Kiểm tra chữ ký ECDSA (mbedtls) cần ~3 KB stack
+#define TASK_OTA_CORE CORE_NET
+#define TASK_OTA_PRIORITY 1
+#define TASK_OTA_STACK_SIZE 6144
+
+#define TASK_MEMPROF_CORE CORE_BG
+#define TASK_MEMPROF_PRIORITY 1
+#define TASK_MEMPROF_STACK_SIZE 3072
+
+// Trên task nền priority 1 để rule tới hạn không phải chờ log / attendance
+#define TASK_SCHED_CORE CORE_BG
+#define TASK_SCHED_PRIORITY 2
+#define TASK_SCHED_STACK_SIZE 3072
+
+// Cao hơn mọi task ứng dụng: vẫn chạy khi task khác kẹt trong vòng lặp
+#define TASK_SUP_CORE CORE_BG
+#define TASK_SUP_PRIORITY 4
+#define TASK_SUP_STACK_SIZE 2560
+
+// Đo tải CPU từng core bằng idle hook (lib/cpu_load). Idle task không vào
+// WAITI khi bật nên tốn điện hơn một chút; 0 để tắt.
+#ifndef CPU_LOAD_ENABLED
+#define CPU_LOAD_ENABLED 1
+#endif
+#define CPU_LOAD_WINDOW_MS 1000
+
+// POOL MESSAGE (lib/msg_pool)
+#define MSG_POOL_MQTT_RX_BLOCKS 4     // MqttMsg lệnh đang chờ MqttControlTask
+#define MSG_POOL_JSON_RX_BYTES 1280   // parse lệnh: 1 pool slot ArduinoJson (1 KB) + chuỗi
+#define MSG_POOL_JSON_TX_BYTES 4096   // heartbeat (queues, pools, slo) / mem_report: 3 pool slot + chuỗi
+#define MSG_POOL_OTA_RX_BLOCKS OTA_WINDOW // OtaChunk đang chờ TaskOta
+
+// OTA (lib/ota): delta firmware qua MQTT, xem tools/ota_delta.py
+#define OTA_CHUNK_BYTES 512               // dữ liệu mỗi message .../ota/data (+4 byte offset), vừa buffer 640 của PubSubClient
+#define OTA_WINDOW 4                      // chunk backend gửi trước khi chờ ack
+#define OTA_IDLE_TIMEOUT_MS 60000UL       // không nhận chunk nào -> huỷ phiên
+#define OTA_CONFIRM_TIMEOUT_MS 180000UL   // image mới phải kết nối được broker trong thời gian này
+#define OTA_MAX_TRIAL_BOOTS 3             // reset quá số lần này trước khi xác nhận -> quay về image cũ
+
+// EVENT BUS
+#define BUS_ARENA_SIZE 16    // số event đang "bay" tối đa (mỗi ô ~20 byte)
+#define BUS_APP_QUEUE_LEN 10 // con trỏ chờ xử lý cho BUS_SUB_APP
+#define BUS_JOURNAL_QUEUE_LEN 10
+
+// ATTENDANCE LOG (lib/attendance), partition khai báo trong partitions.csv
+#define ATT_PARTITION_LABEL "attlog"
+#define ATT_PARTITION_TYPE 0x40            // type riêng của ứng dụng (0x40..0xFE)
+#define ATT_PAGE_RECORDS 32                // record mỗi trang trả về qua MQTT
+#define ATT_RETENTION_S (60UL * 86400UL)   // giữ ít nhất 60 ngày dù backend đã lấy
+#define ATT_COMPACT_INTERVAL_MS 600000UL   // bảo trì nền mỗi 10 phút
+#define ATT_DAILY_MAX_IDS 162              // dung lượng mẫu của AS608, ID nằm trong [0, 162)
+#define ATT_DAILY_RETRY_MS 30000UL         // thử publish lại tổng hợp ngày khi chưa có broker
+
+// SUPERVISOR (lib/supervisor): SLO từng task
+//  _ITER_MS: một vòng làm việc (begin -> end), _PERIOD_MS: giữa hai vòng của
+//  task định kỳ, _STALL_MS: không tiến triển quá lâu -> coi như treo
+#define SUP_CHECK_MS 250
+#define SUP_EVENT_INTERVAL_MS 60000UL // gom vi phạm SLO, tối đa một event mỗi phút
+#define SUP_RESET_GRACE_MS 10000UL    // treo thêm sau khi báo / gọi phục hồi -> reset
+#define SUP_MAX_RESETS 3              // reset liên tiếp tối đa, sau đó chỉ báo
+#define SUP_STABLE_MS 600000UL        // chạy đủ 10 phút thì đếm reset liên tiếp lại từ 0
+#define SUP_TWDT_TIMEOUT_S 10         // Task Watchdog cho chính task supervisor
+
+#define SUP_DOOR_ITER_MS 20
+#define SUP_DOOR_PERIOD_MS 100 // vòng 50 ms + xử lý
+#define SUP_DOOR_STALL_MS 3000UL
+#define SUP_FP_ITER_MS 200 // một lần poll + so khớp
+#define SUP_FP_STALL_MS 90000UL // enroll: 3 lần chờ tay, mỗi lần tối đa FP_ENROLL_STEP_TIMEOUT_MS
+#define SUP_APP_ITER_MS 50
+#define SUP_APP_STALL_MS 5000UL
+#define SUP_MQTT_LOOP_ITER_MS 5000 // gồm cả connect (DNS + TCP + CONNACK)
+#define SUP_MQTT_LOOP_STALL_MS 60000UL
+#define SUP_MQTT_CMD_ITER_MS 2000 // ghi NVS, publish trả lời
+#define SUP_MQTT_CMD_STALL_MS 20000UL
+#define SUP_NET_ITER_MS 1000
+#define SUP_NET_STALL_MS 20000UL
+#define SUP_SCHED_ITER_MS 50
+#define SUP_SCHED_PERIOD_MS 1500 // thức mỗi đầu giây
+#define SUP_SCHED_STALL_MS 10000UL
+
+// LỊCH (lib/schedule)
+#define SCHEDULE_MAX_RULES 24   // 8 byte NVS mỗi rule
+#define SCHEDULE_MAX_SKEW_S 300 // đồng hồ nhảy xa hơn: dựng lại lịch thay vì chạy bù từng giây
 
 typedef enum
 {
@@ -46,19 +275,33 @@ typedef enum
     EVT_DOOR_LOCKED,
     EVT_DOOR_UNLOCKED_WAIT_OPEN, // unlock nhưng chưa mở
     EVT_DOOR_OPEN,
-    EVT_STATUS_ONLINE
+    EVT_DOOR_FORCED_OPEN, // alarm: cửa bị mở khi đang khoá
+    EVT_DOOR_HELD_OPEN,   // alarm: cửa mở quá lâu, value = số giây
+    EVT_DOOR_RECOVERED,   // khôi phục trạng thái sau reset (xem door_get_recovery_info)
+    EVT_STATUS_ONLINE,
+    EVT_MEM_REPORT,  // stack / heap / call site cấp phát (xem memprof_get_snapshot)
+    EVT_STATE_CHANGED, // snapshot trạng thái có field đổi (xem device_state_take)
+    EVT_SLO_VIOLATION, // task vượt SLO (xem supervisor_take_violations)
+    EVT_TASK_STALL     // task treo, value = SupTaskId_t
 } SystemEventType_t;
 
+// Đi qua app_queue theo giá trị: giữ <= APP_QUEUE_MAX_ITEM (16 byte, static_assert trong main.cpp)
 typedef struct
 {
-    SystemEventType_t type;
-    int16_t value; // Ví dụ: ID vân tay, hoặc mã lỗi
+    uint8_t type;   // SystemEventType_t
+    uint8_t tq;     // TimeSyncQuality_t lúc event xảy ra
+    int16_t value;  // Ví dụ: ID vân tay, hoặc mã lỗi
+    uint16_t ts_ms; // phần mili giây của ts_s
+    uint32_t seq;   // số thứ tự door event (0 = không có)
+    uint32_t ts_s;  // giờ UTC (epoch) lúc event xảy ra, 0 = lấy giờ lúc publish (xem event_stamp)
 } SystemEvent_t;
 
 enum DoorRequest_t
 {
-    DOOR_REQUEST_UNLOCK, // yêu cầu mở khoá
-    DOOR_REQUEST_NONE    // poll trạng thái cửa
+    DOOR_REQUEST_UNLOCK,      // yêu cầu mở khoá
+    DOOR_REQUEST_HOLD_UNLOCK, // giữ chốt mở (giờ tiếp khách), không tự khoá tới DOOR_REQUEST_LOCK
+    DOOR_REQUEST_LOCK,        // bỏ giữ mở và khoá (cửa đang mở: khoá khi đóng)
+    DOOR_REQUEST_NONE         // poll trạng thái cửa
 };
 enum FingerprintRequest_t
 {
@@ -102,7 +345,16 @@ struct LcdEvent_t
 struct MqttMsg
 {
   char topic[50];
-  char payload[150];
+  char payload[256]; // config_set nhiều key
+};
+
+// Message cho TaskOta (block của POOL_OTA_RX)
+struct OtaChunk
+{
+  uint8_t kind;  // OtaChunkKind_t (ota.h)
+  uint16_t len;
+  uint32_t off;  // DATA: offset trong file delta, BEGIN: kích thước file delta
+  uint8_t data[OTA_CHUNK_BYTES];
 };
 
 #endif
\ No newline at end of file
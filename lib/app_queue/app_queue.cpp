@@ -0,0 +1,160 @@
+#include "app_queue.h"
+#include "app_config.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "log.h"
+
+// Log queue đầy tối đa 1 lần / khoảng này cho mỗi queue
+#define APP_QUEUE_DROP_LOG_MS 5000
+
+typedef struct
+{
+    QueueHandle_t handle;
+    UBaseType_t item_size;
+    uint32_t last_drop_log;
+    AppQueueStats_t stats;
+} AppQueue_t;
+
+static AppQueue_t queues[QUEUE_ID_COUNT];
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const queue_names[QUEUE_ID_COUNT] = {
+    "door_cmd", "fp_request", "system_evt", "mqtt_payload", "lcd", "bus_app", "bus_journal", "ota"};
+
+// Tối đa QUEUE_ID_COUNT phần tử, quét tuyến tính rẻ hơn mọi cấu trúc khác.
+// -1 cho NULL (app_queue_create lỗi) và queue không tạo qua app_queue: slot
+// chưa tạo cũng có handle NULL, không được khớp với nó.
+static int app_queue_id(QueueHandle_t q)
+{
+    if (q == NULL)
+        return -1;
+    for (int i = 0; i < QUEUE_ID_COUNT; i++)
+        if (queues[i].handle == q)
+            return i;
+    return -1;
+}
+
+static uint8_t wait_bucket(uint32_t ms)
+{
+    uint8_t b = 0;
+    for (uint32_t limit = 1; b < APP_QUEUE_WAIT_BUCKETS - 1 && ms >= limit; limit *= 10)
+        b++;
+    return b;
+}
+
+QueueHandle_t app_queue_create(AppQueueId_t id, UBaseType_t length, UBaseType_t item_size)
+{
+    if (id >= QUEUE_ID_COUNT || item_size > APP_QUEUE_MAX_ITEM)
+    {
+        LOG_E("[QUEUE] invalid queue %d (item %u B)", id, (unsigned)item_size);
+        return NULL;
+    }
+
+    // [uint32_t thời điểm gửi][item]
+    QueueHandle_t q = xQueueCreate(length, sizeof(uint32_t) + item_size);
+    queues[id].handle = q;
+    queues[id].item_size = item_size;
+    queues[id].stats = {};
+    queues[id].stats.length = length;
+    return q;
+}
+
+static BaseType_t app_queue_put(QueueHandle_t q, const void *item, TickType_t wait, bool front)
+{
+    int id = app_queue_id(q);
+    if (id < 0)
+        return errQUEUE_FULL;
+
+    AppQueue_t *aq = &queues[id];
+    uint8_t buf[sizeof(uint32_t) + APP_QUEUE_MAX_ITEM];
+    uint32_t now = millis();
+    memcpy(buf, &now, sizeof(now));
+    memcpy(buf + sizeof(now), item, aq->item_size);
+
+    BaseType_t ok = front ? xQueueSendToFront(q, buf, wait) : xQueueSend(q, buf, wait);
+    UBaseType_t depth = uxQueueMessagesWaiting(q);
+    bool log_drop = false;
+
+    portENTER_CRITICAL(&stats_mux);
+    if (ok == pdTRUE)
+    {
+        aq->stats.sends++;
+        if (depth > aq->stats.high_water)
+            aq->stats.high_water = depth;
+    }
+    else
+    {
+        aq->stats.drops++;
+        if (now - aq->last_drop_log >= APP_QUEUE_DROP_LOG_MS || aq->last_drop_log == 0)
+        {
+            aq->last_drop_log = now ? now : 1;
+            log_drop = true;
+        }
+    }
+    portEXIT_CRITICAL(&stats_mux);
+
+    TRACE_QUEUE_SEND(id, ok, depth);
+    if (ok != pdTRUE)
+        telemetry_note_alarm();
+    if (log_drop)
+        LOG_W("[QUEUE] %s full, dropped (%u total)", queue_names[id], (unsigned)aq->stats.drops);
+    return ok;
+}
+
+BaseType_t app_queue_send(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    return app_queue_put(q, item, wait, false);
+}
+
+BaseType_t app_queue_send_to_front(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    return app_queue_put(q, item, wait, true);
+}
+
+BaseType_t app_queue_receive(QueueHandle_t q, void *out, TickType_t wait)
+{
+    int id = app_queue_id(q);
+    if (id < 0)
+    {
+        // Như queue luôn rỗng: chờ hết wait rồi báo thất bại, task gọi trong
+        // vòng lặp không bị quay tròn chiếm CPU
+        vTaskDelay(wait);
+        return errQUEUE_EMPTY;
+    }
+
+    AppQueue_t *aq = &queues[id];
+    uint8_t buf[sizeof(uint32_t) + APP_QUEUE_MAX_ITEM];
+    BaseType_t ok = xQueueReceive(q, buf, wait);
+    if (ok != pdTRUE)
+        return ok;
+
+    uint32_t sent_at;
+    memcpy(&sent_at, buf, sizeof(sent_at));
+    memcpy(out, buf + sizeof(sent_at), aq->item_size);
+    uint32_t waited = millis() - sent_at;
+
+    portENTER_CRITICAL(&stats_mux);
+    aq->stats.receives++;
+    aq->stats.wait_hist[wait_bucket(waited)]++;
+    if (waited > aq->stats.max_wait_ms)
+        aq->stats.max_wait_ms = waited;
+    portEXIT_CRITICAL(&stats_mux);
+
+    TRACE_QUEUE_RECV(id, uxQueueMessagesWaiting(q));
+    return ok;
+}
+
+const char *app_queue_name(AppQueueId_t id)
+{
+    return id < QUEUE_ID_COUNT ? queue_names[id] : "?";
+}
+
+bool app_queue_get_stats(AppQueueId_t id, AppQueueStats_t *out)
+{
+    if (id >= QUEUE_ID_COUNT || queues[id].handle == NULL)
+        return false;
+    portENTER_CRITICAL(&stats_mux);
+    *out = queues[id].stats;
+    portEXIT_CRITICAL(&stats_mux);
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef APP_QUEUE_H_
+#define APP_QUEUE_H_
+
+#include <Arduino.h>
+
+// Các queue giữa các task. QUEUE_LCD là mailbox của display (không phải
+// FreeRTOS queue), chỉ có id để trace dùng chung bảng tên.
+typedef enum
+{
+    QUEUE_DOOR_CMD,
+    QUEUE_FP_REQUEST,
+    QUEUE_SYSTEM_EVT,
+    QUEUE_MQTT_PAYLOAD,
+    QUEUE_LCD,
+    QUEUE_BUS_APP, // con trỏ BusEvent_t* cho subscriber BUS_SUB_APP
+    QUEUE_BUS_JOURNAL,
+    QUEUE_OTA, // con trỏ OtaChunk* cho TaskOta
+    QUEUE_ID_COUNT
+} AppQueueId_t;
+
+// Phần tử lớn nhất đi qua app_queue (buffer tạm trên stack khi đóng / mở gói).
+// Message lớn đi qua queue bằng con trỏ tới block trong msg_pool.
+#define APP_QUEUE_MAX_ITEM 16
+
+// Histogram thời gian một phần tử nằm trong queue (từ lúc send tới lúc receive):
+// <1 ms, <10 ms, <100 ms, <1 s, <10 s, >=10 s
+#define APP_QUEUE_WAIT_BUCKETS 6
+
+typedef struct
+{
+    uint16_t length;     // dung lượng lúc tạo
+    uint16_t high_water; // số phần tử lớn nhất từng có
+    uint32_t sends;      // gửi thành công
+    uint32_t drops;      // gửi thất bại (queue đầy)
+    uint32_t receives;
+    uint32_t max_wait_ms;
+    uint32_t wait_hist[APP_QUEUE_WAIT_BUCKETS];
+} AppQueueStats_t;
+
+// Thay cho xQueueCreate: mỗi phần tử có thêm 4 byte thời điểm gửi để đo thời gian chờ
+QueueHandle_t app_queue_create(AppQueueId_t id, UBaseType_t length, UBaseType_t item_size);
+
+// Thay cho xQueueSend / xQueueSendToFront / xQueueReceive, cùng ngữ nghĩa và giá trị trả về.
+// Queue tạo bằng app_queue_create chỉ được đọc / ghi qua các hàm này; queue khác
+// (kể cả NULL) trả errQUEUE_FULL / errQUEUE_EMPTY, không chuyển tới FreeRTOS.
+BaseType_t app_queue_send(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t app_queue_send_to_front(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t app_queue_receive(QueueHandle_t q, void *buf, TickType_t wait);
+
+const char *app_queue_name(AppQueueId_t id);
+// false nếu id chưa được tạo (vd. QUEUE_LCD)
+bool app_queue_get_stats(AppQueueId_t id, AppQueueStats_t *out);
+
+#endif // APP_QUEUE_H_
@@ -0,0 +1,102 @@
+#include "att_daily.h"
+#include "app_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ATT_DAY_S 86400UL
+#define ATT_LOCAL_OFFSET_S ((int32_t)(NTP_GMT_OFFSET_SEC + NTP_DAYLIGHT_OFFSET_SEC))
+
+static AttDailyEntry_t table[ATT_DAILY_MAX_IDS];
+static AttDailyTotals_t totals;
+
+uint32_t att_daily_day_of(uint32_t ts)
+{
+    return (uint32_t)(((int64_t)ts + ATT_LOCAL_OFFSET_S) / ATT_DAY_S);
+}
+
+uint32_t att_daily_midnight(uint32_t day)
+{
+    return (uint32_t)((int64_t)day * ATT_DAY_S - ATT_LOCAL_OFFSET_S);
+}
+
+uint32_t att_daily_current_day(void)
+{
+    return totals.day;
+}
+
+void att_daily_reset(uint32_t day)
+{
+    uint16_t carry = totals.day == 0 ? totals.unsynced : 0;
+    memset(table, 0, sizeof(table));
+    memset(&totals, 0, sizeof(totals));
+    totals.day = day;
+    totals.unsynced = carry;
+}
+
+void att_daily_add(const AttRecord_t *rec)
+{
+    if (rec->ts == 0)
+    {
+        totals.unsynced++;
+        return;
+    }
+    if (att_daily_day_of(rec->ts) != totals.day)
+        return;
+
+    if (rec->result == ATT_RESULT_DENIED)
+    {
+        totals.denied++;
+        return;
+    }
+    if (rec->finger_id < 0 || rec->finger_id >= ATT_DAILY_MAX_IDS)
+    {
+        totals.overflow++;
+        return;
+    }
+
+    AttDailyEntry_t *e = &table[rec->finger_id];
+    if (e->count == 0)
+    {
+        e->first_ts = rec->ts;
+        totals.ids++;
+    }
+    // ts có thể lùi nhẹ khi SNTP chỉnh giờ: giữ min / max thay vì tin thứ tự
+    if (rec->ts < e->first_ts)
+        e->first_ts = rec->ts;
+    if (rec->ts > e->last_ts)
+        e->last_ts = rec->ts;
+    if (e->count < UINT16_MAX)
+        e->count++;
+}
+
+size_t att_daily_to_json(char *buf, size_t len, bool final)
+{
+    time_t day_utc = (time_t)totals.day * ATT_DAY_S;
+    struct tm tm_day;
+    gmtime_r(&day_utc, &tm_day);
+    uint32_t midnight = att_daily_midnight(totals.day);
+
+    size_t n = snprintf(buf, len, "{\"day\":\"%04d-%02d-%02d\",\"final\":%s,\"denied\":%u,\"unsynced\":%u,\"overflow\":%u,\"ids\":[",
+                        tm_day.tm_year + 1900, tm_day.tm_mon + 1, tm_day.tm_mday, final ? "true" : "false",
+                        totals.denied, totals.unsynced, totals.overflow);
+    bool first = true;
+    for (int id = 0; id < ATT_DAILY_MAX_IDS && n < len; id++)
+    {
+        const AttDailyEntry_t *e = &table[id];
+        if (e->count == 0)
+            continue;
+        n += snprintf(buf + n, len - n, "%s[%d,%lu,%lu,%u]", first ? "" : ",", id,
+                      (unsigned long)(e->first_ts - midnight), (unsigned long)(e->last_ts - midnight), e->count);
+        first = false;
+    }
+    if (n < len)
+        n += snprintf(buf + n, len - n, "]}");
+    return n < len ? n : 0;
+}
+
+void att_daily_get_totals(AttDailyTotals_t *out)
+{
+    *out = totals;
+}
@@ -0,0 +1,53 @@
+#ifndef ATT_DAILY_H_
+#define ATT_DAILY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "att_log.h"
+
+// ================== TỔNG HỢP CHẤM CÔNG THEO NGÀY ==================
+// Bảng đánh chỉ số trực tiếp bằng finger_id (không tìm kiếm): mỗi lượt quét cập
+// nhật first / last / count của ID đó trong O(1). Lượt bị từ chối không có ID
+// (AS608 không nhận ra vân tay) nên chỉ đếm chung cho cả ngày.
+// Ngày tính theo giờ địa phương: (ts + NTP_GMT_OFFSET_SEC + NTP_DAYLIGHT_OFFSET_SEC) / 86400.
+// Record có ts = 0 (đồng hồ chưa sync) không gán được vào ngày nào, chỉ đếm unsynced.
+// Chỉ TaskAttendance gọi các hàm này.
+
+typedef struct
+{
+    uint32_t first_ts; // epoch lần quét đầu trong ngày, 0 = chưa quét
+    uint32_t last_ts;
+    uint16_t count;
+} AttDailyEntry_t;
+
+typedef struct
+{
+    uint32_t day;      // số ngày địa phương kể từ 1970-01-01, 0 = chưa có
+    uint16_t denied;   // lượt bị từ chối trong ngày
+    uint16_t unsynced; // lượt quét khi đồng hồ chưa sync (không có trong bảng)
+    uint16_t overflow; // ID >= ATT_DAILY_MAX_IDS
+    uint16_t ids;      // số ID có ít nhất một lượt quét
+} AttDailyTotals_t;
+
+// Ngày địa phương của một epoch
+uint32_t att_daily_day_of(uint32_t ts);
+// Epoch lúc 00:00 giờ địa phương của ngày day
+uint32_t att_daily_midnight(uint32_t day);
+
+// Ngày hiện tại của bảng, 0 khi bảng chưa gắn với ngày nào (mới boot)
+uint32_t att_daily_current_day(void);
+// Xoá bảng và gắn với ngày day (unsynced từ trước lần sync đầu được giữ lại)
+void att_daily_reset(uint32_t day);
+// Cộng một record vào bảng. Record thuộc ngày khác ngày của bảng bị bỏ qua
+// (người gọi phải rollover trước).
+void att_daily_add(const AttRecord_t *rec);
+
+// Ghi tổng hợp ngày hiện tại thành JSON vào buf, trả về độ dài (0 nếu không đủ chỗ):
+// {"day":"2025-12-25","final":true,"denied":D,"unsynced":U,"overflow":O,
+//  "ids":[[id,first_s,last_s,count],...]}
+// first_s / last_s là giây kể từ 00:00 địa phương; final = false khi ngày chưa kết thúc.
+size_t att_daily_to_json(char *buf, size_t len, bool final);
+
+void att_daily_get_totals(AttDailyTotals_t *out);
+
+#endif // ATT_DAILY_H_
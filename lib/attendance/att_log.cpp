@@ -0,0 +1,379 @@
+#include "att_log.h"
+#include "app_config.h"
+#include "log.h"
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+#define ATT_SECTOR_MAGIC 0xA77E0001UL
+#define ATT_SECTOR_SIZE SPI_FLASH_SEC_SIZE
+#define ATT_SLOTS (ATT_SECTOR_SIZE / sizeof(AttRecord_t)) // ô 0 là header
+#define ATT_ERASED_SEQ 0xFFFFFFFFUL
+#define ATT_READ_CHUNK 16 // record mỗi lần đọc flash (256 byte trên stack)
+
+struct AttSectorHeader_t
+{
+    uint32_t magic;
+    uint32_t first_seq; // seq của ô 1
+    uint32_t ts_floor;  // ts lớn nhất của mọi record trước sector này
+    uint32_t check;
+};
+static_assert(sizeof(AttSectorHeader_t) == sizeof(AttRecord_t), "header chiếm đúng một ô");
+
+// Chỉ TaskAttendance gọi các hàm ghi / đọc; att_log_get_stats đọc field 32 bit không khoá
+static const esp_partition_t *part = NULL;
+static uint16_t n_sectors = 0;
+static int32_t head = -1;         // sector đang ghi, -1 = log rỗng
+static int32_t tail = -1;         // sector cũ nhất
+static uint16_t head_slot = 0;    // ô ghi tiếp trong head
+static uint32_t next_seq = 1;
+static uint32_t ts_max = 0;       // ts lớn nhất đã ghi, làm ts_floor cho sector mới
+static uint32_t tail_first_seq = 0;
+static int32_t pre_erased = -1;   // sector nằm ngoài ring đã được xoá sẵn
+static AttLogStats_t stats;
+
+/* ===== helper ===== */
+static uint32_t header_check(const AttSectorHeader_t *h)
+{
+    return ~(h->magic ^ (h->first_seq * 0x9E3779B1UL) ^ (h->ts_floor * 0x85EBCA6BUL));
+}
+
+// CRC16-CCITT trên mọi byte trừ door (lập trình sau) và crc
+static uint16_t record_crc(const AttRecord_t *r)
+{
+    const uint8_t *p = (const uint8_t *)r;
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < offsetof(AttRecord_t, crc); i++)
+    {
+        if (i == offsetof(AttRecord_t, door))
+            continue;
+        crc ^= (uint16_t)p[i] << 8;
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static size_t sector_addr(int32_t s)
+{
+    return (size_t)s * ATT_SECTOR_SIZE;
+}
+
+static bool read_header(int32_t s, AttSectorHeader_t *h)
+{
+    if (esp_partition_read(part, sector_addr(s), h, sizeof(*h)) != ESP_OK)
+        return false;
+    return h->magic == ATT_SECTOR_MAGIC && h->check == header_check(h);
+}
+
+static bool erase_sector(int32_t s)
+{
+    stats.erases++;
+    return esp_partition_erase_range(part, sector_addr(s), ATT_SECTOR_SIZE) == ESP_OK;
+}
+
+static uint16_t ring_count(void)
+{
+    if (head < 0)
+        return 0;
+    return (uint16_t)((head - tail + n_sectors) % n_sectors + 1);
+}
+
+static int32_t ring_at(uint16_t i)
+{
+    return (tail + i) % n_sectors;
+}
+
+// Số ô đã dùng (kể cả header) của sector s trong ring
+static uint16_t sector_used_slots(int32_t s)
+{
+    return s == head ? head_slot : ATT_SLOTS;
+}
+
+// Vị trí lớn nhất trong ring có khoá < target (0 nếu không có).
+// Khoá first_seq / ts_floor không giảm theo thứ tự ring.
+static uint16_t ring_search(bool by_ts, uint32_t target)
+{
+    uint16_t lo = 0, hi = ring_count(); // tìm trong [lo, hi)
+    while (hi - lo > 1)
+    {
+        uint16_t mid = lo + (hi - lo) / 2;
+        AttSectorHeader_t h;
+        if (!read_header(ring_at(mid), &h))
+        {
+            hi = mid; // không nên xảy ra: coi phần sau là không hợp lệ
+            continue;
+        }
+        uint32_t key = by_ts ? h.ts_floor : h.first_seq;
+        if (key < target)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* ===== API ===== */
+bool att_log_init(void)
+{
+    part = esp_partition_find_first((esp_partition_type_t)ATT_PARTITION_TYPE, ESP_PARTITION_SUBTYPE_ANY, ATT_PARTITION_LABEL);
+    if (part == NULL)
+    {
+        LOG_E("[ATT] Partition '%s' not found", ATT_PARTITION_LABEL);
+        return false;
+    }
+    n_sectors = part->size / ATT_SECTOR_SIZE;
+    stats.sectors = n_sectors;
+
+    // Ring liên tục từ tail tới head: head có first_seq lớn nhất, tail nhỏ nhất
+    uint32_t head_first = 0, tail_first = 0, head_floor = 0;
+    for (int32_t s = 0; s < n_sectors; s++)
+    {
+        AttSectorHeader_t h;
+        if (!read_header(s, &h))
+            continue;
+        if (head < 0 || h.first_seq > head_first)
+        {
+            head = s;
+            head_first = h.first_seq;
+            head_floor = h.ts_floor;
+        }
+        if (tail < 0 || h.first_seq < tail_first)
+        {
+            tail = s;
+            tail_first = h.first_seq;
+        }
+    }
+
+    if (head < 0)
+    {
+        LOG_I("[ATT] Empty log, %u sectors", n_sectors);
+        return true;
+    }
+
+    // Ô trống đầu tiên của head. Record ghi dở vẫn chiếm ô (seq theo vị trí ô).
+    ts_max = head_floor;
+    head_slot = ATT_SLOTS;
+    AttRecord_t buf[ATT_READ_CHUNK];
+    for (uint16_t slot = 1; slot < ATT_SLOTS && head_slot == ATT_SLOTS; slot += ATT_READ_CHUNK)
+    {
+        uint16_t n = min((uint16_t)ATT_READ_CHUNK, (uint16_t)(ATT_SLOTS - slot));
+        esp_partition_read(part, sector_addr(head) + slot * sizeof(AttRecord_t), buf, n * sizeof(AttRecord_t));
+        for (uint16_t i = 0; i < n; i++)
+        {
+            if (buf[i].seq == ATT_ERASED_SEQ)
+            {
+                head_slot = slot + i;
+                break;
+            }
+            if (buf[i].crc == record_crc(&buf[i]) && buf[i].ts > ts_max)
+                ts_max = buf[i].ts;
+        }
+    }
+    next_seq = head_first + head_slot - 1;
+    tail_first_seq = tail_first;
+
+    LOG_I("[ATT] Log ready: %u/%u sectors, next seq %u", ring_count(), n_sectors, (unsigned)next_seq);
+    return true;
+}
+
+static bool open_sector(void)
+{
+    int32_t s = head < 0 ? 0 : (head + 1) % n_sectors;
+    if (head >= 0 && s == tail)
+    {
+        // Ring đầy: bỏ sector cũ nhất
+        tail = (tail + 1) % n_sectors;
+        AttSectorHeader_t th;
+        if (read_header(tail, &th))
+            tail_first_seq = th.first_seq;
+    }
+    if (s != pre_erased && !erase_sector(s))
+        return false;
+    pre_erased = -1;
+
+    AttSectorHeader_t h = {ATT_SECTOR_MAGIC, next_seq, ts_max, 0};
+    h.check = header_check(&h);
+    if (esp_partition_write(part, sector_addr(s), &h, sizeof(h)) != ESP_OK)
+        return false;
+
+    head = s;
+    head_slot = 1;
+    if (tail < 0)
+    {
+        tail = s;
+        tail_first_seq = next_seq;
+    }
+    return true;
+}
+
+uint32_t att_log_append(AttRecord_t *rec)
+{
+    if (part == NULL)
+        return 0;
+    if ((head < 0 || head_slot >= ATT_SLOTS) && !open_sector())
+    {
+        LOG_E("[ATT] Cannot open sector");
+        return 0;
+    }
+
+    rec->seq = next_seq;
+    rec->reserved = 0xFF;
+    rec->crc = record_crc(rec);
+    size_t addr = sector_addr(head) + head_slot * sizeof(AttRecord_t);
+
+    // Ô đã bị đụng tới thì không dùng lại, kể cả khi ghi lỗi
+    head_slot++;
+    next_seq++;
+    if (rec->ts > ts_max)
+        ts_max = rec->ts;
+
+    if (esp_partition_write(part, addr, rec, sizeof(*rec)) != ESP_OK)
+    {
+        LOG_E("[ATT] Write failed at seq %u", (unsigned)rec->seq);
+        return 0;
+    }
+    return rec->seq;
+}
+
+bool att_log_set_door(uint32_t seq, AttDoor_t door)
+{
+    if (part == NULL || head < 0 || seq < tail_first_seq || seq >= next_seq)
+        return false;
+
+    int32_t s = ring_at(ring_search(false, seq + 1));
+    AttSectorHeader_t h;
+    if (!read_header(s, &h) || seq < h.first_seq)
+        return false;
+    uint32_t slot = seq - h.first_seq + 1;
+    if (slot >= sector_used_slots(s))
+        return false;
+
+    size_t addr = sector_addr(s) + slot * sizeof(AttRecord_t);
+    AttRecord_t rec;
+    esp_partition_read(part, addr, &rec, sizeof(rec));
+    if (rec.seq != seq || rec.door != ATT_DOOR_PENDING)
+        return false;
+
+    uint8_t value = door;
+    return esp_partition_write(part, addr + offsetof(AttRecord_t, door), &value, 1) == ESP_OK;
+}
+
+size_t att_log_query(const AttQuery_t *q, AttRecord_t *out, size_t max, uint32_t *next)
+{
+    *next = 0;
+    uint16_t count = ring_count();
+    if (part == NULL || count == 0 || max == 0)
+        return 0;
+
+    uint32_t since = q->since_seq > tail_first_seq ? q->since_seq : tail_first_seq;
+    uint16_t start = ring_search(false, since + 1);
+    if (q->from_ts)
+    {
+        uint16_t by_ts = ring_search(true, q->from_ts);
+        if (by_ts > start)
+            start = by_ts;
+    }
+
+    size_t n = 0;
+    AttRecord_t buf[ATT_READ_CHUNK];
+    for (uint16_t i = start; i < count; i++)
+    {
+        int32_t s = ring_at(i);
+        AttSectorHeader_t h;
+        if (!read_header(s, &h))
+            continue;
+        // Mọi record từ đây về sau mới hơn to_ts (trừ khi đồng hồ bị chỉnh lùi)
+        if (q->to_ts && i > start && h.ts_floor > q->to_ts)
+            break;
+
+        uint16_t used = sector_used_slots(s);
+        uint16_t slot = 1;
+        if (since > h.first_seq)
+        {
+            uint32_t skip = since - h.first_seq;
+            slot = skip + 1 < used ? skip + 1 : used;
+        }
+
+        for (; slot < used; slot += ATT_READ_CHUNK)
+        {
+            uint16_t cnt = min((uint16_t)ATT_READ_CHUNK, (uint16_t)(used - slot));
+            esp_partition_read(part, sector_addr(s) + slot * sizeof(AttRecord_t), buf, cnt * sizeof(AttRecord_t));
+            for (uint16_t k = 0; k < cnt; k++)
+            {
+                const AttRecord_t *r = &buf[k];
+                if (r->seq == ATT_ERASED_SEQ)
+                    break;
+                if (r->crc != record_crc(r))
+                {
+                    stats.bad_records++;
+                    continue;
+                }
+                if (r->seq < since)
+                    continue;
+                if ((q->from_ts && r->ts < q->from_ts) || (q->to_ts && (r->ts == 0 || r->ts > q->to_ts)))
+                    continue;
+
+                out[n++] = *r;
+                if (n == max)
+                {
+                    *next = r->seq + 1;
+                    return n;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+void att_log_compact(uint32_t acked_seq, uint32_t now_ts, uint32_t retention_s)
+{
+    if (part == NULL || head < 0)
+        return;
+
+    // Bỏ sector cũ nhất đã được xác nhận và quá hạn giữ. ts_floor của sector
+    // kế tiếp >= ts của mọi record trong sector cũ nhất.
+    while (ring_count() > 1)
+    {
+        AttSectorHeader_t nh;
+        if (!read_header(ring_at(1), &nh))
+            break;
+        bool acked = nh.first_seq - 1 <= acked_seq;
+        bool expired = now_ts && nh.ts_floor && nh.ts_floor + retention_s < now_ts;
+        if (!acked || !expired)
+            break;
+        if (!erase_sector(tail))
+            break;
+        LOG_I("[ATT] Compacted sector %d (seq < %u)", (int)tail, (unsigned)nh.first_seq);
+        tail = ring_at(1);
+        tail_first_seq = nh.first_seq;
+    }
+
+    // Xoá trước sector kế tiếp (45 ms .. vài trăm ms) để lần mở sector không phải chờ
+    int32_t s = (head + 1) % n_sectors;
+    if (s == pre_erased)
+        return;
+    if (s != tail)
+    {
+        if (erase_sector(s))
+            pre_erased = s;
+        return;
+    }
+
+    // Ring đầy: sector cũ nhất sắp bị ghi đè, xoá sớm nếu backend đã lấy hết
+    AttSectorHeader_t nh;
+    if (ring_count() > 1 && read_header(ring_at(1), &nh) && nh.first_seq - 1 <= acked_seq && erase_sector(s))
+    {
+        tail = ring_at(1);
+        tail_first_seq = nh.first_seq;
+        pre_erased = s;
+    }
+}
+
+void att_log_get_stats(AttLogStats_t *out)
+{
+    *out = stats;
+    out->sectors_used = ring_count();
+    out->head_seq = head < 0 ? 0 : next_seq - 1;
+    out->oldest_seq = head < 0 ? 0 : tail_first_seq;
+}
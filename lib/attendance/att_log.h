@@ -0,0 +1,85 @@
+#ifndef ATT_LOG_H_
+#define ATT_LOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== NHẬT KÝ CHẤM CÔNG TRÊN FLASH ==================
+// Partition riêng (ATT_PARTITION_LABEL) chia thành các sector 4 KB dùng như
+// một vòng tròn: chỉ ghi nối tiếp, sector cũ nhất bị xoá khi cần chỗ, nên mỗi
+// sector bị erase đều nhau (wear leveling tự nhiên của ring).
+//  - Ô 0 của sector là header: first_seq (seq của record đầu) và ts_floor
+//    (ts lớn nhất của mọi record trước sector). Hai giá trị này không giảm theo
+//    thứ tự sector nên tìm theo seq / thời gian bằng binary search trên header,
+//    không cần index trong RAM.
+//  - 255 ô còn lại là record 16 byte. Record ghi dở khi mất điện sai CRC và bị
+//    bỏ qua; ô còn 0xFF là chưa ghi.
+//  - Trường door không nằm trong CRC: record ghi với ATT_DOOR_PENDING (0xFF)
+//    rồi được lập trình thêm khi biết cửa có mở hay không (flash chỉ xoá bit
+//    1 -> 0, không cần erase).
+
+typedef enum
+{
+    ATT_RESULT_GRANTED = 1,
+    ATT_RESULT_DENIED = 2,
+} AttResult_t;
+
+typedef enum
+{
+    ATT_DOOR_NOT_OPENED = 0x00, // mở chốt nhưng không ai mở cửa, tự khoá lại
+    ATT_DOOR_OPENED = 0x01,
+    ATT_DOOR_NONE = 0x02,    // không mở chốt (bị từ chối)
+    ATT_DOOR_PENDING = 0xFF, // chưa biết (hoặc mất điện trước khi biết)
+} AttDoor_t;
+
+struct __attribute__((packed)) AttRecord_t
+{
+    uint32_t seq;      // tăng dần từ 1, không lặp lại kể cả khi ring quay vòng
+    uint32_t ts;       // epoch UTC (s), 0 = đồng hồ chưa sync
+    int16_t finger_id; // -1 khi bị từ chối
+    uint8_t result;    // AttResult_t
+    uint8_t door;      // AttDoor_t, ngoài CRC
+    uint8_t tq;        // TimeSyncQuality_t lúc ghi
+    uint8_t reserved;
+    uint16_t crc;
+};
+static_assert(sizeof(AttRecord_t) == 16, "record phải đúng 16 byte");
+
+typedef struct
+{
+    uint32_t since_seq; // chỉ record có seq >= since_seq (0 = từ đầu)
+    uint32_t from_ts;   // 0 = không lọc
+    uint32_t to_ts;     // 0 = không lọc
+} AttQuery_t;
+
+typedef struct
+{
+    uint16_t sectors;      // tổng số sector của partition
+    uint16_t sectors_used; // sector đang có dữ liệu
+    uint32_t head_seq;     // seq record mới nhất, 0 = rỗng
+    uint32_t oldest_seq;   // seq record cũ nhất còn giữ
+    uint32_t erases;       // số lần erase sector từ khi boot
+    uint32_t bad_records;  // record sai CRC gặp khi đọc
+} AttLogStats_t;
+
+// Dò partition, tìm sector mới nhất và vị trí ghi tiếp. false nếu không có partition.
+bool att_log_init(void);
+
+// Ghi record mới (điền seq, crc). Trả về seq, 0 nếu lỗi.
+uint32_t att_log_append(AttRecord_t *rec);
+// Cập nhật door của record vẫn đang ATT_DOOR_PENDING
+bool att_log_set_door(uint32_t seq, AttDoor_t door);
+
+// Đọc tối đa max record khớp q theo thứ tự seq. *next_seq = seq để hỏi trang
+// kế tiếp, 0 khi đã hết.
+size_t att_log_query(const AttQuery_t *q, AttRecord_t *out, size_t max, uint32_t *next_seq);
+
+// Bảo trì nền (không gọi từ đường ghi):
+//  - xoá trước sector kế tiếp để lần mở sector mới không phải chờ erase
+//  - xoá sector cũ nhất khi mọi record trong đó đã được backend xác nhận
+//    (seq <= acked_seq) và cũ hơn retention_s
+void att_log_compact(uint32_t acked_seq, uint32_t now_ts, uint32_t retention_s);
+
+void att_log_get_stats(AttLogStats_t *out);
+
+#endif // ATT_LOG_H_
@@ -0,0 +1,338 @@
+#include "attendance.h"
+#include "att_daily.h"
+#include "app_config.h"
+#include "event_bus.h"
+#include "timesync.h"
+#include "mqtt.h"
+#include "log.h"
+
+#include <Preferences.h>
+#include <time.h>
+
+// Trang JSON: {"q":tag,"head":H,"next":N,"recs":[[seq,ts,id,result,door,tq],...]}
+// mỗi record tối đa ~40 ký tự
+#define ATT_PAGE_BUF_SIZE (96 + ATT_PAGE_RECORDS * 40)
+// Tổng hợp ngày: "[id,first_s,last_s,count]," tối đa 24 ký tự mỗi ID
+#define ATT_DAILY_BUF_SIZE (128 + ATT_DAILY_MAX_IDS * 24)
+
+typedef struct
+{
+    AttQuery_t q;
+    uint16_t limit;
+    uint32_t tag;
+} AttRequest_t;
+
+static bool log_ok = false;
+static uint32_t acked_seq = 0;
+static uint32_t pending_seq = 0; // record GRANTED đang chờ kết quả cửa
+static AttendanceStats_t counters;
+static AttRecord_t page_recs[ATT_PAGE_RECORDS]; // dùng chung cho trang query và rebuild tổng hợp
+
+// Tổng hợp của ngày vừa kết thúc, giữ tới khi publish được (retained)
+static char daily_buf[ATT_DAILY_BUF_SIZE];
+static size_t daily_len = 0;
+
+// Hộp thư một chỗ: task MQTT ghi, TaskAttendance lấy khi bị event_bus_wake
+static AttRequest_t mailbox;
+static bool mailbox_full = false;
+static bool daily_requested = false; // lệnh att_daily: gửi tổng hợp ngày đang chạy
+static portMUX_TYPE mailbox_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void ack_load(void)
+{
+    Preferences prefs;
+    if (prefs.begin("att", true))
+    {
+        acked_seq = prefs.getUInt("ack", 0);
+        prefs.end();
+    }
+}
+
+static void ack_store(uint32_t seq)
+{
+    Preferences prefs;
+    if (prefs.begin("att", false))
+    {
+        prefs.putUInt("ack", seq);
+        prefs.end();
+    }
+}
+
+/* ===== TỔNG HỢP THEO NGÀY ===== */
+static uint32_t clock_now(void)
+{
+    return timesync_quality() != TIME_Q_NONE ? (uint32_t)time(NULL) : 0;
+}
+
+// Dựng lại bảng của ngày day từ record trên flash (sau boot, hoặc khi đồng hồ
+// bị chỉnh lùi qua nửa đêm). Chỉ đọc record của một ngày.
+static void daily_rebuild(uint32_t day)
+{
+    att_daily_reset(day);
+    if (!log_ok)
+        return;
+    AttQuery_t q = {0, att_daily_midnight(day), att_daily_midnight(day + 1) - 1};
+    uint32_t next = 0;
+    do
+    {
+        size_t n = att_log_query(&q, page_recs, ATT_PAGE_RECORDS, &next);
+        for (size_t i = 0; i < n; i++)
+            att_daily_add(&page_recs[i]);
+        q.since_seq = next;
+    } while (next);
+}
+
+// Gọi trước khi cộng record mới và định kỳ: sang ngày mới thì chốt tổng hợp
+// của ngày cũ để publish rồi bắt đầu bảng mới.
+static void daily_roll(uint32_t now)
+{
+    if (now == 0)
+        return;
+    uint32_t day = att_daily_day_of(now);
+    uint32_t cur = att_daily_current_day();
+    if (day == cur)
+        return;
+
+    if (cur != 0 && day > cur)
+    {
+        if (daily_len)
+            LOG_W("[ATT] daily summary not published, overwritten");
+        daily_len = att_daily_to_json(daily_buf, sizeof(daily_buf), true);
+        att_daily_reset(day);
+        LOG_I("[ATT] Day rollover, summary %u B", (unsigned)daily_len);
+    }
+    else
+    {
+        daily_rebuild(day);
+    }
+}
+
+static void daily_publish(void)
+{
+    if (daily_len && mqtt_publish("attendance/daily", daily_buf, daily_len, true))
+        daily_len = 0;
+}
+
+// Tổng hợp ngày đang chạy theo yêu cầu (không retained, final = false)
+static void daily_publish_current(void)
+{
+    static char buf[ATT_DAILY_BUF_SIZE];
+    if (att_daily_current_day() == 0)
+        return;
+    size_t len = att_daily_to_json(buf, sizeof(buf), false);
+    if (len)
+        mqtt_publish("attendance/daily", buf, len, false);
+}
+
+/* ===== GHI RECORD ===== */
+static void journal_append(AttResult_t result, int16_t finger_id, AttDoor_t door)
+{
+    AttRecord_t rec = {};
+    TimeSyncQuality_t tq = timesync_quality();
+    rec.ts = clock_now();
+    rec.finger_id = finger_id;
+    rec.result = result;
+    rec.door = door;
+    rec.tq = tq;
+
+    // Rollover / rebuild trước khi ghi để rebuild không đếm trùng record này
+    daily_roll(rec.ts);
+    uint32_t seq = log_ok ? att_log_append(&rec) : 0;
+    if (seq == 0)
+    {
+        counters.write_errors++;
+        LOG_W("[ATT] append failed (id=%d)", finger_id);
+    }
+    if (result == ATT_RESULT_GRANTED)
+        pending_seq = seq;
+    att_daily_add(&rec);
+}
+
+static void journal_door_outcome(AttDoor_t door)
+{
+    if (pending_seq == 0)
+        return;
+    att_log_set_door(pending_seq, door);
+    pending_seq = 0;
+}
+
+static void journal_handle(const BusEvent_t *evt)
+{
+    if (evt->type == BUS_EVT_FINGERPRINT)
+    {
+        if (evt->fp.evt == FP_EVT_SCAN_SUCCESS)
+        {
+            // Lần quét trước chưa có kết quả cửa (cửa bị mở lại ngay) -> coi như không mở
+            journal_door_outcome(ATT_DOOR_NOT_OPENED);
+            journal_append(ATT_RESULT_GRANTED, evt->fp.id, ATT_DOOR_PENDING);
+        }
+        else if (evt->fp.evt == FP_EVT_SCAN_NOT_MATCH)
+        {
+            journal_append(ATT_RESULT_DENIED, -1, ATT_DOOR_NONE);
+        }
+    }
+    else if (evt->type == BUS_EVT_DOOR)
+    {
+        if (evt->door.evt == DOOR_EVT_OPENED)
+            journal_door_outcome(ATT_DOOR_OPENED);
+        else if (evt->door.evt == DOOR_EVT_WAIT_TIME_END_AND_LOCKED || evt->door.evt == DOOR_EVT_LOCKED)
+            journal_door_outcome(ATT_DOOR_NOT_OPENED);
+    }
+}
+
+/* ===== TRANG KẾT QUẢ ===== */
+static void journal_serve(const AttRequest_t *req)
+{
+    static char page[ATT_PAGE_BUF_SIZE];
+    AttRecord_t *recs = page_recs;
+
+    uint16_t limit = req->limit && req->limit < ATT_PAGE_RECORDS ? req->limit : ATT_PAGE_RECORDS;
+    uint32_t next = 0;
+    size_t n = log_ok ? att_log_query(&req->q, recs, limit, &next) : 0;
+
+    AttLogStats_t st;
+    att_log_get_stats(&st);
+    int len = snprintf(page, sizeof(page), "{\"q\":%lu,\"head\":%lu,\"oldest\":%lu,\"next\":%lu,\"recs\":[",
+                       (unsigned long)req->tag, (unsigned long)st.head_seq,
+                       (unsigned long)st.oldest_seq, (unsigned long)next);
+    for (size_t i = 0; i < n; i++)
+    {
+        const AttRecord_t *r = &recs[i];
+        len += snprintf(page + len, sizeof(page) - len, "%s[%lu,%lu,%d,%u,%u,%u]",
+                        i ? "," : "", (unsigned long)r->seq, (unsigned long)r->ts,
+                        r->finger_id, r->result, r->door, r->tq);
+    }
+    len += snprintf(page + len, sizeof(page) - len, "]}");
+
+    if (mqtt_publish("attendance", page, len, false))
+        counters.pages_sent++;
+    else
+        LOG_W("[ATT] page publish failed (q=%lu)", (unsigned long)req->tag);
+    LOG_D("[ATT] page q=%lu: %u recs, next=%lu", (unsigned long)req->tag, (unsigned)n, (unsigned long)next);
+}
+
+// Thời gian chờ event: tới lần bảo trì kế tiếp, nửa đêm kế tiếp, hoặc lần thử
+// publish lại tổng hợp ngày
+static uint32_t journal_wait_ms(uint32_t since_compact_ms)
+{
+    uint32_t wait = since_compact_ms < ATT_COMPACT_INTERVAL_MS ? ATT_COMPACT_INTERVAL_MS - since_compact_ms : 0;
+    uint32_t now = clock_now();
+    if (now)
+    {
+        uint32_t to_midnight_ms = (att_daily_midnight(att_daily_day_of(now) + 1) - now) * 1000UL + 1000UL;
+        if (to_midnight_ms < wait)
+            wait = to_midnight_ms;
+    }
+    if (daily_len && wait > ATT_DAILY_RETRY_MS)
+        wait = ATT_DAILY_RETRY_MS;
+    return wait;
+}
+
+static void TaskAttendance(void *pvParameters)
+{
+    (void)pvParameters;
+    uint32_t last_compact = millis();
+
+    for (;;)
+    {
+        TickType_t wait = pdMS_TO_TICKS(journal_wait_ms(millis() - last_compact));
+        const BusEvent_t *evt = event_bus_receive(BUS_SUB_JOURNAL, wait);
+        if (evt)
+        {
+            journal_handle(evt);
+            event_bus_release(evt);
+        }
+
+        AttRequest_t req;
+        bool have_req = false;
+        bool want_daily = false;
+        portENTER_CRITICAL(&mailbox_mux);
+        if (mailbox_full)
+        {
+            req = mailbox;
+            mailbox_full = false;
+            have_req = true;
+        }
+        want_daily = daily_requested;
+        daily_requested = false;
+        portEXIT_CRITICAL(&mailbox_mux);
+
+        daily_roll(clock_now());
+        if (have_req)
+            journal_serve(&req);
+        if (want_daily)
+            daily_publish_current();
+        daily_publish();
+
+        // Erase (~50 ms/sector) chạy ở đây, không bao giờ trên đường append
+        if (log_ok && millis() - last_compact >= ATT_COMPACT_INTERVAL_MS)
+        {
+            last_compact = millis();
+            att_log_compact(acked_seq, clock_now(), ATT_RETENTION_S);
+        }
+    }
+}
+
+bool attendance_init(void)
+{
+    ack_load();
+    log_ok = att_log_init();
+    if (log_ok)
+    {
+        AttLogStats_t st;
+        att_log_get_stats(&st);
+        LOG_I("[ATT] %u/%u sectors, seq %lu..%lu, acked %lu", st.sectors_used, st.sectors,
+              (unsigned long)st.oldest_seq, (unsigned long)st.head_seq, (unsigned long)acked_seq);
+    }
+    return log_ok;
+}
+
+void attendance_start_task(void)
+{
+    xTaskCreatePinnedToCore(TaskAttendance, "Attendance", TASK_ATT_STACK_SIZE, NULL, TASK_ATT_PRIORITY, NULL, TASK_ATT_CORE);
+}
+
+void attendance_request_query(const AttQuery_t *q, uint16_t limit, uint32_t tag)
+{
+    portENTER_CRITICAL(&mailbox_mux);
+    mailbox.q = *q;
+    mailbox.limit = limit;
+    mailbox.tag = tag;
+    mailbox_full = true;
+    portEXIT_CRITICAL(&mailbox_mux);
+    event_bus_wake(BUS_SUB_JOURNAL);
+}
+
+void attendance_request_daily(void)
+{
+    portENTER_CRITICAL(&mailbox_mux);
+    daily_requested = true;
+    portEXIT_CRITICAL(&mailbox_mux);
+    event_bus_wake(BUS_SUB_JOURNAL);
+}
+
+void attendance_ack(uint32_t seq)
+{
+    // Không cho ack vượt head (backend gửi nhầm) và không lùi
+    uint32_t head = attendance_head_seq();
+    if (seq > head)
+        seq = head;
+    if (seq <= acked_seq)
+        return;
+    acked_seq = seq;
+    ack_store(seq);
+}
+
+uint32_t attendance_head_seq(void)
+{
+    AttLogStats_t st;
+    att_log_get_stats(&st);
+    return st.head_seq;
+}
+
+void attendance_get_stats(AttendanceStats_t *out)
+{
+    *out = counters;
+    att_log_get_stats(&out->log);
+    out->acked_seq = acked_seq;
+}
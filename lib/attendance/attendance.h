@@ -0,0 +1,47 @@
+#ifndef ATTENDANCE_H_
+#define ATTENDANCE_H_
+
+#include <Arduino.h>
+#include "att_log.h"
+
+// ================== ATTENDANCE ==================
+// Task nền đăng ký BUS_SUB_JOURNAL: mỗi lần quét vân tay (khớp / không khớp)
+// ghi một record vào att_log, rồi cập nhật kết quả cửa khi door báo mở hoặc
+// tự khoá lại. Không nằm trên đường mở cửa: TaskApp vẫn xử lý event độc lập.
+//
+// Backend đồng bộ theo con trỏ seq:
+//   {"cmd":"att_query","since_seq":N}            -> trang từ seq N
+//   {"cmd":"att_query","from":T0,"to":T1}        -> lọc theo thời gian (epoch)
+//   {"cmd":"att_ack","seq":N}                    -> đã lưu tới seq N
+// Mỗi trang publish lên topic .../attendance, "next" là since_seq của trang kế
+// tiếp (0 = hết). Sector chỉ bị xoá khi đã ack và quá ATT_RETENTION_S.
+//
+// Task giữ thêm tổng hợp theo ngày (att_daily): qua nửa đêm giờ địa phương,
+// tổng hợp ngày cũ được publish retained lên .../attendance/daily (thử lại tới
+// khi có broker), backend không cần kéo từng record để tính giờ vào / ra.
+
+typedef struct
+{
+    AttLogStats_t log;
+    uint32_t acked_seq;
+    uint32_t pages_sent;
+    uint32_t write_errors;
+} AttendanceStats_t;
+
+// Mở partition, đọc acked seq từ NVS. false nếu không có partition (task vẫn
+// chạy được, chỉ không ghi).
+bool attendance_init(void);
+void attendance_start_task(void);
+
+// Gửi yêu cầu đọc cho task (gọi từ task MQTT). Chỉ một yêu cầu chờ tại một thời
+// điểm, yêu cầu mới ghi đè yêu cầu chưa xử lý. tag được trả lại trong trang ("q").
+void attendance_request_query(const AttQuery_t *q, uint16_t limit, uint32_t tag);
+// Gửi tổng hợp của ngày đang chạy (lệnh att_daily)
+void attendance_request_daily(void);
+// Backend xác nhận đã lưu mọi record có seq <= seq
+void attendance_ack(uint32_t seq);
+
+uint32_t attendance_head_seq(void);
+void attendance_get_stats(AttendanceStats_t *out);
+
+#endif // ATTENDANCE_H_
@@ -0,0 +1,71 @@
+#include "boot.h"
+#include "log.h"
+
+static BootStageInfo_t stages[BOOT_STAGE_COUNT];
+static portMUX_TYPE boot_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const stage_names[BOOT_STAGE_COUNT] = {
+    "core", "door", "display", "fp", "wifi", "ntp", "mqtt"};
+
+void boot_stage_begin(BootStage_t stage)
+{
+    portENTER_CRITICAL(&boot_mux);
+    if (!stages[stage].started)
+    {
+        stages[stage].start_ms = millis();
+        stages[stage].started = true;
+    }
+    portEXIT_CRITICAL(&boot_mux);
+}
+
+bool boot_stage_end(BootStage_t stage, bool ok)
+{
+    bool ended = false;
+    portENTER_CRITICAL(&boot_mux);
+    if (stages[stage].started && stages[stage].end_ms == 0)
+    {
+        stages[stage].end_ms = millis();
+        stages[stage].ok = ok;
+        ended = true;
+    }
+    portEXIT_CRITICAL(&boot_mux);
+    return ended;
+}
+
+const BootStageInfo_t *boot_stage_info(BootStage_t stage)
+{
+    return &stages[stage];
+}
+
+const char *boot_stage_name(BootStage_t stage)
+{
+    return stage < BOOT_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+bool boot_local_ready(void)
+{
+    return stages[BOOT_STAGE_DOOR].end_ms && stages[BOOT_STAGE_DISPLAY].end_ms &&
+           stages[BOOT_STAGE_FINGERPRINT].end_ms;
+}
+
+void boot_print_report(void)
+{
+    LOG_I("[BOOT] stage        start    end   took");
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++)
+    {
+        const BootStageInfo_t *s = &stages[i];
+        if (s->end_ms)
+            LOG_I("[BOOT] %-10s %7u %6u %6u%s", stage_names[i], (unsigned)s->start_ms,
+                          (unsigned)s->end_ms, (unsigned)(s->end_ms - s->start_ms), s->ok ? "" : " FAIL");
+        else
+            LOG_I("[BOOT] %-10s %7u    ...", stage_names[i], (unsigned)s->start_ms);
+    }
+}
+
+bool boot_complete(void)
+{
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++)
+        if (stages[i].end_ms == 0)
+            return false;
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include <Arduino.h>
+
+// ================== BOOT STAGES ==================
+// Thứ tự phụ thuộc:
+//   CORE -> DOOR, DISPLAY, FINGERPRINT  (kiểm soát ra vào cục bộ, không cần mạng)
+//   CORE -> WIFI -> NTP, MQTT           (chạy song song ở nền)
+typedef enum
+{
+    BOOT_STAGE_CORE,        // Serial, queues
+    BOOT_STAGE_DOOR,        // khôi phục trạng thái cửa + task cửa
+    BOOT_STAGE_DISPLAY,     // task LCD
+    BOOT_STAGE_FINGERPRINT, // verify cảm biến + task quét
+    BOOT_STAGE_WIFI,        // từ network_init tới khi có IP
+    BOOT_STAGE_NTP,         // từ khi có IP tới khi đồng bộ giờ
+    BOOT_STAGE_MQTT,        // từ khi có IP tới khi kết nối broker
+    BOOT_STAGE_COUNT
+} BootStage_t;
+
+typedef struct
+{
+    uint32_t start_ms; // tính từ lúc khởi động (millis)
+    uint32_t end_ms;   // 0 = chưa xong
+    bool started;
+    bool ok;
+} BootStageInfo_t;
+
+// Chỉ lần gọi đầu tiên được ghi nhận: reconnect về sau không tính là boot
+void boot_stage_begin(BootStage_t stage);
+// true nếu lần gọi này ghi nhận kết thúc stage (lần đầu)
+bool boot_stage_end(BootStage_t stage, bool ok = true);
+const BootStageInfo_t *boot_stage_info(BootStage_t stage);
+const char *boot_stage_name(BootStage_t stage);
+
+// Các stage cục bộ (DOOR, DISPLAY, FINGERPRINT) đều xong
+bool boot_local_ready(void);
+// Mọi stage đều xong (kể cả mạng)
+bool boot_complete(void);
+// In bảng thời gian từng stage qua log; stage chưa xong in "..."
+void boot_print_report(void);
+
+#endif // BOOT_H_
@@ -0,0 +1,472 @@
+#include "config_store.h"
+#include "app_config.h"
+#include "log.h"
+
+#include <Preferences.h>
+#include <freertos/timers.h>
+#include <stdarg.h>
+
+#define CFG_T_STR 0
+#define CFG_T_U16 1
+#define CFG_T_U32 2
+
+#define CFG_F_SECRET (1 << 0) // không trả về trong config_get
+
+#define CFG_TRIAL_GROUPS (CFG_GROUP_WIFI | CFG_GROUP_MQTT)
+
+typedef struct
+{
+    const char *key; // cũng là key NVS (tối đa 15 ký tự)
+    uint8_t group;
+    uint8_t type;
+    uint8_t flags;
+    uint8_t size;    // byte của field trong AppSettings_t (chuỗi: kể cả '\0')
+    uint16_t offset;
+    uint32_t min;    // số: khoảng cho phép; chuỗi: độ dài tối thiểu
+    uint32_t max;
+} ConfigField_t;
+
+#define CFG_FIELD(name, grp, t, fl, lo, hi) \
+    {#name, grp, t, fl, sizeof(((AppSettings_t *)0)->name), offsetof(AppSettings_t, name), lo, hi}
+
+static const ConfigField_t fields[] = {
+    CFG_FIELD(wifi_ssid, CFG_GROUP_WIFI, CFG_T_STR, 0, 1, 0),
+    CFG_FIELD(wifi_pass, CFG_GROUP_WIFI, CFG_T_STR, CFG_F_SECRET, 0, 0),
+    CFG_FIELD(mqtt_host, CFG_GROUP_MQTT, CFG_T_STR, 0, 1, 0),
+    CFG_FIELD(mqtt_port, CFG_GROUP_MQTT, CFG_T_U16, 0, 1, 65535),
+    CFG_FIELD(mqtt_user, CFG_GROUP_MQTT, CFG_T_STR, 0, 0, 0),
+    CFG_FIELD(mqtt_pass, CFG_GROUP_MQTT, CFG_T_STR, CFG_F_SECRET, 0, 0),
+    CFG_FIELD(mqtt_base, CFG_GROUP_MQTT, CFG_T_STR, 0, 1, 0),
+    CFG_FIELD(mqtt_keepalive_s, CFG_GROUP_MQTT, CFG_T_U16, 0, 5, 600),
+    CFG_FIELD(ntp_server, CFG_GROUP_TIME, CFG_T_STR, 0, 1, 0),
+    CFG_FIELD(auto_lock_ms, CFG_GROUP_DOOR, CFG_T_U32, 0, 1000, 120000),
+    CFG_FIELD(held_open_ms, CFG_GROUP_DOOR, CFG_T_U32, 0, 5000, 3600000),
+    CFG_FIELD(hb_min_ms, CFG_GROUP_TELEMETRY, CFG_T_U32, 0, 10000, 3600000),
+    CFG_FIELD(hb_max_ms, CFG_GROUP_TELEMETRY, CFG_T_U32, 0, 60000, 86400000),
+    CFG_FIELD(memprof_ms, CFG_GROUP_TELEMETRY, CFG_T_U32, 0, 10000, 86400000),
+    CFG_FIELD(fp_baud, CFG_GROUP_REBOOT, CFG_T_U32, 0, 9600, 115200),
+};
+#define CFG_FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+static const AppSettings_t defaults = {
+    WIFI_SSID, WIFI_PASS,
+    MQTT_BROKER, MQTT_PORT, MQTT_USERNAME, MQTT_PASSWORD, MQTT_TOPIC_BASE, MQTT_KEEPALIVE_S,
+    NTP_SERVER,
+    AUTO_LOCK_TIMEOUT, DOOR_HELD_OPEN_TIMEOUT,
+    TELEMETRY_HB_MIN_MS, TELEMETRY_HB_MAX_MS, MEMPROF_INTERVAL_MS,
+    FP_BAUDRATE,
+};
+
+// active trỏ tới bank đang được đọc, bank còn lại là chỗ ghi của giao dịch
+static AppSettings_t bank[2];
+static const AppSettings_t *volatile active = &bank[0];
+static AppSettings_t *staging = NULL;
+static AppSettings_t stored; // bản trong NVS: giá trị quay về khi thử WiFi / MQTT thất bại
+
+static uint32_t rev = 0;
+static uint32_t trial_groups = 0;
+static uint32_t pending_groups = 0; // đã commit, chưa báo callback
+static TimerHandle_t trial_timer = NULL;
+static SemaphoreHandle_t cfg_mutex = NULL; // một người ghi tại một thời điểm
+static config_change_cb_t change_cb = nullptr;
+
+/* ===== FIELD ===== */
+static const ConfigField_t *field_find(const char *key)
+{
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++)
+        if (strcmp(fields[i].key, key) == 0)
+            return &fields[i];
+    return NULL;
+}
+
+static void *field_ptr(const AppSettings_t *s, const ConfigField_t *f)
+{
+    return (uint8_t *)s + f->offset;
+}
+
+static uint32_t field_u32(const AppSettings_t *s, const ConfigField_t *f)
+{
+    if (f->type == CFG_T_U16)
+        return *(uint16_t *)field_ptr(s, f);
+    return *(uint32_t *)field_ptr(s, f);
+}
+
+static bool field_equal(const AppSettings_t *a, const AppSettings_t *b, const ConfigField_t *f)
+{
+    if (f->type == CFG_T_STR)
+        return strcmp((const char *)field_ptr(a, f), (const char *)field_ptr(b, f)) == 0;
+    return field_u32(a, f) == field_u32(b, f);
+}
+
+static void field_copy(AppSettings_t *dst, const AppSettings_t *src, const ConfigField_t *f)
+{
+    memcpy(field_ptr(dst, f), field_ptr(src, f), f->size);
+}
+
+static const char *check_str(const ConfigField_t *f, const char *value)
+{
+    size_t n = strlen(value);
+    if (n < f->min)
+        return "too_short";
+    if (n >= f->size)
+        return "too_long";
+    return NULL;
+}
+
+static const char *check_u32(const ConfigField_t *f, uint32_t value)
+{
+    if (value < f->min || value > f->max)
+        return "out_of_range";
+    // AS608: baud = 9600 * N, N = 1..12
+    if (f->offset == offsetof(AppSettings_t, fp_baud) && value % 9600 != 0)
+        return "not_multiple_of_9600";
+    return NULL;
+}
+
+static void field_set_u32(AppSettings_t *s, const ConfigField_t *f, uint32_t value)
+{
+    if (f->type == CFG_T_U16)
+        *(uint16_t *)field_ptr(s, f) = value;
+    else
+        *(uint32_t *)field_ptr(s, f) = value;
+}
+
+/* ===== NVS ===== */
+static void field_load(Preferences &prefs, AppSettings_t *s, const ConfigField_t *f)
+{
+    if (!prefs.isKey(f->key))
+        return;
+    const char *err;
+    if (f->type == CFG_T_STR)
+    {
+        char buf[72];
+        size_t n = prefs.getString(f->key, buf, sizeof(buf));
+        buf[n < sizeof(buf) ? n : sizeof(buf) - 1] = '\0';
+        err = n ? check_str(f, buf) : "unreadable";
+        if (err == NULL)
+            strcpy((char *)field_ptr(s, f), buf);
+    }
+    else
+    {
+        uint32_t v = prefs.getUInt(f->key, 0);
+        err = check_u32(f, v);
+        if (err == NULL)
+            field_set_u32(s, f, v);
+    }
+    if (err)
+        LOG_W("[CFG] Stored %s invalid (%s), using default", f->key, err);
+}
+
+static void field_store(Preferences &prefs, const AppSettings_t *s, const ConfigField_t *f)
+{
+    // Bằng mặc định: xoá key, firmware sau đổi mặc định thì thiết bị theo
+    bool is_default = field_equal(s, &defaults, f);
+    if (is_default)
+        prefs.remove(f->key);
+    else if (f->type == CFG_T_STR)
+        prefs.putString(f->key, (const char *)field_ptr(s, f));
+    else
+        prefs.putUInt(f->key, field_u32(s, f));
+}
+
+// Ghi các field thuộc groups từ s vào NVS và vào stored
+static void persist_groups(const AppSettings_t *s, uint32_t groups)
+{
+    Preferences prefs;
+    if (!prefs.begin("cfg", false))
+    {
+        LOG_E("[CFG] NVS open failed, change kept in RAM only");
+        return;
+    }
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++)
+    {
+        const ConfigField_t *f = &fields[i];
+        if (!(f->group & groups) || field_equal(s, &stored, f))
+            continue;
+        field_store(prefs, s, f);
+        field_copy(&stored, s, f);
+    }
+    prefs.putUInt("rev", rev);
+    prefs.end();
+}
+
+/* ===== ĐỔI BANK ===== */
+static uint32_t diff_groups(const AppSettings_t *a, const AppSettings_t *b)
+{
+    uint32_t groups = 0;
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++)
+        if (!field_equal(a, b, &fields[i]))
+            groups |= fields[i].group;
+    return groups;
+}
+
+static AppSettings_t *inactive_bank(void)
+{
+    return active == &bank[0] ? &bank[1] : &bank[0];
+}
+
+// Hết hạn thử: đưa nhóm WiFi / MQTT về bản trong NVS (chạy trong timer daemon)
+static void trial_expired(TimerHandle_t t)
+{
+    (void)t;
+    if (xSemaphoreTake(cfg_mutex, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        xTimerChangePeriod(trial_timer, pdMS_TO_TICKS(1000), 0); // giao dịch đang chạy: thử lại sau
+        return;
+    }
+    uint32_t groups = trial_groups;
+    AppSettings_t *next = inactive_bank();
+    *next = *active;
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++)
+        if (fields[i].group & groups)
+            field_copy(next, &stored, &fields[i]);
+    trial_groups = 0;
+    rev++;
+    persist_groups(next, 0);
+    active = next;
+    xSemaphoreGive(cfg_mutex);
+
+    LOG_W("[CFG] No broker within %lu s, network settings reverted (rev %lu)",
+          (unsigned long)(CONFIG_NET_TRIAL_MS / 1000), (unsigned long)rev);
+    if (change_cb && groups)
+        change_cb(groups);
+}
+
+/* ===== JSON ===== */
+typedef struct
+{
+    char *buf;
+    size_t len;
+    size_t pos;
+} JsonOut_t;
+
+static void out_printf(JsonOut_t *o, const char *fmt, ...)
+{
+    if (o->pos >= o->len)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->pos, o->len - o->pos, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        o->pos = min(o->pos + n, o->len - 1);
+}
+
+static void out_str(JsonOut_t *o, const char *s)
+{
+    out_printf(o, "\"");
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            out_printf(o, "\\%c", *s);
+        else if ((uint8_t)*s < 0x20)
+            out_printf(o, "\\u%04x", (uint8_t)*s);
+        else
+            out_printf(o, "%c", *s);
+    }
+    out_printf(o, "\"");
+}
+
+/* ===== API ===== */
+void config_init(void)
+{
+    cfg_mutex = xSemaphoreCreateMutex();
+    trial_timer = xTimerCreate("cfg_trial", pdMS_TO_TICKS(CONFIG_NET_TRIAL_MS), pdFALSE, NULL, trial_expired);
+
+    bank[0] = defaults;
+    Preferences prefs;
+    if (prefs.begin("cfg", false))
+    {
+        for (size_t i = 0; i < CFG_FIELD_COUNT; i++)
+            field_load(prefs, &bank[0], &fields[i]);
+        rev = prefs.getUInt("rev", 0);
+        // Key lưu theo tên field: field mới lấy mặc định, field bỏ đi bị bỏ qua
+        uint16_t schema = prefs.getUShort("schema", 0);
+        if (schema != CONFIG_SCHEMA_VERSION)
+        {
+            if (schema)
+                LOG_I("[CFG] Schema %u -> %u", schema, CONFIG_SCHEMA_VERSION);
+            prefs.putUShort("schema", CONFIG_SCHEMA_VERSION);
+        }
+        prefs.end();
+    }
+    stored = bank[0];
+    active = &bank[0];
+
+    unsigned changed = 0;
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++)
+        changed += !field_equal(&bank[0], &defaults, &fields[i]);
+    LOG_I("[CFG] Loaded rev %lu, %u field(s) differ from defaults", (unsigned long)rev, changed);
+}
+
+void config_register_change_callback(config_change_cb_t cb)
+{
+    change_cb = cb;
+}
+
+const AppSettings_t *config_get(void)
+{
+    return active;
+}
+
+uint32_t config_revision(void)
+{
+    return rev;
+}
+
+bool config_begin(void)
+{
+    if (xSemaphoreTake(cfg_mutex, pdMS_TO_TICKS(1000)) != pdTRUE)
+        return false;
+    staging = inactive_bank();
+    *staging = *active;
+    return true;
+}
+
+const char *config_stage_str(const char *key, const char *value)
+{
+    const ConfigField_t *f = field_find(key);
+    if (f == NULL)
+        return "unknown_key";
+    if (f->type != CFG_T_STR)
+        return "expected_number";
+    const char *err = check_str(f, value);
+    if (err == NULL)
+        strcpy((char *)field_ptr(staging, f), value);
+    return err;
+}
+
+const char *config_stage_u32(const char *key, uint32_t value)
+{
+    const ConfigField_t *f = field_find(key);
+    if (f == NULL)
+        return "unknown_key";
+    if (f->type == CFG_T_STR)
+        return "expected_string";
+    const char *err = check_u32(f, value);
+    if (err == NULL)
+        field_set_u32(staging, f, value);
+    return err;
+}
+
+const char *config_stage_json(JsonObjectConst set, const char **err_key)
+{
+    for (JsonPairConst kv : set)
+    {
+        JsonVariantConst v = kv.value();
+        const char *err;
+        if (v.is<const char *>())
+            err = config_stage_str(kv.key().c_str(), v.as<const char *>());
+        else if (v.is<uint32_t>())
+            err = config_stage_u32(kv.key().c_str(), v.as<uint32_t>());
+        else
+            err = "bad_type";
+        if (err)
+        {
+            *err_key = kv.key().c_str();
+            return err;
+        }
+    }
+    return NULL;
+}
+
+void config_stage_defaults(void)
+{
+    *staging = defaults;
+}
+
+void config_abort(void)
+{
+    staging = NULL;
+    xSemaphoreGive(cfg_mutex);
+}
+
+size_t config_commit(char *out, size_t len)
+{
+    JsonOut_t o = {out, len, 0};
+    if (staging->hb_min_ms > staging->hb_max_ms)
+    {
+        out_printf(&o, "{\"rev\":%lu,\"err\":\"hb_min_ms > hb_max_ms\"}", (unsigned long)rev);
+        config_abort();
+        return o.pos;
+    }
+
+    out_printf(&o, "{\"changed\":[");
+    bool first = true;
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++)
+    {
+        if (field_equal(staging, active, &fields[i]))
+            continue;
+        out_printf(&o, first ? "\"%s\"" : ",\"%s\"", fields[i].key);
+        first = false;
+    }
+    out_printf(&o, "]");
+
+    uint32_t groups = diff_groups(staging, active);
+    if (groups)
+    {
+        rev++;
+        // Nhóm thử chỉ nằm trong RAM tới config_confirm; nhóm khác ghi ngay
+        uint32_t trial = groups & CFG_TRIAL_GROUPS;
+        persist_groups(staging, groups & ~CFG_TRIAL_GROUPS);
+        if (trial)
+        {
+            trial_groups |= trial;
+            xTimerChangePeriod(trial_timer, pdMS_TO_TICKS(CONFIG_NET_TRIAL_MS), 0); // cũng start lại timer
+            out_printf(&o, ",\"trial_s\":%lu", (unsigned long)(CONFIG_NET_TRIAL_MS / 1000));
+        }
+        if (groups & CFG_GROUP_REBOOT)
+            out_printf(&o, ",\"reboot\":true");
+        active = staging;
+    }
+    out_printf(&o, ",\"rev\":%lu}", (unsigned long)rev);
+    staging = NULL;
+    xSemaphoreGive(cfg_mutex);
+
+    if (groups)
+        LOG_I("[CFG] Rev %lu applied, groups 0x%02lx", (unsigned long)rev, (unsigned long)groups);
+    pending_groups |= groups;
+    return o.pos;
+}
+
+void config_notify(void)
+{
+    uint32_t groups = pending_groups;
+    pending_groups = 0;
+    if (change_cb && groups)
+        change_cb(groups);
+}
+
+void config_confirm(void)
+{
+    if (trial_groups == 0)
+        return;
+    if (xSemaphoreTake(cfg_mutex, pdMS_TO_TICKS(1000)) != pdTRUE)
+        return; // lần kết nối sau sẽ xác nhận
+    xTimerStop(trial_timer, 0);
+    persist_groups(active, trial_groups);
+    trial_groups = 0;
+    xSemaphoreGive(cfg_mutex);
+    LOG_I("[CFG] Network settings confirmed (rev %lu)", (unsigned long)rev);
+}
+
+size_t config_to_json(char *out, size_t len)
+{
+    JsonOut_t o = {out, len, 0};
+    const AppSettings_t *s = config_get();
+    out_printf(&o, "{\"rev\":%lu,\"schema\":%u,\"trial\":%s,\"cfg\":{", (unsigned long)rev,
+               CONFIG_SCHEMA_VERSION, trial_groups ? "true" : "false");
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++)
+    {
+        const ConfigField_t *f = &fields[i];
+        out_printf(&o, i ? ",\"%s\":" : "\"%s\":", f->key);
+        if (f->flags & CFG_F_SECRET)
+            out_str(&o, "***");
+        else if (f->type == CFG_T_STR)
+            out_str(&o, (const char *)field_ptr(s, f));
+        else
+            out_printf(&o, "%lu", (unsigned long)field_u32(s, f));
+    }
+    out_printf(&o, "}}");
+    return o.pos;
+}
@@ -0,0 +1,94 @@
+#ifndef CONFIG_STORE_H_
+#define CONFIG_STORE_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ================== CẤU HÌNH RUNTIME (NVS) ==================
+// Các thông số vận hành trước đây là #define trong app_config.h (WiFi, broker,
+// timeout cửa, chu kỳ heartbeat...) nay nằm trong một struct cache trong RAM.
+// Macro trong app_config.h chỉ còn là giá trị mặc định; giá trị đã đổi qua
+// MQTT (config_set) được lưu từng key trong NVS namespace "cfg".
+//
+// Đọc: config_get()->field, O(1), không khoá. Cache có 2 bank: thay đổi được
+// ghi vào bank không dùng rồi đổi con trỏ một lần, nên người đọc luôn thấy một
+// bản đầy đủ. Đọc field ngay, không giữ con trỏ qua nhiều chu kỳ của task.
+//
+// Áp dụng: sau commit, config_notify() gọi callback với mask CFG_GROUP_* vừa đổi
+// (main.cpp gọi network / mqtt / timesync reconfigure). Field CFG_GROUP_REBOOT
+// chỉ có hiệu lực sau khi khởi động lại.
+//
+// WiFi / MQTT là thay đổi "thử": chỉ ghi NVS khi thiết bị kết nối lại được
+// broker (config_confirm). Không lên được trong CONFIG_NET_TRIAL_MS thì quay về
+// giá trị cũ, khởi động lại trước đó cũng dùng giá trị cũ.
+
+typedef enum
+{
+    CFG_GROUP_WIFI = 1 << 0,
+    CFG_GROUP_MQTT = 1 << 1,
+    CFG_GROUP_TIME = 1 << 2,
+    CFG_GROUP_DOOR = 1 << 3,
+    CFG_GROUP_TELEMETRY = 1 << 4,
+    CFG_GROUP_REBOOT = 1 << 5, // cần khởi động lại (baud cảm biến)
+} ConfigGroup_t;
+
+typedef struct
+{
+    // CFG_GROUP_WIFI
+    char wifi_ssid[33];
+    char wifi_pass[65];
+    // CFG_GROUP_MQTT
+    char mqtt_host[64];
+    uint16_t mqtt_port;
+    char mqtt_user[33];
+    char mqtt_pass[65];
+    char mqtt_base[40]; // topic base, + "/" + client_id phải vừa topic_prefix[64]
+    uint16_t mqtt_keepalive_s;
+    // CFG_GROUP_TIME
+    char ntp_server[48];
+    // CFG_GROUP_DOOR
+    uint32_t auto_lock_ms;
+    uint32_t held_open_ms;
+    // CFG_GROUP_TELEMETRY
+    uint32_t hb_min_ms;
+    uint32_t hb_max_ms;
+    uint32_t memprof_ms;
+    // CFG_GROUP_REBOOT
+    uint32_t fp_baud;
+} AppSettings_t;
+
+// Gọi trong task đã commit (MqttControlTask) hoặc timer daemon (quay về giá trị
+// cũ): chỉ đánh thức task liên quan, không làm việc nặng
+typedef void (*config_change_cb_t)(uint32_t groups);
+
+// Gọi đầu setup(), trước mọi module đọc cấu hình
+void config_init(void);
+void config_register_change_callback(config_change_cb_t cb);
+
+const AppSettings_t *config_get(void);
+// Tăng mỗi lần commit, lưu trong NVS; backend so với "cfg_rev" trong heartbeat
+uint32_t config_revision(void);
+
+// Giao dịch: begin -> stage từng key -> commit (hoặc abort). Stage trả NULL nếu
+// hợp lệ, ngược lại là mô tả lỗi; có lỗi thì không commit gì.
+bool config_begin(void);
+const char *config_stage_str(const char *key, const char *value);
+const char *config_stage_u32(const char *key, uint32_t value);
+// Stage mọi key của object "set" trong config_set (MQTT hoặc console provisioning).
+// Dừng ở key lỗi đầu tiên: trả mô tả lỗi, *err_key = key đó.
+const char *config_stage_json(JsonObjectConst set, const char **err_key);
+// Về mặc định của firmware (app_config.h)
+void config_stage_defaults(void);
+// Ghi NVS, đổi bank. out: {"changed":[...],"trial_s":S,"reboot":true,"rev":N}
+size_t config_commit(char *out, size_t len);
+void config_abort(void);
+// Gọi callback cho các nhóm vừa commit. Tách khỏi commit để trả lời kịp đi ra
+// trước khi MQTT / WiFi kết nối lại với cấu hình mới.
+void config_notify(void);
+
+// Kết nối broker thành công: giữ thay đổi WiFi / MQTT đang thử
+void config_confirm(void);
+// {"rev":N,"schema":S,"trial":bool,"cfg":{...}}, mật khẩu thay bằng "***"
+size_t config_to_json(char *out, size_t len);
+
+#endif // CONFIG_STORE_H_
@@ -0,0 +1,104 @@
+#include "cpu_load.h"
+#include "app_config.h"
+
+#include <esp_timer.h>
+#include <esp_freertos_hooks.h>
+
+// Một vòng idle (hook + reset WDT) tốn ~1-3 µs; khoảng cách lớn hơn là bị chiếm
+#define CPU_LOAD_GAP_US 20
+
+typedef struct
+{
+    uint32_t last_us;      // lần gọi hook trước
+    uint32_t win_start_us; // đầu cửa sổ hiện tại
+    uint32_t idle_us;      // idle cộng dồn trong cửa sổ hiện tại
+    volatile int8_t load;  // % cửa sổ trước, -1 = chưa có
+    volatile int8_t peak;
+} CoreLoad_t;
+
+static CoreLoad_t cores[CPU_LOAD_CORES];
+
+// Chỉ idle task của core đó ghi, core kia chỉ đọc các field 32 / 8 bit
+static inline void cpu_load_tick(CoreLoad_t *c)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint32_t gap = now - c->last_us;
+    c->last_us = now;
+    if (gap < CPU_LOAD_GAP_US)
+        c->idle_us += gap;
+
+    uint32_t span = now - c->win_start_us;
+    if (span >= CPU_LOAD_WINDOW_MS * 1000UL)
+    {
+        uint32_t idle = c->idle_us < span ? c->idle_us : span;
+        int8_t load = (int8_t)(100 - (uint64_t)idle * 100 / span);
+        c->load = load;
+        if (load > c->peak)
+            c->peak = load;
+        c->idle_us = 0;
+        c->win_start_us = now;
+    }
+}
+
+static bool cpu_load_idle_hook_0(void)
+{
+    cpu_load_tick(&cores[0]);
+    return false; // không WAITI: gọi lại ngay ở vòng idle kế tiếp
+}
+
+static bool cpu_load_idle_hook_1(void)
+{
+    cpu_load_tick(&cores[1]);
+    return false;
+}
+
+void cpu_load_init(void)
+{
+#if CPU_LOAD_ENABLED
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    for (int i = 0; i < CPU_LOAD_CORES; i++)
+    {
+        cores[i].last_us = now;
+        cores[i].win_start_us = now;
+        cores[i].load = -1;
+        cores[i].peak = -1;
+    }
+    esp_register_freertos_idle_hook_for_cpu(cpu_load_idle_hook_0, 0);
+    esp_register_freertos_idle_hook_for_cpu(cpu_load_idle_hook_1, 1);
+#endif
+}
+
+int cpu_load_percent(int core)
+{
+#if CPU_LOAD_ENABLED
+    if (core < 0 || core >= CPU_LOAD_CORES)
+        return -1;
+    // Core bận 100% thì idle task không chạy để đóng cửa sổ: tính từ phần đang dở
+    CoreLoad_t *c = &cores[core];
+    uint32_t span = (uint32_t)esp_timer_get_time() - c->win_start_us;
+    if (span > 2 * CPU_LOAD_WINDOW_MS * 1000UL)
+    {
+        uint32_t idle = c->idle_us < span ? c->idle_us : span;
+        return 100 - (int)((uint64_t)idle * 100 / span);
+    }
+    return c->load;
+#else
+    return -1;
+#endif
+}
+
+int cpu_load_take_peak(int core)
+{
+#if CPU_LOAD_ENABLED
+    if (core < 0 || core >= CPU_LOAD_CORES)
+        return -1;
+    int peak = cores[core].peak;
+    int now = cpu_load_percent(core);
+    if (now > peak)
+        peak = now;
+    cores[core].peak = cores[core].load;
+    return peak;
+#else
+    return -1;
+#endif
+}
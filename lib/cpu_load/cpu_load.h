@@ -0,0 +1,23 @@
+#ifndef CPU_LOAD_H_
+#define CPU_LOAD_H_
+
+#include <Arduino.h>
+
+// ================== TẢI CPU THEO CORE ==================
+// Idle hook của từng core trả false nên idle task không WAITI mà gọi hook liên
+// tục; hai lần gọi liền nhau cách vài µs. Khoảng cách lớn hơn CPU_LOAD_GAP_US
+// nghĩa là có task / ISR khác chiếm core, phần còn lại cộng vào thời gian idle.
+// Không cần configGENERATE_RUN_TIME_STATS (tắt trong core Arduino).
+// Tắt bằng CPU_LOAD_ENABLED 0 trong app_config.
+
+#define CPU_LOAD_CORES 2
+
+// Đăng ký idle hook cho cả hai core
+void cpu_load_init(void);
+
+// % tải của cửa sổ CPU_LOAD_WINDOW_MS gần nhất, -1 nếu không đo
+int cpu_load_percent(int core);
+// % lớn nhất từ lần gọi trước (heartbeat), -1 nếu không đo
+int cpu_load_take_peak(int core);
+
+#endif // CPU_LOAD_H_
@@ -0,0 +1,142 @@
+#include "device_state.h"
+#include "app_config.h"
+#include "app_queue.h"
+
+static DeviceState_t state = {DOOR_STATE_LOCKED, DOOR_CLOSED, true, false, -1, TIME_Q_NONE};
+static uint16_t dirty = STATE_F_ALL; // lần publish đầu sau boot gửi đủ mọi field
+static bool queued = false;          // đã có EVT_STATE_CHANGED nằm trong queue
+static uint32_t version = 0;
+static portMUX_TYPE state_mux = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t _report_queue = NULL;
+
+// Gọi ngoài critical section: gửi event nếu chưa có event nào chờ
+static void state_notify(void)
+{
+    bool send = false;
+    portENTER_CRITICAL(&state_mux);
+    if (dirty && !queued && _report_queue)
+    {
+        queued = true;
+        send = true;
+    }
+    portEXIT_CRITICAL(&state_mux);
+    if (!send)
+        return;
+
+    SystemEvent_t evt = {};
+    evt.type = EVT_STATE_CHANGED;
+    if (app_queue_send(_report_queue, &evt, 0) != pdTRUE)
+    {
+        // Queue đầy: lần thay đổi sau thử lại
+        portENTER_CRITICAL(&state_mux);
+        queued = false;
+        portEXIT_CRITICAL(&state_mux);
+    }
+}
+
+#define STATE_SET(field, bit, value)    \
+    do                                  \
+    {                                   \
+        portENTER_CRITICAL(&state_mux); \
+        if (state.field != (value))     \
+        {                               \
+            state.field = (value);      \
+            dirty |= (bit);             \
+        }                               \
+        portEXIT_CRITICAL(&state_mux);  \
+        state_notify();                 \
+    } while (0)
+
+void device_state_init(QueueHandle_t report_queue)
+{
+    _report_queue = report_queue;
+    state_notify();
+}
+
+void device_state_set_door(DoorFSMState_t door)
+{
+    STATE_SET(door, STATE_F_DOOR, door);
+}
+
+void device_state_set_sensor(DoorOpenState_t open)
+{
+    STATE_SET(sensor, STATE_F_SENSOR, open);
+}
+
+void device_state_set_scan(bool enabled)
+{
+    STATE_SET(scan, STATE_F_SCAN, enabled);
+}
+
+void device_state_set_fp(bool ok, int16_t templates)
+{
+    portENTER_CRITICAL(&state_mux);
+    if (state.fp_ok != ok)
+    {
+        state.fp_ok = ok;
+        dirty |= STATE_F_FP;
+    }
+    if (templates >= 0 && state.templates != templates)
+    {
+        state.templates = templates;
+        dirty |= STATE_F_TPL;
+    }
+    portEXIT_CRITICAL(&state_mux);
+    state_notify();
+}
+
+void device_state_set_tq(TimeSyncQuality_t tq)
+{
+    STATE_SET(tq, STATE_F_TQ, tq);
+}
+
+void device_state_mark_all(void)
+{
+    portENTER_CRITICAL(&state_mux);
+    dirty = STATE_F_ALL;
+    portEXIT_CRITICAL(&state_mux);
+    state_notify();
+}
+
+uint16_t device_state_take(DeviceState_t *out, uint32_t *v)
+{
+    portENTER_CRITICAL(&state_mux);
+    uint16_t fields = dirty;
+    dirty = 0;
+    queued = false;
+    *out = state;
+    if (fields)
+        version++;
+    *v = version;
+    portEXIT_CRITICAL(&state_mux);
+    return fields;
+}
+
+void device_state_restore(uint16_t fields)
+{
+    portENTER_CRITICAL(&state_mux);
+    dirty |= fields;
+    portEXIT_CRITICAL(&state_mux);
+}
+
+size_t device_state_to_json(const DeviceState_t *s, uint16_t fields, uint32_t v, char *buf, size_t len)
+{
+    size_t n = snprintf(buf, len, "{\"v\":%lu", (unsigned long)v);
+    if ((fields & STATE_F_DOOR) && n < len)
+        n += snprintf(buf + n, len - n, ",\"door\":\"%s\"", door_state_to_str(s->door));
+    if ((fields & STATE_F_SENSOR) && n < len)
+        n += snprintf(buf + n, len - n, ",\"sensor\":\"%s\"", s->sensor == DOOR_OPEN ? "open" : "closed");
+    if ((fields & STATE_F_SCAN) && n < len)
+        n += snprintf(buf + n, len - n, ",\"scan\":%d", s->scan ? 1 : 0);
+    if ((fields & STATE_F_FP) && n < len)
+        n += snprintf(buf + n, len - n, ",\"fp\":%d", s->fp_ok ? 1 : 0);
+    if ((fields & STATE_F_TPL) && n < len)
+        n += snprintf(buf + n, len - n, ",\"tpl\":%d", s->templates);
+    if ((fields & STATE_F_TQ) && n < len)
+        n += snprintf(buf + n, len - n, ",\"tq\":\"%s\"", timesync_quality_to_str(s->tq));
+    if ((fields & STATE_F_FW) && n < len)
+        n += snprintf(buf + n, len - n, ",\"fw\":\"%s\"", FW_VERSION);
+    if (n < len)
+        n += snprintf(buf + n, len - n, "}");
+    return n < len ? n : 0;
+}
@@ -0,0 +1,62 @@
+#ifndef DEVICE_STATE_H_
+#define DEVICE_STATE_H_
+
+#include <Arduino.h>
+#include "door.h"
+#include "timesync.h"
+
+// ================== DEVICE STATE SNAPSHOT ==================
+// Ảnh chụp nhỏ gọn trạng thái thiết bị. Module sở hữu từng field (door,
+// fingerprint, timesync) gọi setter khi giá trị đổi; setter chỉ đánh dấu field
+// và gửi MỘT EVT_STATE_CHANGED cho tới khi task MQTT lấy đi, nên nhiều thay đổi
+// liên tiếp gộp thành một lần publish:
+//   .../state        (retained) toàn bộ snapshot, client mới subscribe nhận ngay
+//   .../state/delta  chỉ các field vừa đổi
+// Cả hai có "v" tăng dần từ lúc boot; delta đầu tiên sau boot / kết nối lại chứa
+// mọi field. Dashboard không cần gửi device_get_status để biết trạng thái.
+
+typedef enum
+{
+    STATE_F_DOOR = 1 << 0,   // FSM chốt
+    STATE_F_SENSOR = 1 << 1, // cảm biến cửa
+    STATE_F_SCAN = 1 << 2,   // đang cho phép quét vân tay
+    STATE_F_FP = 1 << 3,     // cảm biến vân tay phản hồi
+    STATE_F_TPL = 1 << 4,    // số mẫu vân tay đã lưu
+    STATE_F_TQ = 1 << 5,     // chất lượng đồng hồ (NTP)
+    STATE_F_FW = 1 << 6,     // phiên bản firmware
+    STATE_F_ALL = (1 << 7) - 1
+} DeviceStateField_t;
+
+typedef struct
+{
+    DoorFSMState_t door;
+    DoorOpenState_t sensor;
+    bool scan;
+    bool fp_ok;
+    int16_t templates; // -1 = chưa đọc được
+    TimeSyncQuality_t tq;
+} DeviceState_t;
+
+// report_queue nhận EVT_STATE_CHANGED (system_evt_queue). Setter gọi trước
+// init chỉ đánh dấu field, init gửi event nếu đã có thay đổi.
+void device_state_init(QueueHandle_t report_queue);
+
+void device_state_set_door(DoorFSMState_t state);
+void device_state_set_sensor(DoorOpenState_t open);
+void device_state_set_scan(bool enabled);
+void device_state_set_fp(bool ok, int16_t templates);
+void device_state_set_tq(TimeSyncQuality_t tq);
+// Đánh dấu mọi field (sau khi kết nối lại broker: retained có thể đã cũ)
+void device_state_mark_all(void);
+
+// Task MQTT: lấy snapshot + các field đã đổi (xoá đánh dấu), *version = v mới.
+// Trả về 0 nếu không có gì đổi.
+uint16_t device_state_take(DeviceState_t *out, uint32_t *version);
+// Publish thất bại: đánh dấu lại các field để lần sau gửi tiếp
+void device_state_restore(uint16_t fields);
+
+// {"v":12,"door":"locked","sensor":"closed","scan":1,"fp":1,"tpl":37,"tq":"ntp","fw":"1.0.0"}
+// chỉ gồm các field có bit trong fields. Trả về độ dài, 0 nếu buf không đủ.
+size_t device_state_to_json(const DeviceState_t *s, uint16_t fields, uint32_t version, char *buf, size_t len);
+
+#endif // DEVICE_STATE_H_
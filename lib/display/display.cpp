@@ -1,10 +1,189 @@
 #include "display.h"
+#include "lcd_shadow.h"
+#include "lcd_glyph.h"
+#include "network.h"
+#include "mqtt.h"
+#include "door.h"
+#include "app_queue.h"
+#include "trace.h"
+#include "log.h"
+#include <time.h>
 
 LiquidCrystal_I2C lcd(LCD_ADDR, LCD_COLS, LCD_ROWS);
-QueueHandle_t lcd_queue;
+
+// ================== MAILBOX ==================
+// Mỗi loại LcdMessageType_t có 1 slot: tin mới cùng loại ghi đè tin cũ
+// (coalesce), TaskLCD luôn lấy slot ưu tiên cao nhất. Không bao giờ bị đầy.
+#define LCD_MSG_TYPE_COUNT (LCD_MSG_DOOR_OPEN + 1)
+
+struct LcdSlot_t
+{
+  bool pending;
+  unsigned long posted_at;
+  LcdEvent_t evt;
+};
+
+static LcdSlot_t lcd_slots[LCD_MSG_TYPE_COUNT];
+static portMUX_TYPE lcd_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t lcd_task = NULL;
+static LcdQueueStats_t queue_stats;
+
+static LcdShadow<LiquidCrystal_I2C, LCD_COLS, LCD_ROWS> shadow(lcd);
+static LcdGlyphCache<LiquidCrystal_I2C> glyphs(lcd);
+static LcdRenderStats_t render_stats;
+
+// Cửa sổ đo lưu lượng I2C khi ở màn hình chờ
+static unsigned long idle_window_start = 0;
+static uint32_t idle_window_bytes = 0;
+
+void display_get_stats(LcdRenderStats_t *out)
+{
+  *out = render_stats; // chỉ TaskLCD ghi, đọc lệch 1 frame cũng không sao
+}
+
+void display_get_queue_stats(LcdQueueStats_t *out)
+{
+  portENTER_CRITICAL(&lcd_mux);
+  *out = queue_stats;
+  portEXIT_CRITICAL(&lcd_mux);
+}
+
+// Mức ưu tiên: lỗi > thành công > cửa mở > thông tin > chờ
+static uint8_t lcd_msg_priority(LcdMessageType_t type)
+{
+  switch (type)
+  {
+  case LCD_MSG_ERROR:
+    return 4;
+  case LCD_MSG_SUCCESS:
+    return 3;
+  case LCD_MSG_DOOR_OPEN:
+    return 2;
+  case LCD_MSG_INFO:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+// Flush shadow buffer và cộng dồn thống kê. extra_bytes: I2C đã tốn ngoài
+// flush (nạp glyph), legacy_bytes: chi phí tương đương nếu vẽ kiểu cũ.
+static uint32_t lcd_flush_frame(uint32_t extra_bytes, uint32_t legacy_bytes)
+{
+  const LcdFrameStats_t &f = shadow.flush();
+  uint32_t bytes = f.i2c_bytes + extra_bytes;
+  if (bytes == 0)
+    return 0; // không có gì thay đổi, không tính là 1 frame
+
+  render_stats.frames++;
+  render_stats.i2c_bytes += bytes;
+  render_stats.legacy_i2c_bytes += legacy_bytes;
+  render_stats.us_total += f.us;
+  render_stats.last_i2c_bytes = bytes;
+  render_stats.last_us = f.us;
+
+  LOG_D("[LCD] frame: %u cells, %u moves, %u B (legacy %u B), %u us",
+        f.cells, f.cursor_moves, (unsigned)bytes, (unsigned)legacy_bytes, (unsigned)f.us);
+  return bytes;
+}
+
+// Vẽ 2 dòng qua shadow buffer: chỉ ghi các ô thay đổi, không lcd.clear()
+static void lcd_render(const char *l1, const char *l2)
+{
+  TRACE_BEGIN(TRACE_SPAN_LCD_FLUSH);
+  shadow.set_line(0, l1);
+  shadow.set_line(1, l2);
+  lcd_flush_frame(0, shadow.legacy_i2c_bytes(l1, l2));
+  TRACE_END(TRACE_SPAN_LCD_FLUSH);
+}
+
+// Đặt glyph vào ô (col,row), ghim slot cho frame hiện tại
+static uint32_t lcd_put_glyph(uint8_t col, uint8_t row, LcdGlyph_t g, uint8_t *pinned)
+{
+  bool loaded;
+  uint8_t code = glyphs.acquire(g, *pinned, &loaded);
+  *pinned |= 1 << code;
+  shadow.put(col, row, code);
+  if (!loaded)
+    return 0;
+
+  // createChar để địa chỉ ở CGRAM. Ô giữ mã slot vừa nạp không cần vẽ lại: LCD
+  // hiện theo CGRAM mới ngay, và slot đang dùng trong frame này đã bị ghim
+  shadow.invalidate_cursor();
+  render_stats.glyph_loads++;
+  return glyphs.load_i2c_bytes();
+}
+
+// ================== IDLE SCREEN ==================
+// "HH:MM:SS     W M D" / "Please Scan..."
+// Gọi mỗi vòng TaskLCD; shadow buffer đảm bảo mỗi giây chỉ ghi các chữ số đổi.
+static void lcd_render_idle(unsigned long now)
+{
+  char clock_buf[LCD_COLS + 1];
+  time_t t = time(nullptr);
+  bool synced = t > 1600000000; // trước 2020 = chưa đồng bộ NTP
+  if (synced)
+  {
+    struct tm tm_now;
+    localtime_r(&t, &tm_now);
+    strftime(clock_buf, sizeof(clock_buf), "%H:%M:%S", &tm_now);
+  }
+  else
+  {
+    strcpy(clock_buf, "--:--:--");
+  }
+  shadow.set_line(0, clock_buf);
+  shadow.set_line(1, "Please Scan...");
+
+  LcdGlyph_t wifi = GLYPH_WIFI_OFF;
+  if (network_is_connected())
+    wifi = (network_get_rssi() < LCD_WIFI_WEAK_RSSI) ? GLYPH_WIFI_WEAK : GLYPH_WIFI_STRONG;
+
+  LcdGlyph_t door;
+  switch (door_get_state())
+  {
+  case DOOR_STATE_UNLOCKED_WAIT_OPEN:
+    door = GLYPH_UNLOCKED;
+    break;
+  case DOOR_STATE_OPEN:
+    door = GLYPH_DOOR_OPEN;
+    break;
+  case DOOR_STATE_FORCED_OPEN:
+    door = GLYPH_ALARM;
+    break;
+  default:
+    door = GLYPH_LOCKED;
+    break;
+  }
+
+  uint8_t pinned = 0;
+  uint32_t extra = 0;
+  if (!synced)
+    extra += lcd_put_glyph(9, 0, GLYPH_HOURGLASS, &pinned);
+  extra += lcd_put_glyph(LCD_COLS - 3, 0, wifi, &pinned);
+  extra += lcd_put_glyph(LCD_COLS - 2, 0, mqtt_is_connected() ? GLYPH_MQTT_ON : GLYPH_MQTT_OFF, &pinned);
+  extra += lcd_put_glyph(LCD_COLS - 1, 0, door, &pinned);
+
+  // Cách cũ sẽ phải clear + viết lại cả 2 dòng mỗi lần cập nhật
+  uint32_t legacy = shadow.legacy_i2c_bytes("0123456789ABCDEF", "Please Scan...");
+  uint32_t bytes = lcd_flush_frame(extra, legacy);
+
+  idle_window_bytes += bytes;
+  if (now - idle_window_start >= 60000)
+  {
+    render_stats.idle_i2c_per_min = idle_window_bytes;
+    LOG_D("[LCD] Idle I2C traffic: %u B/min (%u glyph loads total)",
+          (unsigned)idle_window_bytes, (unsigned)render_stats.glyph_loads);
+    idle_window_start = now;
+    idle_window_bytes = 0;
+  }
+}
 
 void send_lcd_message(LcdMessageType_t type, const char *l1, const char *l2, uint32_t duration)
 {
+  if ((unsigned)type >= LCD_MSG_TYPE_COUNT)
+    return;
+
   LcdEvent_t evt;
   evt.type = type;
   evt.duration = duration;
@@ -16,10 +195,61 @@ void send_lcd_message(LcdMessageType_t type, const char *l1, const char *l2, uin
   strncpy(evt.line2, l2, sizeof(evt.line2) - 1);
   evt.line2[sizeof(evt.line2) - 1] = '\0';
 
-  // Gửi vào queue (wait 0 để không treo callback nếu queue đầy)
-  if (lcd_queue != NULL) {
-      xQueueSend(lcd_queue, &evt, 0);
+  // Ghi vào slot theo loại (không chờ, không bao giờ đầy)
+  portENTER_CRITICAL(&lcd_mux);
+  LcdSlot_t &slot = lcd_slots[type];
+  if (slot.pending)
+    queue_stats.coalesced++;
+  slot.evt = evt;
+  slot.posted_at = millis();
+  slot.pending = true;
+  queue_stats.posted++;
+  portEXIT_CRITICAL(&lcd_mux);
+  TRACE_QUEUE_SEND(QUEUE_LCD, pdTRUE, type);
+
+  if (lcd_task != NULL)
+    xTaskNotifyGive(lcd_task);
+}
+
+// Chọn tin chờ ưu tiên cao nhất; tin tạm đã quá hạn trước khi kịp hiện thì bỏ.
+// Trả về -1 nếu không có tin nào.
+static int lcd_pick_pending(unsigned long now)
+{
+  int best = -1;
+  portENTER_CRITICAL(&lcd_mux);
+  for (int t = 0; t < LCD_MSG_TYPE_COUNT; t++)
+  {
+    LcdSlot_t &slot = lcd_slots[t];
+    if (!slot.pending)
+      continue;
+    if (slot.evt.duration > 0 && now - slot.posted_at > slot.evt.duration)
+    {
+      slot.pending = false; // đã lỗi thời, hiện ra chỉ gây nhầm lẫn
+      queue_stats.dropped++;
+      continue;
+    }
+    if (best < 0 || lcd_msg_priority((LcdMessageType_t)t) > lcd_msg_priority((LcdMessageType_t)best))
+      best = t;
+  }
+  portEXIT_CRITICAL(&lcd_mux);
+  return best;
+}
+
+static bool lcd_take(int type, LcdEvent_t *out)
+{
+  bool ok = false;
+  portENTER_CRITICAL(&lcd_mux);
+  if (lcd_slots[type].pending)
+  {
+    *out = lcd_slots[type].evt;
+    lcd_slots[type].pending = false;
+    queue_stats.shown++;
+    ok = true;
   }
+  portEXIT_CRITICAL(&lcd_mux);
+  if (ok)
+    TRACE_QUEUE_RECV(QUEUE_LCD, type);
+  return ok;
 }
 
 static void TaskLCD(void *pvParameters)
@@ -29,83 +259,107 @@ static void TaskLCD(void *pvParameters)
   // Khởi tạo LCD
   lcd.init();
   lcd.backlight();
+  lcd.clear(); // lần clear duy nhất, từ đây mọi thứ đi qua shadow buffer
+  shadow.sync_cleared();
 
   // Hiển thị màn hình khởi động
-  lcd.setCursor(0, 0);
-  lcd.print("System Booting..");
+  lcd_render("System Booting..", "");
   vTaskDelay(pdMS_TO_TICKS(1000));
 
   // Trạng thái nội bộ để quản lý việc tự động quay về IDLE
   unsigned long last_temp_msg_time = 0;
   bool is_showing_temp_msg = false;
   uint32_t current_msg_duration = 0;
+  uint8_t current_prio = 0;
 
-  // Gửi lệnh IDLE ban đầu
-  LcdEvent_t idleMsg;
-  idleMsg.type = LCD_MSG_IDLE;
-  strcpy(idleMsg.line1, "IoT Smart Door");
-  strcpy(idleMsg.line2, "Ready to scan...");
-  idleMsg.duration = 0;
-
-  // Vẽ màn hình IDLE ngay lập tức
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print(idleMsg.line1);
-  lcd.setCursor(0, 1);
-  lcd.print(idleMsg.line2);
+  // Vào màn hình chờ ngay lập tức
+  bool idle_active = true;
+  idle_window_start = millis();
 
   for (;;)
   {
-    // 1. Kiểm tra xem có tin nhắn mới trong Queue không (Non-blocking hoặc wait ngắn)
-    if (xQueueReceive(lcd_queue, &msg, pdMS_TO_TICKS(100)))
-    {
+    // 1. Chờ tin mới (notify) hoặc tối đa 100 ms để kiểm tra hết hạn
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    unsigned long now = millis();
 
-      // Xóa màn hình và in nội dung mới
-      lcd.clear();
-      lcd.setCursor(0, 0);
-      lcd.print(msg.line1);
-      lcd.setCursor(0, 1);
-      lcd.print(msg.line2);
+    int next = lcd_pick_pending(now);
+    if (next >= 0)
+    {
+      uint8_t prio = lcd_msg_priority((LcdMessageType_t)next);
+      bool shown_long_enough = now - last_temp_msg_time >= LCD_MIN_SHOW_MS;
 
-      // Nếu đây là tin nhắn tạm thời (có duration > 0)
-      if (msg.duration > 0)
-      {
-        is_showing_temp_msg = true;
-        current_msg_duration = msg.duration;
-        last_temp_msg_time = millis();
-      }
-      else
+      // Tin ưu tiên cao hơn (vd. lỗi) chen ngang ngay; tin thấp hơn đợi tin
+      // hiện tại hiện đủ LCD_MIN_SHOW_MS rồi mới thay (tin mới hơn thắng).
+      if (!is_showing_temp_msg || prio > current_prio || shown_long_enough)
       {
-        // Nếu là tin nhắn vĩnh viễn (ví dụ IDLE update), tắt cờ tạm
-        is_showing_temp_msg = false;
+        if (is_showing_temp_msg && now - last_temp_msg_time < current_msg_duration && prio > current_prio)
+        {
+          portENTER_CRITICAL(&lcd_mux);
+          queue_stats.preempted++;
+          portEXIT_CRITICAL(&lcd_mux);
+        }
+
+        if (lcd_take(next, &msg))
+        {
+          if (msg.type == LCD_MSG_IDLE && msg.duration == 0)
+          {
+            // IDLE vĩnh viễn = về màn hình chờ động
+            is_showing_temp_msg = false;
+            idle_active = true;
+            idle_window_start = now;
+            idle_window_bytes = 0;
+          }
+          else
+          {
+            // Chỉ ghi các ô khác với nội dung đang hiển thị
+            lcd_render(msg.line1, msg.line2);
+            idle_active = false;
+
+            // Nếu đây là tin nhắn tạm thời (có duration > 0)
+            if (msg.duration > 0)
+            {
+              is_showing_temp_msg = true;
+              current_msg_duration = msg.duration;
+              current_prio = prio;
+              last_temp_msg_time = now;
+            }
+            else
+            {
+              // Tin nhắn vĩnh viễn: giữ nguyên tới khi có tin khác
+              is_showing_temp_msg = false;
+            }
+          }
+        }
       }
     }
 
     // 2. Logic tự động quay về màn hình chờ (IDLE) sau khi hiển thị thông báo xong
     if (is_showing_temp_msg)
     {
-      if (millis() - last_temp_msg_time > current_msg_duration)
+      if (now - last_temp_msg_time > current_msg_duration)
       {
         is_showing_temp_msg = false;
 
-        // Quay về màn hình chờ mặc định
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print("IoT Smart Door");
+        if (lcd_pick_pending(now) >= 0)
+        {
+          xTaskNotifyGive(lcd_task); // còn tin chờ -> vòng sau hiện tiếp
+          continue;
+        }
 
-        // Dòng 2 hiển thị giờ (nếu có thể lấy từ hàm get_iso_timestamp hoặc đơn giản là text)
-        lcd.setCursor(0, 1);
-        lcd.print("Please Scan...");
+        // Quay về màn hình chờ (giờ + trạng thái WiFi/MQTT/cửa)
+        idle_active = true;
+        idle_window_start = now;
+        idle_window_bytes = 0;
       }
     }
 
-    // Delay nhẹ để nhường CPU
-    vTaskDelay(pdMS_TO_TICKS(50));
+    // 3. Màn hình chờ: cập nhật đồng hồ / glyph, chỉ ghi ô thay đổi
+    if (idle_active)
+      lcd_render_idle(now);
   }
 }
 
-void display_start_task(QueueHandle_t lcd_q)
+void display_start_task(void)
 {
-    lcd_queue = lcd_q;
-    xTaskCreatePinnedToCore(TaskLCD, "TaskLCD", 3072, NULL, 1, NULL, 1);
+    xTaskCreatePinnedToCore(TaskLCD, "TaskLCD", TASK_LCD_STACK_SIZE, NULL, TASK_LCD_PRIORITY, &lcd_task, TASK_LCD_CORE);
 }
@@ -5,15 +5,40 @@
 #include <LiquidCrystal_I2C.h>
 #include "app_config.h"
 
+// Thống kê vẽ LCD (cộng dồn từ lúc khởi động)
+struct LcdRenderStats_t
+{
+    uint32_t frames;
+    uint32_t i2c_bytes;        // byte I2C thực gửi (ước tính theo LCD_I2C_BYTES_PER_OP)
+    uint32_t legacy_i2c_bytes; // byte I2C nếu vẽ kiểu cũ (clear + ghi lại 2 dòng)
+    uint32_t us_total;         // tổng thời gian flush
+    uint32_t last_i2c_bytes;
+    uint32_t last_us;
+    uint32_t glyph_loads;      // số lần nạp glyph vào CGRAM
+    uint32_t idle_i2c_per_min; // byte I2C trong 1 phút gần nhất ở màn hình chờ
+};
+
+// Thống kê hàng đợi tin nhắn LCD
+struct LcdQueueStats_t
+{
+    uint32_t posted;    // số lần send_lcd_message
+    uint32_t shown;     // số tin thực sự hiển thị
+    uint32_t coalesced; // tin bị tin mới cùng loại ghi đè trước khi hiện
+    uint32_t dropped;   // tin tạm hết hạn trước khi tới lượt hiện
+    uint32_t preempted; // tin đang hiện bị tin ưu tiên cao hơn chen ngang
+};
+
 // Biến ngoại lai để các nơi khác có thể truy cập (nếu cần)
 extern LiquidCrystal_I2C lcd;
-extern QueueHandle_t lcd_queue;
 
 // Hàm khởi tạo và chạy Task quản lý LCD
 void display_init();
-void display_start_task(QueueHandle_t lcd_q);
+void display_start_task(void);
 
 // Hàm tiện ích gửi thông báo xuất ra màn hình
 void send_lcd_message(LcdMessageType_t type, const char *l1, const char *l2, uint32_t duration);
 
+void display_get_stats(LcdRenderStats_t *out);
+void display_get_queue_stats(LcdQueueStats_t *out);
+
 #endif // DISPLAY_H_
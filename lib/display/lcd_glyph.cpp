@@ -0,0 +1,26 @@
+#include "lcd_glyph.h"
+
+// clang-format off
+const uint8_t lcd_glyph_bitmaps[GLYPH_COUNT][8] = {
+    // GLYPH_WIFI_STRONG
+    {0b00000, 0b01110, 0b10001, 0b00100, 0b01010, 0b00000, 0b00100, 0b00000},
+    // GLYPH_WIFI_WEAK
+    {0b00000, 0b00000, 0b00000, 0b00100, 0b01010, 0b00000, 0b00100, 0b00000},
+    // GLYPH_WIFI_OFF
+    {0b10001, 0b01010, 0b00100, 0b01010, 0b10001, 0b00000, 0b00100, 0b00000},
+    // GLYPH_MQTT_ON (đám mây đặc)
+    {0b00000, 0b00110, 0b01111, 0b11111, 0b11111, 0b00000, 0b00000, 0b00000},
+    // GLYPH_MQTT_OFF (đám mây rỗng)
+    {0b00000, 0b00110, 0b01001, 0b10001, 0b11111, 0b00000, 0b00000, 0b00000},
+    // GLYPH_LOCKED
+    {0b01110, 0b10001, 0b10001, 0b11111, 0b11011, 0b11011, 0b11111, 0b00000},
+    // GLYPH_UNLOCKED
+    {0b01110, 0b10000, 0b10000, 0b11111, 0b11011, 0b11011, 0b11111, 0b00000},
+    // GLYPH_DOOR_OPEN
+    {0b11000, 0b10110, 0b10001, 0b10101, 0b10001, 0b10110, 0b11000, 0b00000},
+    // GLYPH_ALARM (chuông)
+    {0b00100, 0b01110, 0b01110, 0b01110, 0b11111, 0b00000, 0b00100, 0b00000},
+    // GLYPH_HOURGLASS (chưa đồng bộ giờ)
+    {0b11111, 0b10001, 0b01010, 0b00100, 0b01010, 0b10001, 0b11111, 0b00000},
+};
+// clang-format on
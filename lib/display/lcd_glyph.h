@@ -0,0 +1,86 @@
+#ifndef LCD_GLYPH_H_
+#define LCD_GLYPH_H_
+
+#include <Arduino.h>
+#include "lcd_shadow.h"
+
+// Glyph tự định nghĩa cho màn hình chờ. Nhiều hơn 8 slot CGRAM của HD44780
+// nên phải nạp theo nhu cầu (LRU).
+typedef enum
+{
+    GLYPH_WIFI_STRONG,
+    GLYPH_WIFI_WEAK,
+    GLYPH_WIFI_OFF,
+    GLYPH_MQTT_ON,
+    GLYPH_MQTT_OFF,
+    GLYPH_LOCKED,
+    GLYPH_UNLOCKED,
+    GLYPH_DOOR_OPEN,
+    GLYPH_ALARM,
+    GLYPH_HOURGLASS,
+    GLYPH_COUNT
+} LcdGlyph_t;
+
+#define LCD_CGRAM_SLOTS 8
+#define LCD_GLYPH_NONE 0xFF
+
+extern const uint8_t lcd_glyph_bitmaps[GLYPH_COUNT][8];
+
+// ================== CGRAM LRU ==================
+// acquire() trả về mã ký tự (0..7) đang chứa glyph; nếu chưa có thì nạp vào
+// slot ít dùng gần đây nhất, trừ các slot trong pinned_mask (đang dùng ở
+// frame đang dựng). Nạp 1 glyph = 1 lệnh + 8 byte dữ liệu.
+template <class Backend>
+class LcdGlyphCache
+{
+public:
+    explicit LcdGlyphCache(Backend &backend) : _be(backend)
+    {
+        memset(_slot_glyph, LCD_GLYPH_NONE, sizeof(_slot_glyph));
+        memset(_last_use, 0, sizeof(_last_use));
+    }
+
+    uint8_t acquire(LcdGlyph_t glyph, uint8_t pinned_mask, bool *loaded)
+    {
+        *loaded = false;
+        _tick++;
+
+        uint8_t victim = LCD_GLYPH_NONE;
+        for (uint8_t s = 0; s < LCD_CGRAM_SLOTS; s++)
+        {
+            if (_slot_glyph[s] == glyph)
+            {
+                _last_use[s] = _tick;
+                return s;
+            }
+            if (pinned_mask & (1 << s))
+                continue;
+            if (victim == LCD_GLYPH_NONE || _last_use[s] < _last_use[victim])
+                victim = s;
+        }
+        if (victim == LCD_GLYPH_NONE)
+            victim = 0; // mọi slot đều bị ghim: không xảy ra với <= 8 glyph / frame
+
+        uint8_t bitmap[8];
+        memcpy(bitmap, lcd_glyph_bitmaps[glyph], sizeof(bitmap));
+        _be.createChar(victim, bitmap);
+        _slot_glyph[victim] = glyph;
+        _last_use[victim] = _tick;
+        _loads++;
+        *loaded = true;
+        return victim;
+    }
+
+    uint32_t loads() const { return _loads; }
+
+    static uint32_t load_i2c_bytes() { return (1 + 8) * LCD_I2C_BYTES_PER_OP; }
+
+private:
+    Backend &_be;
+    uint8_t _slot_glyph[LCD_CGRAM_SLOTS];
+    uint32_t _last_use[LCD_CGRAM_SLOTS];
+    uint32_t _tick = 0;
+    uint32_t _loads = 0;
+};
+
+#endif // LCD_GLYPH_H_
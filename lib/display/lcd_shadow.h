@@ -0,0 +1,145 @@
+#ifndef LCD_SHADOW_H_
+#define LCD_SHADOW_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define LCD_SHADOW_MICROS() micros()
+#else
+// Build native (test/test_lcd_shadow): không có Arduino, đo bằng steady_clock
+#include <chrono>
+#define LCD_SHADOW_MICROS()                                                            \
+    ((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(                  \
+         std::chrono::steady_clock::now().time_since_epoch())                          \
+         .count())
+#endif
+
+// Mỗi byte gửi tới HD44780 qua PCF8574 (4-bit mode) = 2 nibble x 3 lần ghi
+// expander (data, EN=1, EN=0) -> 6 byte payload I2C.
+#define LCD_I2C_BYTES_PER_OP 6
+// lcd.clear() của LiquidCrystal_I2C chờ thêm 2 ms sau lệnh
+#define LCD_CLEAR_DELAY_US 2000
+
+struct LcdFrameStats_t
+{
+    uint16_t cells;        // số ô thực sự ghi
+    uint16_t cursor_moves; // số lệnh setCursor
+    uint32_t i2c_bytes;    // ước tính byte I2C của frame
+    uint32_t us;           // thời gian flush đo bằng micros()
+};
+
+// ================== SHADOW FRAMEBUFFER ==================
+// Giữ 2 buffer: back (nội dung muốn hiển thị) và front (nội dung đang có
+// trên LCD). flush() chỉ ghi các ô khác nhau, chỉ setCursor khi con trỏ
+// phần cứng không nằm sẵn ở ô cần ghi (HD44780 tự tăng địa chỉ sau mỗi ký tự).
+// Backend chỉ cần setCursor(col,row) và write(uint8_t): LiquidCrystal_I2C
+// hoặc backend giả đếm I2C (test/test_lcd_shadow).
+template <class Backend, uint8_t COLS, uint8_t ROWS>
+class LcdShadow
+{
+public:
+    explicit LcdShadow(Backend &backend) : _be(backend)
+    {
+        memset(_back, ' ', sizeof(_back));
+        invalidate();
+    }
+
+    // Sau lcd.clear(): LCD toàn khoảng trắng, con trỏ ở (0,0)
+    void sync_cleared()
+    {
+        memset(_front, ' ', sizeof(_front));
+        _cur_col = 0;
+        _cur_row = 0;
+    }
+
+    // Không biết LCD đang hiện gì (vd. vừa init lại) -> lần flush sau vẽ lại hết.
+    // createChar không cần: HD44780 đọc CGRAM mỗi lần quét, ô đang hiện mã slot vừa
+    // nạp tự đổi hình, chỉ con trỏ bị lệch (invalidate_cursor)
+    void invalidate()
+    {
+        memset(_front, 0xFF, sizeof(_front));
+        _cur_row = 0xFF;
+    }
+
+    // Con trỏ phần cứng bị lệnh khác làm sai lệch (createChar...)
+    void invalidate_cursor() { _cur_row = 0xFF; }
+
+    // Ghi cả dòng, phần thiếu tự đệm khoảng trắng (thay cho lcd.clear())
+    void set_line(uint8_t row, const char *text)
+    {
+        if (row >= ROWS)
+            return;
+        uint8_t c = 0;
+        for (; c < COLS && text && text[c]; c++)
+            _back[row][c] = (uint8_t)text[c];
+        for (; c < COLS; c++)
+            _back[row][c] = ' ';
+    }
+
+    // Ghi một đoạn tại vị trí bất kỳ, không đệm
+    void print(uint8_t col, uint8_t row, const char *text)
+    {
+        for (; row < ROWS && col < COLS && *text; col++, text++)
+            _back[row][col] = (uint8_t)*text;
+    }
+
+    void put(uint8_t col, uint8_t row, uint8_t ch)
+    {
+        if (row < ROWS && col < COLS)
+            _back[row][col] = ch;
+    }
+
+    uint8_t get(uint8_t col, uint8_t row) const { return _back[row][col]; }
+
+    const LcdFrameStats_t &flush()
+    {
+        uint32_t t0 = LCD_SHADOW_MICROS();
+        _stats.cells = 0;
+        _stats.cursor_moves = 0;
+
+        for (uint8_t r = 0; r < ROWS; r++)
+        {
+            for (uint8_t c = 0; c < COLS; c++)
+            {
+                if (_back[r][c] == _front[r][c])
+                    continue;
+
+                if (_cur_row != r || _cur_col != c)
+                {
+                    _be.setCursor(c, r);
+                    _stats.cursor_moves++;
+                }
+                _be.write(_back[r][c]);
+                _front[r][c] = _back[r][c];
+                _stats.cells++;
+
+                // Con trỏ HD44780 tự tăng; ô cuối dòng nhảy sang DDRAM không liên tục
+                _cur_row = r;
+                _cur_col = c + 1;
+            }
+        }
+
+        _stats.i2c_bytes = (uint32_t)(_stats.cells + _stats.cursor_moves) * LCD_I2C_BYTES_PER_OP;
+        _stats.us = LCD_SHADOW_MICROS() - t0;
+        return _stats;
+    }
+
+    // Chi phí của cách vẽ cũ (clear + setCursor + print từng dòng) cho cùng nội dung
+    static uint32_t legacy_i2c_bytes(const char *l1, const char *l2)
+    {
+        uint32_t ops = 1 /* clear */ + 2 /* setCursor */ + strnlen(l1, COLS) + strnlen(l2, COLS);
+        return ops * LCD_I2C_BYTES_PER_OP;
+    }
+
+private:
+    Backend &_be;
+    uint8_t _back[ROWS][COLS];
+    uint8_t _front[ROWS][COLS];
+    uint8_t _cur_col = 0;
+    uint8_t _cur_row = 0xFF;
+    LcdFrameStats_t _stats = {};
+};
+
+#endif // LCD_SHADOW_H_
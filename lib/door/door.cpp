@@ -1,107 +1,252 @@
 #include "door.h"
+#include "door_fsm.h"
+#include "door_actuator.h"
+#include "door_persist.h"
 #include "app_config.h"
+#include "config_store.h"
+#include "app_queue.h"
+#include "event_bus.h"
+#include "device_state.h"
+#include "supervisor.h"
+#include "telemetry.h"
 
 #include <Arduino.h>
-#include <Servo.h>
+#include <esp_system.h>
 
-static Servo door_servo;
+#if DOOR_ACTUATOR == DOOR_ACTUATOR_SERVO
+typedef ServoActuator<SERVO_PIN, CLOSE, OPEN, SERVO_MS_PER_60DEG, SERVO_SETTLE_MS> DoorActuator;
+#elif DOOR_ACTUATOR == DOOR_ACTUATOR_RELAY
+typedef RelayActuator<LOCK_RELAY_PIN, LOCK_RELAY_ACTIVE_LEVEL> DoorActuator;
+#elif DOOR_ACTUATOR == DOOR_ACTUATOR_SOLENOID
+typedef SolenoidPulseActuator<LOCK_RELAY_PIN, LOCK_RELAY_ACTIVE_LEVEL, SOLENOID_PULSE_MS> DoorActuator;
+#else
+#error "DOOR_ACTUATOR không hợp lệ"
+#endif
 
 volatile bool s_sensor_event_triggered = false;
-static unsigned long last_debounce_time = 0;
-static unsigned long last_unlocked_time = 0;
-const unsigned long AUTO_LOCK_TIMEOUT = 10000;
-const unsigned long DEBOUNCE_DELAY = 200;
 
-static door_event_cb_t door_evt_cb = nullptr;
+static volatile DoorFSMState_t s_state = DOOR_STATE_LOCKED;
+static volatile bool s_hold = false; // giữ chốt mở, chỉ taskDoor ghi
+static DoorOpenState_t s_boot_open = DOOR_CLOSED;
+static DoorRecoveryInfo_t s_recovery;
+static DoorStats_t s_stats; // chỉ taskDoor ghi, các field 32 bit đọc không cần khoá
 
 static QueueHandle_t _cmd_queue = NULL; // Nhận lệnh mở (từ FP hoặc MQTT)
 static QueueHandle_t _evt_queue = NULL; // Báo cáo tình hình (cho MQTT)
-void door_register_event_callback(door_event_cb_t cb)
+static void door_emit_event(DoorEvent_t evt)
 {
-    door_evt_cb = cb;
+    switch (evt)
+    {
+    case DOOR_EVT_UNLOCKED:
+        s_stats.unlocks++;
+        break;
+    case DOOR_EVT_CLOSED_AND_LOCKED:
+        s_stats.cycles++;
+        break;
+    case DOOR_EVT_FORCED_OPEN:
+    case DOOR_EVT_HELD_OPEN:
+        s_stats.alarms++;
+        telemetry_note_alarm();
+        break;
+    default:
+        break;
+    }
+
+    uint32_t seq = door_persist_next_seq();
+    event_bus_publish_door(evt, seq);
 }
 
-static void door_emit_event(DoorEvent_t evt)
+static DoorOpenState_t door_read_sensor()
+{
+    return digitalRead(SENSOR_PIN) ? DOOR_OPEN : DOOR_CLOSED;
+}
+
+static void door_set_state(DoorFSMState_t state)
+{
+    s_state = state;
+    door_persist_save_state(state);
+    device_state_set_door(state);
+}
+
+DoorFSMState_t door_get_state()
+{
+    return s_state;
+}
+
+bool door_is_held()
+{
+    return s_hold;
+}
+
+const DoorRecoveryInfo_t *door_get_recovery_info()
+{
+    return &s_recovery;
+}
+
+void door_get_stats(DoorStats_t *out)
 {
-    if (door_evt_cb)
-        door_evt_cb(evt);
+    *out = s_stats;
+}
+
+const char *door_state_to_str(DoorFSMState_t state)
+{
+    switch (state)
+    {
+    case DOOR_STATE_LOCKED:
+        return "locked";
+    case DOOR_STATE_UNLOCKED_WAIT_OPEN:
+        return "unlocked_wait_open";
+    case DOOR_STATE_OPEN:
+        return "open";
+    case DOOR_STATE_FORCED_OPEN:
+        return "forced_open";
+    default:
+        return "unknown";
+    }
 }
 
 void IRAM_ATTR door_sensor_isr()
 {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     s_sensor_event_triggered = true;
 }
+// Đối chiếu trạng thái trước reset với cảm biến thật, không ghi đè chốt mù quáng
+static DoorFSMState_t door_reconcile(bool warm, DoorFSMState_t prev, DoorOpenState_t open)
+{
+    if (open == DOOR_CLOSED)
+        return DOOR_STATE_LOCKED; // cửa đóng -> luôn khoá lại (kể cả đang chờ mở)
+
+    if (!warm)
+        return DOOR_STATE_OPEN; // mất điện hẳn: không biết ai mở, để chốt mở cho cửa đóng được
+
+    if (prev == DOOR_STATE_LOCKED || prev == DOOR_STATE_FORCED_OPEN)
+        return DOOR_STATE_FORCED_OPEN;
+    return DOOR_STATE_OPEN;
+}
+
 void door_init()
 {
     pinMode(SENSOR_PIN, INPUT_PULLUP);
     attachInterrupt(digitalPinToInterrupt(SENSOR_PIN), door_sensor_isr, CHANGE);
-    door_servo.attach(SERVO_PIN);
-    door_servo.write(0);
+
+    DoorFSMState_t prev;
+    bool warm = door_persist_load(&prev);
+    s_boot_open = door_read_sensor();
+    device_state_set_sensor(s_boot_open);
+    DoorFSMState_t state = door_reconcile(warm, prev, s_boot_open);
+
+    DoorActuator::init(state == DOOR_STATE_LOCKED || state == DOOR_STATE_FORCED_OPEN);
+    door_set_state(state);
+
+    s_recovery.warm = warm;
+    s_recovery.prev_state = prev;
+    s_recovery.state = state;
+    s_recovery.reset_reason = (int)esp_reset_reason();
+    s_recovery.recover_us = micros();
+
+    door_emit_event(DOOR_EVT_RECOVERED);
 }
 void door_lock()
 {
-    door_servo.write(0);
+    DoorActuator::lock();
 }
 void door_unlock()
 {
-    door_servo.write(180);
+    DoorActuator::unlock();
 }
+
+template <class Actuator>
 static void taskDoor(void *pvParameters)
 {
-    DoorFSMState_t state = DOOR_STATE_LOCKED;
-    DoorOpenState_t last_open = DOOR_CLOSED;
+    DoorFSMState_t state = s_state; // đã khôi phục trong door_init()
     DoorRequest_t cmd;
 
-    unsigned long unlocked_time = 0;
+    // Debounce cảm biến: chỉ nhận mức mới khi ổn định đủ DOOR_SENSOR_DEBOUNCE
+    DoorOpenState_t stable_open = s_boot_open;
+    DoorOpenState_t raw_open = door_read_sensor();
+    unsigned long raw_change_time = millis();
+
+    unsigned long state_enter_time = millis();
+    bool held_alarm_sent = false;
 
     for (;;)
     {
+        supervisor_begin(SUP_TASK_DOOR);
+        DoorInput_t inputs[4];
+        uint8_t n_inputs = 0;
+        unsigned long now = millis();
+
         /* ========= 1. Nhận command ========= */
-        if (xQueueReceive(_cmd_queue, &cmd, 0) == pdPASS)
+        if (app_queue_receive(_cmd_queue, &cmd, 0) == pdPASS)
         {
-            if (cmd == DOOR_REQUEST_UNLOCK && state == DOOR_STATE_LOCKED)
+            if (cmd == DOOR_REQUEST_UNLOCK)
+                inputs[n_inputs++] = DOOR_IN_UNLOCK_REQ;
+            else if (cmd == DOOR_REQUEST_HOLD_UNLOCK)
+                s_hold = true;
+            else if (cmd == DOOR_REQUEST_LOCK && s_hold)
             {
-                door_unlock();
-                unlocked_time = millis();
-                state = DOOR_STATE_UNLOCKED_WAIT_OPEN;
-                door_emit_event(DOOR_EVT_UNLOCKED);
+                s_hold = false;
+                inputs[n_inputs++] = DOOR_IN_LOCK_REQ; // cửa đang mở: khoá khi đóng như thường
             }
         }
+        // Giữ mở: chốt đang khoá (vừa bật giữ mở / cửa bị cạy rồi đóng) thì mở lại
+        if (s_hold && state == DOOR_STATE_LOCKED)
+            inputs[n_inputs++] = DOOR_IN_UNLOCK_REQ;
 
-        /* ========= 2. Xử lý sensor ========= */
-        if (s_sensor_event_triggered && state != DOOR_STATE_LOCKED)
+        /* ========= 2. Sensor (debounce) ========= */
+        // Đọc cả khi đang LOCKED để phát hiện cửa bị cạy
+        DoorOpenState_t current_open = door_read_sensor();
+        if (current_open != raw_open || s_sensor_event_triggered)
         {
+            // ISR thấy cạnh (kể cả nảy giữa 2 lần poll) -> tính lại debounce
             s_sensor_event_triggered = false;
+            raw_open = current_open;
+            raw_change_time = now;
+        }
+        if (raw_open != stable_open && now - raw_change_time >= DOOR_SENSOR_DEBOUNCE)
+        {
+            stable_open = raw_open;
+            device_state_set_sensor(stable_open);
+            if (stable_open == DOOR_OPEN)
+                inputs[n_inputs++] = DOOR_IN_SENSOR_OPEN;
+            else
+                inputs[n_inputs++] = (s_hold && state == DOOR_STATE_OPEN) ? DOOR_IN_CLOSED_HELD : DOOR_IN_SENSOR_CLOSED;
+        }
 
-            DoorOpenState_t current_open = digitalRead(SENSOR_PIN) ? DOOR_OPEN : DOOR_CLOSED;
+        /* ========= 3. Timer (config_store: auto_lock_ms, held_open_ms) ========= */
+        const AppSettings_t *cfg = config_get();
+        if (state == DOOR_STATE_UNLOCKED_WAIT_OPEN && !s_hold && now - state_enter_time >= cfg->auto_lock_ms)
+            inputs[n_inputs++] = DOOR_IN_UNLOCK_TIMEOUT;
+        else if ((state == DOOR_STATE_OPEN || state == DOOR_STATE_FORCED_OPEN) &&
+                 !held_alarm_sent && now - state_enter_time >= cfg->held_open_ms)
+            inputs[n_inputs++] = DOOR_IN_HELD_TIMEOUT;
 
-            if (current_open != last_open)
-            {
-                if (current_open == DOOR_OPEN)
-                {
-                    state = DOOR_STATE_OPEN;
-                    door_emit_event(DOOR_EVT_OPENED);
-                }
-                else // OPEN → CLOSED
-                {
-                    door_lock();
-                    state = DOOR_STATE_LOCKED;
-                    door_emit_event(DOOR_EVT_CLOSED_AND_LOCKED);
-                }
-            }
-            last_open = current_open;
-        }
-        if (state == DOOR_STATE_UNLOCKED_WAIT_OPEN)
+        /* ========= 4. Tra bảng FSM ========= */
+        for (uint8_t i = 0; i < n_inputs; i++)
         {
-            /* ========= 3. Auto-lock timeout ========= */
-            if (millis() - unlocked_time >= AUTO_LOCK_TIMEOUT)
+            DoorTransition_t t = door_fsm_next(state, inputs[i]);
+
+            if (t.action == DOOR_ACT_LOCK)
+                Actuator::lock();
+            else if (t.action == DOOR_ACT_UNLOCK)
+                Actuator::unlock();
+
+            if (t.to != state)
             {
-                door_lock();
-                state = DOOR_STATE_LOCKED;
-                door_emit_event(DOOR_EVT_WAIT_TIME_END_AND_LOCKED);
+                state = t.to;
+                door_set_state(state);
+                state_enter_time = now;
+                held_alarm_sent = false;
             }
+            if (inputs[i] == DOOR_IN_HELD_TIMEOUT)
+                held_alarm_sent = true;
+
+            if (t.event != DOOR_EVT_NONE)
+                door_emit_event(t.event);
         }
+
+        /* ========= 5. Actuator housekeeping (detach servo / hết xung) ========= */
+        Actuator::poll(millis());
+        supervisor_end(SUP_TASK_DOOR);
         vTaskDelay(pdMS_TO_TICKS(50));
     }
 }
@@ -113,12 +258,11 @@ void door_start_task(QueueHandle_t cmd_queue, QueueHandle_t report_queue)
     _evt_queue = report_queue;
 
     xTaskCreatePinnedToCore(
-        taskDoor,
+        taskDoor<DoorActuator>,
         "TaskDoor",
-        TASK_DOOR_STACK_SIZE, // Nhớ define trong app_config (vd: 2048)
+        TASK_DOOR_STACK_SIZE,
         NULL,
-        TASK_DOOR_PRIORITY, // Nhớ define (vd: 2)
+        TASK_DOOR_PRIORITY,
         NULL,
-        1 // Core 1
-    );
+        TASK_DOOR_CORE);
 }
\ No newline at end of file
@@ -2,39 +2,10 @@
 #define DOOR_H_
 
 #include <Arduino.h>
+#include "door_types.h"
 
 #define OPEN 180
 #define CLOSE 0
-// ================== ENUM ==================
-
-// Trạng thái CHỐT (cơ cấu khoá)
-typedef enum
-{
-    DOOR_STATE_LOCKED,
-    DOOR_STATE_UNLOCKED_WAIT_OPEN, // unlock nhưng chưa mở
-    DOOR_STATE_OPEN,               // cửa đang mở
-} DoorFSMState_t;
-// Trạng thái CỬA (cảm biến cửa)
-enum DoorOpenState_t
-{
-
-    DOOR_CLOSED = 0, // cửa đóng
-    DOOR_OPEN = 1    // cửa đang mở
-};
-// Handle event
-// enum DoorRequest_t
-// {
-//     DOOR_REQUEST_UNLOCK, // yêu cầu mở khoá
-//     DOOR_REQUEST_NONE    // poll trạng thái cửa
-// };
-typedef enum
-{
-    DOOR_EVT_NONE,
-    DOOR_EVT_UNLOCKED,
-    DOOR_EVT_OPENED,
-    DOOR_EVT_CLOSED_AND_LOCKED,
-    DOOR_EVT_WAIT_TIME_END_AND_LOCKED
-} DoorEvent_t;
 
 // ================== TYPE ==================
 
@@ -44,10 +15,27 @@ struct DoorStatus_t
     DoorOpenState_t open_state;
 };
 
-// ================== API CÔNG KHAI ==================
-typedef void (*door_event_cb_t)(DoorEvent_t evt);
+// Kết quả khôi phục trạng thái sau reset (cố định sau door_init)
+struct DoorRecoveryInfo_t
+{
+    bool warm;                 // có bản ghi RTC hợp lệ (reset nóng)
+    DoorFSMState_t prev_state; // trạng thái trước reset (chỉ đúng khi warm)
+    DoorFSMState_t state;      // trạng thái sau khi đối chiếu cảm biến
+    int reset_reason;          // esp_reset_reason_t
+    uint32_t recover_us;       // thời điểm (tính từ boot) hoàn tất khôi phục
+};
+
+// Bộ đếm từ lúc khởi động (telemetry)
+struct DoorStats_t
+{
+    uint32_t unlocks; // số lần mở chốt
+    uint32_t cycles;  // số chu kỳ mở cửa -> đóng -> khoá hoàn chỉnh
+    uint32_t alarms;  // forced_open + held_open
+};
 
-void door_register_event_callback(door_event_cb_t cb);
+// ================== API CÔNG KHAI ==================
+// Event cửa được publish lên event bus (BUS_EVT_DOOR) kèm seq: số thứ tự
+// tăng dần, giữ được qua reset
 // Khởi tạo phần cứng cửa
 void door_init();
 // Chốt cửa
@@ -58,6 +46,12 @@ void door_unlock();
 // DoorStatus_t door_get_status();
 // void door_handle_event(DoorRequest_t req = DOOR_REQUEST_NONE);
 void door_event_response(DoorEvent_t res);
+DoorFSMState_t door_get_state();
+const char *door_state_to_str(DoorFSMState_t state);
+const DoorRecoveryInfo_t *door_get_recovery_info();
+// Đang giữ chốt mở (DOOR_REQUEST_HOLD_UNLOCK)
+bool door_is_held();
+void door_get_stats(DoorStats_t *out);
 void door_start_task(QueueHandle_t cmd_queue, QueueHandle_t report_queue);
 extern volatile bool s_sensor_event_triggered;
 #endif
\ No newline at end of file
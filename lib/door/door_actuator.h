@@ -0,0 +1,140 @@
+#ifndef DOOR_ACTUATOR_H_
+#define DOOR_ACTUATOR_H_
+
+#include <Arduino.h>
+#include <Servo.h>
+
+// ================== ACTUATOR POLICY ==================
+// Mỗi policy là một struct chỉ có hàm static:
+//   init(locked) cấu hình chân, đưa chốt về trạng thái khoá / mở
+//   lock()      khoá, trả về thời gian ước tính (ms) đến khi cơ cấu dừng
+//   unlock()    mở, trả về thời gian ước tính (ms)
+//   poll(now)   gọi mỗi tick của taskDoor (detach servo, ngắt xung solenoid)
+// taskDoor được instantiate theo policy (template), không có virtual dispatch.
+
+// ---------- Servo: detach sau khi quay xong để bỏ xung PWM và dòng giữ ----------
+template <uint8_t PIN, uint8_t LOCK_ANGLE, uint8_t UNLOCK_ANGLE, uint16_t MS_PER_60DEG, uint16_t SETTLE_MS>
+struct ServoActuator
+{
+    static void init(bool locked)
+    {
+        uint8_t target = locked ? LOCK_ANGLE : UNLOCK_ANGLE;
+        angle = locked ? UNLOCK_ANGLE : LOCK_ANGLE; // chưa biết vị trí thật -> ước tính cả hành trình
+        move_to(target);
+    }
+    static uint32_t lock() { return move_to(LOCK_ANGLE); }
+    static uint32_t unlock() { return move_to(UNLOCK_ANGLE); }
+
+    static void poll(unsigned long now)
+    {
+        if (attached && (long)(now - detach_at) >= 0)
+        {
+            servo.detach();
+            attached = false;
+        }
+    }
+
+    // Ước tính thời gian quay theo tốc độ datasheet (ms / 60 độ) + thời gian ổn định
+    static uint32_t motion_estimate(uint8_t from, uint8_t to)
+    {
+        uint16_t delta = (from > to) ? from - to : to - from;
+        return (uint32_t)delta * MS_PER_60DEG / 60 + SETTLE_MS;
+    }
+
+private:
+    static uint32_t move_to(uint8_t target)
+    {
+        uint32_t eta = motion_estimate(angle, target);
+        if (!attached)
+        {
+            servo.attach(PIN);
+            attached = true;
+        }
+        servo.write(target);
+        angle = target;
+        detach_at = millis() + eta;
+        return eta;
+    }
+
+    static Servo servo;
+    static uint8_t angle;
+    static bool attached;
+    static unsigned long detach_at;
+};
+
+template <uint8_t PIN, uint8_t LA, uint8_t UA, uint16_t MS, uint16_t ST>
+Servo ServoActuator<PIN, LA, UA, MS, ST>::servo;
+template <uint8_t PIN, uint8_t LA, uint8_t UA, uint16_t MS, uint16_t ST>
+uint8_t ServoActuator<PIN, LA, UA, MS, ST>::angle = LA;
+template <uint8_t PIN, uint8_t LA, uint8_t UA, uint16_t MS, uint16_t ST>
+bool ServoActuator<PIN, LA, UA, MS, ST>::attached = false;
+template <uint8_t PIN, uint8_t LA, uint8_t UA, uint16_t MS, uint16_t ST>
+unsigned long ServoActuator<PIN, LA, UA, MS, ST>::detach_at = 0;
+
+// ---------- Relay: giữ mức ACTIVE_LEVEL trong suốt thời gian mở ----------
+template <uint8_t PIN, uint8_t ACTIVE_LEVEL>
+struct RelayActuator
+{
+    static void init(bool locked)
+    {
+        digitalWrite(PIN, locked ? !ACTIVE_LEVEL : ACTIVE_LEVEL); // đặt mức trước khi bật output
+        pinMode(PIN, OUTPUT);
+    }
+    static uint32_t lock()
+    {
+        digitalWrite(PIN, !ACTIVE_LEVEL);
+        return 0;
+    }
+    static uint32_t unlock()
+    {
+        digitalWrite(PIN, ACTIVE_LEVEL);
+        return 0;
+    }
+    static void poll(unsigned long now) { (void)now; }
+};
+
+// ---------- Solenoid: chỉ cấp xung PULSE_MS khi mở, lò xo tự chốt lại ----------
+template <uint8_t PIN, uint8_t ACTIVE_LEVEL, uint16_t PULSE_MS>
+struct SolenoidPulseActuator
+{
+    static void init(bool locked)
+    {
+        // Không cấp xung lúc khởi động: cửa đang mở thì chốt lò xo chưa chạm, không cần mở
+        (void)locked;
+        digitalWrite(PIN, !ACTIVE_LEVEL);
+        pinMode(PIN, OUTPUT);
+    }
+    static uint32_t lock()
+    {
+        // Chốt lò xo tự khoá khi cửa đóng; chỉ cần chắc chắn cuộn dây đã ngắt
+        digitalWrite(PIN, !ACTIVE_LEVEL);
+        energized = false;
+        return 0;
+    }
+    static uint32_t unlock()
+    {
+        digitalWrite(PIN, ACTIVE_LEVEL);
+        energized = true;
+        pulse_end = millis() + PULSE_MS;
+        return PULSE_MS;
+    }
+    static void poll(unsigned long now)
+    {
+        if (energized && (long)(now - pulse_end) >= 0)
+        {
+            digitalWrite(PIN, !ACTIVE_LEVEL);
+            energized = false;
+        }
+    }
+
+private:
+    static bool energized;
+    static unsigned long pulse_end;
+};
+
+template <uint8_t PIN, uint8_t AL, uint16_t PM>
+bool SolenoidPulseActuator<PIN, AL, PM>::energized = false;
+template <uint8_t PIN, uint8_t AL, uint16_t PM>
+unsigned long SolenoidPulseActuator<PIN, AL, PM>::pulse_end = 0;
+
+#endif // DOOR_ACTUATOR_H_
@@ -0,0 +1,34 @@
+#include "door_fsm.h"
+
+// clang-format off
+const DoorTransition_t door_fsm_table[] = {
+    // from                           input                   to                             action           event
+    {DOOR_STATE_LOCKED,             DOOR_IN_UNLOCK_REQ,     DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_ACT_UNLOCK, DOOR_EVT_UNLOCKED},
+    {DOOR_STATE_LOCKED,             DOOR_IN_SENSOR_OPEN,    DOOR_STATE_FORCED_OPEN,        DOOR_ACT_NONE,   DOOR_EVT_FORCED_OPEN},
+
+    {DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_IN_SENSOR_OPEN,    DOOR_STATE_OPEN,               DOOR_ACT_NONE,   DOOR_EVT_OPENED},
+    {DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_IN_UNLOCK_TIMEOUT, DOOR_STATE_LOCKED,             DOOR_ACT_LOCK,   DOOR_EVT_WAIT_TIME_END_AND_LOCKED},
+    {DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_IN_LOCK_REQ,       DOOR_STATE_LOCKED,             DOOR_ACT_LOCK,   DOOR_EVT_LOCKED},
+
+    {DOOR_STATE_OPEN,               DOOR_IN_SENSOR_CLOSED,  DOOR_STATE_LOCKED,             DOOR_ACT_LOCK,   DOOR_EVT_CLOSED_AND_LOCKED},
+    {DOOR_STATE_OPEN,               DOOR_IN_HELD_TIMEOUT,   DOOR_STATE_OPEN,               DOOR_ACT_NONE,   DOOR_EVT_HELD_OPEN},
+    {DOOR_STATE_OPEN,               DOOR_IN_CLOSED_HELD,    DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_ACT_NONE,   DOOR_EVT_CLOSED_HELD},
+
+    {DOOR_STATE_FORCED_OPEN,        DOOR_IN_SENSOR_CLOSED,  DOOR_STATE_LOCKED,             DOOR_ACT_LOCK,   DOOR_EVT_CLOSED_AND_LOCKED},
+    {DOOR_STATE_FORCED_OPEN,        DOOR_IN_HELD_TIMEOUT,   DOOR_STATE_FORCED_OPEN,        DOOR_ACT_NONE,   DOOR_EVT_HELD_OPEN},
+};
+// clang-format on
+
+const uint8_t door_fsm_table_size = sizeof(door_fsm_table) / sizeof(door_fsm_table[0]);
+
+DoorTransition_t door_fsm_next(DoorFSMState_t state, DoorInput_t input)
+{
+    for (uint8_t i = 0; i < door_fsm_table_size; i++)
+    {
+        if (door_fsm_table[i].from == state && door_fsm_table[i].input == input)
+            return door_fsm_table[i];
+    }
+
+    DoorTransition_t stay = {state, input, state, DOOR_ACT_NONE, DOOR_EVT_NONE};
+    return stay;
+}
@@ -0,0 +1,48 @@
+#ifndef DOOR_FSM_H_
+#define DOOR_FSM_H_
+
+#include <stdint.h>
+#include "door_types.h"
+
+// ================== INPUT ==================
+// Các tín hiệu đầu vào của FSM (lệnh, cảm biến đã debounce, timer)
+typedef enum
+{
+    DOOR_IN_UNLOCK_REQ,     // lệnh mở khoá (vân tay / MQTT)
+    DOOR_IN_SENSOR_OPEN,    // cảm biến: cửa vừa mở
+    DOOR_IN_SENSOR_CLOSED,  // cảm biến: cửa vừa đóng
+    DOOR_IN_UNLOCK_TIMEOUT, // hết AUTO_LOCK_TIMEOUT mà chưa mở cửa
+    DOOR_IN_HELD_TIMEOUT,   // cửa mở quá DOOR_HELD_OPEN_TIMEOUT
+    DOOR_IN_LOCK_REQ,       // lệnh khoá (hết giờ giữ mở)
+    DOOR_IN_CLOSED_HELD,    // cảm biến: cửa vừa đóng khi đang giữ chốt mở
+    DOOR_IN_COUNT
+} DoorInput_t;
+
+// Hành động lên cơ cấu chốt khi chuyển trạng thái
+typedef enum
+{
+    DOOR_ACT_NONE,
+    DOOR_ACT_LOCK,
+    DOOR_ACT_UNLOCK
+} DoorAction_t;
+
+// ================== TABLE ==================
+struct DoorTransition_t
+{
+    DoorFSMState_t from;
+    DoorInput_t input;
+    DoorFSMState_t to;
+    DoorAction_t action;
+    DoorEvent_t event;
+};
+
+// Bảng chuyển trạng thái. Cặp (state, input) không có trong bảng
+// nghĩa là giữ nguyên trạng thái, không hành động, không phát event.
+extern const DoorTransition_t door_fsm_table[];
+extern const uint8_t door_fsm_table_size;
+
+// Tra bảng, không phụ thuộc phần cứng (dùng được trong unit test).
+// Luôn trả về một transition hợp lệ.
+DoorTransition_t door_fsm_next(DoorFSMState_t state, DoorInput_t input);
+
+#endif // DOOR_FSM_H_
@@ -0,0 +1,91 @@
+#include "door_persist.h"
+#include "app_config.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#define DOOR_PERSIST_MAGIC 0xD0012345UL
+
+struct DoorPersistRecord_t
+{
+    uint32_t magic;
+    uint32_t state;
+    uint32_t seq;
+    uint32_t check;
+};
+
+// Không bị xoá khi reset nóng; sau power-on nội dung là rác -> kiểm tra magic/check
+static RTC_NOINIT_ATTR DoorPersistRecord_t rtc_record;
+
+static uint32_t seq_reserved = 0; // seq lớn nhất đã "đặt chỗ" trong NVS
+
+static uint32_t record_check(const DoorPersistRecord_t *r)
+{
+    return ~(r->magic ^ (r->state * 0x9E3779B1UL) ^ (r->seq * 0x85EBCA6BUL));
+}
+
+static void rtc_commit(void)
+{
+    rtc_record.magic = DOOR_PERSIST_MAGIC;
+    rtc_record.check = record_check(&rtc_record);
+}
+
+static void nvs_reserve_seq(uint32_t upto)
+{
+    Preferences prefs;
+    if (prefs.begin("door", false))
+    {
+        prefs.putUInt("seq_blk", upto);
+        prefs.end();
+    }
+    seq_reserved = upto;
+}
+
+bool door_persist_load(DoorFSMState_t *state)
+{
+    Preferences prefs;
+    uint32_t nvs_blk = 0;
+    if (prefs.begin("door", true))
+    {
+        nvs_blk = prefs.getUInt("seq_blk", 0);
+        prefs.end();
+    }
+
+    bool valid = rtc_record.magic == DOOR_PERSIST_MAGIC &&
+                 rtc_record.check == record_check(&rtc_record) &&
+                 rtc_record.state < DOOR_STATE_COUNT;
+
+    if (valid)
+    {
+        *state = (DoorFSMState_t)rtc_record.state;
+        seq_reserved = nvs_blk;
+    }
+    else
+    {
+        // Cold boot: không biết seq thật, nhảy tới mốc đã đặt chỗ (luôn >= seq cũ)
+        rtc_record.state = DOOR_STATE_LOCKED;
+        rtc_record.seq = nvs_blk;
+        *state = DOOR_STATE_LOCKED;
+        nvs_reserve_seq(nvs_blk + DOOR_SEQ_BLOCK);
+    }
+    rtc_commit();
+
+    return valid;
+}
+
+void door_persist_save_state(DoorFSMState_t state)
+{
+    rtc_record.state = state;
+    rtc_commit();
+}
+
+uint32_t door_persist_next_seq(void)
+{
+    rtc_record.seq++;
+    rtc_commit();
+
+    if (rtc_record.seq >= seq_reserved)
+        nvs_reserve_seq(rtc_record.seq + DOOR_SEQ_BLOCK);
+
+    return rtc_record.seq;
+}
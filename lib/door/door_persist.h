@@ -0,0 +1,19 @@
+#ifndef DOOR_PERSIST_H_
+#define DOOR_PERSIST_H_
+
+#include <stdint.h>
+#include "door.h"
+
+// Lưu trạng thái FSM + số thứ tự event qua reset.
+//  - RTC (RTC_NOINIT): ghi mỗi lần chuyển trạng thái, không tốn flash,
+//    còn giữ qua watchdog / panic / brownout / reset mềm.
+//  - NVS: chỉ giữ "mốc" seq, ghi 1 lần mỗi DOOR_SEQ_BLOCK event và mỗi lần
+//    cold boot, để seq luôn tăng kể cả khi mất điện hẳn.
+
+// Trả về true nếu có bản ghi RTC hợp lệ (reset nóng); khi đó *state là trạng thái trước reset.
+bool door_persist_load(DoorFSMState_t *state);
+void door_persist_save_state(DoorFSMState_t state);
+// Cấp seq tiếp theo cho một door event
+uint32_t door_persist_next_seq(void);
+
+#endif // DOOR_PERSIST_H_
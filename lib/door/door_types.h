@@ -0,0 +1,45 @@
+#ifndef DOOR_TYPES_H_
+#define DOOR_TYPES_H_
+
+// Enum thuần của cửa, không phụ thuộc Arduino: door_fsm dùng được trong
+// unit test native (test/test_door_fsm)
+
+// ================== ENUM ==================
+
+// Trạng thái CHỐT (cơ cấu khoá)
+typedef enum
+{
+    DOOR_STATE_LOCKED,
+    DOOR_STATE_UNLOCKED_WAIT_OPEN, // unlock nhưng chưa mở
+    DOOR_STATE_OPEN,               // cửa đang mở
+    DOOR_STATE_FORCED_OPEN,        // cửa bị mở khi đang khoá (cạy cửa)
+    DOOR_STATE_COUNT
+} DoorFSMState_t;
+// Trạng thái CỬA (cảm biến cửa)
+enum DoorOpenState_t
+{
+
+    DOOR_CLOSED = 0, // cửa đóng
+    DOOR_OPEN = 1    // cửa đang mở
+};
+// Handle event
+// enum DoorRequest_t
+// {
+//     DOOR_REQUEST_UNLOCK, // yêu cầu mở khoá
+//     DOOR_REQUEST_NONE    // poll trạng thái cửa
+// };
+typedef enum
+{
+    DOOR_EVT_NONE,
+    DOOR_EVT_UNLOCKED,
+    DOOR_EVT_OPENED,
+    DOOR_EVT_CLOSED_AND_LOCKED,
+    DOOR_EVT_WAIT_TIME_END_AND_LOCKED,
+    DOOR_EVT_FORCED_OPEN, // alarm: cửa mở khi chốt vẫn khoá
+    DOOR_EVT_HELD_OPEN,   // alarm: cửa mở quá DOOR_HELD_OPEN_TIMEOUT
+    DOOR_EVT_RECOVERED,   // khởi động lại xong, đã đối chiếu trạng thái với cảm biến
+    DOOR_EVT_LOCKED,      // khoá theo DOOR_REQUEST_LOCK (hết giờ giữ mở)
+    DOOR_EVT_CLOSED_HELD  // cửa đóng khi đang giữ mở: chốt vẫn mở
+} DoorEvent_t;
+
+#endif // DOOR_TYPES_H_
@@ -0,0 +1,179 @@
+#include "event_bus.h"
+#include "app_config.h"
+#include "app_queue.h"
+#include "log.h"
+
+#define BUS_SUB_BIT(sub) (1u << (sub))
+
+// ===== Bảng route: loại event -> tập subscriber =====
+static const uint32_t bus_routes[BUS_EVT_COUNT] = {
+    /* BUS_EVT_DOOR        */ BUS_SUB_BIT(BUS_SUB_APP) | BUS_SUB_BIT(BUS_SUB_JOURNAL),
+    /* BUS_EVT_FINGERPRINT */ BUS_SUB_BIT(BUS_SUB_APP) | BUS_SUB_BIT(BUS_SUB_JOURNAL),
+};
+
+// ===== Queue của từng subscriber =====
+static const AppQueueId_t bus_sub_queue_id[BUS_SUB_COUNT] = {
+    /* BUS_SUB_APP     */ QUEUE_BUS_APP,
+    /* BUS_SUB_JOURNAL */ QUEUE_BUS_JOURNAL,
+};
+
+static const uint8_t bus_sub_queue_len[BUS_SUB_COUNT] = {
+    /* BUS_SUB_APP     */ BUS_APP_QUEUE_LEN,
+    /* BUS_SUB_JOURNAL */ BUS_JOURNAL_QUEUE_LEN,
+};
+
+static_assert(BUS_SUB_COUNT <= 32, "route là bitmask 32 bit");
+static_assert(BUS_ARENA_SIZE < 256, "free list dùng chỉ số 8 bit");
+
+static QueueHandle_t sub_queues[BUS_SUB_COUNT];
+
+// ===== Arena =====
+static BusEvent_t arena[BUS_ARENA_SIZE];
+static uint8_t free_list[BUS_ARENA_SIZE]; // stack chỉ số ô trống
+static uint8_t free_top = 0;
+static BusStats_t bus_stats;
+static portMUX_TYPE bus_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static BusEvent_t *bus_alloc(BusEventType_t type)
+{
+    BusEvent_t *evt = NULL;
+    portENTER_CRITICAL(&bus_mux);
+    if (free_top > 0)
+    {
+        evt = &arena[free_list[--free_top]];
+        bus_stats.in_use++;
+        if (bus_stats.in_use > bus_stats.high_water)
+            bus_stats.high_water = bus_stats.in_use;
+    }
+    else
+    {
+        bus_stats.arena_drops++;
+    }
+    portEXIT_CRITICAL(&bus_mux);
+
+    if (!evt)
+    {
+        LOG_W("[BUS] Arena full, event type %d dropped", type);
+        return NULL;
+    }
+    memset(evt, 0, sizeof(*evt));
+    evt->type = type;
+    evt->ts_ms = millis();
+    return evt;
+}
+
+static void bus_unref(BusEvent_t *evt)
+{
+    portENTER_CRITICAL(&bus_mux);
+    if (--evt->refs == 0)
+    {
+        free_list[free_top++] = (uint8_t)(evt - arena);
+        bus_stats.in_use--;
+    }
+    portEXIT_CRITICAL(&bus_mux);
+}
+
+// Publisher giữ 1 tham chiếu trong lúc phát để subscriber nhanh tay không trả ô
+// về arena trước khi vòng gửi kết thúc
+static bool bus_publish(BusEvent_t *evt)
+{
+    uint32_t mask = bus_routes[evt->type];
+    evt->refs = 1;
+    for (int sub = 0; sub < BUS_SUB_COUNT; sub++)
+        if (mask & BUS_SUB_BIT(sub))
+            evt->refs++;
+
+    bool delivered = false;
+    for (int sub = 0; sub < BUS_SUB_COUNT; sub++)
+    {
+        if (!(mask & BUS_SUB_BIT(sub)))
+            continue;
+        if (sub_queues[sub] && app_queue_send(sub_queues[sub], &evt, 0) == pdTRUE)
+        {
+            delivered = true;
+        }
+        else
+        {
+            portENTER_CRITICAL(&bus_mux);
+            bus_stats.queue_drops++;
+            portEXIT_CRITICAL(&bus_mux);
+            bus_unref(evt);
+        }
+    }
+
+    portENTER_CRITICAL(&bus_mux);
+    bus_stats.published++;
+    portEXIT_CRITICAL(&bus_mux);
+    bus_unref(evt);
+    return delivered;
+}
+
+bool event_bus_init(void)
+{
+    for (int i = 0; i < BUS_ARENA_SIZE; i++)
+        free_list[i] = BUS_ARENA_SIZE - 1 - i;
+    free_top = BUS_ARENA_SIZE;
+
+    bool ok = true;
+    for (int sub = 0; sub < BUS_SUB_COUNT; sub++)
+    {
+        sub_queues[sub] = app_queue_create(bus_sub_queue_id[sub], bus_sub_queue_len[sub], sizeof(BusEvent_t *));
+        if (!sub_queues[sub])
+        {
+            LOG_E("[BUS] Failed to create queue for subscriber %d", sub);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool event_bus_publish_door(DoorEvent_t evt, uint32_t seq)
+{
+    BusEvent_t *e = bus_alloc(BUS_EVT_DOOR);
+    if (!e)
+        return false;
+    e->door.evt = evt;
+    e->door.seq = seq;
+    return bus_publish(e);
+}
+
+bool event_bus_publish_fp(FingerprintEvent_t evt, int16_t id)
+{
+    BusEvent_t *e = bus_alloc(BUS_EVT_FINGERPRINT);
+    if (!e)
+        return false;
+    e->fp.evt = evt;
+    e->fp.id = id;
+    return bus_publish(e);
+}
+
+const BusEvent_t *event_bus_receive(BusSubscriber_t sub, TickType_t wait)
+{
+    BusEvent_t *evt = NULL;
+    if (sub >= BUS_SUB_COUNT || !sub_queues[sub])
+        return NULL;
+    if (app_queue_receive(sub_queues[sub], &evt, wait) != pdTRUE)
+        return NULL;
+    return evt;
+}
+
+bool event_bus_wake(BusSubscriber_t sub)
+{
+    BusEvent_t *none = NULL;
+    if (sub >= BUS_SUB_COUNT || !sub_queues[sub])
+        return false;
+    return app_queue_send(sub_queues[sub], &none, 0) == pdTRUE;
+}
+
+void event_bus_release(const BusEvent_t *evt)
+{
+    if (evt)
+        bus_unref(const_cast<BusEvent_t *>(evt));
+}
+
+void event_bus_get_stats(BusStats_t *out)
+{
+    portENTER_CRITICAL(&bus_mux);
+    *out = bus_stats;
+    portEXIT_CRITICAL(&bus_mux);
+}
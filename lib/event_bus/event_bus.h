@@ -0,0 +1,80 @@
+#ifndef EVENT_BUS_H_
+#define EVENT_BUS_H_
+
+#include <Arduino.h>
+#include "door.h"
+#include "fingerprint.h"
+
+// ================== EVENT BUS ==================
+// Producer (door, fingerprint) cấp một event trong arena dùng chung, điền dữ
+// liệu và publish. Bus gửi CON TRỎ tới queue của từng subscriber đăng ký cho
+// loại event đó trong bảng route (cố định lúc biên dịch, xem event_bus.cpp).
+// Event có đếm tham chiếu: mỗi subscriber gọi event_bus_release() sau khi xử lý,
+// subscriber cuối cùng trả ô về arena. Không copy event, producer không biết
+// có bao nhiêu subscriber.
+//
+// Thêm subscriber mới: thêm id vào BusSubscriber_t, một AppQueueId_t cho queue
+// của nó, rồi thêm bit vào bảng route. Producer không phải sửa.
+
+typedef enum
+{
+    BUS_EVT_DOOR,
+    BUS_EVT_FINGERPRINT,
+    BUS_EVT_COUNT
+} BusEventType_t;
+
+typedef enum
+{
+    BUS_SUB_APP,     // main.cpp: LCD, lệnh mở cửa, chuyển thành SystemEvent_t cho MQTT
+    BUS_SUB_JOURNAL, // attendance: nhật ký chấm công trên flash
+    BUS_SUB_COUNT
+} BusSubscriber_t;
+
+struct BusEvent_t
+{
+    BusEventType_t type;
+    uint32_t ts_ms; // millis() lúc publish
+    union
+    {
+        struct
+        {
+            DoorEvent_t evt;
+            uint32_t seq;
+        } door;
+        struct
+        {
+            FingerprintEvent_t evt;
+            int16_t id;
+        } fp;
+    };
+    uint8_t refs; // chỉ bus dùng
+};
+
+typedef struct
+{
+    uint32_t published;
+    uint32_t arena_drops; // arena hết ô, event bị bỏ
+    uint32_t queue_drops; // queue của một subscriber đầy, subscriber đó mất event
+    uint16_t in_use;
+    uint16_t high_water;
+} BusStats_t;
+
+// Tạo queue cho mọi subscriber, gọi trước khi bất kỳ producer nào chạy
+bool event_bus_init(void);
+
+// Publish có kiểu: cấp ô trong arena, điền dữ liệu, gửi tới các subscriber.
+// false nếu không subscriber nào nhận được.
+bool event_bus_publish_door(DoorEvent_t evt, uint32_t seq);
+bool event_bus_publish_fp(FingerprintEvent_t evt, int16_t id);
+
+// Chờ event kế tiếp của subscriber, NULL khi hết thời gian chờ hoặc bị
+// event_bus_wake() đánh thức. Event chỉ đọc, phải trả lại bằng event_bus_release().
+const BusEvent_t *event_bus_receive(BusSubscriber_t sub, TickType_t wait);
+// Đánh thức subscriber đang chờ trong event_bus_receive (nó nhận NULL), để
+// task subscriber xử lý việc khác (vd. yêu cầu từ MQTT) mà không phải poll
+bool event_bus_wake(BusSubscriber_t sub);
+void event_bus_release(const BusEvent_t *evt);
+
+void event_bus_get_stats(BusStats_t *out);
+
+#endif // EVENT_BUS_H_
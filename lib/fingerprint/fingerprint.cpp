@@ -1,5 +1,11 @@
 #include "fingerprint.h"
 #include "app_config.h"
+#include "config_store.h"
+#include "app_queue.h"
+#include "trace.h"
+#include "event_bus.h"
+#include "device_state.h"
+#include "supervisor.h"
 
 #include <Arduino.h>
 #include <Adafruit_Fingerprint.h>
@@ -8,31 +14,91 @@
 static HardwareSerial FPSerial(FP_UART_NUM);
 static Adafruit_Fingerprint finger(&FPSerial);
 static bool scan_enabled = true;
-static fingerprint_event_cb_t fp_evt_cb = nullptr;
 static FP_InternalState_t fp_state = FP_IDLE;
+static volatile bool s_abort = false; // supervisor yêu cầu bỏ lần chờ tay hiện tại
+
+// Số lần quét theo từng khung 5 phút, 12 khung = 1 giờ gần nhất
+#define FP_RATE_SLOT_MS 300000UL
+#define FP_RATE_SLOTS 12
+
+static FingerprintStats_t fp_stats;
+static uint16_t rate_count[FP_RATE_SLOTS];
+static uint32_t rate_epoch[FP_RATE_SLOTS]; // khung thời gian (millis / FP_RATE_SLOT_MS) của ô
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
 
 static QueueHandle_t _fp_req_queue = NULL; // Để ra lệnh mở
 static QueueHandle_t _report_queue = NULL; // Để báo cáo lên MQTT
 
-void fingerprint_register_event_callback(fingerprint_event_cb_t cb)
+static void fingerprint_emit_event(FingerprintEvent_t evt, uint16_t id = 0)
 {
-    fp_evt_cb = cb;
+    event_bus_publish_fp(evt, id);
+}
+// ===== helper: số mẫu đã lưu cho snapshot trạng thái (một lệnh UART) =====
+static void refresh_template_count()
+{
+    if (finger.getTemplateCount() == FINGERPRINT_OK)
+        device_state_set_fp(true, finger.templateCount);
 }
 
-static void fingerprint_emit_event(FingerprintEvent_t evt, uint16_t id = 0)
+// ===== helper: chờ người dùng (đặt / nhấc tay) =====
+// Không tính vào SLO vòng quét; false khi quá hạn hoặc supervisor yêu cầu huỷ
+static bool wait_user(unsigned long start_ms, unsigned long timeout_ms)
 {
-    if (fp_evt_cb)
-        fp_evt_cb(evt, id);
+    supervisor_feed(SUP_TASK_FP);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    return !s_abort && millis() - start_ms < timeout_ms;
 }
+
+// Supervisor thấy task treo: thoát vòng chờ tay đang chạy
+static void fingerprint_recover()
+{
+    s_abort = true;
+}
+
 // ===== helper: chờ nhấc tay =====
+// Cảm biến mất kết nối trả lỗi thay vì NOFINGER: không chờ mãi
 static void wait_finger_removed()
 {
+    unsigned long start = millis();
     while (finger.getImage() != FINGERPRINT_NOFINGER)
     {
-        delay(100);
+        if (!wait_user(start, FP_REMOVE_TIMEOUT_MS))
+            return;
     }
 }
 
+// ===== helper: thống kê =====
+static void record_scan(bool matched, uint32_t us)
+{
+    uint32_t epoch = millis() / FP_RATE_SLOT_MS;
+    uint8_t slot = epoch % FP_RATE_SLOTS;
+
+    portENTER_CRITICAL(&stats_mux);
+    fp_stats.scans++;
+    if (matched)
+        fp_stats.matches++;
+    fp_stats.scan_us_total += us;
+    if (rate_epoch[slot] != epoch)
+    {
+        rate_epoch[slot] = epoch; // ô cũ từ giờ trước -> dùng lại
+        rate_count[slot] = 0;
+    }
+    rate_count[slot]++;
+    portEXIT_CRITICAL(&stats_mux);
+}
+
+void fingerprint_get_stats(FingerprintStats_t *out)
+{
+    uint32_t epoch = millis() / FP_RATE_SLOT_MS;
+    portENTER_CRITICAL(&stats_mux);
+    *out = fp_stats;
+    out->scans_last_hour = 0;
+    for (int i = 0; i < FP_RATE_SLOTS; i++)
+        if (epoch - rate_epoch[i] < FP_RATE_SLOTS)
+            out->scans_last_hour += rate_count[i];
+    portEXIT_CRITICAL(&stats_mux);
+}
+
 // ===== helper: quét ID =====
 static int scan_fingerprint_id()
 {
@@ -40,11 +106,16 @@ static int scan_fingerprint_id()
     if (p != FINGERPRINT_OK)
         return -1; // Không thấy vân tay
 
+    TRACE_BEGIN(TRACE_SPAN_FP_MATCH);
     p = finger.image2Tz();
     if (p != FINGERPRINT_OK)
+    {
+        TRACE_END(TRACE_SPAN_FP_MATCH);
         return -2; // Lỗi chuyển đổi ảnh
+    }
 
     p = finger.fingerSearch();
+    TRACE_END(TRACE_SPAN_FP_MATCH);
     if (p != FINGERPRINT_OK)
         return -3; // Không tìm thấy ID khớp
 
@@ -57,12 +128,13 @@ static int enroll_fingerprint(uint16_t id)
     fingerprint_emit_event(FP_EVT_ENROLL_START, id);
 
     /* ===== STEP 1: lấy ảnh lần 1 ===== */
+    unsigned long start = millis();
     while ((p = finger.getImage()) != FINGERPRINT_OK)
     {
-        if (p == FINGERPRINT_NOFINGER)
-            vTaskDelay(pdMS_TO_TICKS(100));
-        else
+        if (p != FINGERPRINT_NOFINGER)
             return -1;
+        if (!wait_user(start, FP_ENROLL_STEP_TIMEOUT_MS))
+            return -7;
     }
 
     p = finger.image2Tz(1);
@@ -82,18 +154,23 @@ static int enroll_fingerprint(uint16_t id)
     fingerprint_emit_event(FP_EVT_ENROLL_STEP1_OK, id);
 
     /* ===== yêu cầu nhấc tay ===== */
+    start = millis();
     while (finger.getImage() != FINGERPRINT_NOFINGER)
-        vTaskDelay(pdMS_TO_TICKS(100));
+    {
+        if (!wait_user(start, FP_ENROLL_STEP_TIMEOUT_MS))
+            return -7;
+    }
 
     vTaskDelay(pdMS_TO_TICKS(500));
 
     /* ===== STEP 2: lấy ảnh lần 2 ===== */
+    start = millis();
     while ((p = finger.getImage()) != FINGERPRINT_OK)
     {
-        if (p == FINGERPRINT_NOFINGER)
-            vTaskDelay(pdMS_TO_TICKS(100));
-        else
+        if (p != FINGERPRINT_NOFINGER)
             return -3;
+        if (!wait_user(start, FP_ENROLL_STEP_TIMEOUT_MS))
+            return -7;
     }
 
     p = finger.image2Tz(2);
@@ -127,16 +204,20 @@ static int enroll_fingerprint(uint16_t id)
 
 bool fingerprint_init(void)
 {
-    FPSerial.begin(FP_BAUDRATE, SERIAL_8N1, FP_RX_PIN, FP_TX_PIN);
-    finger.begin(FP_BAUDRATE);
+    // fp_baud phải khớp baud đã lưu trong AS608, chỉ đọc lúc khởi động
+    uint32_t baud = config_get()->fp_baud;
+    FPSerial.begin(baud, SERIAL_8N1, FP_RX_PIN, FP_TX_PIN);
+    finger.begin(baud);
 
     if (finger.verifyPassword())
     {
+        refresh_template_count();
         fingerprint_emit_event(FP_EVT_INIT_OK);
         return true;
     }
     else
     {
+        device_state_set_fp(false, -1);
         fingerprint_emit_event(FP_EVT_INIT_FAIL);
         return false;
     }
@@ -153,32 +234,42 @@ static void taskFingerprint(void *pv)
 
     while (1)
     {
+        supervisor_begin(SUP_TASK_FP);
+        s_abort = false;
+
         /* ===== 1. Handle REQUEST ===== */
-        if (xQueueReceive(_fp_req_queue, &req, 0) == pdTRUE)
+        if (app_queue_receive(_fp_req_queue, &req, 0) == pdTRUE)
         {
             switch (req.type)
             {
             case FP_REQUEST_ENROLL:
+                TRACE_BEGIN(TRACE_SPAN_FP_ENROLL);
                 id = enroll_fingerprint(req.id);
+                TRACE_END(TRACE_SPAN_FP_ENROLL);
+                if (id >= 0)
+                    refresh_template_count();
                 fingerprint_emit_event(FP_EVT_ENROLL_DONE, id);
                 break;
 
             case FP_REQUEST_DELETE_ID:
                 finger.deleteModel(req.id);
+                refresh_template_count();
                 fingerprint_emit_event(FP_EVT_DELETE_DONE, req.id);
                 break;
 
             case FP_REQUEST_SHOW_ALL_ID:
-                finger.getTemplateCount();
+                refresh_template_count();
                 fingerprint_emit_event(FP_EVT_SHOW_ALL_DONE, finger.templateCount);
                 break;
 
             case FP_REQ_SCAN_ENABLE:
                 scan_enabled = true;
+                device_state_set_scan(true);
                 break;
 
             case FP_REQ_SCAN_DISABLE:
                 scan_enabled = false;
+                device_state_set_scan(false);
                 break;
             }
         }
@@ -186,14 +277,19 @@ static void taskFingerprint(void *pv)
         /* ===== 2. Runtime SCAN ===== */
         if (!scan_enabled)
         {
+            supervisor_end(SUP_TASK_FP);
             vTaskDelay(pdMS_TO_TICKS(50));
             continue;
         }
 
+        TRACE_BEGIN(TRACE_SPAN_FP_POLL);
         p = finger.getImage();
+        TRACE_END(TRACE_SPAN_FP_POLL);
         if (p == FINGERPRINT_OK)
         {
+            uint32_t t0 = micros();
             id = scan_fingerprint_id();
+            record_scan(id >= 0, micros() - t0);
             if (id >= 0)
                 fingerprint_emit_event(FP_EVT_SCAN_SUCCESS, id);
             else
@@ -202,6 +298,7 @@ static void taskFingerprint(void *pv)
             wait_finger_removed();
         }
 
+        supervisor_end(SUP_TASK_FP);
         vTaskDelay(pdMS_TO_TICKS(40));
     }
 }
@@ -209,6 +306,7 @@ static void taskFingerprint(void *pv)
 void fingerprint_start_task(QueueHandle_t fp_request_queue)
 {
     _fp_req_queue = fp_request_queue;
+    supervisor_register_recovery(SUP_TASK_FP, fingerprint_recover);
     xTaskCreatePinnedToCore(
         taskFingerprint,
         "TaskFingerprint",
@@ -216,5 +314,5 @@ void fingerprint_start_task(QueueHandle_t fp_request_queue)
         NULL,
         TASK_FP_PRIORITY,
         NULL,
-        1);
+        TASK_FP_CORE);
 }
\ No newline at end of file
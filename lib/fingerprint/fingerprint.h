@@ -31,14 +31,21 @@ typedef enum
     FP_WAIT_REMOVE, // chờ nhấc tay
 } FP_InternalState_t;
 
-typedef void (*fingerprint_event_cb_t)(
-    FingerprintEvent_t evt,
-    int16_t finger_id);
-void fingerprint_register_event_callback(fingerprint_event_cb_t cb);
+// Bộ đếm quét từ lúc khởi động (telemetry)
+typedef struct
+{
+    uint32_t scans;         // số lần có tay đặt lên và chạy so khớp
+    uint32_t matches;
+    uint32_t scan_us_total; // tổng thời gian so khớp (image2Tz + search)
+    uint32_t scans_last_hour;
+} FingerprintStats_t;
+
+// Event vân tay được publish lên event bus (BUS_EVT_FINGERPRINT) kèm finger id
 
 bool fingerprint_init(void);
 void fingerprint_scan_once(void);
 void fingerprint_poll(void);
 // Thay đổi hàm start để nhận 2 queue
 void fingerprint_start_task(QueueHandle_t fp_request_queue);
+void fingerprint_get_stats(FingerprintStats_t *out);
 #endif
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "log.h"
+#include "app_config.h"
+
+typedef struct
+{
+    uint32_t ts_ms;
+    const char *fmt;
+    uint8_t level;
+    uint8_t nargs;
+    uint8_t str_used;
+    LogArg_t args[LOG_MAX_ARGS]; // LOG_ARG_STR: .u = offset trong str[]
+    char str[LOG_STR_BYTES];
+} LogRecord_t;
+
+static LogRecord_t ring[LOG_RING_SIZE];
+static uint32_t ring_head = 0; // record tiếp theo được ghi
+static uint32_t ring_tail = 0; // record tiếp theo được in
+static LogStats_t stats;
+static portMUX_TYPE ring_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t log_task = NULL;
+
+void log_commit(uint8_t level, const char *fmt, const LogArg_t *args, uint8_t nargs)
+{
+    bool stored = false;
+
+    portENTER_CRITICAL(&ring_mux);
+    if (ring_head - ring_tail < LOG_RING_SIZE)
+    {
+        LogRecord_t *r = &ring[ring_head % LOG_RING_SIZE];
+        r->ts_ms = millis();
+        r->fmt = fmt;
+        r->level = level;
+        r->nargs = nargs;
+        r->str_used = 0;
+        for (uint8_t i = 0; i < nargs; i++)
+        {
+            r->args[i] = args[i];
+            if (args[i].type == LOG_ARG_STR)
+            {
+                // Chép chuỗi vào record: con trỏ gốc có thể là buffer tạm
+                uint8_t off = r->str_used;
+                size_t room = sizeof(r->str) - off;
+                size_t len = room ? strnlen(args[i].s, room - 1) : 0;
+                if (room)
+                {
+                    memcpy(&r->str[off], args[i].s, len);
+                    r->str[off + len] = '\0';
+                    r->str_used = off + len + 1;
+                }
+                r->args[i].u = room ? off : sizeof(r->str) - 1; // hết chỗ -> chuỗi rỗng cuối buffer
+            }
+        }
+        ring_head++;
+        stats.written++;
+        if (ring_head - ring_tail > stats.high_water)
+            stats.high_water = ring_head - ring_tail;
+        stored = true;
+    }
+    else
+    {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&ring_mux);
+
+    if (stored && log_task != NULL)
+        xTaskNotifyGive(log_task);
+}
+
+// Format 1 record theo fmt, mỗi chỉ thị % lấy 1 tham số theo đúng kiểu đã lưu
+static size_t log_format(const LogRecord_t *r, char *out, size_t len)
+{
+    static const char level_chr[] = "?EWID";
+    size_t n = snprintf(out, len, "%c (%u) ", level_chr[r->level < 5 ? r->level : 0], (unsigned)r->ts_ms);
+    uint8_t argi = 0;
+
+    for (const char *p = r->fmt; *p && n < len - 1; p++)
+    {
+        if (*p != '%')
+        {
+            out[n++] = *p;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out[n++] = '%';
+            p++;
+            continue;
+        }
+
+        // Gom chỉ thị: cờ / độ rộng / độ chính xác, bỏ length modifier (đã chuẩn hoá 32 bit)
+        char spec[16];
+        size_t s = 0;
+        spec[s++] = '%';
+        for (p++; *p && strchr("-+ #0123456789.", *p) && s < sizeof(spec) - 3; p++)
+            spec[s++] = *p;
+        while (*p && strchr("hlzjt", *p))
+            p++;
+        if (!*p)
+            break;
+        char conv = *p;
+        spec[s++] = conv;
+        spec[s] = '\0';
+
+        if (argi >= r->nargs)
+        {
+            n += snprintf(out + n, len - n, "%s", "<?>");
+            continue;
+        }
+        const LogArg_t *a = &r->args[argi++];
+        switch (conv)
+        {
+        case 's':
+            n += snprintf(out + n, len - n, spec, a->type == LOG_ARG_STR ? &r->str[a->u] : "<?>");
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            n += snprintf(out + n, len - n, spec, a->type == LOG_ARG_FLOAT ? (double)a->f : (double)a->i);
+            break;
+        case 'p':
+            n += snprintf(out + n, len - n, "%p", (void *)(uintptr_t)a->u);
+            break;
+        case 'd':
+        case 'i':
+        case 'c':
+            n += snprintf(out + n, len - n, spec, (int)a->i);
+            break;
+        default: // u x X o
+            n += snprintf(out + n, len - n, spec, (unsigned)a->u);
+            break;
+        }
+    }
+    if (n > len - 2)
+        n = len - 2;
+    out[n++] = '\n';
+    out[n] = '\0';
+    return n;
+}
+
+// In các record đang chờ; trả về false nếu ring rỗng
+static bool log_drain_one(char *line, size_t len)
+{
+    LogRecord_t rec;
+    static uint32_t reported_drops = 0;
+    uint32_t drops;
+
+    portENTER_CRITICAL(&ring_mux);
+    bool has = ring_tail != ring_head;
+    if (has)
+    {
+        rec = ring[ring_tail % LOG_RING_SIZE];
+        ring_tail++;
+    }
+    drops = stats.dropped;
+    portEXIT_CRITICAL(&ring_mux);
+
+    if (drops != reported_drops)
+    {
+        Serial.printf("[LOG] dropped %u records (ring %d)\n", (unsigned)(drops - reported_drops), LOG_RING_SIZE);
+        reported_drops = drops;
+    }
+    if (!has)
+        return false;
+
+    size_t n = log_format(&rec, line, len);
+    Serial.write((const uint8_t *)line, n);
+    return true;
+}
+
+static void TaskLog(void *pvParameters)
+{
+    (void)pvParameters;
+    static char line[LOG_LINE_BYTES];
+    for (;;)
+    {
+        while (log_drain_one(line, sizeof(line)))
+        {
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void log_start_task(void)
+{
+    // Ưu tiên thấp nhất trên core 0: UART chỉ chạy khi các task khác rảnh
+    xTaskCreatePinnedToCore(TaskLog, "TaskLog", TASK_LOG_STACK_SIZE, NULL, TASK_LOG_PRIORITY, &log_task, TASK_LOG_CORE);
+}
+
+void log_flush(void)
+{
+    char line[LOG_LINE_BYTES];
+    while (log_drain_one(line, sizeof(line)))
+    {
+    }
+    Serial.flush();
+}
+
+void log_get_stats(LogStats_t *out)
+{
+    portENTER_CRITICAL(&ring_mux);
+    *out = stats;
+    portEXIT_CRITICAL(&ring_mux);
+}
@@ -0,0 +1,152 @@
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <Arduino.h>
+#include <type_traits>
+
+// ================== DEFERRED LOG ==================
+// LOG_E / LOG_W / LOG_I / LOG_D thay cho Serial.print* trên hot path.
+//  - Mức thấp hơn LOG_LEVEL bị bỏ ngay lúc compile (không còn lệnh nào).
+//  - Task gọi log chỉ chép con trỏ format (chuỗi literal trong flash = "format ID")
+//    và tối đa LOG_MAX_ARGS tham số vào ring buffer, không format, không chờ UART.
+//  - Chuỗi %s được chép vào record (tối đa LOG_STR_BYTES, cắt bớt nếu dài hơn)
+//    nên truyền buffer tạm trên stack vẫn an toàn. Không truyền String, dùng .c_str().
+//  - TaskLog (ưu tiên thấp) format và in ra Serial; ring đầy thì record bị bỏ
+//    và được báo lại bằng dòng "[LOG] dropped N".
+// Format string được kiểm tra như printf lúc compile.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_MAX_ARGS 6
+#define LOG_STR_BYTES 48
+
+typedef enum
+{
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_FLOAT,
+    LOG_ARG_STR,
+} LogArgType_t;
+
+typedef struct
+{
+    uint8_t type; // LogArgType_t
+    union
+    {
+        int32_t i;
+        uint32_t u;
+        float f;
+        const char *s;
+    };
+} LogArg_t;
+
+typedef struct
+{
+    uint32_t written;
+    uint32_t dropped; // ring đầy
+    uint16_t high_water;
+} LogStats_t;
+
+// ---------- đóng gói tham số theo kiểu (chọn lúc compile) ----------
+inline LogArg_t log_arg(const char *s)
+{
+    LogArg_t a;
+    a.type = LOG_ARG_STR;
+    a.s = s ? s : "(null)";
+    return a;
+}
+inline LogArg_t log_arg(char *s) { return log_arg((const char *)s); }
+inline LogArg_t log_arg(double v)
+{
+    LogArg_t a;
+    a.type = LOG_ARG_FLOAT;
+    a.f = (float)v;
+    return a;
+}
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, LogArg_t>::type
+log_arg(T v)
+{
+    // Record chỉ giữ 32 bit: int64_t / uint64_t / time_t (64 bit trên IDF 5) bị cắt
+    // âm thầm. Ép về 32 bit ở chỗ gọi nếu giá trị chắc chắn vừa, hoặc đổi ra chuỗi.
+    static_assert(sizeof(T) <= sizeof(uint32_t), "LOG_*: 64-bit argument, cast to 32 bit or format to a string");
+    LogArg_t a;
+    if (std::is_signed<T>::value)
+    {
+        a.type = LOG_ARG_INT;
+        a.i = (int32_t)v;
+    }
+    else
+    {
+        a.type = LOG_ARG_UINT;
+        a.u = (uint32_t)v;
+    }
+    return a;
+}
+template <typename T>
+inline LogArg_t log_arg(T *p)
+{
+    LogArg_t a;
+    a.type = LOG_ARG_UINT;
+    a.u = (uint32_t)(uintptr_t)p;
+    return a;
+}
+
+void log_commit(uint8_t level, const char *fmt, const LogArg_t *args, uint8_t nargs);
+
+template <typename... Args>
+inline void log_write(uint8_t level, const char *fmt, Args... args)
+{
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "LOG_*: too many arguments");
+    const LogArg_t packed[sizeof...(Args) + 1] = {log_arg(args)...};
+    log_commit(level, fmt, packed, sizeof...(Args));
+}
+
+// Chỉ để compiler kiểm tra format như printf, không bao giờ được gọi
+inline void log_format_check(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+inline void log_format_check(const char *fmt, ...) { (void)fmt; }
+
+#define LOG_AT(level, fmt, ...)                          \
+    do                                                   \
+    {                                                    \
+        if (0)                                           \
+            log_format_check(fmt, ##__VA_ARGS__);        \
+        log_write(level, fmt, ##__VA_ARGS__);            \
+    } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_E(fmt, ...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_W(fmt, ...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_I(fmt, ...) ((void)0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_D(fmt, ...) ((void)0)
+#endif
+
+// Tạo TaskLog; record ghi trước khi task chạy vẫn nằm chờ trong ring
+void log_start_task(void);
+// In hết record đang chờ ngay trong task gọi (trước esp_restart...)
+void log_flush(void);
+void log_get_stats(LogStats_t *out);
+
+#endif // LOG_H_
@@ -0,0 +1,192 @@
+#include "memprof.h"
+#include "app_config.h"
+#include "config_store.h"
+#include "app_queue.h"
+#include "utils.h"
+#include "log.h"
+
+#include <esp_heap_caps.h>
+
+static MemSnapshot_t snapshot;
+static portMUX_TYPE snap_mux = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t _report_queue = NULL;
+static TaskHandle_t memprof_task = NULL;
+
+/* ===== CALL SITE COUNTERS (-Wl,--wrap) ===== */
+#ifdef MEMPROF_WRAP_MALLOC
+
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_calloc(size_t n, size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+static MemAllocSite_t sites[MEMPROF_MAX_SITES];
+static uint32_t sites_overflow = 0; // cấp phát từ call site không còn chỗ trong bảng
+static portMUX_TYPE sites_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Địa chỉ trả về trên Xtensa mang 2 bit window ở đầu -> đưa về vùng IROM/IRAM
+static inline uint32_t caller_pc(void *ra)
+{
+    return ((uint32_t)(uintptr_t)ra & 0x3FFFFFFF) | 0x40000000;
+}
+
+static void IRAM_ATTR count_site(uint32_t pc, size_t size)
+{
+    // Bảng băm mở, không cấp phát, chạy được trong mọi ngữ cảnh malloc
+    uint32_t h = (pc >> 2) % MEMPROF_MAX_SITES;
+    portENTER_CRITICAL_SAFE(&sites_mux);
+    for (int i = 0; i < MEMPROF_MAX_SITES; i++)
+    {
+        MemAllocSite_t *s = &sites[(h + i) % MEMPROF_MAX_SITES];
+        if (s->pc == pc || s->pc == 0)
+        {
+            s->pc = pc;
+            s->count++;
+            s->bytes += size;
+            portEXIT_CRITICAL_SAFE(&sites_mux);
+            return;
+        }
+    }
+    sites_overflow++;
+    portEXIT_CRITICAL_SAFE(&sites_mux);
+}
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+    count_site(caller_pc(__builtin_return_address(0)), size);
+    return __real_malloc(size);
+}
+
+extern "C" void *__wrap_calloc(size_t n, size_t size)
+{
+    count_site(caller_pc(__builtin_return_address(0)), n * size);
+    return __real_calloc(n, size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+    count_site(caller_pc(__builtin_return_address(0)), size);
+    return __real_realloc(ptr, size);
+}
+
+size_t memprof_get_sites(MemAllocSite_t *out, size_t max)
+{
+    MemAllocSite_t copy[MEMPROF_MAX_SITES];
+    portENTER_CRITICAL(&sites_mux);
+    memcpy(copy, sites, sizeof(copy));
+    portEXIT_CRITICAL(&sites_mux);
+
+    // Chọn max phần tử lớn nhất (bảng nhỏ, selection sort là đủ)
+    size_t n = 0;
+    for (; n < max; n++)
+    {
+        int best = -1;
+        for (int i = 0; i < MEMPROF_MAX_SITES; i++)
+            if (copy[i].count && (best < 0 || copy[i].count > copy[best].count))
+                best = i;
+        if (best < 0)
+            break;
+        out[n] = copy[best];
+        copy[best].count = 0;
+    }
+    return n;
+}
+
+#else
+
+size_t memprof_get_sites(MemAllocSite_t *out, size_t max)
+{
+    (void)out;
+    (void)max;
+    return 0;
+}
+
+#endif // MEMPROF_WRAP_MALLOC
+
+/* ===== SAMPLING ===== */
+// Chỉ chạy trong TaskMemProf; lấy mẫu vào bản nháp rồi mới chép vào snapshot
+static void memprof_sample(void)
+{
+    static MemSnapshot_t s;
+
+    s.taken_ms = millis();
+    s.heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    s.heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    s.heap_largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    // uxTaskGetSystemState trả 0 nếu mảng nhỏ hơn số task: cấp theo số task hiện có
+    UBaseType_t cap = uxTaskGetNumberOfTasks() + MEMPROF_TASK_HEADROOM;
+    TaskStatus_t *status = (TaskStatus_t *)pvPortMalloc(cap * sizeof(TaskStatus_t));
+    UBaseType_t n = status ? uxTaskGetSystemState(status, cap, NULL) : 0;
+    if (n == 0)
+        LOG_W("[MEM] Task list unavailable (%u tasks)", (unsigned)uxTaskGetNumberOfTasks());
+
+    for (UBaseType_t i = 0; i < n; i++)
+        if (status[i].usStackHighWaterMark < MEMPROF_STACK_WARN_BYTES)
+            LOG_W("[MEM] task %s stack low: %u B free", status[i].pcTaskName,
+                  (unsigned)status[i].usStackHighWaterMark);
+
+    // Quá MEMPROF_MAX_TASKS: giữ các task ít stack nhất (sắp xếp chọn một phần)
+    UBaseType_t keep = n < MEMPROF_MAX_TASKS ? n : MEMPROF_MAX_TASKS;
+    if (keep < n)
+    {
+        for (UBaseType_t i = 0; i < keep; i++)
+        {
+            UBaseType_t min = i;
+            for (UBaseType_t j = i + 1; j < n; j++)
+                if (status[j].usStackHighWaterMark < status[min].usStackHighWaterMark)
+                    min = j;
+            TaskStatus_t tmp = status[i];
+            status[i] = status[min];
+            status[min] = tmp;
+        }
+    }
+
+    s.task_total = n;
+    s.task_count = keep;
+    for (UBaseType_t i = 0; i < keep; i++)
+    {
+        strncpy(s.tasks[i].name, status[i].pcTaskName, sizeof(s.tasks[i].name) - 1);
+        s.tasks[i].name[sizeof(s.tasks[i].name) - 1] = '\0';
+        s.tasks[i].stack_free = status[i].usStackHighWaterMark;
+        s.tasks[i].core = status[i].xCoreID > 1 ? 2 : status[i].xCoreID;
+    }
+    vPortFree(status);
+
+    portENTER_CRITICAL(&snap_mux);
+    snapshot = s;
+    portEXIT_CRITICAL(&snap_mux);
+}
+
+void memprof_get_snapshot(MemSnapshot_t *out)
+{
+    portENTER_CRITICAL(&snap_mux);
+    *out = snapshot;
+    portEXIT_CRITICAL(&snap_mux);
+}
+
+static void TaskMemProf(void *pvParameters)
+{
+    (void)pvParameters;
+    SystemEvent_t evt = {};
+    evt.type = EVT_MEM_REPORT;
+
+    for (;;)
+    {
+        memprof_sample();
+        event_stamp(&evt);
+        app_queue_send(_report_queue, &evt, 0);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(config_get()->memprof_ms));
+    }
+}
+
+void memprof_start_task(QueueHandle_t report_queue)
+{
+    _report_queue = report_queue;
+    xTaskCreatePinnedToCore(TaskMemProf, "MemProf", TASK_MEMPROF_STACK_SIZE, NULL, TASK_MEMPROF_PRIORITY, &memprof_task, TASK_MEMPROF_CORE);
+}
+
+void memprof_request_report(void)
+{
+    if (memprof_task != NULL)
+        xTaskNotifyGive(memprof_task);
+}
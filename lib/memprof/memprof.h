@@ -0,0 +1,54 @@
+#ifndef MEMPROF_H_
+#define MEMPROF_H_
+
+#include <Arduino.h>
+
+// ================== MEMORY PROFILER ==================
+// Task nền lấy mẫu định kỳ:
+//  - stack high-watermark (byte còn trống ít nhất từ lúc chạy) của mọi task
+//  - heap: free / min free từ lúc boot / block trống lớn nhất (phân mảnh)
+// Số lần cấp phát theo call site chỉ có khi link với
+//   build_flags = -DMEMPROF_WRAP_MALLOC -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+// (call site = địa chỉ trả về của lệnh gọi malloc, giải bằng xtensa-esp32-elf-addr2line).
+
+// Firmware ~14 task + Arduino/IDF ~10 (IDLE, Tmr Svc, ipc, esp_timer, wifi, tiT...).
+// Nhiều task hơn thì snapshot giữ các task còn ít stack nhất.
+#define MEMPROF_MAX_TASKS 32
+// Chừa thêm chỗ cho task được tạo giữa uxTaskGetNumberOfTasks và uxTaskGetSystemState
+#define MEMPROF_TASK_HEADROOM 4
+#define MEMPROF_MAX_SITES 16
+
+typedef struct
+{
+    char name[configMAX_TASK_NAME_LEN];
+    uint16_t stack_free; // byte (ESP-IDF tính stack theo byte)
+    uint8_t core;        // 0, 1, hoặc 2 = không pin
+} MemTaskInfo_t;
+
+typedef struct
+{
+    uint32_t taken_ms;
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint32_t heap_largest; // largest / free nhỏ dần = heap đang phân mảnh
+    uint8_t task_count; // số task trong tasks[]
+    uint8_t task_total; // số task đang chạy lúc lấy mẫu
+    MemTaskInfo_t tasks[MEMPROF_MAX_TASKS];
+} MemSnapshot_t;
+
+typedef struct
+{
+    uint32_t pc; // địa chỉ lệnh gọi malloc / calloc / realloc
+    uint32_t count;
+    uint32_t bytes;
+} MemAllocSite_t;
+
+// Task lấy mẫu mỗi MEMPROF_INTERVAL_MS, gửi EVT_MEM_REPORT vào report_queue
+void memprof_start_task(QueueHandle_t report_queue);
+// Đánh thức task lấy mẫu + báo cáo ngay (lệnh MQTT mem_report)
+void memprof_request_report(void);
+void memprof_get_snapshot(MemSnapshot_t *out);
+// Các call site cấp phát nhiều nhất (giảm dần theo count), trả về số phần tử; 0 nếu không bật wrap
+size_t memprof_get_sites(MemAllocSite_t *out, size_t max);
+
+#endif // MEMPROF_H_
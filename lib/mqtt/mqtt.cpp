@@ -1,8 +1,24 @@
 #include "mqtt.h"
 #include "network.h"
 #include "app_config.h"
+#include "app_queue.h"
+#include "trace.h"
 #include "utils.h"
 #include "display.h"      // For send_lcd_message
+#include "door.h"
+#include "boot.h"
+#include "timesync.h"
+#include "memprof.h"
+#include "telemetry.h"
+#include "log.h"
+#include "msg_pool.h"
+#include "cpu_load.h"
+#include "attendance.h"
+#include "device_state.h"
+#include "ota.h"
+#include "config_store.h"
+#include "schedule.h"
+#include "supervisor.h"
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 
@@ -15,7 +31,86 @@ static QueueHandle_t door_cmd_queue = NULL;
 static QueueHandle_t fp_request_queue = NULL;
 
 static SemaphoreHandle_t mqtt_client_mutex;
-static String client_id;
+static char client_id[24];     // "esp32-" + MAC
+static char topic_prefix[64];  // mqtt_base "/" client_id, đổi trong TaskMQTTClientLoop khi giữ mutex
+static char broker_host[sizeof(((AppSettings_t *)0)->mqtt_host)]; // PubSubClient giữ con trỏ domain
+static volatile bool s_reconfigure = false; // config_store đổi nhóm MQTT
+static volatile bool s_mqtt_connected = false; // cập nhật trong TaskMQTTClientLoop, đọc không cần mutex
+static volatile bool s_net_up = false;         // trạng thái link do WiFi manager báo
+static TaskHandle_t mqtt_loop_task = NULL;
+static uint32_t mqtt_connects = 0;
+// boot_report chưa gửi được: ms tới khi sẵn sàng cục bộ (0 = không có report chờ)
+static volatile uint32_t boot_report_ready_ms = 0;
+static volatile bool boot_report_new = false; // vừa yêu cầu, có thể đã có broker từ trước
+// Bit CONNECTED: TaskMqttPublish chờ bit này thay vì bỏ event khi chưa có broker
+static EventGroupHandle_t mqtt_state_group = NULL;
+#define MQTT_CONNECTED_BIT (1 << 0)
+
+// Topic đầy đủ của thiết bị: "<base>/<client_id>/<leaf>"
+static const char *mqtt_topic(char *buf, size_t len, const char *leaf)
+{
+    snprintf(buf, len, "%s/%s", topic_prefix, leaf);
+    return buf;
+}
+
+// Broker / keepalive / topic base từ config_store. Gọi trước khi có task hoặc khi giữ mqtt_client_mutex
+static void mqtt_apply_settings(void)
+{
+    const AppSettings_t *cfg = config_get();
+    strcpy(broker_host, cfg->mqtt_host);
+    mqtt.setServer(broker_host, cfg->mqtt_port);
+    mqtt.setKeepAlive(cfg->mqtt_keepalive_s);
+    snprintf(topic_prefix, sizeof(topic_prefix), "%s/%s", cfg->mqtt_base, client_id);
+}
+
+static void mqtt_emit_event(MqttEvent_t evt)
+{
+    if (mqtt_evt_cb)
+      mqtt_evt_cb(evt);
+}
+
+static void mqtt_set_connected(bool connected)
+{
+    s_mqtt_connected = connected;
+    if (connected)
+      xEventGroupSetBits(mqtt_state_group, MQTT_CONNECTED_BIT);
+    else
+      xEventGroupClearBits(mqtt_state_group, MQTT_CONNECTED_BIT);
+}
+
+bool mqtt_is_connected(void)
+{
+    return s_mqtt_connected;
+}
+
+uint32_t mqtt_get_reconnects(void)
+{
+    return mqtt_connects > 1 ? mqtt_connects - 1 : 0;
+}
+
+void mqtt_reconfigure(void)
+{
+    s_reconfigure = true;
+    if (mqtt_loop_task != NULL)
+      xTaskNotifyGive(mqtt_loop_task);
+}
+
+void mqtt_notify_network(bool up)
+{
+    s_net_up = up;
+    if (!up && mqtt_state_group != NULL)
+      mqtt_set_connected(false);
+    // Đánh thức TaskMQTTClientLoop để kết nối lại ngay khi có mạng
+    if (mqtt_loop_task != NULL)
+      xTaskNotifyGive(mqtt_loop_task);
+}
+
+// Alarm cửa / queue drop: heartbeat về chu kỳ ngắn, gửi sớm thay vì chờ hết chu kỳ
+static void mqtt_wake_for_telemetry(void)
+{
+    if (mqtt_loop_task != NULL)
+      xTaskNotifyGive(mqtt_loop_task);
+}
 
 void mqtt_register_event_callback(mqtt_event_cb_t cb)
 {
@@ -24,60 +119,204 @@ void mqtt_register_event_callback(mqtt_event_cb_t cb)
 
 static void callback(char *topic, byte *payload, unsigned int length)
 {
-  char expect_topic[128];
-  snprintf(
-      expect_topic,
-      sizeof(expect_topic),
-      "%s/%s/command",
-      MQTT_TOPIC_BASE,
-      client_id.c_str());
-
-  if (strcmp(topic, expect_topic) != 0)
+  // "<prefix>/command": so phần đầu và phần đuôi, không dựng chuỗi tạm
+  size_t prefix_len = strlen(topic_prefix);
+  if (strncmp(topic, topic_prefix, prefix_len) != 0)
+  {
+    return; // không phải của device này
+  }
+  if (strcmp(topic + prefix_len, "/ota/data") == 0)
+  {
+    // Chunk nhị phân: chép vào block POOL_OTA_RX, TaskOta áp delta
+    ota_submit_chunk(payload, length);
+    return;
+  }
+  if (strcmp(topic + prefix_len, "/command") != 0)
+  {
+    return;
+  }
+
+  // Block thuộc MqttControlTask sau khi gửi thành công
+  MqttMsg *msg = (MqttMsg *)msg_pool_alloc(POOL_MQTT_RX);
+  if (msg == NULL)
+  {
+    LOG_W("[MQTT] Command dropped, rx pool empty");
+    return;
+  }
+
+  strncpy(msg->topic, topic, sizeof(msg->topic) - 1);
+  msg->topic[sizeof(msg->topic) - 1] = '\0';
+
+  int copyLen = min((int)sizeof(msg->payload) - 1, (int)length);
+  memcpy(msg->payload, payload, copyLen);
+  msg->payload[copyLen] = '\0';
+
+  // config_set có thể chứa mật khẩu WiFi / broker: không đưa vào log
+  bool secret = strstr(msg->payload, "config_set") != NULL;
+  LOG_I("[MQTT] Command received: %s", secret ? "config_set" : msg->payload);
+
+  if (mqtt_payload_queue == NULL || app_queue_send(mqtt_payload_queue, &msg, 0) != pdTRUE)
+  {
+    msg_pool_free(POOL_MQTT_RX, msg);
+  }
+}
+
+// Print gom text thành từng gói ~512 byte (cắt ở cuối dòng) rồi publish lên topic.
+// Dùng cho các dump dài (trace) không vừa một message.
+class MqttChunkPrint : public Print
+{
+public:
+  explicit MqttChunkPrint(const char *topic) : _topic(topic) {}
+  ~MqttChunkPrint() { send(); }
+
+  size_t write(uint8_t c) override
   {
-    return; // không phải command của device này
+    _buf[_len++] = (char)c;
+    if ((c == '\n' && _len > sizeof(_buf) - 96) || _len == sizeof(_buf) - 1)
+      send();
+    return 1;
   }
+  using Print::write;
 
-  MqttMsg msg = {0};
+private:
+  void send()
+  {
+    if (_len == 0)
+      return;
+    _buf[_len] = '\0';
+    if (xSemaphoreTake(mqtt_client_mutex, pdMS_TO_TICKS(2000)))
+    {
+      if (mqtt.connected())
+        mqtt.publish(_topic, _buf);
+      xSemaphoreGive(mqtt_client_mutex);
+    }
+    _len = 0;
+  }
 
-  strncpy(msg.topic, topic, sizeof(msg.topic) - 1);
+  const char *_topic;
+  char _buf[512];
+  size_t _len = 0;
+};
 
-  int copyLen = min((int)sizeof(msg.payload) - 1, (int)length);
-  memcpy(msg.payload, payload, copyLen);
-  msg.payload[copyLen] = '\0';
+// Trả lời config_get / config_set trên .../config (chỉ MqttControlTask dùng)
+static char cfg_reply[768];
 
-  if (mqtt_payload_queue != NULL) {
-      xQueueSend(mqtt_payload_queue, &msg, 0);
+// {"cmd":"config_set","set":{"auto_lock_ms":8000,"wifi_ssid":"x"},"rev":12}
+// "rev" (tuỳ chọn): rev backend đọc được lần trước, khác rev hiện tại thì từ chối
+// để hai backend không ghi đè nhau. Một key sai thì không key nào được áp dụng.
+static void handle_config_update(JsonDocument &doc, bool reset)
+{
+  const char *err = NULL;
+  const char *err_key = "";
+  size_t len;
+  if (!config_begin())
+  {
+    err = "busy";
+  }
+  else
+  {
+    if (!doc["rev"].isNull() && (doc["rev"] | 0UL) != config_revision())
+      err = "rev_mismatch";
+    else if (reset)
+      config_stage_defaults();
+    else
+      err = config_stage_json(doc["set"].as<JsonObjectConst>(), &err_key);
+    if (err)
+      config_abort();
   }
 
-  Serial.print("[MQTT] Command received: ");
-  Serial.println(msg.payload);
+  if (err)
+  {
+    len = snprintf(cfg_reply, sizeof(cfg_reply), "{\"rev\":%lu,\"err\":\"%s\",\"key\":\"%.32s\"}",
+                   (unsigned long)config_revision(), err, err_key);
+    LOG_W("[MQTT CTRL] Config rejected: %s %s", err_key, err);
+  }
+  else
+  {
+    len = config_commit(cfg_reply, sizeof(cfg_reply));
+  }
+  mqtt_publish("config", cfg_reply, min(len, sizeof(cfg_reply) - 1), false);
+  config_notify();
+}
+
+// Trả lời sched_* trên .../schedule: bảng rule, hoặc lỗi kèm id
+static char sched_reply[1152];
+
+static void publish_schedule(const char *err, int id)
+{
+  size_t len;
+  if (err)
+  {
+    len = snprintf(sched_reply, sizeof(sched_reply), "{\"rev\":%lu,\"err\":\"%s\",\"id\":%d}",
+                   (unsigned long)schedule_revision(), err, id);
+    LOG_W("[MQTT CTRL] Schedule rule %d rejected: %s", id, err);
+  }
+  else
+  {
+    len = schedule_to_json(sched_reply, sizeof(sched_reply));
+  }
+  if (len)
+    mqtt_publish("schedule", sched_reply, len, false);
+}
+
+// {"cmd":"sched_put","id":1,"at":"08:00","days":[1,2,3,4,5],"do":"door_hold"}
+// "days": mảng tm_wday (0 = Chủ nhật) hoặc mask; bỏ trống = mọi ngày
+static const char *parse_schedule_rule(JsonDocument &doc, ScheduleRule_t *r)
+{
+  memset(r, 0, sizeof(*r));
+  int id = doc["id"] | 0;
+  if (id <= 0 || id > 255)
+    return "bad_id";
+  r->id = (uint8_t)id;
+  if (!schedule_parse_time(doc["at"].as<const char *>(), &r->at_s))
+    return "bad_time";
+  if (!schedule_parse_action(doc["do"].as<const char *>(), &r->action))
+    return "bad_action";
+
+  JsonVariant days = doc["days"];
+  if (days.isNull())
+    r->days = 0x7F;
+  else if (days.is<JsonArray>())
+  {
+    for (JsonVariant d : days.as<JsonArray>())
+    {
+      int wd = d | -1;
+      if (wd < 0 || wd > 6)
+        return "bad_days";
+      r->days |= 1u << wd;
+    }
+  }
+  else
+    r->days = days | 0;
+  return NULL;
 }
 
 static void MqttControlTask(void *pvParameter)
 {
-  MqttMsg msg;
-  Serial.println("[MQTT] Control task started");
+  MqttMsg *msg;
+  LOG_I("[MQTT] Control task started");
   while (1)
   {
-    if (xQueueReceive(mqtt_payload_queue, &msg, portMAX_DELAY))
+    supervisor_end(SUP_TASK_MQTT_CMD);
+    if (app_queue_receive(mqtt_payload_queue, &msg, portMAX_DELAY))
     {
-      Serial.print("[MQTT CTRL] Topic: ");
-      Serial.println(msg.topic);
-      Serial.print("[MQTT CTRL] Payload: ");
-      Serial.println(msg.payload);
+      supervisor_begin(SUP_TASK_MQTT_CMD);
+      LOG_D("[MQTT CTRL] Topic: %s", msg->topic);
 
-      StaticJsonDocument<256> doc;
-      auto err = deserializeJson(doc, msg.payload);
+      JsonDocument doc(msg_pool_json(POOL_JSON_RX));
+      // deserializeJson chép chuỗi vào arena, trả block ngay cho callback dùng lại
+      auto err = deserializeJson(doc, (const char *)msg->payload);
+      msg_pool_free(POOL_MQTT_RX, msg);
       if (err)
       {
-        Serial.println("[MQTT CTRL] JSON parse failed");
+        LOG_W("[MQTT CTRL] JSON parse failed");
         continue;
       }
 
       const char *cmd = doc["cmd"];
       if (!cmd)
       {
-        Serial.println("[MQTT CTRL] Missing cmd");
+        LOG_W("[MQTT CTRL] Missing cmd");
         continue;
       }
 
@@ -85,25 +324,24 @@ static void MqttControlTask(void *pvParameter)
       if (strcasecmp(cmd, "door_unlock") == 0)
       {
         DoorRequest_t door_cmd = DOOR_REQUEST_UNLOCK;
-        xQueueSend(door_cmd_queue, &door_cmd, 0);
+        app_queue_send(door_cmd_queue, &door_cmd, 0);
 
-        Serial.println("[MQTT CTRL] Door unlock request");
+        LOG_I("[MQTT CTRL] Door unlock request");
       }
       /* ========= FINGERPRINT ENROLL ========= */
       else if (strcasecmp(cmd, "fp_enroll") == 0)
       {
         int id = doc["id"] | -1;
         if (id < 0)
-          if (id < 0)
-          {
-            Serial.println("[MQTT CTRL] fp_delete missing id");
-            continue;
-          }
+        {
+          LOG_W("[MQTT CTRL] fp_enroll missing id");
+          continue;
+        }
         FingerprintRequestMsg_t req;
         req.type = FP_REQUEST_ENROLL;
         req.id = id;
-        xQueueSend(fp_request_queue, &req, 0);
-        Serial.printf("[MQTT CTRL] FP enroll request");
+        app_queue_send(fp_request_queue, &req, 0);
+        LOG_I("[MQTT CTRL] FP enroll request, id=%d", id);
       }
       /* ========= FINGERPRINT DELETE ========= */
       else if (strcasecmp(cmd, "fp_delete") == 0)
@@ -111,14 +349,14 @@ static void MqttControlTask(void *pvParameter)
         int id = doc["id"] | -1;
         if (id < 0)
         {
-          Serial.println("[MQTT CTRL] fp_delete missing id");
+          LOG_W("[MQTT CTRL] fp_delete missing id");
           continue;
         }
         FingerprintRequestMsg_t req;
         req.type = FP_REQUEST_DELETE_ID;
         req.id = id;
-        xQueueSend(fp_request_queue, &req, 0);
-        Serial.printf("[MQTT CTRL] FP delete request, id=%d\n", id);
+        app_queue_send(fp_request_queue, &req, 0);
+        LOG_I("[MQTT CTRL] FP delete request, id=%d", id);
       }
       /* ========= FINGERPRINT SHOW ALL ========= */
       else if (strcasecmp(cmd, "fp_show_all") == 0)
@@ -126,100 +364,437 @@ static void MqttControlTask(void *pvParameter)
         FingerprintRequestMsg_t req;
         req.type = FP_REQUEST_SHOW_ALL_ID;
         req.id = 0;
-        xQueueSend(fp_request_queue, &req, 0);
-        Serial.println("[MQTT CTRL] FP show all IDs request");
+        app_queue_send(fp_request_queue, &req, 0);
+        LOG_I("[MQTT CTRL] FP show all IDs request");
+      }
+      /* ========= MEMORY REPORT ========= */
+      else if (strcasecmp(cmd, "mem_report") == 0)
+      {
+        memprof_request_report();
+        LOG_I("[MQTT CTRL] Memory report request");
+      }
+      /* ========= TRACE DUMP ========= */
+      else if (strcasecmp(cmd, "trace_dump") == 0)
+      {
+        // {"cmd":"trace_dump"} -> topic .../trace, {"cmd":"trace_dump","to":"serial"} -> Serial
+        const char *to = doc["to"] | "mqtt";
+        if (strcasecmp(to, "serial") == 0)
+        {
+          trace_dump(Serial);
+        }
+        else
+        {
+          char trace_topic[80];
+          MqttChunkPrint out(mqtt_topic(trace_topic, sizeof(trace_topic), "trace"));
+          trace_dump(out);
+        }
+        LOG_I("[MQTT CTRL] Trace dumped");
+      }
+      /* ========= ATTENDANCE ========= */
+      else if (strcasecmp(cmd, "att_query") == 0)
+      {
+        // {"cmd":"att_query","since_seq":N,"from":T0,"to":T1,"limit":L,"q":tag}
+        AttQuery_t q;
+        q.since_seq = doc["since_seq"] | 0UL;
+        q.from_ts = doc["from"] | 0UL;
+        q.to_ts = doc["to"] | 0UL;
+        uint16_t limit = doc["limit"] | 0;
+        uint32_t tag = doc["q"] | 0UL;
+        attendance_request_query(&q, limit, tag);
+        LOG_I("[MQTT CTRL] Attendance query since=%lu q=%lu", (unsigned long)q.since_seq, (unsigned long)tag);
+      }
+      else if (strcasecmp(cmd, "att_daily") == 0)
+      {
+        attendance_request_daily();
+        LOG_I("[MQTT CTRL] Attendance daily summary request");
+      }
+      else if (strcasecmp(cmd, "att_ack") == 0)
+      {
+        uint32_t seq = doc["seq"] | 0UL;
+        attendance_ack(seq);
+        LOG_I("[MQTT CTRL] Attendance ack seq=%lu", (unsigned long)seq);
+      }
+      /* ========= CONFIG ========= */
+      else if (strcasecmp(cmd, "config_get") == 0)
+      {
+        size_t len = config_to_json(cfg_reply, sizeof(cfg_reply));
+        mqtt_publish("config", cfg_reply, len, false);
+        LOG_I("[MQTT CTRL] Config get, rev %lu", (unsigned long)config_revision());
+      }
+      else if (strcasecmp(cmd, "config_set") == 0)
+      {
+        handle_config_update(doc, false);
+      }
+      else if (strcasecmp(cmd, "config_reset") == 0)
+      {
+        // Về mặc định của firmware (app_config.h), cùng đường đi với config_set
+        handle_config_update(doc, true);
+      }
+      /* ========= SCHEDULE ========= */
+      else if (strcasecmp(cmd, "sched_get") == 0)
+      {
+        publish_schedule(NULL, 0);
+        LOG_I("[MQTT CTRL] Schedule get, rev %lu", (unsigned long)schedule_revision());
+      }
+      else if (strcasecmp(cmd, "sched_put") == 0)
+      {
+        ScheduleRule_t rule;
+        const char *err = parse_schedule_rule(doc, &rule);
+        if (!err)
+          err = schedule_put(&rule);
+        publish_schedule(err, doc["id"] | 0);
+        if (!err)
+          LOG_I("[MQTT CTRL] Schedule rule %u: %s", rule.id, schedule_action_to_str(rule.action));
+      }
+      else if (strcasecmp(cmd, "sched_del") == 0)
+      {
+        int id = doc["id"] | 0;
+        const char *err = id > 0 && id <= 255 ? schedule_delete((uint8_t)id) : "bad_id";
+        publish_schedule(err, id);
+        if (!err)
+          LOG_I("[MQTT CTRL] Schedule rule %d deleted", id);
+      }
+      else if (strcasecmp(cmd, "sched_clear") == 0)
+      {
+        schedule_clear();
+        publish_schedule(NULL, 0);
+        LOG_I("[MQTT CTRL] Schedule cleared");
+      }
+      /* ========= OTA ========= */
+      else if (strcasecmp(cmd, "ota_begin") == 0)
+      {
+        // {"cmd":"ota_begin","size":N}: N = kích thước file delta
+        uint32_t size = doc["size"] | 0UL;
+        if (size > 0)
+          ota_request_begin(size);
+        LOG_I("[MQTT CTRL] OTA begin, delta %lu B", (unsigned long)size);
+      }
+      else if (strcasecmp(cmd, "ota_abort") == 0)
+      {
+        ota_request_abort();
+        LOG_I("[MQTT CTRL] OTA abort");
       }
       else if (strcasecmp(cmd, "device_get_status") == 0)
       {
 
-        SystemEvent_t req;
+        SystemEvent_t req = {};
         req.type = EVT_STATUS_ONLINE;
-        xQueueSend(system_evt_queue, &req, 0);
-        Serial.println("[MQTT CTRL] get device's status request");
+        app_queue_send(system_evt_queue, &req, 0);
+        LOG_I("[MQTT CTRL] get device's status request");
       }
       else
       {
-        Serial.print("[MQTT CTRL] Unknown cmd: ");
-        Serial.println(cmd);
+        LOG_W("[MQTT CTRL] Unknown cmd: %s", cmd);
       }
     }
   }
 }
 
+// boot_report lên .../status. Gọi từ TaskMQTTClientLoop ngay sau khi kết nối,
+// trước khi bật MQTT_CONNECTED_BIT: TaskMqttPublish (có thể đang giữ sẵn một
+// event) chưa được publish nên report luôn là event đầu tiên. Một lần mỗi boot:
+// JsonDocument dùng heap thay vì arena POOL_JSON_TX của TaskMqttPublish.
+static bool publish_boot_report(uint32_t local_ready_ms)
+{
+  char ts[ISO_TIMESTAMP_LEN];
+  JsonDocument doc;
+  doc["device"] = client_id;
+  doc["ts"] = get_iso_timestamp(ts, sizeof(ts));
+  doc["tq"] = timesync_quality_to_str(timesync_quality());
+  // stage: [start_ms, took_ms], stage chưa xong (vd. NTP) chỉ có start
+  doc["event"] = "boot_report";
+  doc["task_profile"] = TASK_PROFILE == TASK_PROFILE_DUAL_CORE ? "dual_core" : "single_core";
+  doc["reset_reason"] = reset_reason_to_str(esp_reset_reason());
+  JsonObject stages = doc["stages"].to<JsonObject>();
+  for (int i = 0; i < BOOT_STAGE_COUNT; i++)
+  {
+    const BootStageInfo_t *st = boot_stage_info((BootStage_t)i);
+    JsonArray a = stages[boot_stage_name((BootStage_t)i)].to<JsonArray>();
+    a.add(st->start_ms);
+    if (st->end_ms)
+      a.add(st->end_ms - st->start_ms);
+  }
+  doc["local_ready_ms"] = local_ready_ms;
+  // Lần chạy trước bị supervisor reset vì task treo
+  uint32_t stall_ms;
+  int sup_task = supervisor_last_reset(&stall_ms);
+  if (sup_task >= 0)
+  {
+    JsonObject sup = doc["sup_reset"].to<JsonObject>();
+    sup["task"] = supervisor_task_name((SupTaskId_t)sup_task);
+    sup["stall_ms"] = stall_ms;
+  }
+
+  size_t len = measureJson(doc);
+  char *buf = (char *)malloc(len + 1);
+  if (buf == NULL)
+    return false;
+  serializeJson(doc, buf, len + 1);
+  bool ok = mqtt_publish("status", buf, len, false);
+  free(buf);
+  if (ok)
+    LOG_I("[MQTT] Boot report published (%u B)", (unsigned)len);
+  else
+    LOG_W("[MQTT] Boot report not sent, retry on next connect");
+  return ok;
+}
+
+void mqtt_request_boot_report(uint32_t local_ready_ms)
+{
+  boot_report_ready_ms = local_ready_ms ? local_ready_ms : 1;
+  boot_report_new = true;
+  // Có thể đã lên broker trước khi setup xong: loop task gửi ở vòng kế tiếp
+  if (mqtt_loop_task != NULL)
+    xTaskNotifyGive(mqtt_loop_task);
+}
+
 static void TaskMQTTClientLoop(void *pvParameters)
 {
   (void)pvParameters;
 
-  String cmd_topic;
-  String status_topic;
-  SystemEvent_t req;
+  char cmd_topic[80];
+  char avail_topic[80];
+  char ota_topic[80];
+  SystemEvent_t req = {};
 
-  cmd_topic = String(MQTT_TOPIC_BASE) + "/" + client_id + "/command";
-  status_topic = String(MQTT_TOPIC_BASE) + "/" + client_id + "/status";
+  mqtt_topic(cmd_topic, sizeof(cmd_topic), "command");
+  mqtt_topic(ota_topic, sizeof(ota_topic), "ota/data");
+  // Retained "online" / "offline" (Last Will): broker tự báo thiết bị mất kết nối
+  mqtt_topic(avail_topic, sizeof(avail_topic), "availability");
   static unsigned long last_heartbeat_time = 0;
+  bool was_connected = false;
 
-  Serial.println("[MQTT] Client Loop task started");
+  LOG_I("[MQTT] Client Loop task started");
   while (1)
   {
+    supervisor_begin(SUP_TASK_MQTT_LOOP);
+    if (!s_net_up)
+    {
+      // Không có mạng: không thử connect, chỉ đóng socket cũ rồi chờ WiFi manager báo
+      if (xSemaphoreTake(mqtt_client_mutex, pdMS_TO_TICKS(2000)))
+      {
+        if (mqtt.connected())
+          mqtt.disconnect();
+        xSemaphoreGive(mqtt_client_mutex);
+      }
+      if (was_connected)
+      {
+        was_connected = false;
+        mqtt_emit_event(MQTT_NET_DISCONECTED);
+      }
+      mqtt_set_connected(false);
+      supervisor_end(SUP_TASK_MQTT_LOOP);
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+
+    bool connect_failed = false;
+    bool now_connected = s_mqtt_connected;
     if (xSemaphoreTake(mqtt_client_mutex, pdMS_TO_TICKS(2000)))
     {
+      if (s_reconfigure)
+      {
+        s_reconfigure = false;
+        if (mqtt.connected())
+        {
+          // disconnect() chủ động không kích hoạt Last Will: tự báo offline trên topic cũ
+          mqtt.publish(avail_topic, "offline", true);
+          mqtt.disconnect();
+        }
+        mqtt_apply_settings();
+        mqtt_topic(cmd_topic, sizeof(cmd_topic), "command");
+        mqtt_topic(ota_topic, sizeof(ota_topic), "ota/data");
+        mqtt_topic(avail_topic, sizeof(avail_topic), "availability");
+        LOG_I("[MQTT] Settings changed, broker %s", broker_host);
+      }
+
       if (!mqtt.connected())
       {
-        Serial.println("[MQTT] Not connected, reconnecting...");
+        const AppSettings_t *cfg = config_get();
+        LOG_I("[MQTT] Connecting as %s", client_id);
 
-        if (mqtt.connect(client_id.c_str(), MQTT_USERNAME, MQTT_PASSWORD))
+        TRACE_BEGIN(TRACE_SPAN_MQTT_CONNECT);
+        bool connected = mqtt.connect(client_id, cfg->mqtt_user[0] ? cfg->mqtt_user : NULL,
+                                      cfg->mqtt_pass[0] ? cfg->mqtt_pass : NULL,
+                                      avail_topic, 1, true, "offline");
+        TRACE_END(TRACE_SPAN_MQTT_CONNECT);
+        if (connected)
         {
-          Serial.println("[MQTT] Reconnected");
-          mqtt.subscribe(cmd_topic.c_str());
+          LOG_I("[MQTT] Connected");
+          mqtt_connects++;
+          mqtt.publish(avail_topic, "online", true);
+          mqtt.subscribe(cmd_topic);
+          mqtt.subscribe(ota_topic);
 
+          // Heartbeat đầy đủ ngay khi lên, sau đó chu kỳ bắt đầu lại từ mức ngắn nhất
+          telemetry_reset_interval();
+          last_heartbeat_time = millis();
           req.type = EVT_STATUS_ONLINE;
-          xQueueSend(system_evt_queue, &req, 0);
+          app_queue_send(system_evt_queue, &req, 0);
 
-          Serial.print("[MQTT] Subscribed: ");
-          Serial.println(cmd_topic);
+          LOG_I("[MQTT] Subscribed: %s", cmd_topic);
         }
         else
         {
-          Serial.printf("[MQTT] Reconnect failed, state=%d\n", mqtt.state());
+          LOG_W("[MQTT] Connect failed, state=%d", mqtt.state());
+          connect_failed = true;
         }
       }
       else
       {
+        TRACE_BEGIN(TRACE_SPAN_MQTT_LOOP);
         mqtt.loop();
+        TRACE_END(TRACE_SPAN_MQTT_LOOP);
       }
+      now_connected = mqtt.connected();
+      // Bit CONNECTED chỉ bật sau boot_report (bên dưới)
+      if (!now_connected)
+        mqtt_set_connected(false);
       xSemaphoreGive(mqtt_client_mutex);
     }
-    if (millis() - last_heartbeat_time > 60000)
+
+    // Phát event ngoài mutex: handler có thể gửi queue / LCD
+    if (now_connected != was_connected)
+    {
+      was_connected = now_connected;
+      // Trước boot_report: main.cpp ghi nhận stage MQTT xong
+      mqtt_emit_event(was_connected ? MQTT_NET_CONNECTED : MQTT_NET_DISCONECTED);
+    }
+    else if (connect_failed)
+    {
+      mqtt_emit_event(MQTT_NET_CONNECT_FAIL);
+      // Broker không trả lời: không thử lại dồn dập, nhưng vẫn dậy ngay nếu mạng đổi trạng thái
+      supervisor_end(SUP_TASK_MQTT_LOOP);
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(2000));
+    }
+    if (now_connected)
+    {
+      // Chỉ thử ở lần kết nối mới (bit chưa bật) hoặc ngay sau khi setup yêu cầu
+      if (boot_report_ready_ms && (!s_mqtt_connected || boot_report_new))
+      {
+        boot_report_new = false;
+        if (publish_boot_report(boot_report_ready_ms))
+          boot_report_ready_ms = 0;
+      }
+      if (!s_mqtt_connected)
+        mqtt_set_connected(true); // TaskMqttPublish bắt đầu gửi event đang chờ
+    }
+    if (s_mqtt_connected && millis() - last_heartbeat_time >= telemetry_interval_ms())
     {
       last_heartbeat_time = millis();
+      telemetry_schedule_next();
 
-      SystemEvent_t hb_req;
+      SystemEvent_t hb_req = {};
       hb_req.type = EVT_STATUS_ONLINE;
-      xQueueSend(system_evt_queue, &hb_req, 0);
+      app_queue_send(system_evt_queue, &hb_req, 0);
 
-      Serial.println("[MQTT LOOP] Triggered 60s Heartbeat");
+      LOG_I("[MQTT LOOP] Heartbeat, next in %u s", (unsigned)(telemetry_interval_ms() / 1000));
     }
-    vTaskDelay(pdMS_TO_TICKS(100));
+    supervisor_end(SUP_TASK_MQTT_LOOP);
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
   }
 }
 
 // Bổ sung extern nếu cần gộp handler thông báo lỗi vân tay từ main.cpp
 extern const char *fingerprint_enroll_fault_handler(int16_t err);
 
+// Print đệm nhỏ ghi thẳng vào socket giữa beginPublish / endPublish:
+// serializeJson không cần buffer bằng cả payload
+class MqttStreamPrint : public Print
+{
+public:
+  ~MqttStreamPrint() { flush(); }
+
+  size_t write(uint8_t c) override
+  {
+    _buf[_len++] = c;
+    if (_len == sizeof(_buf))
+      flush();
+    return 1;
+  }
+  using Print::write;
+
+  void flush() override
+  {
+    if (_len)
+      mqtt.write(_buf, _len);
+    _len = 0;
+  }
+
+private:
+  uint8_t _buf[128];
+  size_t _len = 0;
+};
+
+bool mqtt_publish(const char *leaf, const char *payload, size_t len, bool retained)
+{
+  char topic[80];
+  bool ok = false;
+  if (xSemaphoreTake(mqtt_client_mutex, pdMS_TO_TICKS(2000)))
+  {
+    mqtt_topic(topic, sizeof(topic), leaf); // topic_prefix chỉ đổi khi giữ mutex
+    if (mqtt.connected() && mqtt.beginPublish(topic, len, retained))
+    {
+      ok = mqtt.write((const uint8_t *)payload, len) == len;
+      ok = mqtt.endPublish() && ok;
+    }
+    xSemaphoreGive(mqtt_client_mutex);
+  }
+  return ok;
+}
+
+// .../state/delta (field vừa đổi) rồi .../state (retained, đủ field)
+static void publish_device_state(void)
+{
+  char buf[192];
+  DeviceState_t st;
+  uint32_t v;
+  uint16_t changed = device_state_take(&st, &v);
+  if (!changed)
+    return;
+
+  size_t len = device_state_to_json(&st, changed, v, buf, sizeof(buf));
+  bool ok = len && mqtt_publish("state/delta", buf, len, false);
+  len = device_state_to_json(&st, STATE_F_ALL, v, buf, sizeof(buf));
+  ok = len && mqtt_publish("state", buf, len, true) && ok;
+  if (!ok)
+    device_state_restore(changed); // kết nối lại sẽ gọi device_state_mark_all
+  LOG_D("[MQTT] State v%lu published (fields 0x%02x)", (unsigned long)v, changed);
+}
+
 static void TaskMqttPublish(void *pvParameter)
 {
   SystemEvent_t evt;
-  char payload[256]; 
+  char ts[ISO_TIMESTAMP_LEN];
 
-  Serial.println("[MQTT] Publish task started");
+  LOG_I("[MQTT] Publish task started");
 
   for (;;)
   {
-    if (xQueueReceive(system_evt_queue, &evt, portMAX_DELAY) == pdTRUE)
+    if (app_queue_receive(system_evt_queue, &evt, portMAX_DELAY) == pdTRUE)
     {
-      StaticJsonDocument<256> doc;
+      if (evt.type == EVT_STATE_CHANGED)
+      {
+        // Không dựng JsonDocument: snapshot nhỏ, ghi bằng snprintf
+        xEventGroupWaitBits(mqtt_state_group, MQTT_CONNECTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+        publish_device_state();
+        continue;
+      }
+
+      JsonDocument doc(msg_pool_json(POOL_JSON_TX));
       doc["device"] = client_id;
-      doc["ts"] = get_iso_timestamp();
+      // Giờ lúc event xảy ra (có thể đã chờ trong queue khi mất broker) và
+      // độ tin cậy của nó lúc đó: "ntp" / "stale" / "none" (xem timesync_quality)
+      if (evt.ts_s)
+      {
+        doc["ts"] = format_iso_timestamp(evt.ts_s, evt.ts_ms, ts, sizeof(ts));
+        doc["tq"] = timesync_quality_to_str((TimeSyncQuality_t)evt.tq);
+      }
+      else
+      {
+        doc["ts"] = get_iso_timestamp(ts, sizeof(ts));
+        doc["tq"] = timesync_quality_to_str(timesync_quality());
+      }
 
       switch (evt.type)
       {
@@ -261,35 +836,216 @@ static void TaskMqttPublish(void *pvParameter)
         doc["event"] = "door_state";
         doc["state"] = "open";
         break;
+      case EVT_DOOR_FORCED_OPEN:
+        doc["event"] = "door_alarm";
+        doc["alarm"] = "forced_open";
+        break;
+      case EVT_DOOR_HELD_OPEN:
+        doc["event"] = "door_alarm";
+        doc["alarm"] = "held_open";
+        doc["held_s"] = evt.value;
+        break;
+      case EVT_DOOR_RECOVERED:
+      {
+        const DoorRecoveryInfo_t *rec = door_get_recovery_info();
+        doc["event"] = "door_recovered";
+        doc["state"] = door_state_to_str(rec->state);
+        if (rec->warm)
+          doc["prev_state"] = door_state_to_str(rec->prev_state);
+        doc["reset_reason"] = reset_reason_to_str(rec->reset_reason);
+        doc["recover_us"] = rec->recover_us;
+        break;
+      }
       case EVT_STATUS_ONLINE:
+      {
+        Telemetry_t tm;
+        telemetry_collect(&tm);
+        // ntp -> stale chỉ do thời gian trôi, không có event: cập nhật theo nhịp heartbeat
+        device_state_set_tq(timesync_quality());
         doc["event"] = "device_status";
         doc["status"] = "online";
+        doc["up"] = tm.uptime_s;
+        doc["rssi"] = tm.rssi;
+        doc["net_rc"] = tm.net_reconnects;
+        doc["mqtt_rc"] = tm.mqtt_reconnects;
+        doc["heap"] = tm.heap_free;
+        doc["heap_min"] = tm.heap_min_free;
+        doc["scans_h"] = tm.scans_last_hour;
+        doc["scan_ms"] = tm.scan_avg_ms;
+        doc["door_cycles"] = tm.door_cycles;
+        doc["log_drop"] = tm.log_drops;
+        doc["att_seq"] = attendance_head_seq(); // backend so với seq đã lưu để biết cần att_query
+        doc["cfg_rev"] = config_revision();     // khác rev backend biết -> config_get
+        // Tải CPU: hiện tại và lớn nhất từ heartbeat trước, [core0, core1]
+        if (tm.cpu_load[0] >= 0)
+        {
+          JsonArray cpu = doc["cpu"].to<JsonArray>();
+          cpu.add(tm.cpu_load[0]);
+          cpu.add(tm.cpu_load[1]);
+          JsonArray cpu_peak = doc["cpu_peak"].to<JsonArray>();
+          cpu_peak.add(cpu_load_take_peak(0));
+          cpu_peak.add(cpu_load_take_peak(1));
+        }
+        if (tm.unlock_max_ms)
+        {
+          doc["unlock_ms"] = tm.unlock_ms;
+          doc["unlock_max_ms"] = tm.unlock_max_ms;
+        }
+        doc["next_s"] = telemetry_interval_ms() / 1000; // heartbeat kế tiếp dự kiến
+        // Sức khoẻ queue: {"system_evt":{"len":10,"hw":3,"tx":..,"drop":..,"max_ms":..,"wait":[<1ms,<10ms,<100ms,<1s,<10s,>=10s]}}
+        JsonObject queues = doc["queues"].to<JsonObject>();
+        for (int i = 0; i < QUEUE_ID_COUNT; i++)
+        {
+          AppQueueStats_t qs;
+          if (!app_queue_get_stats((AppQueueId_t)i, &qs))
+            continue;
+          JsonObject q = queues[app_queue_name((AppQueueId_t)i)].to<JsonObject>();
+          q["len"] = qs.length;
+          q["hw"] = qs.high_water;
+          q["tx"] = qs.sends;
+          q["drop"] = qs.drops;
+          q["max_ms"] = qs.max_wait_ms;
+          JsonArray wait = q["wait"].to<JsonArray>();
+          for (int b = 0; b < APP_QUEUE_WAIT_BUCKETS; b++)
+            wait.add(qs.wait_hist[b]);
+        }
+        // Supervisor: {"door":[iter_max_ms, period_max_ms, violations, stalls]} từ lúc boot
+        JsonObject slo = doc["slo"].to<JsonObject>();
+        for (int i = 0; i < SUP_TASK_COUNT; i++)
+        {
+          SupTaskStats_t st;
+          supervisor_get_stats((SupTaskId_t)i, &st);
+          if (st.iterations == 0)
+            continue;
+          JsonArray a = slo[supervisor_task_name((SupTaskId_t)i)].to<JsonArray>();
+          a.add(st.iter_max_ms);
+          a.add(st.period_max_ms);
+          a.add(st.violations);
+          a.add(st.stalls);
+        }
+        // Pool: {"mqtt_rx":[high_water, capacity, exhausted]}, arena json_* tính theo byte
+        JsonObject pools = doc["pools"].to<JsonObject>();
+        for (int i = 0; i < POOL_ID_COUNT; i++)
+        {
+          MsgPoolStats_t ps;
+          if (!msg_pool_get_stats((MsgPoolId_t)i, &ps))
+            continue;
+          JsonArray a = pools[msg_pool_name((MsgPoolId_t)i)].to<JsonArray>();
+          a.add(ps.high_water);
+          a.add(ps.capacity);
+          a.add(ps.exhausted);
+        }
         break;
+      }
+      case EVT_SLO_VIOLATION:
+      {
+        // {"door":{"period":[worst_ms, slo_ms, count]},"fp":{"iter":[...]}} từ event trước
+        SupViolation_t v[SUP_TASK_COUNT];
+        size_t n = supervisor_take_violations(v, SUP_TASK_COUNT);
+        if (n == 0)
+          continue;
+        doc["event"] = "slo_violation";
+        JsonObject tasks = doc["tasks"].to<JsonObject>();
+        for (size_t i = 0; i < n; i++)
+        {
+          JsonObject t = tasks[supervisor_task_name(v[i].id)].to<JsonObject>();
+          if (v[i].iter_count)
+          {
+            JsonArray a = t["iter"].to<JsonArray>();
+            a.add(v[i].iter_worst_ms);
+            a.add(supervisor_iter_slo_ms(v[i].id));
+            a.add(v[i].iter_count);
+          }
+          if (v[i].period_count)
+          {
+            JsonArray a = t["period"].to<JsonArray>();
+            a.add(v[i].period_worst_ms);
+            a.add(supervisor_period_slo_ms(v[i].id));
+            a.add(v[i].period_count);
+          }
+        }
+        break;
+      }
+      case EVT_TASK_STALL:
+      {
+        SupTaskStats_t st;
+        supervisor_get_stats((SupTaskId_t)evt.value, &st);
+        doc["event"] = "task_stall";
+        doc["task"] = supervisor_task_name((SupTaskId_t)evt.value);
+        doc["stall_ms"] = st.stall_age_ms;
+        doc["action"] = supervisor_stall_action((SupTaskId_t)evt.value);
+        break;
+      }
+      case EVT_MEM_REPORT:
+      {
+        // stack: {"task": byte trống ít nhất}, heap: [free, min_free, largest_block]
+        static MemSnapshot_t snap; // ~700 byte, để ngoài stack của task
+        memprof_get_snapshot(&snap);
+        doc["event"] = "mem_report";
+        JsonArray heap = doc["heap"].to<JsonArray>();
+        heap.add(snap.heap_free);
+        heap.add(snap.heap_min_free);
+        heap.add(snap.heap_largest);
+        doc["tasks"] = snap.task_total; // nhiều hơn số mục trong stack: chỉ giữ task ít stack nhất
+        JsonObject stack = doc["stack"].to<JsonObject>();
+        for (int i = 0; i < snap.task_count; i++)
+          stack[snap.tasks[i].name] = snap.tasks[i].stack_free;
+
+        // Chỉ có khi build với MEMPROF_WRAP_MALLOC: {"0x400d1234": [count, bytes]}
+        MemAllocSite_t sites[8];
+        size_t n = memprof_get_sites(sites, 8);
+        if (n)
+        {
+          JsonObject alloc = doc["alloc"].to<JsonObject>();
+          char pc[12];
+          for (size_t i = 0; i < n; i++)
+          {
+            snprintf(pc, sizeof(pc), "0x%08x", (unsigned)sites[i].pc);
+            JsonArray a = alloc[pc].to<JsonArray>();
+            a.add(sites[i].count);
+            a.add(sites[i].bytes);
+          }
+        }
+        break;
+      }
       default:
         continue;
       }
+      if (evt.seq)
+        doc["seq"] = evt.seq;
+
+      if (doc.overflowed())
+        LOG_W("[MQTT] Event %d truncated, json_tx arena full", evt.type);
 
-      serializeJson(doc, payload, sizeof(payload));
+      // Giữ event cho tới khi có broker (queue đầy thì phía gửi tự bỏ với timeout 0)
+      xEventGroupWaitBits(mqtt_state_group, MQTT_CONNECTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
 
       if (xSemaphoreTake(mqtt_client_mutex, pdMS_TO_TICKS(2000)))
       {
         if (mqtt.connected())
         {
-          const char *category = event_to_topic(evt.type);
+          const char *category = event_to_topic((SystemEventType_t)evt.type);
           if (category)
           {
-            String full_topic = String(MQTT_TOPIC_BASE) + "/" + client_id + "/" + category;
-            mqtt.publish(full_topic.c_str(), payload);
+            char full_topic[80];
+            mqtt_topic(full_topic, sizeof(full_topic), category);
+            size_t len = measureJson(doc);
+            TRACE_BEGIN(TRACE_SPAN_MQTT_PUBLISH);
+            if (mqtt.beginPublish(full_topic, len, false))
+            {
+              MqttStreamPrint out;
+              serializeJson(doc, out);
+              out.flush();
+              mqtt.endPublish();
+            }
+            TRACE_END(TRACE_SPAN_MQTT_PUBLISH);
 
-            Serial.print("[MQTT] Published to ");
-            Serial.print(full_topic);
-            Serial.print(": ");
-            Serial.println(payload);
+            LOG_I("[MQTT] Published to %s (%u B)", full_topic, (unsigned)len);
           }
         }
         else
         {
-          Serial.println("[MQTT] Skip publish, mqtt not connected");
+          LOG_I("[MQTT] Skip publish, mqtt not connected");
         }
         xSemaphoreGive(mqtt_client_mutex);
       }
@@ -300,37 +1056,28 @@ static void TaskMqttPublish(void *pvParameter)
 bool mqtt_init(void)
 {
     mqtt.setClient(*network_get_client());
-    mqtt.setServer(MQTT_BROKER, MQTT_PORT);
     mqtt.setCallback(callback);
 
     mqtt_client_mutex = xSemaphoreCreateMutex();
     if (mqtt_client_mutex == NULL)
     {
-        Serial.println("Failed to create mqtt mutex");
+        LOG_W("Failed to create mqtt mutex");
         return false;
     }
 
-    client_id = "esp32-" + String(network_get_mac());
-
-    while (!mqtt.connected())
+    mqtt_state_group = xEventGroupCreate();
+    if (mqtt_state_group == NULL)
     {
-        Serial.printf("MQTT connecting as %s...\n", client_id.c_str());
-        if (mqtt.connect(client_id.c_str(), MQTT_USERNAME, MQTT_PASSWORD))
-        {
-            Serial.println("MQTT broker connected");
-        }
-        else
-        {
-            Serial.print("failed, rc=");
-            Serial.print(mqtt.state());
-            delay(2000);
-        }
+        LOG_W("Failed to create mqtt event group");
+        return false;
     }
 
-    String cmd_topic = String(MQTT_TOPIC_BASE) + "/" + client_id + "/command";
-    mqtt.subscribe(cmd_topic.c_str());
-    Serial.print("[MQTT] Subscribed: ");
-    Serial.println(cmd_topic);
+    // Không connect ở đây: TaskMQTTClientLoop tự kết nối khi WiFi manager báo có mạng
+    // Event đi thẳng vào socket (beginPublish), buffer chỉ cần cho lệnh nhận về
+    // và các gói trace dump 512 byte / chunk OTA (4 + OTA_CHUNK_BYTES + topic)
+    mqtt.setBufferSize(640);
+    snprintf(client_id, sizeof(client_id), "esp32-%s", network_get_mac());
+    mqtt_apply_settings();
 
     return true;
 }
@@ -347,7 +1094,10 @@ void mqtt_start_tasks(
     door_cmd_queue = _door_cmd_queue;
     fp_request_queue = _fp_request_queue;
 
-    xTaskCreatePinnedToCore(MqttControlTask, "MQTT Cmd", 8198, NULL, 1, NULL, 1);
-    xTaskCreatePinnedToCore(TaskMQTTClientLoop, "MQTT Loop", 4096, NULL, 2, NULL, 1);
-    xTaskCreatePinnedToCore(TaskMqttPublish, "MQTT Pub", 4096, NULL, 1, NULL, 1);
+    // Stack: MqttMsg / JSON nằm trong msg_pool; đo lại bằng lệnh mem_report
+    xTaskCreatePinnedToCore(MqttControlTask, "MQTT Cmd", TASK_MQTT_CMD_STACK_SIZE, NULL, TASK_MQTT_CMD_PRIORITY, NULL, TASK_MQTT_CMD_CORE);
+    s_net_up = network_is_connected();
+    xTaskCreatePinnedToCore(TaskMQTTClientLoop, "MQTT Loop", TASK_MQTT_LOOP_STACK_SIZE, NULL, TASK_MQTT_LOOP_PRIORITY, &mqtt_loop_task, TASK_MQTT_LOOP_CORE);
+    telemetry_register_wake_callback(mqtt_wake_for_telemetry);
+    xTaskCreatePinnedToCore(TaskMqttPublish, "MQTT Pub", TASK_MQTT_PUB_STACK_SIZE, NULL, TASK_MQTT_PUB_PRIORITY, NULL, TASK_MQTT_PUB_CORE);
 }
\ No newline at end of file
@@ -11,7 +11,7 @@ enum MqttEvent_t
 
 typedef void (*mqtt_event_cb_t)(MqttEvent_t evt);
 
-// Khởi tạo MQTT client và bắt đầu các tác vụ
+// Khởi tạo MQTT client (không chặn, không kết nối); TaskMQTTClientLoop tự kết nối khi có mạng
 bool mqtt_init();
 void mqtt_start_tasks(
     QueueHandle_t _mqtt_payload_queue, 
@@ -21,5 +21,19 @@ void mqtt_start_tasks(
 );
 
 void mqtt_register_event_callback(mqtt_event_cb_t cb);
+bool mqtt_is_connected(void);
+// Số lần kết nối lại broker sau lần đầu
+uint32_t mqtt_get_reconnects(void);
+// WiFi manager báo link lên/xuống (gọi từ network event handler)
+void mqtt_notify_network(bool up);
+// Broker / tài khoản / topic base trong config_store vừa đổi: ngắt và kết nối lại
+void mqtt_reconfigure(void);
+// Publish payload dựng sẵn lên "<base>/<client_id>/<leaf>" (ghi thẳng vào
+// socket, không giới hạn bởi buffer của PubSubClient). false nếu chưa kết nối.
+bool mqtt_publish(const char *leaf, const char *payload, size_t len, bool retained);
+// Kiểm soát ra vào cục bộ đã sẵn sàng (setup xong): boot_report được publish
+// ngay khi lên broker, trước mọi event trong system_evt_queue; gửi lỗi thì thử
+// lại ở lần kết nối sau
+void mqtt_request_boot_report(uint32_t local_ready_ms);
 
 #endif
\ No newline at end of file
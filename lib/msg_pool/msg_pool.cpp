@@ -0,0 +1,221 @@
+#include "msg_pool.h"
+#include "app_config.h"
+
+static_assert(MSG_POOL_MQTT_RX_BLOCKS < 256 && MSG_POOL_OTA_RX_BLOCKS < 256, "free list dùng chỉ số 8 bit");
+
+static MsgPoolStats_t pool_stats[POOL_ID_COUNT];
+static portMUX_TYPE pool_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const pool_names[POOL_ID_COUNT] = {
+    "mqtt_rx", "json_rx", "json_tx", "ota_rx"};
+
+/* ===== Pool block cố định ===== */
+typedef struct
+{
+    uint8_t *storage;
+    uint16_t block_size;
+    uint8_t count;
+    uint8_t top;      // số block trống
+    uint8_t *free_ix; // stack chỉ số block trống
+} BlockPool_t;
+
+static MqttMsg mqtt_rx_blocks[MSG_POOL_MQTT_RX_BLOCKS];
+static uint8_t mqtt_rx_free[MSG_POOL_MQTT_RX_BLOCKS];
+static OtaChunk ota_rx_blocks[MSG_POOL_OTA_RX_BLOCKS];
+static uint8_t ota_rx_free[MSG_POOL_OTA_RX_BLOCKS];
+
+static BlockPool_t block_pools[POOL_ID_COUNT] = {
+    /* POOL_MQTT_RX */ {(uint8_t *)mqtt_rx_blocks, sizeof(MqttMsg), MSG_POOL_MQTT_RX_BLOCKS, 0, mqtt_rx_free},
+    /* POOL_JSON_RX */ {},
+    /* POOL_JSON_TX */ {},
+    /* POOL_OTA_RX  */ {(uint8_t *)ota_rx_blocks, sizeof(OtaChunk), MSG_POOL_OTA_RX_BLOCKS, 0, ota_rx_free},
+};
+
+static void block_pool_init(MsgPoolId_t id)
+{
+    BlockPool_t *p = &block_pools[id];
+    for (uint8_t i = 0; i < p->count; i++)
+        p->free_ix[i] = p->count - 1 - i;
+    p->top = p->count;
+    pool_stats[id].block_size = p->block_size;
+    pool_stats[id].capacity = p->count;
+}
+
+void *msg_pool_alloc(MsgPoolId_t id)
+{
+    if (id >= POOL_ID_COUNT || block_pools[id].count == 0)
+        return NULL;
+
+    BlockPool_t *p = &block_pools[id];
+    MsgPoolStats_t *st = &pool_stats[id];
+    void *block = NULL;
+
+    portENTER_CRITICAL(&pool_mux);
+    // Khởi tạo lười: không cần gọi init từ setup() trước khi task đầu tiên chạy
+    if (st->capacity == 0)
+        block_pool_init(id);
+    if (p->top > 0)
+    {
+        block = p->storage + (size_t)p->free_ix[--p->top] * p->block_size;
+        st->allocs++;
+        st->in_use++;
+        if (st->in_use > st->high_water)
+            st->high_water = st->in_use;
+    }
+    else
+    {
+        st->exhausted++;
+    }
+    portEXIT_CRITICAL(&pool_mux);
+    return block;
+}
+
+void msg_pool_free(MsgPoolId_t id, void *block)
+{
+    if (id >= POOL_ID_COUNT || block == NULL || block_pools[id].count == 0)
+        return;
+
+    BlockPool_t *p = &block_pools[id];
+    size_t off = (uint8_t *)block - p->storage;
+    if (off % p->block_size != 0 || off / p->block_size >= p->count)
+        return; // không thuộc pool này
+
+    portENTER_CRITICAL(&pool_mux);
+    p->free_ix[p->top++] = off / p->block_size;
+    pool_stats[id].in_use--;
+    portEXIT_CRITICAL(&pool_mux);
+}
+
+/* ===== Arena cho JsonDocument ===== */
+// Mỗi block có 4 byte kích thước phía trước để reallocate biết cần chép bao nhiêu.
+// Chỉ task sở hữu gọi allocate/deallocate nên không khoá; task khác chỉ đọc stats.
+class JsonArena : public ArduinoJson::Allocator
+{
+public:
+    JsonArena(uint8_t *buf, size_t cap, MsgPoolStats_t *stats) : _buf(buf), _cap(cap), _st(stats)
+    {
+        _st->capacity = cap;
+    }
+
+    void *allocate(size_t size) override
+    {
+        size_t need = sizeof(uint32_t) + align(size);
+        if (_used + need > _cap)
+        {
+            _st->exhausted++;
+            return nullptr;
+        }
+        uint8_t *hdr = _buf + _used;
+        *(uint32_t *)hdr = size;
+        _last = hdr;
+        _used += need;
+        _live++;
+        note_usage();
+        return hdr + sizeof(uint32_t);
+    }
+
+    void deallocate(void *ptr) override
+    {
+        if (ptr == nullptr)
+            return;
+        uint8_t *hdr = (uint8_t *)ptr - sizeof(uint32_t);
+        if (hdr == _last)
+        {
+            // Block cuối: thu hồi ngay, hay gặp với chuỗi tạm của deserializeJson
+            _used = hdr - _buf;
+            _last = nullptr;
+        }
+        if (--_live == 0)
+        {
+            _used = 0;
+            _last = nullptr;
+        }
+        _st->in_use = _used;
+    }
+
+    void *reallocate(void *ptr, size_t size) override
+    {
+        if (ptr == nullptr)
+            return allocate(size);
+
+        uint8_t *hdr = (uint8_t *)ptr - sizeof(uint32_t);
+        uint32_t old = *(uint32_t *)hdr;
+        if (hdr == _last)
+        {
+            // Block cuối: co / giãn tại chỗ (shrinkToFit, StringBuilder)
+            size_t end = (hdr - _buf) + sizeof(uint32_t) + align(size);
+            if (end > _cap)
+            {
+                _st->exhausted++;
+                return nullptr;
+            }
+            *(uint32_t *)hdr = size;
+            _used = end;
+            note_usage();
+            return ptr;
+        }
+        if (size <= old)
+            return ptr;
+
+        void *p = allocate(size);
+        if (p)
+        {
+            memcpy(p, ptr, old);
+            deallocate(ptr);
+        }
+        return p;
+    }
+
+private:
+    static size_t align(size_t n) { return (n + 3) & ~(size_t)3; }
+
+    void note_usage()
+    {
+        _st->allocs++;
+        _st->in_use = _used;
+        if (_used > _st->high_water)
+            _st->high_water = _used;
+    }
+
+    uint8_t *_buf;
+    size_t _cap;
+    MsgPoolStats_t *_st;
+    size_t _used = 0;
+    uint8_t *_last = nullptr;
+    uint16_t _live = 0;
+};
+
+static uint8_t json_rx_buf[MSG_POOL_JSON_RX_BYTES] __attribute__((aligned(4)));
+static uint8_t json_tx_buf[MSG_POOL_JSON_TX_BYTES] __attribute__((aligned(4)));
+static JsonArena json_rx_arena(json_rx_buf, sizeof(json_rx_buf), &pool_stats[POOL_JSON_RX]);
+static JsonArena json_tx_arena(json_tx_buf, sizeof(json_tx_buf), &pool_stats[POOL_JSON_TX]);
+
+ArduinoJson::Allocator *msg_pool_json(MsgPoolId_t id)
+{
+    switch (id)
+    {
+    case POOL_JSON_RX:
+        return &json_rx_arena;
+    case POOL_JSON_TX:
+        return &json_tx_arena;
+    default:
+        return nullptr;
+    }
+}
+
+const char *msg_pool_name(MsgPoolId_t id)
+{
+    return id < POOL_ID_COUNT ? pool_names[id] : "?";
+}
+
+bool msg_pool_get_stats(MsgPoolId_t id, MsgPoolStats_t *out)
+{
+    if (id >= POOL_ID_COUNT)
+        return false;
+    portENTER_CRITICAL(&pool_mux);
+    if (block_pools[id].count && pool_stats[id].capacity == 0)
+        block_pool_init(id);
+    *out = pool_stats[id];
+    portEXIT_CRITICAL(&pool_mux);
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef MSG_POOL_H_
+#define MSG_POOL_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ================== POOL BỘ NHỚ CHO MESSAGE GIỮA CÁC TASK ==================
+// Mọi pool là RAM tĩnh, cấp / trả O(1) dưới spinlock, không đụng heap.
+//  - Pool block cố định: queue chỉ chở CON TRỎ tới block. Bên gửi cấp block,
+//    gửi con trỏ là trao quyền sở hữu; bên nhận trả block sau khi xử lý.
+//    Gửi thất bại thì bên gửi vẫn là chủ và phải tự trả.
+//  - Arena JSON: Allocator của ArduinoJson 7 cho một JsonDocument tại một thời
+//    điểm (mỗi arena thuộc một task). Cấp kiểu "bump", tự về rỗng khi document
+//    trả hết bộ nhớ. Thay cho StaticJsonDocument<N>, vốn chỉ là alias của
+//    JsonDocument cấp trên heap trong ArduinoJson 7.
+
+typedef enum
+{
+    POOL_MQTT_RX,  // block: MqttMsg nhận từ broker (callback -> MqttControlTask)
+    POOL_JSON_RX,  // arena: parse lệnh trong MqttControlTask
+    POOL_JSON_TX,  // arena: build event trong TaskMqttPublish
+    POOL_OTA_RX,   // block: OtaChunk (callback / MqttControlTask -> TaskOta)
+    POOL_ID_COUNT
+} MsgPoolId_t;
+
+typedef struct
+{
+    uint16_t block_size; // byte mỗi block, arena: 0
+    uint16_t capacity;   // số block, arena: số byte
+    uint16_t in_use;     // block đang cấp, arena: byte đang dùng
+    uint16_t high_water;
+    uint32_t allocs;
+    uint32_t exhausted; // lần cấp thất bại vì hết chỗ
+} MsgPoolStats_t;
+
+// Pool block cố định, NULL khi hết block (hoặc id là arena)
+void *msg_pool_alloc(MsgPoolId_t id);
+void msg_pool_free(MsgPoolId_t id, void *block);
+
+// Allocator cho JsonDocument, vd. JsonDocument doc(msg_pool_json(POOL_JSON_TX));
+ArduinoJson::Allocator *msg_pool_json(MsgPoolId_t id);
+
+const char *msg_pool_name(MsgPoolId_t id);
+bool msg_pool_get_stats(MsgPoolId_t id, MsgPoolStats_t *out);
+
+#endif // MSG_POOL_H_
@@ -12,12 +12,42 @@ typedef enum
     NET_CONNECTED,
 } NetStateEvent_t;
 
+// Thống kê kết nối (thời gian tính bằng ms)
+typedef struct
+{
+    uint32_t connects;        // số lần có IP
+    uint32_t reconnects;      // số lần có IP lại sau khi mất kết nối
+    uint32_t disconnects;
+    uint32_t last_connect_ms; // từ lúc WiFi.begin tới khi có IP
+    uint32_t last_outage_ms;  // từ lúc mất kết nối tới khi có IP lại
+    uint32_t max_outage_ms;
+    uint32_t total_outage_ms;
+    uint8_t last_reason;      // wifi_err_reason_t của lần mất gần nhất
+    bool last_connect_warm;   // lần gần nhất dùng BSSID/kênh/IP đã cache
+    uint32_t warm_connects;
+    uint32_t warm_failures;   // cache sai -> phải scan đầy đủ
+    uint32_t boot_to_ip_ms;   // từ lúc khởi động tới khi có IP lần đầu
+} NetStats_t;
+
+// Được gọi trong TaskNetwork (không phải trong ISR / WiFi event task)
+typedef void (*net_event_cb_t)(NetStateEvent_t evt);
+
+void network_register_event_callback(net_event_cb_t cb);
+// Khởi động WiFi manager, không chặn; tự reconnect với backoff
 bool network_init(void);
+// SSID / mật khẩu trong config_store vừa đổi: rời AP và kết nối lại
+void network_reconfigure(void);
+// Chờ có IP tối đa timeout_ms (dùng lúc boot)
+bool network_wait_connected(uint32_t timeout_ms);
 bool network_is_connected(void);
+// Chưa có SSID: không kết nối, nhận config_set qua console (lib/provision)
+bool network_is_provisioning(void);
+void network_get_stats(NetStats_t *out);
 Client *network_get_client(void);
 
 // Thêm hàm lấy địa chỉ IP và dải MAC
 const char* network_get_ip(void);
 const char* network_get_mac(void);
+int8_t network_get_rssi(void);
 
 #endif
\ No newline at end of file
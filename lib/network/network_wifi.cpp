@@ -1,28 +1,393 @@
 #include "network.h"
 
 #include "app_config.h"
+#include "config_store.h"
+#include "supervisor.h"
+#include "log.h"
 #include <Arduino.h>
 #include <WiFi.h>
+#include <esp_system.h>
+#include <Preferences.h>
 
 static WiFiClient net_client;
 
-bool network_init(void)
+// ================== FAST RECONNECT CACHE ==================
+// AP (BSSID + kênh) và IP lease lần kết nối tốt gần nhất. RTC giữ qua reset
+// nóng; NVS chỉ ghi khi nội dung đổi (sau power-on RTC mất).
+#define NET_CACHE_MAGIC 0x4E455401UL
+
+struct NetCache_t
+{
+    uint32_t magic;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t ip, gateway, subnet, dns;
+    uint32_t check;
+};
+
+static RTC_NOINIT_ATTR NetCache_t rtc_cache;
+
+static uint32_t net_cache_check(const NetCache_t *c)
+{
+    const uint8_t *p = (const uint8_t *)c;
+    uint32_t h = 2166136261UL; // FNV-1a trên mọi byte trừ trường check
+    for (size_t i = 0; i < offsetof(NetCache_t, check); i++)
+        h = (h ^ p[i]) * 16777619UL;
+    return h;
+}
+
+static bool net_cache_valid(const NetCache_t *c)
+{
+    return c->magic == NET_CACHE_MAGIC && c->check == net_cache_check(c) && c->channel > 0;
+}
+
+static bool net_cache_load(void)
+{
+    if (net_cache_valid(&rtc_cache))
+        return true;
+
+    Preferences prefs;
+    NetCache_t nvs;
+    bool ok = false;
+    if (prefs.begin("net", true))
+    {
+        ok = prefs.getBytes("cache", &nvs, sizeof(nvs)) == sizeof(nvs) && net_cache_valid(&nvs);
+        prefs.end();
+    }
+    if (ok)
+        rtc_cache = nvs;
+    return ok;
+}
+
+static void net_cache_store(void)
+{
+    NetCache_t c = {};
+    c.magic = NET_CACHE_MAGIC;
+    const uint8_t *bssid = WiFi.BSSID();
+    if (bssid == NULL)
+        return;
+    memcpy(c.bssid, bssid, sizeof(c.bssid));
+    c.channel = WiFi.channel();
+    c.ip = WiFi.localIP();
+    c.gateway = WiFi.gatewayIP();
+    c.subnet = WiFi.subnetMask();
+    c.dns = WiFi.dnsIP();
+    c.check = net_cache_check(&c);
+
+    bool changed = memcmp(&c, &rtc_cache, sizeof(c)) != 0;
+    rtc_cache = c;
+    if (!changed)
+        return; // cùng AP, cùng lease: không ghi flash
+
+    Preferences prefs;
+    if (prefs.begin("net", false))
+    {
+        prefs.putBytes("cache", &c, sizeof(c));
+        prefs.end();
+    }
+}
+
+// ================== WIFI MANAGER ==================
+// WiFi event (chạy trong task sự kiện của WiFi) chỉ đẩy message vào queue;
+// TaskNetwork xử lý: phát NetStateEvent_t, đo thời gian, lên lịch reconnect.
+struct NetMsg_t
+{
+    arduino_event_id_t id;
+    uint8_t reason;
+};
+
+#define NET_BIT_CONNECTED (1 << 0)
+#define NET_MSG_RECONFIGURE ARDUINO_EVENT_MAX // network_reconfigure(): SSID / mật khẩu đổi
+#define NET_REASON_ASSOC_LEAVE 8 // WIFI_REASON_ASSOC_LEAVE
+
+static QueueHandle_t net_msg_queue = NULL;
+static EventGroupHandle_t net_bits = NULL;
+static net_event_cb_t net_evt_cb = nullptr;
+
+static volatile NetStateEvent_t net_state = NET_DISCONNECTED;
+static NetStats_t net_stats;
+static portMUX_TYPE net_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void network_register_event_callback(net_event_cb_t cb)
+{
+    net_evt_cb = cb;
+}
+
+static void network_emit_event(NetStateEvent_t evt)
+{
+    net_state = evt;
+    if (net_evt_cb)
+        net_evt_cb(evt);
+}
+
+static void wifi_event_handler(arduino_event_id_t event, arduino_event_info_t info)
+{
+    NetMsg_t msg;
+    msg.id = event;
+    msg.reason = 0;
+
+    switch (event)
+    {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        xEventGroupSetBits(net_bits, NET_BIT_CONNECTED);
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        msg.reason = info.wifi_sta_disconnected.reason;
+        xEventGroupClearBits(net_bits, NET_BIT_CONNECTED);
+        break;
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        xEventGroupClearBits(net_bits, NET_BIT_CONNECTED);
+        break;
+    default:
+        return;
+    }
+    xQueueSend(net_msg_queue, &msg, 0);
+}
+
+// Lần thử "warm": kết nối thẳng tới BSSID/kênh đã biết (bỏ scan), tuỳ chọn
+// dùng lại IP cũ (bỏ DHCP). Thất bại thì lần sau quay về scan + DHCP ("cold").
+static bool network_begin_connect(bool allow_fast)
+{
+    network_emit_event(NET_CONNECTING);
+
+    if (allow_fast && net_cache_load())
+    {
+#if NET_FAST_STATIC_IP
+        WiFi.config(IPAddress(rtc_cache.ip), IPAddress(rtc_cache.gateway),
+                    IPAddress(rtc_cache.subnet), IPAddress(rtc_cache.dns));
+#endif
+        WiFi.begin(config_get()->wifi_ssid, config_get()->wifi_pass, rtc_cache.channel, rtc_cache.bssid, true);
+        return true;
+    }
+
+    // Về DHCP nếu lần trước dùng IP tĩnh
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+    WiFi.begin(config_get()->wifi_ssid, config_get()->wifi_pass);
+    return false;
+}
+
+static void TaskNetwork(void *pvParameters)
 {
-    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    NetMsg_t msg;
+    uint32_t backoff = NET_BACKOFF_MIN_MS;
+    unsigned long attempt_start = millis(); // bắt đầu lần kết nối hiện tại
+    unsigned long lost_at = 0;              // lúc mất kết nối (0 = chưa từng có)
+    unsigned long retry_at = 0;
+    bool retry_pending = false;
+    bool first_ip = true;
 
-    unsigned long start = millis();
-    while (WiFi.status() != WL_CONNECTED)
+    bool attempt_fast = false;
+    if (network_is_provisioning())
+        LOG_W("[NET] No WiFi SSID configured, waiting for config_set");
+    else
+        attempt_fast = network_begin_connect(true);
+
+    for (;;)
     {
-        if (millis() - start > 10000)
-            return false;
-        delay(200);
+        // Ngủ tới khi có event WiFi, tới hạn retry, hoặc hết hạn kết nối
+        unsigned long now = millis();
+        uint32_t attempt_timeout = attempt_fast ? NET_FAST_CONNECT_TIMEOUT_MS : NET_CONNECT_TIMEOUT_MS;
+        unsigned long deadline = retry_pending ? retry_at : attempt_start + attempt_timeout;
+        TickType_t wait = portMAX_DELAY;
+        if (retry_pending || net_state == NET_CONNECTING)
+            wait = (long)(deadline - now) > 0 ? pdMS_TO_TICKS(deadline - now) : 0;
+
+        supervisor_end(SUP_TASK_NET);
+        BaseType_t got = xQueueReceive(net_msg_queue, &msg, wait);
+        supervisor_begin(SUP_TASK_NET);
+        if (got != pdTRUE)
+        {
+            now = millis();
+            if (retry_pending)
+            {
+                retry_pending = false;
+                if (network_is_provisioning())
+                    continue;
+                attempt_start = now;
+                attempt_fast = network_begin_connect(true);
+            }
+            else if (net_state == NET_CONNECTING)
+            {
+                // Không có GOT_IP cũng không có DISCONNECTED trong thời hạn
+                WiFi.disconnect();
+                msg.id = ARDUINO_EVENT_WIFI_STA_DISCONNECTED;
+                msg.reason = 0;
+                xQueueSend(net_msg_queue, &msg, 0);
+            }
+            continue;
+        }
+
+        now = millis();
+        switch (msg.id)
+        {
+        case NET_MSG_RECONFIGURE:
+            // AP khác: bỏ cache BSSID / IP, rời AP hiện tại rồi kết nối lại bằng scan đầy đủ
+            rtc_cache.magic = 0;
+            if (net_state == NET_CONNECTED)
+            {
+                lost_at = now;
+                portENTER_CRITICAL(&net_mux);
+                net_stats.disconnects++;
+                portEXIT_CRITICAL(&net_mux);
+                network_emit_event(NET_DISCONNECTED);
+            }
+            WiFi.disconnect();
+            backoff = NET_BACKOFF_MIN_MS;
+            retry_pending = false;
+            if (network_is_provisioning())
+            {
+                // Ví dụ hết hạn thử SSID mới mà NVS chưa có SSID nào
+                if (net_state == NET_CONNECTING)
+                    network_emit_event(NET_DISCONNECTED);
+                LOG_W("[NET] No WiFi SSID configured, waiting for config_set");
+                break;
+            }
+            LOG_I("[NET] Settings changed, reconnecting");
+            attempt_start = now;
+            attempt_fast = network_begin_connect(false);
+            break;
+
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        {
+            uint32_t connect_ms = now - attempt_start;
+            portENTER_CRITICAL(&net_mux);
+            net_stats.connects++;
+            net_stats.last_connect_ms = connect_ms;
+            net_stats.last_connect_warm = attempt_fast;
+            if (attempt_fast)
+                net_stats.warm_connects++;
+            if (first_ip)
+                net_stats.boot_to_ip_ms = now;
+            if (lost_at)
+            {
+                uint32_t outage_ms = now - lost_at;
+                net_stats.reconnects++;
+                net_stats.last_outage_ms = outage_ms;
+                if (outage_ms > net_stats.max_outage_ms)
+                    net_stats.max_outage_ms = outage_ms;
+                net_stats.total_outage_ms += outage_ms;
+            }
+            portEXIT_CRITICAL(&net_mux);
+
+            LOG_I("[NET] Connected (%s) in %u ms, IP %s",
+                  attempt_fast ? "warm" : "cold", (unsigned)connect_ms, network_get_ip());
+            if (first_ip)
+                LOG_I("[NET] Boot -> IP: %u ms", (unsigned)now);
+            first_ip = false;
+            net_cache_store();
+            backoff = NET_BACKOFF_MIN_MS;
+            retry_pending = false;
+            lost_at = 0;
+            network_emit_event(NET_CONNECTED);
+            break;
+        }
+
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            // WiFi.begin()/disconnect() của chính mình sinh ra ASSOC_LEAVE:
+            // không phải lỗi của lần thử đang chạy
+            if (net_state == NET_CONNECTING && msg.reason == NET_REASON_ASSOC_LEAVE)
+                break;
+
+            if (net_state == NET_CONNECTED)
+            {
+                lost_at = now;
+                portENTER_CRITICAL(&net_mux);
+                net_stats.disconnects++;
+                net_stats.last_reason = msg.reason;
+                portEXIT_CRITICAL(&net_mux);
+                LOG_W("[NET] Link lost, reason=%u", msg.reason);
+                network_emit_event(NET_DISCONNECTED);
+            }
+            else if (net_state == NET_CONNECTING)
+            {
+                network_emit_event(NET_CONNECT_FAILED);
+                if (attempt_fast)
+                {
+                    // AP đổi kênh / lease hết hạn: thử ngay bằng scan đầy đủ
+                    portENTER_CRITICAL(&net_mux);
+                    net_stats.warm_failures++;
+                    portEXIT_CRITICAL(&net_mux);
+                    LOG_W("[NET] Cached AP failed, falling back to full scan");
+                    attempt_start = now;
+                    attempt_fast = network_begin_connect(false);
+                    break;
+                }
+            }
+
+            // Driver có thể báo DISCONNECTED nhiều lần, chỉ lên lịch 1 lần
+            if (!retry_pending)
+            {
+                uint32_t jitter = esp_random() % (backoff / 4 + 1);
+                retry_at = now + backoff + jitter;
+                retry_pending = true;
+                LOG_I("[NET] Retry in %u ms", (unsigned)(backoff + jitter));
+                backoff = min((uint32_t)NET_BACKOFF_MAX_MS, backoff * 2);
+            }
+            break;
+
+        default:
+            break;
+        }
     }
+}
+
+bool network_init(void)
+{
+    if (net_msg_queue != NULL)
+        return true;
+
+    net_msg_queue = xQueueCreate(8, sizeof(NetMsg_t));
+    net_bits = xEventGroupCreate();
+    if (net_msg_queue == NULL || net_bits == NULL)
+        return false;
+
+    WiFi.persistent(false);       // không để SDK ghi cấu hình WiFi vào flash mỗi lần begin
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false); // TaskNetwork tự reconnect có backoff
+    WiFi.onEvent(wifi_event_handler);
+
+    // Chạy cùng core với WiFi stack
+    xTaskCreatePinnedToCore(TaskNetwork, "TaskNetwork", TASK_NET_STACK_SIZE, NULL, TASK_NET_PRIORITY, NULL, TASK_NET_CORE);
     return true;
 }
 
+void network_reconfigure(void)
+{
+    if (net_msg_queue == NULL)
+        return;
+    NetMsg_t msg;
+    msg.id = NET_MSG_RECONFIGURE;
+    msg.reason = 0;
+    xQueueSend(net_msg_queue, &msg, 0);
+}
+
+bool network_wait_connected(uint32_t timeout_ms)
+{
+    if (net_bits == NULL)
+        return false;
+    EventBits_t bits = xEventGroupWaitBits(net_bits, NET_BIT_CONNECTED, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (bits & NET_BIT_CONNECTED) != 0;
+}
+
+// Chưa có SSID (mặc định rỗng, chưa config_set): không thử kết nối, chờ
+// provisioning qua console rồi network_reconfigure()
+bool network_is_provisioning(void)
+{
+    return config_get()->wifi_ssid[0] == '\0';
+}
+
 bool network_is_connected(void)
 {
-    return WiFi.status() == WL_CONNECTED;
+    return net_bits != NULL && (xEventGroupGetBits(net_bits) & NET_BIT_CONNECTED);
+}
+
+void network_get_stats(NetStats_t *out)
+{
+    portENTER_CRITICAL(&net_mux);
+    *out = net_stats;
+    portEXIT_CRITICAL(&net_mux);
 }
 
 Client *network_get_client(void)
@@ -44,4 +409,9 @@ const char* network_get_mac(void)
     strncpy(mac_buf, WiFi.macAddress().c_str(), sizeof(mac_buf) - 1);
     mac_buf[sizeof(mac_buf) - 1] = '\0';
     return mac_buf;
-}
\ No newline at end of file
+}
+
+int8_t network_get_rssi(void)
+{
+    return network_is_connected() ? WiFi.RSSI() : 0;
+}
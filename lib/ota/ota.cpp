@@ -0,0 +1,385 @@
+#include "ota.h"
+#include "ota_delta.h"
+#include "ota_key.h"
+#include "app_config.h"
+#include "app_queue.h"
+#include "msg_pool.h"
+#include "mqtt.h"
+#include "log.h"
+
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/pk.h>
+
+static QueueHandle_t ota_queue = NULL;
+static OtaStats_t stats;
+
+// Phiên nhận delta, chỉ TaskOta dùng
+static OtaDelta_t delta;
+static const esp_partition_t *running_part = NULL;
+static const esp_partition_t *update_part = NULL;
+static esp_ota_handle_t ota_handle = 0;
+static bool ota_begun = false; // esp_ota_begin đã gọi, lỗi phải esp_ota_abort
+static mbedtls_sha256_context target_sha;
+static uint32_t last_rx_ms = 0;
+
+/* ===== TRẠNG THÁI LÊN .../ota ===== */
+static void ota_report(const char *state, const char *err = NULL)
+{
+    char buf[128];
+    int len;
+    if (err)
+        len = snprintf(buf, sizeof(buf), "{\"state\":\"%s\",\"err\":\"%s\",\"off\":%lu}", state, err,
+                       (unsigned long)stats.received);
+    else if (strcmp(state, "ready") == 0)
+        len = snprintf(buf, sizeof(buf), "{\"state\":\"ready\",\"off\":0,\"chunk\":%d,\"window\":%d}",
+                       OTA_CHUNK_BYTES, OTA_WINDOW);
+    else if (strcmp(state, "recv") == 0)
+        len = snprintf(buf, sizeof(buf), "{\"state\":\"recv\",\"off\":%lu}", (unsigned long)stats.received);
+    else
+        len = snprintf(buf, sizeof(buf), "{\"state\":\"%s\",\"fw\":\"%s\"}", state, FW_VERSION);
+    mqtt_publish("ota", buf, len, false);
+}
+
+/* ===== PERSIST: image chờ xác nhận ===== */
+static void pending_store(bool pending, uint8_t tries)
+{
+    Preferences prefs;
+    if (prefs.begin("ota", false))
+    {
+        prefs.putUChar("pend", pending ? 1 : 0);
+        prefs.putUChar("tries", tries);
+        prefs.end();
+    }
+}
+
+static void ota_rollback(const char *why)
+{
+    LOG_E("[OTA] Rollback: %s", why);
+    pending_store(false, 0);
+    // Bootloader có bật rollback: tự chọn image cũ và reset
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+    // Không bật: partition OTA còn lại vẫn là image trước khi cập nhật
+    const esp_partition_t *prev = esp_ota_get_next_update_partition(NULL);
+    if (prev && esp_ota_set_boot_partition(prev) == ESP_OK)
+    {
+        delay(100); // cho task Log kịp in
+        esp_restart();
+    }
+    LOG_E("[OTA] No previous image to roll back to");
+    stats.pending_verify = false;
+}
+
+// Core Arduino tự xác nhận image mới ngay khi boot nếu hàm này trả false (weak,
+// C linkage trong esp32-hal-misc.c): giữ lại để ota_confirm quyết định
+extern "C" bool verifyRollbackLater()
+{
+    return true;
+}
+
+/* ===== CALLBACK CỦA ota_delta ===== */
+static bool sha256_partition(const esp_partition_t *part, uint32_t size, uint8_t out[32])
+{
+    uint8_t buf[512];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    bool ok = true;
+    for (uint32_t off = 0; off < size && ok; off += sizeof(buf))
+    {
+        uint32_t n = min((uint32_t)sizeof(buf), size - off);
+        ok = esp_partition_read(part, off, buf, n) == ESP_OK;
+        mbedtls_sha256_update(&ctx, buf, n);
+    }
+    mbedtls_sha256_finish(&ctx, out);
+    mbedtls_sha256_free(&ctx);
+    return ok;
+}
+
+static bool on_header(void *ctx, const OtaDeltaHeader_t *hdr)
+{
+    (void)ctx;
+    uint8_t sha[32];
+    if (hdr->base_size > running_part->size || !sha256_partition(running_part, hdr->base_size, sha) ||
+        memcmp(sha, hdr->base_sha, sizeof(sha)) != 0)
+    {
+        LOG_W("[OTA] Delta built for a different base image");
+        return false;
+    }
+    if (hdr->target_size > update_part->size)
+    {
+        LOG_W("[OTA] Image %u B does not fit partition %s", (unsigned)hdr->target_size, update_part->label);
+        return false;
+    }
+    // Chỉ xoá đúng số sector cần cho image mới (vài trăm ms .. vài giây)
+    esp_err_t err = esp_ota_begin(update_part, hdr->target_size, &ota_handle);
+    if (err != ESP_OK)
+    {
+        LOG_E("[OTA] esp_ota_begin: %s", esp_err_to_name(err));
+        return false;
+    }
+    ota_begun = true;
+    mbedtls_sha256_starts(&target_sha, 0);
+    LOG_I("[OTA] Applying delta -> %s, image %u B", update_part->label, (unsigned)hdr->target_size);
+    return true;
+}
+
+static bool on_read_base(void *ctx, uint32_t off, uint8_t *buf, size_t len)
+{
+    (void)ctx;
+    return esp_partition_read(running_part, off, buf, len) == ESP_OK;
+}
+
+static bool on_write(void *ctx, const uint8_t *buf, size_t len)
+{
+    (void)ctx;
+    if (esp_ota_write(ota_handle, buf, len) != ESP_OK)
+        return false;
+    mbedtls_sha256_update(&target_sha, buf, len);
+    stats.written += len;
+    return true;
+}
+
+/* ===== PHIÊN ===== */
+static void session_end(void)
+{
+    if (ota_begun)
+        esp_ota_abort(ota_handle);
+    ota_begun = false;
+    stats.active = false;
+}
+
+static void session_fail(const char *err)
+{
+    LOG_W("[OTA] Failed at %u/%u: %s", (unsigned)stats.received, (unsigned)stats.size, err);
+    session_end();
+    ota_report("error", err);
+}
+
+static void session_begin(uint32_t size)
+{
+    if (stats.active)
+        session_end();
+    running_part = esp_ota_get_running_partition();
+    update_part = esp_ota_get_next_update_partition(NULL);
+    if (update_part == NULL)
+    {
+        ota_report("error", "no_ota_partition");
+        return;
+    }
+
+    static const OtaDeltaIo_t io = {NULL, on_header, on_read_base, on_write};
+    ota_delta_init(&delta, &io);
+    mbedtls_sha256_init(&target_sha);
+    stats.active = true;
+    stats.size = size;
+    stats.received = 0;
+    stats.written = 0;
+    last_rx_ms = millis();
+    LOG_I("[OTA] Session started, delta %u B", (unsigned)size);
+    ota_report("ready");
+}
+
+static bool signature_ok(const uint8_t hash[32], const OtaDeltaHeader_t *hdr)
+{
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    bool ok = mbedtls_pk_parse_public_key(&pk, (const unsigned char *)OTA_PUBLIC_KEY_PEM,
+                                          sizeof(OTA_PUBLIC_KEY_PEM)) == 0 &&
+              mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, hash, 32, hdr->sig, hdr->sig_len) == 0;
+    mbedtls_pk_free(&pk);
+    return ok;
+}
+
+static void session_finish(void)
+{
+    uint8_t hash[32];
+    mbedtls_sha256_finish(&target_sha, hash);
+    if (memcmp(hash, delta.hdr.target_sha, sizeof(hash)) != 0)
+        return session_fail("sha_mismatch");
+    if (!signature_ok(hash, &delta.hdr))
+        return session_fail("bad_signature");
+
+    // esp_ota_end kiểm tra thêm header / checksum của image ESP
+    esp_err_t err = esp_ota_end(ota_handle);
+    ota_begun = false;
+    if (err != ESP_OK)
+        return session_fail("image_invalid");
+    if (esp_ota_set_boot_partition(update_part) != ESP_OK)
+        return session_fail("set_boot_failed");
+
+    pending_store(true, 0);
+    stats.active = false;
+    LOG_I("[OTA] Update written to %s, restarting", update_part->label);
+    ota_report("done");
+    delay(1000); // để message "done" kịp ra khỏi socket
+    esp_restart();
+}
+
+static void session_data(const OtaChunk *c)
+{
+    if (!stats.active)
+        return;
+    if (c->off != stats.received)
+    {
+        // Trùng hoặc thiếu chunk trước: báo lại offset cần để backend gửi lại
+        stats.out_of_order++;
+        ota_report("recv");
+        return;
+    }
+    last_rx_ms = millis();
+    uint32_t len = min((uint32_t)c->len, stats.size - stats.received);
+    OtaDeltaResult_t r = ota_delta_feed(&delta, c->data, len);
+    stats.received += len;
+    if (r != OTA_DELTA_MORE && r != OTA_DELTA_DONE)
+        return session_fail(ota_delta_result_str(r));
+
+    if (stats.received < stats.size)
+    {
+        ota_report("recv");
+        return;
+    }
+    if (r != OTA_DELTA_DONE)
+        return session_fail("truncated");
+    ota_report("recv");
+    session_finish();
+}
+
+static void TaskOta(void *pvParameters)
+{
+    (void)pvParameters;
+    OtaChunk *c;
+
+    for (;;)
+    {
+        TickType_t wait = portMAX_DELAY;
+        if (stats.active)
+            wait = pdMS_TO_TICKS(1000);
+        else if (stats.pending_verify)
+            wait = pdMS_TO_TICKS(5000);
+
+        if (app_queue_receive(ota_queue, &c, wait) == pdTRUE)
+        {
+            if (c->kind == OTA_CHUNK_BEGIN)
+                session_begin(c->off);
+            else if (c->kind == OTA_CHUNK_ABORT)
+            {
+                if (stats.active)
+                {
+                    session_end();
+                    ota_report("aborted");
+                }
+            }
+            else
+                session_data(c);
+            msg_pool_free(POOL_OTA_RX, c);
+        }
+
+        if (stats.active && millis() - last_rx_ms > OTA_IDLE_TIMEOUT_MS)
+            session_fail("timeout");
+        if (stats.pending_verify && millis() > OTA_CONFIRM_TIMEOUT_MS)
+            ota_rollback("not confirmed in time");
+    }
+}
+
+/* ===== API ===== */
+void ota_init(void)
+{
+    Preferences prefs;
+    uint8_t pend = 0, tries = 0;
+    if (prefs.begin("ota", true))
+    {
+        pend = prefs.getUChar("pend", 0);
+        tries = prefs.getUChar("tries", 0);
+        prefs.end();
+    }
+
+    esp_ota_img_states_t img_state;
+    bool boot_pending = esp_ota_get_state_partition(esp_ota_get_running_partition(), &img_state) == ESP_OK &&
+                        img_state == ESP_OTA_IMG_PENDING_VERIFY;
+    if (!pend && !boot_pending)
+        return;
+
+    stats.pending_verify = true;
+    tries++;
+    LOG_W("[OTA] New image %s on trial boot %u/%u", FW_VERSION, tries, OTA_MAX_TRIAL_BOOTS);
+    if (tries > OTA_MAX_TRIAL_BOOTS)
+        ota_rollback("too many trial boots");
+    else
+        pending_store(true, tries);
+}
+
+void ota_start_task(void)
+{
+    ota_queue = app_queue_create(QUEUE_OTA, OTA_WINDOW + 2, sizeof(OtaChunk *));
+    xTaskCreatePinnedToCore(TaskOta, "TaskOta", TASK_OTA_STACK_SIZE, NULL, TASK_OTA_PRIORITY, NULL, TASK_OTA_CORE);
+}
+
+static void ota_send(OtaChunk *c)
+{
+    if (ota_queue == NULL || app_queue_send(ota_queue, &c, 0) != pdTRUE)
+    {
+        stats.dropped++;
+        msg_pool_free(POOL_OTA_RX, c);
+    }
+}
+
+static void ota_send_control(OtaChunkKind_t kind, uint32_t value)
+{
+    OtaChunk *c = (OtaChunk *)msg_pool_alloc(POOL_OTA_RX);
+    if (c == NULL)
+    {
+        LOG_W("[OTA] Control message dropped, pool empty");
+        return;
+    }
+    c->kind = kind;
+    c->off = value;
+    c->len = 0;
+    ota_send(c);
+}
+
+void ota_request_begin(uint32_t size)
+{
+    ota_send_control(OTA_CHUNK_BEGIN, size);
+}
+
+void ota_request_abort(void)
+{
+    ota_send_control(OTA_CHUNK_ABORT, 0);
+}
+
+void ota_submit_chunk(const uint8_t *payload, size_t len)
+{
+    if (len <= 4 || len - 4 > OTA_CHUNK_BYTES)
+        return;
+    // Hết block: bỏ, backend không thấy ack sẽ gửi lại
+    OtaChunk *c = (OtaChunk *)msg_pool_alloc(POOL_OTA_RX);
+    if (c == NULL)
+    {
+        stats.dropped++;
+        return;
+    }
+    c->kind = OTA_CHUNK_DATA;
+    c->off = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) |
+             ((uint32_t)payload[3] << 24);
+    c->len = len - 4;
+    memcpy(c->data, payload + 4, c->len);
+    ota_send(c);
+}
+
+void ota_confirm(void)
+{
+    if (!stats.pending_verify)
+        return;
+    stats.pending_verify = false;
+    pending_store(false, 0);
+    esp_ota_mark_app_valid_cancel_rollback();
+    LOG_I("[OTA] Image %s confirmed", FW_VERSION);
+    ota_report("confirmed");
+}
+
+void ota_get_stats(OtaStats_t *out)
+{
+    *out = stats;
+}
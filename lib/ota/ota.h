@@ -0,0 +1,55 @@
+#ifndef OTA_H_
+#define OTA_H_
+
+#include <Arduino.h>
+
+// ================== OTA DELTA QUA MQTT ==================
+// Backend (tools/ota_delta.py push):
+//   1. {"cmd":"ota_begin","size":N}  -> thiết bị trả {"state":"ready",...} trên .../ota
+//   2. gửi file delta lên .../ota/data: mỗi message = offset u32 LE + tối đa
+//      OTA_CHUNK_BYTES byte, tối đa OTA_WINDOW chunk chưa ack; thiết bị ack
+//      {"state":"recv","off":X} (X = offset cần tiếp theo, chunk lệch offset bị bỏ
+//      và ack lại X: backend gửi lại từ X)
+//   3. đủ N byte: kiểm tra sha256 + chữ ký ECDSA của image mới, đặt boot
+//      partition, báo {"state":"done"} rồi khởi động lại
+// Delta được áp ngay khi nhận (ota_delta) vào partition OTA không chạy: không
+// cần chứa cả file, RAM cố định vài KB.
+//
+// Rollback: image mới khởi động ở trạng thái chờ xác nhận. ota_confirm() (khi
+// kết nối được broker) đánh dấu image tốt; quá OTA_CONFIRM_TIMEOUT_MS hoặc reset
+// quá OTA_MAX_TRIAL_BOOTS lần trước khi xác nhận thì quay về image cũ.
+
+typedef enum
+{
+    OTA_CHUNK_DATA,
+    OTA_CHUNK_BEGIN,
+    OTA_CHUNK_ABORT,
+} OtaChunkKind_t;
+
+typedef struct
+{
+    bool active;          // đang nhận delta
+    bool pending_verify;  // image đang chạy chưa được xác nhận
+    uint32_t size;        // kích thước file delta của phiên hiện tại
+    uint32_t received;    // byte delta đã áp
+    uint32_t written;     // byte image mới đã ghi
+    uint32_t out_of_order; // chunk lệch offset (gửi lại / trùng)
+    uint32_t dropped;     // chunk bị bỏ vì hết block POOL_OTA_RX
+} OtaStats_t;
+
+// Gọi sớm trong setup(): đếm số lần khởi động thử của image mới, quay về image
+// cũ nếu đã quá OTA_MAX_TRIAL_BOOTS
+void ota_init(void);
+void ota_start_task(void);
+
+// Từ MqttControlTask
+void ota_request_begin(uint32_t size);
+void ota_request_abort(void);
+// Từ callback MQTT (topic .../ota/data): payload = offset u32 LE + dữ liệu
+void ota_submit_chunk(const uint8_t *payload, size_t len);
+
+// Image mới chạy được tới khi kết nối broker: huỷ rollback
+void ota_confirm(void);
+void ota_get_stats(OtaStats_t *out);
+
+#endif // OTA_H_
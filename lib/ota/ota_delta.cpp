@@ -0,0 +1,220 @@
+#include "ota_delta.h"
+
+#include <string.h>
+
+#define OP_END 0x00
+#define OP_COPY 0x01
+#define OP_ADD 0x02
+#define OP_RUN 0x03
+
+typedef enum
+{
+    ST_HEADER,    // gom OTA_DELTA_FIXED_HDR byte
+    ST_SIG,       // gom sig_len byte
+    ST_OPCODE,
+    ST_ARGS,      // gom tham số của op
+    ST_ADD_DATA,  // chuyển thẳng dữ liệu ADD ra output
+    ST_END,
+} DeltaState_t;
+
+static uint32_t rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static OtaDeltaResult_t fail(OtaDelta_t *d, OtaDeltaResult_t r)
+{
+    d->result = r;
+    return r;
+}
+
+static bool out_fits(const OtaDelta_t *d, uint32_t len)
+{
+    return len <= d->hdr.target_size - d->out_bytes;
+}
+
+static bool emit(OtaDelta_t *d, const uint8_t *buf, size_t len)
+{
+    if (!d->io.write(d->io.ctx, buf, len))
+        return false;
+    d->out_bytes += len;
+    return true;
+}
+
+// Gom tới buf_need byte vào d->buf, true khi đủ
+static bool gather(OtaDelta_t *d, const uint8_t **data, size_t *len)
+{
+    size_t take = d->buf_need - d->buf_len;
+    if (take > *len)
+        take = *len;
+    memcpy(d->buf + d->buf_len, *data, take);
+    d->buf_len += take;
+    *data += take;
+    *len -= take;
+    return d->buf_len == d->buf_need;
+}
+
+static void expect(OtaDelta_t *d, DeltaState_t st, uint16_t need)
+{
+    d->state = st;
+    d->buf_len = 0;
+    d->buf_need = need;
+}
+
+static OtaDeltaResult_t run_copy(OtaDelta_t *d, uint32_t src, uint32_t len)
+{
+    if (src > d->hdr.base_size || len > d->hdr.base_size - src || !out_fits(d, len))
+        return fail(d, OTA_DELTA_ERR_RANGE);
+    while (len)
+    {
+        uint32_t n = len < OTA_DELTA_COPY_BUF ? len : OTA_DELTA_COPY_BUF;
+        if (!d->io.read_base(d->io.ctx, src, d->copy_buf, n) || !emit(d, d->copy_buf, n))
+            return fail(d, OTA_DELTA_ERR_IO);
+        src += n;
+        len -= n;
+    }
+    return OTA_DELTA_MORE;
+}
+
+static OtaDeltaResult_t run_fill(OtaDelta_t *d, uint8_t value, uint32_t len)
+{
+    if (!out_fits(d, len))
+        return fail(d, OTA_DELTA_ERR_RANGE);
+    memset(d->copy_buf, value, OTA_DELTA_COPY_BUF);
+    while (len)
+    {
+        uint32_t n = len < OTA_DELTA_COPY_BUF ? len : OTA_DELTA_COPY_BUF;
+        if (!emit(d, d->copy_buf, n))
+            return fail(d, OTA_DELTA_ERR_IO);
+        len -= n;
+    }
+    return OTA_DELTA_MORE;
+}
+
+void ota_delta_init(OtaDelta_t *d, const OtaDeltaIo_t *io)
+{
+    memset(d, 0, sizeof(*d));
+    d->io = *io;
+    d->result = OTA_DELTA_MORE;
+    expect(d, ST_HEADER, OTA_DELTA_FIXED_HDR);
+}
+
+OtaDeltaResult_t ota_delta_feed(OtaDelta_t *d, const uint8_t *data, size_t len)
+{
+    if (d->result != OTA_DELTA_MORE && d->result != OTA_DELTA_DONE)
+        return d->result;
+
+    while (len)
+    {
+        switch (d->state)
+        {
+        case ST_HEADER:
+            if (!gather(d, &data, &len))
+                break;
+            if (rd32(d->buf) != OTA_DELTA_MAGIC || d->buf[4] != OTA_DELTA_VERSION)
+                return fail(d, OTA_DELTA_ERR_MAGIC);
+            d->hdr.sig_len = d->buf[6] | (d->buf[7] << 8);
+            d->hdr.base_size = rd32(d->buf + 8);
+            d->hdr.target_size = rd32(d->buf + 12);
+            memcpy(d->hdr.base_sha, d->buf + 16, 32);
+            memcpy(d->hdr.target_sha, d->buf + 48, 32);
+            if (d->hdr.sig_len == 0 || d->hdr.sig_len > OTA_DELTA_MAX_SIG || d->hdr.target_size == 0)
+                return fail(d, OTA_DELTA_ERR_HEADER);
+            expect(d, ST_SIG, d->hdr.sig_len);
+            break;
+
+        case ST_SIG:
+            if (!gather(d, &data, &len))
+                break;
+            memcpy(d->hdr.sig, d->buf, d->hdr.sig_len);
+            if (!d->io.header(d->io.ctx, &d->hdr))
+                return fail(d, OTA_DELTA_ERR_HEADER);
+            expect(d, ST_OPCODE, 0);
+            break;
+
+        case ST_OPCODE:
+            d->op = *data++;
+            len--;
+            if (d->op == OP_END)
+            {
+                if (d->out_bytes != d->hdr.target_size)
+                    return fail(d, OTA_DELTA_ERR_RANGE);
+                d->state = ST_END;
+                d->result = OTA_DELTA_DONE;
+            }
+            else if (d->op == OP_COPY)
+                expect(d, ST_ARGS, 8);
+            else if (d->op == OP_ADD)
+                expect(d, ST_ARGS, 4);
+            else if (d->op == OP_RUN)
+                expect(d, ST_ARGS, 5);
+            else
+                return fail(d, OTA_DELTA_ERR_OP);
+            break;
+
+        case ST_ARGS:
+        {
+            if (!gather(d, &data, &len))
+                break;
+            OtaDeltaResult_t r = OTA_DELTA_MORE;
+            if (d->op == OP_COPY)
+                r = run_copy(d, rd32(d->buf), rd32(d->buf + 4));
+            else if (d->op == OP_RUN)
+                r = run_fill(d, d->buf[4], rd32(d->buf));
+            else
+            {
+                d->remaining = rd32(d->buf);
+                if (!out_fits(d, d->remaining))
+                    return fail(d, OTA_DELTA_ERR_RANGE);
+                expect(d, d->remaining ? ST_ADD_DATA : ST_OPCODE, 0);
+                break;
+            }
+            if (r != OTA_DELTA_MORE)
+                return r;
+            expect(d, ST_OPCODE, 0);
+            break;
+        }
+
+        case ST_ADD_DATA:
+        {
+            size_t n = len < d->remaining ? len : d->remaining;
+            if (!emit(d, data, n))
+                return fail(d, OTA_DELTA_ERR_IO);
+            data += n;
+            len -= n;
+            d->remaining -= n;
+            if (d->remaining == 0)
+                expect(d, ST_OPCODE, 0);
+            break;
+        }
+
+        case ST_END:
+        default:
+            return fail(d, OTA_DELTA_ERR_OP); // dữ liệu thừa sau END
+        }
+    }
+    return d->result;
+}
+
+const char *ota_delta_result_str(OtaDeltaResult_t r)
+{
+    switch (r)
+    {
+    case OTA_DELTA_MORE:
+        return "more";
+    case OTA_DELTA_DONE:
+        return "done";
+    case OTA_DELTA_ERR_MAGIC:
+        return "bad_magic";
+    case OTA_DELTA_ERR_HEADER:
+        return "bad_header";
+    case OTA_DELTA_ERR_OP:
+        return "bad_op";
+    case OTA_DELTA_ERR_RANGE:
+        return "bad_range";
+    case OTA_DELTA_ERR_IO:
+        return "io_error";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef OTA_DELTA_H_
+#define OTA_DELTA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== GIẢI MÃ DELTA FIRMWARE (STREAMING) ==================
+// Định dạng do tools/ota_delta.py tạo (little-endian):
+//   header  "ODLT" | ver u8 | rsv u8 | sig_len u16 | base_size u32 | target_size u32
+//           | base_sha256[32] | target_sha256[32] | sig[sig_len] (ECDSA P-256, DER)
+//   op      0x01 COPY  src_off u32, len u32   chép từ image đang chạy (base)
+//           0x02 ADD   len u32, data[len]     dữ liệu mới
+//           0x03 RUN   len u32, byte u8       lặp một byte (padding 0x00 / 0xFF)
+//           0x00 END
+// Dữ liệu được nạp từng mảnh bất kỳ (chunk MQTT); ADD ghi thẳng ra output, COPY
+// đọc base qua bộ đệm OTA_DELTA_COPY_BUF byte. RAM cố định, không phụ thuộc
+// kích thước image. Module không gọi API ESP nên chạy được trên host.
+
+#define OTA_DELTA_MAGIC 0x544C444FUL // "ODLT"
+#define OTA_DELTA_VERSION 1
+#define OTA_DELTA_FIXED_HDR 80
+#define OTA_DELTA_MAX_SIG 80
+#define OTA_DELTA_COPY_BUF 256
+
+typedef struct
+{
+    uint32_t base_size;
+    uint32_t target_size;
+    uint8_t base_sha[32];
+    uint8_t target_sha[32];
+    uint16_t sig_len;
+    uint8_t sig[OTA_DELTA_MAX_SIG];
+} OtaDeltaHeader_t;
+
+typedef enum
+{
+    OTA_DELTA_MORE,      // cần thêm dữ liệu
+    OTA_DELTA_DONE,      // đã gặp END, output đủ target_size
+    OTA_DELTA_ERR_MAGIC, // không phải delta / sai version
+    OTA_DELTA_ERR_HEADER, // header không hợp lệ hoặc bị io.header từ chối
+    OTA_DELTA_ERR_OP,    // opcode lạ / dữ liệu sau END
+    OTA_DELTA_ERR_RANGE, // COPY ngoài base hoặc output vượt target_size
+    OTA_DELTA_ERR_IO,    // io.read / io.write lỗi
+} OtaDeltaResult_t;
+
+typedef struct
+{
+    void *ctx;
+    // Header đã đủ: kiểm tra base, chuẩn bị nơi ghi. false = huỷ.
+    bool (*header)(void *ctx, const OtaDeltaHeader_t *hdr);
+    bool (*read_base)(void *ctx, uint32_t off, uint8_t *buf, size_t len);
+    bool (*write)(void *ctx, const uint8_t *buf, size_t len);
+} OtaDeltaIo_t;
+
+typedef struct
+{
+    OtaDeltaIo_t io;
+    OtaDeltaHeader_t hdr;
+    uint8_t state;
+    uint8_t op;
+    uint8_t buf[OTA_DELTA_FIXED_HDR]; // gom header / tham số op qua ranh giới chunk
+    uint16_t buf_len;
+    uint16_t buf_need;
+    uint32_t remaining; // byte còn lại của ADD đang chạy
+    uint32_t out_bytes;
+    OtaDeltaResult_t result;
+    uint8_t copy_buf[OTA_DELTA_COPY_BUF];
+} OtaDelta_t;
+
+void ota_delta_init(OtaDelta_t *d, const OtaDeltaIo_t *io);
+// Nạp len byte tiếp theo. Lỗi là trạng thái cuối: các lần gọi sau trả lại lỗi đó.
+OtaDeltaResult_t ota_delta_feed(OtaDelta_t *d, const uint8_t *data, size_t len);
+const char *ota_delta_result_str(OtaDeltaResult_t r);
+
+#endif // OTA_DELTA_H_
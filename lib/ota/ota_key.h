@@ -0,0 +1,14 @@
+#ifndef OTA_KEY_H_
+#define OTA_KEY_H_
+
+// Khoá công khai ECDSA P-256 kiểm tra chữ ký firmware OTA.
+// Sinh bằng: python3 tools/ota_delta.py keygen -k <private.pem> --header lib/ota/ota_key.h
+// Private key giữ ngoài repo.
+static const char OTA_PUBLIC_KEY_PEM[] =
+    "-----BEGIN PUBLIC KEY-----\n"
+    "MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAE+rVA6nPaIvHBkg2PETEVEufQ7kjO\n"
+    "ldA2+c7TQZnO0PGggTrLbd3X83/j98ESAMqypKnF30ZmRVuD3nKdu5MnRg==\n"
+    "-----END PUBLIC KEY-----\n"
+    ;
+
+#endif // OTA_KEY_H_
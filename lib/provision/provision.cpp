@@ -0,0 +1,90 @@
+#include "provision.h"
+#include "app_config.h"
+#include "config_store.h"
+#include "network.h"
+#include "log.h"
+
+#include <ArduinoJson.h>
+
+static char line[PROVISION_LINE_MAX];
+static size_t line_len = 0;
+static bool line_overflow = false;
+static char reply[768];
+
+// Trả lời trực tiếp lên Serial: logger cắt chuỗi tham số, reply dài hơn thế
+static void reply_line(const char *s)
+{
+    Serial.println(s);
+}
+
+static void handle_line(void)
+{
+    if (!network_is_provisioning())
+    {
+        reply_line("{\"err\":\"provisioned\"}");
+        return;
+    }
+
+    JsonDocument doc;
+    if (deserializeJson(doc, line, line_len))
+    {
+        reply_line("{\"err\":\"bad_json\"}");
+        return;
+    }
+    const char *cmd = doc["cmd"] | "";
+
+    if (strcmp(cmd, "config_get") == 0)
+    {
+        config_to_json(reply, sizeof(reply));
+        reply_line(reply);
+        return;
+    }
+    if (strcmp(cmd, "config_set") != 0)
+    {
+        reply_line("{\"err\":\"unknown_cmd\"}");
+        return;
+    }
+
+    if (!config_begin())
+    {
+        reply_line("{\"err\":\"busy\"}");
+        return;
+    }
+    const char *err_key = "";
+    const char *err = config_stage_json(doc["set"].as<JsonObjectConst>(), &err_key);
+    if (err)
+    {
+        config_abort();
+        snprintf(reply, sizeof(reply), "{\"err\":\"%s\",\"key\":\"%.32s\"}", err, err_key);
+        reply_line(reply);
+        return;
+    }
+    config_commit(reply, sizeof(reply));
+    reply_line(reply);
+    LOG_I("[PROV] Settings received over serial");
+    config_notify(); // main.cpp -> network_reconfigure()
+}
+
+void provision_poll(void)
+{
+    while (Serial.available() > 0)
+    {
+        int c = Serial.read();
+        if (c == '\r')
+            continue;
+        if (c != '\n')
+        {
+            if (line_len < sizeof(line))
+                line[line_len++] = (char)c;
+            else
+                line_overflow = true;
+            continue;
+        }
+        if (line_overflow)
+            reply_line("{\"err\":\"too_long\"}");
+        else if (line_len > 0)
+            handle_line();
+        line_len = 0;
+        line_overflow = false;
+    }
+}
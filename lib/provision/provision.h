@@ -0,0 +1,19 @@
+#ifndef PROVISION_H_
+#define PROVISION_H_
+
+#include <Arduino.h>
+
+// ================== PROVISIONING QUA SERIAL ==================
+// Firmware không mang sẵn SSID / mật khẩu (app_config.h): khi chưa có SSID,
+// network không kết nối (network_is_provisioning) và console nhận từng dòng JSON
+// giống lệnh MQTT:
+//   {"cmd":"config_set","set":{"wifi_ssid":"x","wifi_pass":"y"}}
+//   {"cmd":"config_get"}
+// Trả lời một dòng JSON (như trên .../config). WiFi / MQTT là thay đổi thử:
+// chỉ lưu NVS khi lên được broker, không thì quay về provisioning sau
+// CONFIG_NET_TRIAL_MS. Đã có SSID thì console bỏ qua lệnh.
+
+// Gọi định kỳ từ loop(): đọc Serial không chặn, xử lý khi đủ một dòng
+void provision_poll(void);
+
+#endif // PROVISION_H_
@@ -0,0 +1,400 @@
+#include "schedule.h"
+#include "timer_wheel.h"
+#include "app_config.h"
+#include "app_queue.h"
+#include "door.h"
+#include "timesync.h"
+#include "supervisor.h"
+#include "log.h"
+
+#include <Preferences.h>
+#include <sys/time.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SCHED_DAY_S 86400UL
+#define SCHED_LOCAL_OFFSET_S ((int32_t)(NTP_GMT_OFFSET_SEC + NTP_DAYLIGHT_OFFSET_SEC))
+#define SCHEDULE_NVS_VERSION 1
+#define SCHED_DAYS_ALL 0x7F
+
+static const char *const action_names[SCHED_DO_COUNT] = {
+    "door_unlock", "door_hold", "door_lock", "scan_on", "scan_off"};
+
+/* ===== Bảng rule: MqttControlTask ghi, TaskSchedule chép khi được báo ===== */
+static ScheduleRule_t rules[SCHEDULE_MAX_RULES];
+static uint8_t rule_count = 0;
+static uint32_t rev = 0;
+static portMUX_TYPE rules_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t sched_task = NULL;
+
+/* ===== Trạng thái riêng của TaskSchedule ===== */
+typedef struct
+{
+    TwTimer_t timer; // phải đứng đầu: on_expire ép TwTimer_t* về SchedSlot_t*
+    ScheduleRule_t rule;
+} SchedSlot_t;
+
+static SchedSlot_t slots[SCHEDULE_MAX_RULES];
+static uint8_t slot_count = 0;
+static TimerWheel_t wheel;
+static QueueHandle_t door_q = NULL;
+static QueueHandle_t fp_q = NULL;
+static volatile uint32_t fired_count = 0;
+
+/* ===== Thời gian địa phương ===== */
+
+// Giây địa phương hiện tại; ms_to_next: còn bao lâu tới đầu giây kế tiếp
+static uint32_t local_now(uint32_t *ms_to_next)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (ms_to_next)
+        *ms_to_next = 1000 - (uint32_t)(tv.tv_usec / 1000);
+    return (uint32_t)((int64_t)tv.tv_sec + SCHED_LOCAL_OFFSET_S);
+}
+
+static uint8_t weekday_of(uint32_t day)
+{
+    return (uint8_t)((day + 4) % 7); // 01/01/1970 là thứ năm
+}
+
+// Lần chạy đầu tiên sau giây địa phương after (không tính chính after)
+static uint32_t next_fire(const ScheduleRule_t *r, uint32_t after)
+{
+    uint32_t day = after / SCHED_DAY_S;
+    uint32_t sod = after % SCHED_DAY_S;
+    for (uint8_t k = 0; k <= 7; k++)
+    {
+        if ((r->days & (1u << weekday_of(day + k))) && (k > 0 || r->at_s > sod))
+            return (day + k) * SCHED_DAY_S + r->at_s;
+    }
+    return 0;
+}
+
+// Lần chạy gần nhất không muộn hơn at, 0 nếu không có trong 7 ngày qua
+static uint32_t prev_fire(const ScheduleRule_t *r, uint32_t at)
+{
+    uint32_t day = at / SCHED_DAY_S;
+    uint32_t sod = at % SCHED_DAY_S;
+    for (uint8_t k = 0; k <= 7 && k <= day; k++)
+    {
+        if ((r->days & (1u << weekday_of(day - k))) && (k > 0 || r->at_s <= sod))
+            return (day - k) * SCHED_DAY_S + r->at_s;
+    }
+    return 0;
+}
+
+/* ===== Thực thi ===== */
+
+static void run_action(uint8_t action)
+{
+    if (action <= SCHED_DO_DOOR_LOCK)
+    {
+        static const DoorRequest_t door_map[] = {DOOR_REQUEST_UNLOCK, DOOR_REQUEST_HOLD_UNLOCK, DOOR_REQUEST_LOCK};
+        DoorRequest_t req = door_map[action];
+        if (app_queue_send(door_q, &req, pdMS_TO_TICKS(100)) != pdTRUE)
+            LOG_W("[SCHED] Door queue full, %s dropped", action_names[action]);
+    }
+    else
+    {
+        FingerprintRequestMsg_t req;
+        req.type = action == SCHED_DO_SCAN_ON ? FP_REQ_SCAN_ENABLE : FP_REQ_SCAN_DISABLE;
+        req.id = 0;
+        if (app_queue_send(fp_q, &req, pdMS_TO_TICKS(100)) != pdTRUE)
+            LOG_W("[SCHED] FP queue full, %s dropped", action_names[action]);
+    }
+}
+
+static void on_expire(TwTimer_t *t, void *ctx)
+{
+    (void)ctx;
+    SchedSlot_t *s = (SchedSlot_t *)t;
+    LOG_I("[SCHED] Rule %u: %s", s->rule.id, action_names[s->rule.action]);
+    run_action(s->rule.action);
+    fired_count++;
+    tw_add(&wheel, t, next_fire(&s->rule, t->expires));
+}
+
+// Nạp lại toàn bộ timer, wheel bắt đầu từ giây now + 1 (giây now do catch_up lo)
+static void rebuild(uint32_t now)
+{
+    tw_init(&wheel, now + 1);
+    for (uint8_t i = 0; i < slot_count; i++)
+    {
+        slots[i].timer.next = NULL;
+        slots[i].timer.pprev = NULL;
+        tw_add(&wheel, &slots[i].timer, next_fire(&slots[i].rule, now));
+    }
+}
+
+// Áp trạng thái lịch lẽ ra đang giữ: rule gần nhất đã qua của kênh cửa
+// (hold / lock) và kênh quét (on / off). Cửa chỉ nhận lệnh khi khác chế độ
+// hiện tại để không khoá ngang người vừa quét vân tay.
+static void catch_up(uint32_t now)
+{
+    uint32_t best_ts[2] = {0, 0};
+    int8_t best[2] = {-1, -1};
+    for (uint8_t i = 0; i < slot_count; i++)
+    {
+        uint8_t action = slots[i].rule.action;
+        if (action == SCHED_DO_DOOR_UNLOCK)
+            continue;
+        uint8_t ch = action >= SCHED_DO_SCAN_ON ? 1 : 0;
+        uint32_t ts = prev_fire(&slots[i].rule, now);
+        if (ts && ts >= best_ts[ch])
+        {
+            best_ts[ch] = ts;
+            best[ch] = i;
+        }
+    }
+
+    for (uint8_t ch = 0; ch < 2; ch++)
+    {
+        if (best[ch] < 0)
+            continue;
+        const ScheduleRule_t *r = &slots[best[ch]].rule;
+        if (ch == 0 && (r->action == SCHED_DO_DOOR_HOLD) == door_is_held())
+            continue;
+        LOG_I("[SCHED] Restore %s (rule %u)", action_names[r->action], r->id);
+        run_action(r->action);
+    }
+}
+
+static void load_rules(void)
+{
+    portENTER_CRITICAL(&rules_mux);
+    for (uint8_t i = 0; i < rule_count; i++)
+        slots[i].rule = rules[i];
+    slot_count = rule_count;
+    portEXIT_CRITICAL(&rules_mux);
+}
+
+static void TaskSchedule(void *pvParameters)
+{
+    (void)pvParameters;
+    bool wheel_valid = false;
+    uint32_t ms_to_next = 1000;
+
+    load_rules();
+    LOG_I("[SCHED] Task started, %u rules", slot_count);
+
+    for (;;)
+    {
+        // Thức ngay sau đầu giây (+2 ms bù làm tròn tick) hoặc khi bảng rule đổi
+        supervisor_end(SUP_TASK_SCHED);
+        uint32_t notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms_to_next + 2));
+        supervisor_begin(SUP_TASK_SCHED);
+        if (notified > 0)
+        {
+            load_rules();
+            wheel_valid = false;
+        }
+
+        if (timesync_quality() == TIME_Q_NONE)
+        {
+            ms_to_next = 1000;
+            continue;
+        }
+
+        uint32_t now = local_now(&ms_to_next);
+        if (wheel_valid)
+        {
+            // Đồng hồ bị chỉnh xa (sync lần đầu, đổi múi giờ...): không tick bù
+            // từng giây, dựng lại wheel như lúc khởi động
+            int32_t behind = (int32_t)(now - wheel.now);
+            if (behind < -SCHEDULE_MAX_SKEW_S || behind >= SCHEDULE_MAX_SKEW_S)
+            {
+                LOG_W("[SCHED] Clock moved %ld s, rebuilding", (long)behind);
+                wheel_valid = false;
+            }
+        }
+
+        if (!wheel_valid)
+        {
+            rebuild(now);
+            catch_up(now);
+            wheel_valid = true;
+            continue;
+        }
+
+        // Bình thường 1 tick; lỡ vài giây thì tick bù, đồng hồ lùi ít thì chờ
+        while ((int32_t)(now - wheel.now) >= 0)
+            tw_tick(&wheel, on_expire, NULL);
+    }
+}
+
+/* ===== NVS ===== */
+
+static bool rule_valid(const ScheduleRule_t *r)
+{
+    return r->id != 0 && r->action < SCHED_DO_COUNT && r->at_s < SCHED_DAY_S && (r->days & SCHED_DAYS_ALL) != 0;
+}
+
+static void save_rules(void)
+{
+    Preferences prefs;
+    if (!prefs.begin("sched", false))
+    {
+        LOG_E("[SCHED] NVS open failed");
+        return;
+    }
+    prefs.putUChar("ver", SCHEDULE_NVS_VERSION);
+    if (rule_count)
+        prefs.putBytes("rules", rules, rule_count * sizeof(ScheduleRule_t));
+    else
+        prefs.remove("rules");
+    prefs.putUInt("rev", rev);
+    prefs.end();
+}
+
+void schedule_init(void)
+{
+    Preferences prefs;
+    if (!prefs.begin("sched", true))
+        return; // chưa từng lưu
+    rev = prefs.getUInt("rev", 0);
+    size_t len = prefs.getBytesLength("rules");
+    if (prefs.getUChar("ver", 0) != SCHEDULE_NVS_VERSION)
+    {
+        if (len)
+            LOG_W("[SCHED] NVS layout changed, rules dropped");
+    }
+    else if (len % sizeof(ScheduleRule_t) == 0 && len <= sizeof(rules))
+    {
+        prefs.getBytes("rules", rules, len);
+        for (uint8_t i = 0; i < len / sizeof(ScheduleRule_t); i++)
+        {
+            if (rule_valid(&rules[i]))
+                rules[rule_count++] = rules[i];
+        }
+    }
+    prefs.end();
+    LOG_I("[SCHED] %u rules, rev %lu", rule_count, (unsigned long)rev);
+}
+
+void schedule_start_task(QueueHandle_t door_cmd_queue, QueueHandle_t fp_request_queue)
+{
+    door_q = door_cmd_queue;
+    fp_q = fp_request_queue;
+    xTaskCreatePinnedToCore(TaskSchedule, "Schedule", TASK_SCHED_STACK_SIZE, NULL, TASK_SCHED_PRIORITY, &sched_task, TASK_SCHED_CORE);
+}
+
+/* ===== Cập nhật (MqttControlTask) ===== */
+
+static void rules_changed(void)
+{
+    save_rules();
+    if (sched_task)
+        xTaskNotifyGive(sched_task);
+}
+
+static int find_rule(uint8_t id)
+{
+    for (uint8_t i = 0; i < rule_count; i++)
+    {
+        if (rules[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+const char *schedule_put(const ScheduleRule_t *rule)
+{
+    if (rule->id == 0)
+        return "bad_id";
+    if (rule->action >= SCHED_DO_COUNT)
+        return "bad_action";
+    if (rule->at_s >= SCHED_DAY_S)
+        return "bad_time";
+    if ((rule->days & SCHED_DAYS_ALL) == 0)
+        return "bad_days";
+
+    int idx = find_rule(rule->id);
+    if (idx < 0 && rule_count >= SCHEDULE_MAX_RULES)
+        return "full";
+
+    portENTER_CRITICAL(&rules_mux);
+    if (idx < 0)
+        idx = rule_count++;
+    rules[idx] = *rule;
+    rules[idx].days &= SCHED_DAYS_ALL;
+    rules[idx].reserved = 0;
+    rev++;
+    portEXIT_CRITICAL(&rules_mux);
+
+    rules_changed();
+    return NULL;
+}
+
+const char *schedule_delete(uint8_t id)
+{
+    int idx = find_rule(id);
+    if (idx < 0)
+        return "not_found";
+
+    portENTER_CRITICAL(&rules_mux);
+    memmove(&rules[idx], &rules[idx + 1], (rule_count - idx - 1) * sizeof(ScheduleRule_t));
+    rule_count--;
+    rev++;
+    portEXIT_CRITICAL(&rules_mux);
+
+    rules_changed();
+    return NULL;
+}
+
+void schedule_clear(void)
+{
+    portENTER_CRITICAL(&rules_mux);
+    rule_count = 0;
+    rev++;
+    portEXIT_CRITICAL(&rules_mux);
+
+    rules_changed();
+}
+
+/* ===== Parse / JSON ===== */
+
+bool schedule_parse_action(const char *s, uint8_t *out)
+{
+    if (s == NULL)
+        return false;
+    for (uint8_t i = 0; i < SCHED_DO_COUNT; i++)
+    {
+        if (strcasecmp(s, action_names[i]) == 0)
+        {
+            *out = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *schedule_action_to_str(uint8_t action)
+{
+    return action < SCHED_DO_COUNT ? action_names[action] : "unknown";
+}
+
+uint32_t schedule_revision(void)
+{
+    return rev;
+}
+
+size_t schedule_to_json(char *out, size_t len)
+{
+    bool have_time = timesync_quality() != TIME_Q_NONE;
+    uint32_t now = local_now(NULL);
+    size_t n = snprintf(out, len, "{\"rev\":%lu,\"hold\":%s,\"fired\":%lu,\"rules\":[",
+                        (unsigned long)rev, door_is_held() ? "true" : "false", (unsigned long)fired_count);
+
+    for (uint8_t i = 0; i < rule_count && n < len; i++)
+    {
+        const ScheduleRule_t *r = &rules[i];
+        uint32_t next = have_time ? next_fire(r, now) - SCHED_LOCAL_OFFSET_S : 0;
+        n += snprintf(out + n, len - n, "%s[%u,\"%02lu:%02lu:%02lu\",%u,\"%s\",%lu]", i ? "," : "",
+                      r->id, (unsigned long)(r->at_s / 3600), (unsigned long)(r->at_s / 60 % 60),
+                      (unsigned long)(r->at_s % 60), r->days, action_names[r->action], (unsigned long)next);
+    }
+    if (n < len)
+        n += snprintf(out + n, len - n, "]}");
+    return n < len ? n : 0;
+}
@@ -0,0 +1,71 @@
+#ifndef SCHEDULE_H_
+#define SCHEDULE_H_
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "schedule_time.h" // schedule_parse_time
+
+// ================== LỊCH THEO GIỜ ĐỊA PHƯƠNG ==================
+// Tối đa SCHEDULE_MAX_RULES rule lặp theo tuần: "giờ HH:MM:SS, các thứ trong
+// tuần, hành động". Ví dụ giờ tiếp khách giữ cửa mở, tối khoá lại, ngoài giờ
+// làm việc tắt quét vân tay:
+//   {"cmd":"sched_put","id":1,"at":"08:00","days":[1,2,3,4,5],"do":"door_hold"}
+//   {"cmd":"sched_put","id":2,"at":"17:30","days":[1,2,3,4,5],"do":"door_lock"}
+//   {"cmd":"sched_put","id":3,"at":"19:00","do":"scan_off"}
+//   {"cmd":"sched_del","id":3} / {"cmd":"sched_clear"} / {"cmd":"sched_get"}
+// Mọi lệnh trả bảng rule hiện tại (hoặc lỗi) trên topic .../schedule.
+//
+// TaskSchedule giữ mỗi rule một timer trong timer wheel (timer_wheel.h) theo
+// giây địa phương, thức dậy đúng đầu mỗi giây và tick wheel: chi phí mỗi giây
+// O(1) không phụ thuộc số rule. Tới hạn thì gửi DoorRequest_t / FP_REQ_SCAN_*
+// vào queue như lệnh MQTT, rồi hẹn lần kế tiếp của rule.
+//
+// Rule lưu trong NVS namespace "sched". Sau khởi động, khi đồng hồ nhảy xa hoặc
+// khi bảng rule đổi, task áp lại trạng thái mà lịch lẽ ra đang giữ (rule
+// door_hold / door_lock và scan_on / scan_off gần nhất đã qua trong 7 ngày), nên
+// mất điện giữa giờ tiếp khách vẫn mở lại đúng chế độ. door_unlock chỉ là xung
+// mở một lần, không được bù.
+
+typedef enum
+{
+    SCHED_DO_DOOR_UNLOCK, // DOOR_REQUEST_UNLOCK
+    SCHED_DO_DOOR_HOLD,   // DOOR_REQUEST_HOLD_UNLOCK
+    SCHED_DO_DOOR_LOCK,   // DOOR_REQUEST_LOCK
+    SCHED_DO_SCAN_ON,     // FP_REQ_SCAN_ENABLE
+    SCHED_DO_SCAN_OFF,    // FP_REQ_SCAN_DISABLE
+    SCHED_DO_COUNT
+} ScheduleAction_t;
+
+// Lưu nguyên dạng trong NVS, thêm field thì tăng SCHEDULE_NVS_VERSION
+typedef struct
+{
+    uint8_t id;     // 1..255, do backend chọn
+    uint8_t action; // ScheduleAction_t
+    uint8_t days;   // bit0 = Chủ nhật ... bit6 = Thứ bảy (tm_wday)
+    uint8_t reserved;
+    uint32_t at_s; // giây trong ngày, giờ địa phương
+} ScheduleRule_t;
+
+// Đọc rule từ NVS, gọi trong setup() trước schedule_start_task
+void schedule_init(void);
+// Task chờ đồng hồ có giờ (timesync) rồi mới chạy lịch
+void schedule_start_task(QueueHandle_t door_cmd_queue, QueueHandle_t fp_request_queue);
+
+// Gọi từ MqttControlTask. Trả NULL nếu thành công, ngược lại là mã lỗi.
+// put thêm mới hoặc thay rule cùng id.
+const char *schedule_put(const ScheduleRule_t *rule);
+const char *schedule_delete(uint8_t id);
+void schedule_clear(void);
+
+// "door_hold" -> SCHED_DO_DOOR_HOLD, false nếu không biết
+bool schedule_parse_action(const char *s, uint8_t *out);
+const char *schedule_action_to_str(uint8_t action);
+
+uint32_t schedule_revision(void);
+// {"rev":N,"hold":bool,"fired":N,"rules":[[id,"HH:MM:SS",days,"action",next_ts],...]}
+// next_ts: epoch UTC lần chạy kế tiếp, 0 khi chưa có giờ
+size_t schedule_to_json(char *out, size_t len);
+
+#endif // SCHEDULE_H_
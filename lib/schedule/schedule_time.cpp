@@ -0,0 +1,25 @@
+#include "schedule_time.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool schedule_parse_time(const char *s, uint32_t *out_s)
+{
+    unsigned h, m, sec = 0;
+    int end_hm = -1, end_hms = -1;
+    if (s == NULL)
+        return false;
+    // %u tự bỏ khoảng trắng / nhận dấu: chỉ cho phép chữ số và ':'
+    size_t len = strlen(s);
+    if (strspn(s, "0123456789:") != len)
+        return false;
+    // %n ghi vị trí đã đọc tới: phải hết chuỗi, không nhận "08:00x" / "08:00 junk"
+    int n = sscanf(s, "%2u:%2u%n:%2u%n", &h, &m, &end_hm, &sec, &end_hms);
+    int end = n == 3 ? end_hms : (n == 2 ? end_hm : -1);
+    if (end < 0 || (size_t)end != len)
+        return false;
+    if (h > 23 || m > 59 || sec > 59)
+        return false;
+    *out_s = h * 3600UL + m * 60UL + sec;
+    return true;
+}
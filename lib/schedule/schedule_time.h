@@ -0,0 +1,11 @@
+#ifndef SCHEDULE_TIME_H_
+#define SCHEDULE_TIME_H_
+
+#include <stdint.h>
+
+// Parse giờ của rule lịch. Không gọi API ESP nên chạy được trên host (test_schedule).
+
+// "08:00" / "08:00:30" -> giây trong ngày; 1-2 chữ số mỗi trường, không nhận ký tự thừa
+bool schedule_parse_time(const char *s, uint32_t *out_s);
+
+#endif // SCHEDULE_TIME_H_
@@ -0,0 +1,96 @@
+#include "timer_wheel.h"
+
+#include <string.h>
+
+#define TW_MASK (TW_SLOTS - 1)
+
+static void slot_push(TwTimer_t **head, TwTimer_t *t)
+{
+    t->next = *head;
+    if (t->next)
+        t->next->pprev = &t->next;
+    t->pprev = head;
+    *head = t;
+}
+
+// Ô theo khoảng cách tới hạn: tầng thấp nhất còn chứa được khoảng đó
+static void place(TimerWheel_t *w, TwTimer_t *t)
+{
+    uint32_t delta = t->expires - w->now;
+    uint8_t level = 0;
+    while (level < TW_LEVELS - 1 && delta >= (1ul << (TW_BITS * (level + 1))))
+        level++;
+    slot_push(&w->slots[level][(t->expires >> (TW_BITS * level)) & TW_MASK], t);
+}
+
+void tw_init(TimerWheel_t *w, uint32_t now)
+{
+    memset(w, 0, sizeof(*w));
+    w->now = now;
+}
+
+void tw_add(TimerWheel_t *w, TwTimer_t *t, uint32_t expires)
+{
+    tw_del(t);
+    if ((int32_t)(expires - w->now) < 0)
+        expires = w->now;
+    else if (expires - w->now > TW_MAX_DELAY)
+        expires = w->now + TW_MAX_DELAY;
+    t->expires = expires;
+    place(w, t);
+}
+
+void tw_del(TwTimer_t *t)
+{
+    if (t->pprev == NULL)
+        return;
+    *t->pprev = t->next;
+    if (t->next)
+        t->next->pprev = t->pprev;
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+// Đổ một ô tầng level xuống các tầng dưới theo khoảng cách mới
+static void cascade(TimerWheel_t *w, uint8_t level, uint32_t index)
+{
+    TwTimer_t *t = w->slots[level][index];
+    w->slots[level][index] = NULL;
+    while (t)
+    {
+        TwTimer_t *next = t->next;
+        t->pprev = NULL;
+        place(w, t);
+        t = next;
+    }
+}
+
+void tw_tick(TimerWheel_t *w, tw_expire_cb_t cb, void *ctx)
+{
+    uint32_t index = w->now & TW_MASK;
+    if (index == 0)
+    {
+        // Tầng 0 vừa hết vòng: lấy ô kế tiếp của tầng 1, tầng 1 hết vòng thì tới tầng 2...
+        for (uint8_t level = 1; level < TW_LEVELS; level++)
+        {
+            uint32_t i = (w->now >> (TW_BITS * level)) & TW_MASK;
+            cascade(w, level, i);
+            if (i != 0)
+                break;
+        }
+    }
+
+    // Mọi timer trong ô này tới hạn đúng tick now
+    TwTimer_t *t = w->slots[0][index];
+    w->slots[0][index] = NULL;
+    if (t)
+        t->pprev = &t; // danh sách tạm trên stack, tw_del trong cb vẫn đúng
+    // Tăng trước khi gọi cb: timer cb thêm lại với expires <= now rơi vào tick kế
+    w->now++;
+    while (t)
+    {
+        TwTimer_t *cur = t;
+        tw_del(cur);
+        cb(cur, ctx);
+    }
+}
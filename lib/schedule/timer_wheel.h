@@ -0,0 +1,48 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ================== TIMER WHEEL PHÂN CẤP ==================
+// TW_LEVELS tầng x TW_SLOTS ô, mỗi tầng thô hơn tầng dưới TW_SLOTS lần
+// (1 tick = 1 s: tầng 0 = 64 s, tầng 1 ~ 68 phút, tầng 2 ~ 2.8 ngày, tầng 3 ~ 194 ngày).
+// Thêm / xoá timer O(1). Mỗi tick chỉ xử lý một ô tầng 0; khi tầng dưới quay
+// hết vòng thì một ô của tầng trên được "đổ" xuống (mỗi timer bị đổ tối đa
+// TW_LEVELS - 1 lần trong đời), nên chi phí mỗi tick là O(1) trung bình, không
+// phụ thuộc số timer. Timer nằm trong struct của người dùng (intrusive), wheel
+// không cấp phát. Không gọi API ESP nên chạy được trên host.
+
+#define TW_BITS 6
+#define TW_SLOTS (1u << TW_BITS)
+#define TW_LEVELS 4
+#define TW_MAX_DELAY ((1ul << (TW_BITS * TW_LEVELS)) - 1)
+
+typedef struct TwTimer
+{
+    struct TwTimer *next;
+    struct TwTimer **pprev; // NULL = không nằm trong wheel
+    uint32_t expires;       // tick tới hạn
+} TwTimer_t;
+
+typedef struct
+{
+    uint32_t now; // tick kế tiếp sẽ được xử lý
+    TwTimer_t *slots[TW_LEVELS][TW_SLOTS];
+} TimerWheel_t;
+
+typedef void (*tw_expire_cb_t)(TwTimer_t *t, void *ctx);
+
+void tw_init(TimerWheel_t *w, uint32_t now);
+// expires < now: chạy ở tick kế tiếp; xa hơn TW_MAX_DELAY: kẹp lại
+void tw_add(TimerWheel_t *w, TwTimer_t *t, uint32_t expires);
+void tw_del(TwTimer_t *t);
+static inline bool tw_pending(const TwTimer_t *t)
+{
+    return t->pprev != NULL;
+}
+// Xử lý tick w->now rồi tăng w->now. Timer tới hạn được gỡ khỏi wheel trước
+// khi gọi cb, cb được phép tw_add lại chính timer đó.
+void tw_tick(TimerWheel_t *w, tw_expire_cb_t cb, void *ctx);
+
+#endif // TIMER_WHEEL_H_
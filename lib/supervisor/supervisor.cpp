@@ -0,0 +1,361 @@
+#include "supervisor.h"
+#include "app_config.h"
+#include "app_queue.h"
+#include "log.h"
+#include "utils.h"
+
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+
+#define SUP_RESET_MAGIC 0x5355500AUL
+#define SUP_NO_TASK 0xFF
+
+typedef struct
+{
+    const char *name;
+    uint32_t iter_slo_ms;
+    uint32_t period_slo_ms; // 0 = task chờ event, không có chu kỳ
+    uint32_t stall_ms;
+    bool periodic; // rảnh vẫn phải quay lại vòng mới trong stall_ms
+    bool reset;    // treo quá SUP_RESET_GRACE_MS thì khởi động lại
+} SupSpec_t;
+
+static const SupSpec_t specs[SUP_TASK_COUNT] = {
+    {"door", SUP_DOOR_ITER_MS, SUP_DOOR_PERIOD_MS, SUP_DOOR_STALL_MS, true, true},
+    {"fp", SUP_FP_ITER_MS, 0, SUP_FP_STALL_MS, true, true},
+    {"app", SUP_APP_ITER_MS, 0, SUP_APP_STALL_MS, false, true},
+    {"mqtt_loop", SUP_MQTT_LOOP_ITER_MS, 0, SUP_MQTT_LOOP_STALL_MS, false, true},
+    {"mqtt_cmd", SUP_MQTT_CMD_ITER_MS, 0, SUP_MQTT_CMD_STALL_MS, false, true},
+    {"net", SUP_NET_ITER_MS, 0, SUP_NET_STALL_MS, false, true},
+    {"sched", SUP_SCHED_ITER_MS, SUP_SCHED_PERIOD_MS, SUP_SCHED_STALL_MS, true, true},
+};
+
+typedef struct
+{
+    // Task được giám sát ghi (32 bit / bool, supervisor đọc không khoá)
+    volatile uint32_t begin_ms;    // đầu vòng, hoặc lần feed gần nhất
+    volatile uint32_t progress_ms; // lần begin / end gần nhất
+    volatile bool busy;
+    volatile bool started; // đã begin ít nhất một lần
+    volatile uint32_t last_begin_ms; // begin thật, feed không đổi
+    SupTaskStats_t stats;
+    // Vi phạm chờ báo, khoá bằng sup_mux
+    uint32_t iter_worst_ms;
+    uint16_t iter_count;
+    uint32_t period_worst_ms;
+    uint16_t period_count;
+    // Chỉ TaskSupervisor
+    uint32_t stall_at; // 0 = không treo
+    bool reset_skipped;
+    supervisor_recover_cb_t recover;
+} SupSlot_t;
+
+// Không bị xoá khi reset nóng: task gây reset và số lần reset liên tiếp
+typedef struct
+{
+    uint32_t magic;
+    uint8_t task; // SUP_NO_TASK = lần reset này không do supervisor
+    uint8_t resets;
+    uint16_t reserved;
+    uint32_t stall_ms;
+    uint32_t check;
+} SupResetRecord_t;
+
+static RTC_NOINIT_ATTR SupResetRecord_t rtc_record;
+
+static SupSlot_t slots[SUP_TASK_COUNT];
+static portMUX_TYPE sup_mux = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t _report_queue = NULL;
+static volatile bool slo_evt_queued = false;
+static int last_reset_task = -1;
+static uint32_t last_reset_stall_ms = 0;
+
+/* ===== BẢN GHI RESET (RTC) ===== */
+
+static uint32_t record_check(const SupResetRecord_t *r)
+{
+    return ~(r->magic ^ (r->task * 0x9E3779B1UL) ^ (r->resets * 0x85EBCA6BUL) ^ r->stall_ms);
+}
+
+static void record_commit(uint8_t task, uint8_t resets, uint32_t stall_ms)
+{
+    rtc_record.magic = SUP_RESET_MAGIC;
+    rtc_record.task = task;
+    rtc_record.resets = resets;
+    rtc_record.reserved = 0;
+    rtc_record.stall_ms = stall_ms;
+    rtc_record.check = record_check(&rtc_record);
+}
+
+void supervisor_init(void)
+{
+    uint8_t resets = 0;
+    if (rtc_record.magic == SUP_RESET_MAGIC && rtc_record.check == record_check(&rtc_record))
+    {
+        resets = rtc_record.resets;
+        if (rtc_record.task < SUP_TASK_COUNT && esp_reset_reason() == ESP_RST_SW)
+        {
+            last_reset_task = rtc_record.task;
+            last_reset_stall_ms = rtc_record.stall_ms;
+            LOG_W("[SUP] Restarted after %s stalled %lu ms (%u in a row)", specs[last_reset_task].name,
+                  (unsigned long)last_reset_stall_ms, resets);
+        }
+    }
+    // Reset kế tiếp (OTA, cấu hình...) không bị tính cho task nào
+    record_commit(SUP_NO_TASK, resets, 0);
+}
+
+/* ===== API CHO TASK ĐƯỢC GIÁM SÁT ===== */
+
+static void note_violation(SupSlot_t *s, bool period, uint32_t ms)
+{
+    portENTER_CRITICAL(&sup_mux);
+    s->stats.violations++;
+    if (period)
+    {
+        if (ms > s->period_worst_ms)
+            s->period_worst_ms = ms;
+        if (s->period_count < UINT16_MAX)
+            s->period_count++;
+    }
+    else
+    {
+        if (ms > s->iter_worst_ms)
+            s->iter_worst_ms = ms;
+        if (s->iter_count < UINT16_MAX)
+            s->iter_count++;
+    }
+    portEXIT_CRITICAL(&sup_mux);
+}
+
+void supervisor_begin(SupTaskId_t id)
+{
+    SupSlot_t *s = &slots[id];
+    uint32_t now = millis();
+    if (s->started && specs[id].period_slo_ms)
+    {
+        uint32_t period = now - s->last_begin_ms;
+        if (period > s->stats.period_max_ms)
+            s->stats.period_max_ms = period;
+        if (period > specs[id].period_slo_ms)
+            note_violation(s, true, period);
+    }
+    s->last_begin_ms = now;
+    s->begin_ms = now;
+    s->progress_ms = now;
+    s->busy = true;
+    s->started = true;
+}
+
+void supervisor_end(SupTaskId_t id)
+{
+    SupSlot_t *s = &slots[id];
+    if (!s->busy)
+        return; // end trước mỗi lần chờ, vòng "continue" có thể gọi hai lần
+    uint32_t now = millis();
+    uint32_t iter = now - s->begin_ms;
+    s->busy = false;
+    s->progress_ms = now;
+    s->stats.iterations++;
+    if (iter > s->stats.iter_max_ms)
+        s->stats.iter_max_ms = iter;
+    if (iter > specs[id].iter_slo_ms)
+        note_violation(s, false, iter);
+}
+
+// Chờ hợp lệ không tính vào SLO của vòng; ngưỡng treo vẫn tính từ begin
+void supervisor_feed(SupTaskId_t id)
+{
+    slots[id].begin_ms = millis();
+}
+
+void supervisor_register_recovery(SupTaskId_t id, supervisor_recover_cb_t cb)
+{
+    slots[id].recover = cb;
+}
+
+/* ===== ĐỌC TRẠNG THÁI ===== */
+
+const char *supervisor_task_name(SupTaskId_t id)
+{
+    return id < SUP_TASK_COUNT ? specs[id].name : "unknown";
+}
+
+uint32_t supervisor_iter_slo_ms(SupTaskId_t id)
+{
+    return specs[id].iter_slo_ms;
+}
+
+uint32_t supervisor_period_slo_ms(SupTaskId_t id)
+{
+    return specs[id].period_slo_ms;
+}
+
+void supervisor_get_stats(SupTaskId_t id, SupTaskStats_t *out)
+{
+    portENTER_CRITICAL(&sup_mux);
+    *out = slots[id].stats;
+    portEXIT_CRITICAL(&sup_mux);
+}
+
+static bool reset_allowed(SupTaskId_t id)
+{
+    return specs[id].reset && rtc_record.resets < SUP_MAX_RESETS;
+}
+
+const char *supervisor_stall_action(SupTaskId_t id)
+{
+    if (slots[id].recover)
+        return "recover";
+    return reset_allowed(id) ? "reset" : "report";
+}
+
+size_t supervisor_take_violations(SupViolation_t *out, size_t max)
+{
+    size_t n = 0;
+    portENTER_CRITICAL(&sup_mux);
+    for (int i = 0; i < SUP_TASK_COUNT && n < max; i++)
+    {
+        SupSlot_t *s = &slots[i];
+        if (s->iter_count == 0 && s->period_count == 0)
+            continue;
+        out[n].id = (SupTaskId_t)i;
+        out[n].iter_worst_ms = s->iter_worst_ms;
+        out[n].iter_count = s->iter_count;
+        out[n].period_worst_ms = s->period_worst_ms;
+        out[n].period_count = s->period_count;
+        s->iter_worst_ms = s->period_worst_ms = 0;
+        s->iter_count = s->period_count = 0;
+        n++;
+    }
+    portEXIT_CRITICAL(&sup_mux);
+    slo_evt_queued = false;
+    return n;
+}
+
+int supervisor_last_reset(uint32_t *stall_ms)
+{
+    if (stall_ms)
+        *stall_ms = last_reset_stall_ms;
+    return last_reset_task;
+}
+
+/* ===== TASK SUPERVISOR ===== */
+
+static void send_event(SystemEventType_t type, SupTaskId_t id)
+{
+    SystemEvent_t evt = {};
+    evt.type = type;
+    evt.value = id;
+    event_stamp(&evt);
+    app_queue_send(_report_queue, &evt, 0);
+}
+
+static void escalate_reset(SupTaskId_t id, uint32_t age)
+{
+    record_commit(id, rtc_record.resets + 1, age);
+    LOG_E("[SUP] %s still stalled after %lu ms, restarting", specs[id].name, (unsigned long)age);
+    log_flush();
+    esp_restart();
+}
+
+static void check_stall(SupTaskId_t id, uint32_t now)
+{
+    SupSlot_t *s = &slots[id];
+    const SupSpec_t *sp = &specs[id];
+    if (!s->started)
+        return; // task không chạy (vd. cảm biến vân tay không trả lời lúc boot)
+
+    // Đang trong vòng: tính từ begin (feed không gia hạn); rảnh: từ lần end
+    bool busy = s->busy;
+    uint32_t since = busy ? s->last_begin_ms : s->progress_ms;
+    int32_t age = (int32_t)(now - since);
+    if ((!busy && !sp->periodic) || age < (int32_t)sp->stall_ms)
+    {
+        if (s->stall_at)
+        {
+            LOG_W("[SUP] %s recovered after %lu ms", sp->name, (unsigned long)(now - s->stall_at));
+            s->stall_at = 0;
+            s->stats.stall_age_ms = 0;
+        }
+        return;
+    }
+
+    s->stats.stall_age_ms = age;
+    if (s->stall_at == 0)
+    {
+        s->stall_at = now ? now : 1;
+        s->stats.stalls++;
+        LOG_E("[SUP] %s stalled %lu ms (%s)", sp->name, (unsigned long)age, supervisor_stall_action(id));
+        send_event(EVT_TASK_STALL, id);
+        if (s->recover)
+            s->recover();
+        return;
+    }
+
+    if (!sp->reset || now - s->stall_at < SUP_RESET_GRACE_MS)
+        return;
+    if (!reset_allowed(id))
+    {
+        if (!s->reset_skipped)
+            LOG_E("[SUP] %s stalled, %u resets in a row: not restarting", sp->name, SUP_MAX_RESETS);
+        s->reset_skipped = true;
+        return;
+    }
+    escalate_reset(id, age);
+}
+
+static bool violations_pending(void)
+{
+    for (int i = 0; i < SUP_TASK_COUNT; i++)
+    {
+        if (slots[i].iter_count || slots[i].period_count)
+            return true;
+    }
+    return false;
+}
+
+static void TaskSupervisor(void *pvParameters)
+{
+    (void)pvParameters;
+    uint32_t last_slo_evt = millis() - SUP_EVENT_INTERVAL_MS;
+
+    // Lưới cuối: supervisor không được chạy thì Task Watchdog reset (panic)
+    esp_task_wdt_init(SUP_TWDT_TIMEOUT_S, true);
+    esp_task_wdt_add(NULL);
+    LOG_I("[SUP] Task started, %u tasks, TWDT %u s", SUP_TASK_COUNT, SUP_TWDT_TIMEOUT_S);
+
+    for (;;)
+    {
+        esp_task_wdt_reset();
+        uint32_t now = millis();
+
+        for (int i = 0; i < SUP_TASK_COUNT; i++)
+            check_stall((SupTaskId_t)i, now);
+
+        // Chạy ổn định đủ lâu: không còn là chuỗi reset liên tiếp
+        if (rtc_record.resets && now >= SUP_STABLE_MS)
+            record_commit(SUP_NO_TASK, 0, 0);
+
+        // Một event gom mọi task, tối đa một lần mỗi SUP_EVENT_INTERVAL_MS
+        if (!slo_evt_queued && now - last_slo_evt >= SUP_EVENT_INTERVAL_MS && violations_pending())
+        {
+            SystemEvent_t evt = {};
+            evt.type = EVT_SLO_VIOLATION;
+            event_stamp(&evt);
+            if (app_queue_send(_report_queue, &evt, 0) == pdTRUE)
+            {
+                slo_evt_queued = true;
+                last_slo_evt = now;
+            }
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(SUP_CHECK_MS));
+    }
+}
+
+void supervisor_start_task(QueueHandle_t report_queue)
+{
+    _report_queue = report_queue;
+    xTaskCreatePinnedToCore(TaskSupervisor, "Supervisor", TASK_SUP_STACK_SIZE, NULL, TASK_SUP_PRIORITY, NULL, TASK_SUP_CORE);
+}
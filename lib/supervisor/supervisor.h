@@ -0,0 +1,84 @@
+#ifndef SUPERVISOR_H_
+#define SUPERVISOR_H_
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+// ================== SUPERVISOR (WATCHDOG PHẦN MỀM) ==================
+// Mỗi task được giám sát đánh dấu đầu / cuối một vòng làm việc:
+//   supervisor_begin(id) ngay sau khi thức dậy (có event / tới chu kỳ),
+//   supervisor_end(id) ngay trước khi chờ (queue, delay, notify).
+// Chờ dài hợp lệ bên trong một vòng (chờ đặt tay khi enroll...) gọi
+// supervisor_feed(id) định kỳ: phần chờ không tính vào SLO của vòng, nhưng
+// ngưỡng treo vẫn tính từ begin, nên chờ đó phải có timeout riêng.
+//
+// Supervisor đo thời gian một vòng (begin -> end) và chu kỳ giữa hai lần begin
+// của task định kỳ, so với SLO trong app_config.h (SUP_*_ITER_MS / _PERIOD_MS).
+// Vượt SLO: đếm và gom thành event slo_violation (tối đa một event mỗi
+// SUP_EVENT_INTERVAL_MS). Không tiến triển quá SUP_*_STALL_MS (đang trong vòng,
+// hoặc task định kỳ không quay lại vòng mới): coi như treo, báo task_stall,
+// gọi callback phục hồi của module nếu có, sau SUP_RESET_GRACE_MS vẫn treo thì
+// khởi động lại. Reset liên tiếp quá SUP_MAX_RESETS lần thì chỉ báo, không reset
+// nữa (cảm biến hỏng không được làm cửa khởi động lại mãi).
+//
+// Chính task supervisor đăng ký với Task Watchdog của ESP-IDF: supervisor bị
+// chặn (task ưu tiên cao chạy vòng vô hạn) thì watchdog phần cứng reset.
+
+typedef enum
+{
+    SUP_TASK_DOOR,
+    SUP_TASK_FP,
+    SUP_TASK_APP,
+    SUP_TASK_MQTT_LOOP,
+    SUP_TASK_MQTT_CMD,
+    SUP_TASK_NET,
+    SUP_TASK_SCHED,
+    SUP_TASK_COUNT
+} SupTaskId_t;
+
+typedef struct
+{
+    uint32_t iterations;
+    uint32_t iter_max_ms;   // vòng dài nhất từ lúc boot
+    uint32_t period_max_ms; // chu kỳ dài nhất (chỉ task định kỳ)
+    uint32_t violations;    // số vòng / chu kỳ vượt SLO
+    uint32_t stalls;
+    uint32_t stall_age_ms; // đang treo bao lâu, 0 = không treo
+} SupTaskStats_t;
+
+// Vi phạm gom từ lần lấy trước: [giá trị xấu nhất, số lần] theo từng loại SLO
+typedef struct
+{
+    SupTaskId_t id;
+    uint32_t iter_worst_ms;
+    uint16_t iter_count;
+    uint32_t period_worst_ms;
+    uint16_t period_count;
+} SupViolation_t;
+
+// Gọi từ task supervisor khi task treo: chỉ bật cờ / đánh thức, không chờ
+typedef void (*supervisor_recover_cb_t)(void);
+
+// Đọc bản ghi reset do supervisor (RTC), gọi sớm trong setup()
+void supervisor_init(void);
+// Event EVT_SLO_VIOLATION / EVT_TASK_STALL (value = SupTaskId_t) gửi vào report_queue
+void supervisor_start_task(QueueHandle_t report_queue);
+void supervisor_register_recovery(SupTaskId_t id, supervisor_recover_cb_t cb);
+
+void supervisor_begin(SupTaskId_t id);
+void supervisor_end(SupTaskId_t id);
+void supervisor_feed(SupTaskId_t id);
+
+const char *supervisor_task_name(SupTaskId_t id);
+uint32_t supervisor_iter_slo_ms(SupTaskId_t id);
+uint32_t supervisor_period_slo_ms(SupTaskId_t id);
+void supervisor_get_stats(SupTaskId_t id, SupTaskStats_t *out);
+// "recover" / "reset" / "report": supervisor làm gì với task treo
+const char *supervisor_stall_action(SupTaskId_t id);
+// Lấy và xoá vi phạm đang chờ báo (task publish gọi khi nhận EVT_SLO_VIOLATION)
+size_t supervisor_take_violations(SupViolation_t *out, size_t max);
+// Task làm supervisor reset ở lần chạy trước, -1 nếu không có
+int supervisor_last_reset(uint32_t *stall_ms);
+
+#endif // SUPERVISOR_H_
@@ -0,0 +1,117 @@
+#include "telemetry.h"
+#include "app_config.h"
+#include "config_store.h"
+#include "app_queue.h"
+#include "network.h"
+#include "mqtt.h"
+#include "door.h"
+#include "fingerprint.h"
+#include "log.h"
+#include "cpu_load.h"
+
+#include <esp_system.h>
+
+static uint32_t hb_interval = TELEMETRY_HB_MIN_MS;
+static Telemetry_t hb_last;
+static bool hb_has_last = false;
+static telemetry_wake_cb_t hb_wake_cb = nullptr;
+static uint16_t unlock_last_ms = 0;
+static uint16_t unlock_max_ms = 0;
+
+void telemetry_note_unlock_latency(uint32_t ms)
+{
+    unlock_last_ms = ms > 0xFFFF ? 0xFFFF : ms;
+    if (unlock_last_ms > unlock_max_ms)
+        unlock_max_ms = unlock_last_ms;
+}
+
+void telemetry_collect(Telemetry_t *t)
+{
+    NetStats_t net;
+    network_get_stats(&net);
+    FingerprintStats_t fp;
+    fingerprint_get_stats(&fp);
+    DoorStats_t door;
+    door_get_stats(&door);
+
+    t->uptime_s = millis() / 1000;
+    t->rssi = network_get_rssi();
+    t->net_reconnects = net.reconnects;
+    t->mqtt_reconnects = mqtt_get_reconnects();
+    t->heap_free = esp_get_free_heap_size();
+    t->heap_min_free = esp_get_minimum_free_heap_size();
+    t->scans_last_hour = fp.scans_last_hour;
+    t->scan_avg_ms = fp.scans ? fp.scan_us_total / fp.scans / 1000 : 0;
+    t->door_cycles = door.cycles;
+    t->door_alarms = door.alarms;
+
+    t->queue_drops = 0;
+    for (int i = 0; i < QUEUE_ID_COUNT; i++)
+    {
+        AppQueueStats_t qs;
+        if (app_queue_get_stats((AppQueueId_t)i, &qs))
+            t->queue_drops += qs.drops;
+    }
+
+    LogStats_t ls;
+    log_get_stats(&ls);
+    t->log_drops = ls.dropped;
+
+    t->cpu_load[0] = cpu_load_percent(0);
+    t->cpu_load[1] = cpu_load_percent(1);
+    t->unlock_ms = unlock_last_ms;
+    t->unlock_max_ms = unlock_max_ms;
+}
+
+// Thay đổi đủ lớn để backend cần biết sớm
+static bool telemetry_changed(const Telemetry_t *a, const Telemetry_t *b)
+{
+    int rssi_delta = a->rssi - b->rssi;
+    return rssi_delta >= TELEMETRY_RSSI_DELTA || rssi_delta <= -TELEMETRY_RSSI_DELTA ||
+           a->net_reconnects != b->net_reconnects ||
+           a->mqtt_reconnects != b->mqtt_reconnects ||
+           a->queue_drops != b->queue_drops ||
+           a->door_alarms != b->door_alarms ||
+           a->heap_min_free + TELEMETRY_HEAP_DELTA < b->heap_min_free;
+}
+
+uint32_t telemetry_interval_ms(void)
+{
+    return hb_interval;
+}
+
+void telemetry_schedule_next(void)
+{
+    Telemetry_t now;
+    telemetry_collect(&now);
+
+    if (hb_has_last && telemetry_changed(&now, &hb_last))
+        hb_interval = config_get()->hb_min_ms;
+    else if (hb_interval < config_get()->hb_max_ms / 2)
+        hb_interval *= 2;
+    else
+        hb_interval = config_get()->hb_max_ms;
+
+    hb_last = now;
+    hb_has_last = true;
+}
+
+void telemetry_reset_interval(void)
+{
+    hb_interval = config_get()->hb_min_ms;
+}
+
+void telemetry_register_wake_callback(telemetry_wake_cb_t cb)
+{
+    hb_wake_cb = cb;
+}
+
+void telemetry_note_alarm(void)
+{
+    // Đã ở chu kỳ ngắn nhất: heartbeat kế tiếp đã gần, không cần đánh thức
+    if (hb_interval == config_get()->hb_min_ms)
+        return;
+    hb_interval = config_get()->hb_min_ms;
+    if (hb_wake_cb)
+        hb_wake_cb();
+}
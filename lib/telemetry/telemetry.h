@@ -0,0 +1,47 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <Arduino.h>
+
+// Ảnh chụp gọn các chỉ số vận hành, gửi kèm heartbeat device_status
+typedef struct
+{
+    uint32_t uptime_s;
+    int8_t rssi;              // 0 = không có WiFi
+    uint32_t net_reconnects;
+    uint32_t mqtt_reconnects;
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint32_t scans_last_hour;
+    uint16_t scan_avg_ms;     // thời gian so khớp trung bình
+    uint32_t door_cycles;
+    uint32_t door_alarms;
+    uint32_t queue_drops;     // tổng trên mọi app_queue
+    uint32_t log_drops;       // record log bị bỏ vì ring đầy
+    int8_t cpu_load[2];       // % tải core 0 / 1, -1 = không đo
+    uint16_t unlock_ms;       // khớp vân tay -> chốt mở, lần gần nhất
+    uint16_t unlock_max_ms;
+} Telemetry_t;
+
+void telemetry_collect(Telemetry_t *t);
+// TaskApp báo độ trễ từ lúc khớp vân tay tới khi cửa mở chốt
+void telemetry_note_unlock_latency(uint32_t ms);
+
+// ================== ADAPTIVE HEARTBEAT ==================
+// Offline đã có Last Will lo, heartbeat chỉ để gửi số liệu: khi mọi thứ ổn
+// định, chu kỳ nhân đôi từ TELEMETRY_HB_MIN_MS tới TELEMETRY_HB_MAX_MS; có
+// thay đổi đáng kể (RSSI, reconnect, rơi queue, alarm, heap) thì quay về min.
+uint32_t telemetry_interval_ms(void);
+// Gọi mỗi lần gửi heartbeat định kỳ: so với lần trước để chọn chu kỳ kế tiếp
+void telemetry_schedule_next(void);
+// Vừa kết nối broker: quay về chu kỳ ngắn nhất
+void telemetry_reset_interval(void);
+// Alarm cửa / queue rơi phần tử giữa hai heartbeat: quay về chu kỳ ngắn nhất và
+// đánh thức task gửi heartbeat, không chờ hết chu kỳ dài đang chạy. Gọi từ task
+// (không từ ISR), rẻ: không khoá, không log.
+void telemetry_note_alarm(void);
+typedef void (*telemetry_wake_cb_t)(void);
+// Task gửi heartbeat (MQTT loop) đăng ký để được đánh thức
+void telemetry_register_wake_callback(telemetry_wake_cb_t cb);
+
+#endif // TELEMETRY_H_
@@ -0,0 +1,164 @@
+#include "timesync.h"
+#include "app_config.h"
+#include "config_store.h"
+
+#include <sys/time.h>
+#include "esp_sntp.h"
+#include "esp_timer.h"
+
+// Trước 2020 = đồng hồ chưa từng được đặt
+#define TIME_VALID_EPOCH 1577836800L
+
+static timesync_event_cb_t timesync_evt_cb = nullptr;
+static TimeSyncStats_t stats = {};
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool sntp_started = false;
+// lwIP SNTP giữ con trỏ tên server: bản sao riêng, không trỏ vào bank của config_store
+static char ntp_server[sizeof(((AppSettings_t *)0)->ntp_server)];
+// Mốc để biết đồng hồ nội "lẽ ra" đang chỉ bao nhiêu khi IDF đã nhảy giờ trước
+// callback: giờ hệ thống tại ref_timer_us (esp_timer), cập nhật mỗi lần sync
+static int64_t ref_clock_us = 0;
+static int64_t ref_timer_us = 0;
+
+void timesync_register_event_callback(timesync_event_cb_t cb)
+{
+    timesync_evt_cb = cb;
+}
+
+static int64_t timeval_to_us(const struct timeval *tv)
+{
+    return (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+}
+
+// Chạy trong task tcpip sau khi SNTP nhận được giờ, SAU KHI IDF đã áp giờ mới.
+// Chế độ SMOOTH: sai lệch nhỏ -> adjtime(), đồng hồ nội vẫn là giờ cũ và đang
+// được kéo dần (trạng thái IN_PROGRESS); sai lệch quá lớn -> settimeofday(),
+// đồng hồ nội đã bằng tv (COMPLETED), phải so với giờ dự đoán từ mốc trước.
+static void sntp_sync_cb(struct timeval *tv)
+{
+    struct timeval local;
+    gettimeofday(&local, NULL);
+    int64_t timer_us = esp_timer_get_time();
+    bool step = sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED;
+    int64_t offset_us;
+    if (step)
+        offset_us = timeval_to_us(tv) - (ref_clock_us + (timer_us - ref_timer_us));
+    else
+        offset_us = timeval_to_us(tv) - timeval_to_us(&local);
+    // Giờ NTP là đích của cả slew lẫn nhảy giờ
+    ref_clock_us = timeval_to_us(tv);
+    ref_timer_us = timer_us;
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&stats_mux);
+    stats.stepped = step;
+    if (step)
+        stats.steps++;
+    // Lần đầu: offset là toàn bộ giờ thực, không phải trôi
+    if (stats.syncs > 0)
+    {
+        int32_t off_ms = (int32_t)(offset_us / 1000);
+        int32_t abs_ms = off_ms < 0 ? -off_ms : off_ms;
+        if (abs_ms > stats.max_offset_ms)
+            stats.max_offset_ms = abs_ms;
+
+        // Lần sync trước đã slew hết sai lệch -> phần còn lại là trôi trong khoảng elapsed
+        uint32_t elapsed_ms = now - stats.last_sync_ms;
+        if (elapsed_ms > 0)
+        {
+            int32_t ppm = (int32_t)(offset_us * 1000 / (int64_t)elapsed_ms);
+            stats.drift_ppm = (stats.syncs == 1) ? ppm : (stats.drift_ppm * 3 + ppm) / 4;
+        }
+    }
+    stats.last_offset_ms = (int32_t)(offset_us / 1000);
+    stats.last_sync_ms = now ? now : 1;
+    stats.syncs++;
+    portEXIT_CRITICAL(&stats_mux);
+
+    if (timesync_evt_cb)
+        timesync_evt_cb(TIME_EVT_SYNCED);
+}
+
+void timesync_init(void)
+{
+    // Slew thay vì nhảy giờ: timestamp không bao giờ lùi giữa hai event liên tiếp
+    sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
+    sntp_set_sync_interval(TIME_SYNC_INTERVAL_MS);
+    sntp_set_time_sync_notification_cb(sntp_sync_cb);
+
+    // Giờ hiện có (1970 hoặc còn từ trước reset mềm) làm mốc cho lần sync đầu
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    ref_clock_us = timeval_to_us(&tv);
+    ref_timer_us = esp_timer_get_time();
+}
+
+void timesync_notify_network(bool up)
+{
+    if (!up)
+        return; // lwIP SNTP tự thử lại theo chu kỳ, không cần dừng
+
+    if (!sntp_started)
+    {
+        strcpy(ntp_server, config_get()->ntp_server);
+        configTime(NTP_GMT_OFFSET_SEC, NTP_DAYLIGHT_OFFSET_SEC, ntp_server, NTP_SERVER_2);
+        sntp_started = true;
+    }
+    else
+    {
+        // Vừa có mạng lại: gửi request ngay thay vì chờ hết chu kỳ
+        sntp_restart();
+    }
+}
+
+void timesync_reconfigure(void)
+{
+    if (!sntp_started)
+        return; // lần có mạng đầu tiên sẽ đọc server mới
+    // Dừng SNTP trước khi ghi đè tên server mà lwIP đang giữ con trỏ
+    sntp_stop();
+    strcpy(ntp_server, config_get()->ntp_server);
+    configTime(NTP_GMT_OFFSET_SEC, NTP_DAYLIGHT_OFFSET_SEC, ntp_server, NTP_SERVER_2);
+}
+
+TimeSyncQuality_t timesync_quality(void)
+{
+    uint32_t last;
+    portENTER_CRITICAL(&stats_mux);
+    last = stats.last_sync_ms;
+    portEXIT_CRITICAL(&stats_mux);
+
+    if (last && millis() - last < TIME_SYNC_STALE_MS)
+        return TIME_Q_NTP;
+    // Giờ hệ thống còn qua reset mềm (RTC) -> có giá trị nhưng không đảm bảo
+    return time(nullptr) > TIME_VALID_EPOCH ? TIME_Q_STALE : TIME_Q_NONE;
+}
+
+const char *timesync_quality_to_str(TimeSyncQuality_t q)
+{
+    switch (q)
+    {
+    case TIME_Q_NTP:
+        return "ntp";
+    case TIME_Q_STALE:
+        return "stale";
+    default:
+        return "none";
+    }
+}
+
+int32_t timesync_age_s(void)
+{
+    uint32_t last;
+    portENTER_CRITICAL(&stats_mux);
+    last = stats.last_sync_ms;
+    portEXIT_CRITICAL(&stats_mux);
+    return last ? (int32_t)((millis() - last) / 1000) : -1;
+}
+
+void timesync_get_stats(TimeSyncStats_t *out)
+{
+    portENTER_CRITICAL(&stats_mux);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_mux);
+}
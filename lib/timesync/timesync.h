@@ -0,0 +1,47 @@
+#ifndef TIMESYNC_H_
+#define TIMESYNC_H_
+
+#include <Arduino.h>
+
+// Chất lượng của đồng hồ hệ thống tại thời điểm đọc
+typedef enum
+{
+    TIME_Q_NONE,  // chưa từng đồng bộ (đồng hồ bắt đầu từ 1970)
+    TIME_Q_STALE, // giờ còn từ lần sync trước / trước reset, đã quá TIME_SYNC_STALE_MS
+    TIME_Q_NTP,   // đồng bộ NTP gần đây
+} TimeSyncQuality_t;
+
+typedef enum
+{
+    TIME_EVT_SYNCED, // SNTP vừa đồng bộ xong (lần đầu hoặc định kỳ)
+} TimeSyncEvent_t;
+
+typedef struct
+{
+    uint32_t syncs;          // số lần SNTP đồng bộ thành công
+    uint32_t last_sync_ms;   // millis() lúc sync gần nhất (0 = chưa)
+    int32_t last_offset_ms;  // NTP - đồng hồ nội lúc sync (dương = đồng hồ nội chậm)
+    int32_t max_offset_ms;   // |offset| lớn nhất sau lần sync đầu
+    int32_t drift_ppm;       // độ trôi ước tính (trung bình trượt), dương = chạy chậm
+    uint32_t steps;          // số lần IDF phải nhảy giờ (settimeofday) thay vì slew
+    bool stepped;            // lần sync gần nhất là nhảy giờ
+} TimeSyncStats_t;
+
+// Gọi từ task SNTP (tcpip), không làm việc nặng trong callback
+typedef void (*timesync_event_cb_t)(TimeSyncEvent_t evt);
+
+void timesync_register_event_callback(timesync_event_cb_t cb);
+// Cấu hình SNTP chế độ slew + chu kỳ resync, chưa gửi gói nào
+void timesync_init(void);
+// WiFi manager báo link lên: (re)start SNTP để sync ngay
+void timesync_notify_network(bool up);
+// ntp_server trong config_store vừa đổi: khởi động lại SNTP với server mới
+void timesync_reconfigure(void);
+
+TimeSyncQuality_t timesync_quality(void);
+const char *timesync_quality_to_str(TimeSyncQuality_t q);
+// Số giây từ lần sync gần nhất, -1 nếu chưa sync
+int32_t timesync_age_s(void);
+void timesync_get_stats(TimeSyncStats_t *out);
+
+#endif // TIMESYNC_H_
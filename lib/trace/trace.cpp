@@ -0,0 +1,97 @@
+#include "trace.h"
+#include "app_config.h"
+#include "app_queue.h"
+
+#if TRACE_ENABLED
+
+#include <esp_timer.h>
+
+#define TRACE_CORES 2
+// uxTaskGetSystemState trả 0 nếu mảng nhỏ hơn số task: chừa thêm cho task tạo giữa chừng
+#define TRACE_TASK_HEADROOM 4
+
+// Chỉ số ring dùng mask nên TRACE_RING_SIZE phải là lũy thừa của 2
+static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE must be a power of 2");
+
+static TraceRecord_t trace_ring[TRACE_CORES][TRACE_RING_SIZE];
+static uint32_t trace_head[TRACE_CORES]; // tổng số record đã cấp chỗ (không mask)
+static volatile bool trace_on = true;
+
+static const char *const span_names[TRACE_SPAN_COUNT] = {
+    "fp_poll", "fp_match", "fp_enroll", "mqtt_connect", "mqtt_loop", "mqtt_publish", "lcd_flush"};
+
+void IRAM_ATTR trace_record(uint8_t type, uint8_t id, uint16_t arg)
+{
+    if (!trace_on)
+        return;
+
+    uint32_t core = xPortGetCoreID();
+    uint32_t idx = __atomic_fetch_add(&trace_head[core], 1, __ATOMIC_RELAXED);
+    TraceRecord_t *r = &trace_ring[core][idx & (TRACE_RING_SIZE - 1)];
+    r->ts_us = (uint32_t)esp_timer_get_time();
+    r->task = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    r->type = type;
+    r->id = id;
+    r->arg = arg;
+}
+
+void IRAM_ATTR trace_task_switched_in(void)
+{
+    trace_record(TRACE_REC_TASK_SWITCH, 0, 0);
+}
+
+void trace_dump(Print &out)
+{
+    trace_on = false;
+    vTaskDelay(1); // writer đang dở (bị preempt giữa chừng) kịp ghi xong
+
+    out.printf("# trace v1 cores=%d ring=%d now_us=%u\n", TRACE_CORES, TRACE_RING_SIZE,
+               (unsigned)esp_timer_get_time());
+    for (int i = 0; i < QUEUE_ID_COUNT; i++)
+        out.printf("Q %d %s\n", i, app_queue_name((AppQueueId_t)i));
+    for (int i = 0; i < TRACE_SPAN_COUNT; i++)
+        out.printf("S %d %s\n", i, span_names[i]);
+
+    // Tên task theo handle (cần configUSE_TRACE_FACILITY, Arduino-ESP32 bật sẵn).
+    // Firmware + Arduino/IDF có ~25 task: mảng theo số task hiện có, trên heap
+    // thay vì stack của task gọi dump
+    UBaseType_t cap = uxTaskGetNumberOfTasks() + TRACE_TASK_HEADROOM;
+    TaskStatus_t *tasks = (TaskStatus_t *)pvPortMalloc(cap * sizeof(TaskStatus_t));
+    UBaseType_t n = tasks ? uxTaskGetSystemState(tasks, cap, NULL) : 0;
+    for (UBaseType_t i = 0; i < n; i++)
+        out.printf("K %08x %s\n", (unsigned)(uintptr_t)tasks[i].xHandle, tasks[i].pcTaskName);
+    if (n == 0)
+        out.printf("# task names unavailable (%u tasks)\n", (unsigned)uxTaskGetNumberOfTasks());
+    vPortFree(tasks);
+
+    for (int c = 0; c < TRACE_CORES; c++)
+    {
+        uint32_t head = trace_head[c];
+        uint32_t count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+        for (uint32_t i = head - count; i != head; i++)
+        {
+            const TraceRecord_t *r = &trace_ring[c][i & (TRACE_RING_SIZE - 1)];
+            out.printf("R %d %u %08x %u %u %u\n", c, (unsigned)r->ts_us, (unsigned)r->task,
+                       r->type, r->id, r->arg);
+        }
+        if (head > TRACE_RING_SIZE)
+            out.printf("# core %d overwrote %u records\n", c, (unsigned)(head - TRACE_RING_SIZE));
+        trace_head[c] = 0;
+    }
+    out.println("# end");
+
+    trace_on = true;
+}
+
+#else
+
+void trace_task_switched_in(void)
+{
+}
+
+void trace_dump(Print &out)
+{
+    out.println("# trace disabled (build with -DTRACE_ENABLED=1)");
+}
+
+#endif // TRACE_ENABLED
@@ -0,0 +1,73 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <Arduino.h>
+
+// ================== TRACE ==================
+// Bật bằng build_flags = -DTRACE_ENABLED=1. Khi tắt mọi macro TRACE_* rỗng,
+// không tốn RAM cho ring buffer và không có lệnh nào trên hot path.
+//
+// Mỗi core có một ring TraceRecord_t riêng; chỗ ghi được cấp bằng atomic
+// fetch-add nên không cần khoá, task ở core kia không bao giờ tranh chấp.
+// Dump ra dạng text (Serial / MQTT), tools/trace2chrome.py chuyển sang
+// Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev).
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+typedef enum
+{
+    TRACE_REC_TASK_SWITCH, // task vào CPU (hook traceTASK_SWITCHED_IN, xem trace_task_switched_in)
+    TRACE_REC_SPAN_BEGIN,  // id = TraceSpan_t
+    TRACE_REC_SPAN_END,
+    TRACE_REC_QUEUE_SEND,  // id = AppQueueId_t, arg = số phần tử sau khi gửi (mailbox LCD: loại tin)
+    TRACE_REC_QUEUE_DROP,  // gửi thất bại (queue đầy)
+    TRACE_REC_QUEUE_RECV,  // arg = số phần tử còn lại (mailbox LCD: loại tin)
+} TraceRecType_t;
+
+typedef enum
+{
+    TRACE_SPAN_FP_POLL,      // finger.getImage() trong vòng quét
+    TRACE_SPAN_FP_MATCH,     // image2Tz + fingerSearch
+    TRACE_SPAN_FP_ENROLL,
+    TRACE_SPAN_MQTT_CONNECT,
+    TRACE_SPAN_MQTT_LOOP,
+    TRACE_SPAN_MQTT_PUBLISH,
+    TRACE_SPAN_LCD_FLUSH,    // vẽ tin nhắn (không tính các tick màn hình chờ)
+    TRACE_SPAN_COUNT
+} TraceSpan_t;
+
+// 12 byte, ghi nguyên khối vào ring
+typedef struct
+{
+    uint32_t ts_us; // esp_timer, 32 bit thấp (quay vòng ~71 phút, tool tự nối)
+    uint32_t task;  // TaskHandle_t của task đang chạy
+    uint8_t type;   // TraceRecType_t
+    uint8_t id;
+    uint16_t arg;
+} TraceRecord_t;
+
+#if TRACE_ENABLED
+void trace_record(uint8_t type, uint8_t id, uint16_t arg);
+
+#define TRACE_BEGIN(span) trace_record(TRACE_REC_SPAN_BEGIN, (span), 0)
+#define TRACE_END(span) trace_record(TRACE_REC_SPAN_END, (span), 0)
+#define TRACE_QUEUE_SEND(qid, ok, depth) \
+    trace_record((ok) == pdTRUE ? TRACE_REC_QUEUE_SEND : TRACE_REC_QUEUE_DROP, (qid), (depth))
+#define TRACE_QUEUE_RECV(qid, depth) trace_record(TRACE_REC_QUEUE_RECV, (qid), (depth))
+#else
+#define TRACE_BEGIN(span) ((void)0)
+#define TRACE_END(span) ((void)0)
+#define TRACE_QUEUE_SEND(qid, ok, depth) ((void)0)
+#define TRACE_QUEUE_RECV(qid, depth) ((void)0)
+#endif
+
+// Gọi từ traceTASK_SWITCHED_IN() nếu framework được build lại với hook này.
+// Arduino-ESP32 dùng FreeRTOS build sẵn nên mặc định không có; khi đó
+// trace2chrome suy ra lịch CPU từ task ghi trong từng record.
+void trace_task_switched_in(void);
+
+// Tạm dừng ghi, in toàn bộ ring (cũ -> mới) rồi xoá ring và ghi tiếp
+void trace_dump(Print &out);
+
+#endif // TRACE_H_
@@ -1,20 +1,45 @@
 #include "utils.h"
+#include "timesync.h"
 #include "time.h" // Thư viện native để xử lý RTC nội và NTP
+#include <sys/time.h>
+#include <esp_system.h>
 
-String get_iso_timestamp()
+const char *get_iso_timestamp(char *buf, size_t len)
 {
+  // Đọc thẳng đồng hồ hệ thống (getLocalTime chờ tới 5s khi chưa sync).
+  // Giờ UTC kèm mili giây để backend sắp xếp event giữa nhiều thiết bị;
+  // độ tin cậy đi kèm ở trường "tq" (xem timesync).
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return format_iso_timestamp((uint32_t)tv.tv_sec, (uint16_t)(tv.tv_usec / 1000), buf, len);
+}
+
+const char *format_iso_timestamp(uint32_t sec, uint16_t ms, char *buf, size_t len)
+{
+  time_t t = (time_t)sec;
   struct tm timeinfo;
-  // getLocalTime sẽ lấy thời gian từ RTC nội (đã được sync bởi configTime)
-  if (!getLocalTime(&timeinfo))
-  {
-    return "1970-01-01T00:00:00Z"; // Trả về mặc định nếu chưa sync được giờ
-  }
+  gmtime_r(&t, &timeinfo);
 
-  char timeStringBuff[30];
-  // Định dạng chuỗi theo ISO 8601: YYYY-MM-DDTHH:MM:SSZ
-  strftime(timeStringBuff, sizeof(timeStringBuff), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+  // Định dạng chuỗi theo ISO 8601: YYYY-MM-DDTHH:MM:SS.mmmZ
+  size_t n = strftime(buf, len, "%Y-%m-%dT%H:%M:%S", &timeinfo);
+  snprintf(buf + n, len - n, ".%03uZ", (unsigned)ms);
 
-  return String(timeStringBuff);
+  return buf;
+}
+
+void event_stamp(SystemEvent_t *evt, uint32_t at_ms)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  int64_t now_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  if (at_ms)
+    now_ms -= (uint32_t)(millis() - at_ms); // lùi về lúc xảy ra
+  if (now_ms < 1000)
+    now_ms = 1000; // đồng hồ chưa đặt, vẫn khác 0 để không bị thay bằng giờ publish
+
+  evt->ts_s = (uint32_t)(now_ms / 1000);
+  evt->ts_ms = (uint16_t)(now_ms % 1000);
+  evt->tq = (uint8_t)timesync_quality();
 }
 
 const char *event_to_topic(SystemEventType_t type)
@@ -32,10 +57,41 @@ const char *event_to_topic(SystemEventType_t type)
   case EVT_DOOR_LOCKED:
   case EVT_DOOR_UNLOCKED_WAIT_OPEN:
   case EVT_DOOR_OPEN:
+  case EVT_DOOR_FORCED_OPEN:
+  case EVT_DOOR_HELD_OPEN:
+  case EVT_DOOR_RECOVERED:
     return "door";
   case EVT_STATUS_ONLINE:
+  case EVT_MEM_REPORT:
+  case EVT_SLO_VIOLATION:
+  case EVT_TASK_STALL:
     return "status";
   default:
     return nullptr;
   }
 }
+
+const char *reset_reason_to_str(int reason)
+{
+  switch ((esp_reset_reason_t)reason)
+  {
+  case ESP_RST_POWERON:
+    return "poweron";
+  case ESP_RST_EXT:
+    return "external";
+  case ESP_RST_SW:
+    return "software";
+  case ESP_RST_PANIC:
+    return "panic";
+  case ESP_RST_INT_WDT:
+  case ESP_RST_TASK_WDT:
+  case ESP_RST_WDT:
+    return "watchdog";
+  case ESP_RST_DEEPSLEEP:
+    return "deepsleep";
+  case ESP_RST_BROWNOUT:
+    return "brownout";
+  default:
+    return "unknown";
+  }
+}
@@ -5,9 +5,22 @@
 #include "app_config.h"
 
 // --- Hàm hỗ trợ lấy thời gian (ISO 8601) ---
-String get_iso_timestamp();
+#define ISO_TIMESTAMP_LEN 25 // "YYYY-MM-DDTHH:MM:SS.mmmZ" + '\0'
+// Ghi vào buffer của bên gọi (không cấp String trên heap), trả về buf
+const char *get_iso_timestamp(char *buf, size_t len);
+// Cùng định dạng cho giờ đã lưu (epoch UTC + mili giây)
+const char *format_iso_timestamp(uint32_t sec, uint16_t ms, char *buf, size_t len);
+
+// --- Gắn giờ xảy ra vào SystemEvent_t ---
+// Event có thể nằm trong queue tới khi có broker: producer gắn giờ + tq lúc
+// event xảy ra, TaskMqttPublish chỉ định dạng lại. at_ms: millis() lúc xảy ra
+// (vd. BusEvent_t::ts_ms), 0 = bây giờ.
+void event_stamp(SystemEvent_t *evt, uint32_t at_ms = 0);
 
 // --- Ánh xạ sự kiện hệ thống sang MQTT Topic Category ---
 const char *event_to_topic(SystemEventType_t type);
 
+// --- Lý do reset (esp_reset_reason_t) dạng chuỗi ngắn ---
+const char *reset_reason_to_str(int reason);
+
 #endif // UTILS_H_
@@ -12,6 +12,21 @@
 #include "display.h"
 #include "network.h"
 #include "mqtt.h"
+#include "boot.h"
+#include "timesync.h"
+#include "app_queue.h"
+#include "memprof.h"
+#include "log.h"
+#include "event_bus.h"
+#include "attendance.h"
+#include "device_state.h"
+#include "ota.h"
+#include "config_store.h"
+#include "schedule.h"
+#include "supervisor.h"
+#include "cpu_load.h"
+#include "telemetry.h"
+#include "provision.h"
 
 QueueHandle_t door_cmd_queue;   // Queue lệnh
 QueueHandle_t fp_request_queue; // Queue lệnh cho fp
@@ -20,181 +35,302 @@ QueueHandle_t mqtt_payload_queue;
 
 static SystemState_t sys_state = SYS_IDLE;
 static bool is_scanning = true;
+static uint32_t local_ready_ms = 0; // thời điểm vân tay + cửa + LCD sẵn sàng
 
-// NTP Server Configuration
-const char *ntpServer = "in.pool.ntp.org";
-const long gmtOffset_sec = 25200; // GMT+7 cho Vietnam (7 * 3600)
-const int daylightOffset_sec = 0;
+// Stage mạng vừa xong lần đầu: in lại bảng boot (bản đầu in khi phần cục bộ sẵn sàng)
+static void boot_report_stage_end(BootStage_t stage)
+{
+  if (boot_stage_end(stage) && local_ready_ms)
+    boot_print_report();
+}
 
 // HÀM HỖ TRỢ được gọi từ lib/utils/utils.h
 
 
 // Hàm send_lcd_message được chuyển tới lib/display/display.cpp
 
-void door_event_handler(DoorEvent_t res)
+// at_ms: millis() lúc producer publish lên bus, thành ts của event MQTT
+void door_event_handler(DoorEvent_t res, uint32_t seq, uint32_t at_ms)
 {
-  SystemEvent_t evt;
-  evt.value = 0;
-  Serial.print("DOOR ");
+  SystemEvent_t evt = {};
+  evt.seq = seq;
+  event_stamp(&evt, at_ms);
   switch (res)
   {
   case DOOR_EVT_UNLOCKED:
-    Serial.println("Door has been unlocked!");
+    LOG_I("[DOOR] Unlocked");
     sys_state = SYS_IDLE;
     evt.type = EVT_DOOR_UNLOCKED_WAIT_OPEN;
-    xQueueSend(system_evt_queue, &evt, 0);
+    app_queue_send(system_evt_queue, &evt, 0);
     break;
   case DOOR_EVT_OPENED:
-    Serial.println("Door opened");
+    LOG_I("[DOOR] Opened");
     send_lcd_message(LCD_MSG_DOOR_OPEN, "DOOR OPENED", "Be Careful", 3000);
     sys_state = SYS_DOOR_OPEN;
     evt.type = EVT_DOOR_OPEN;
-    xQueueSend(system_evt_queue, &evt, 0);
+    app_queue_send(system_evt_queue, &evt, 0);
     break;
   case DOOR_EVT_CLOSED_AND_LOCKED:
     send_lcd_message(LCD_MSG_IDLE, "Door Locked", "\0", 2000);
-    Serial.println("Door closed and locked");
+    LOG_I("[DOOR] Closed and locked");
     sys_state = SYS_IDLE;
     evt.type = EVT_DOOR_LOCKED;
-    xQueueSend(system_evt_queue, &evt, 0);
+    app_queue_send(system_evt_queue, &evt, 0);
     break;
   case DOOR_EVT_WAIT_TIME_END_AND_LOCKED:
     send_lcd_message(LCD_MSG_IDLE, "Door auto-locked", "after timeout", 2000);
-    Serial.println("Door auto-locked after timeout");
+    LOG_I("[DOOR] Auto-locked after timeout");
     sys_state = SYS_IDLE;
     evt.type = EVT_DOOR_LOCKED;
-    xQueueSend(system_evt_queue, &evt, 0);
+    app_queue_send(system_evt_queue, &evt, 0);
+    break;
+  case DOOR_EVT_LOCKED:
+    send_lcd_message(LCD_MSG_IDLE, "Door Locked", "\0", 2000);
+    LOG_I("[DOOR] Locked (hold released)");
+    sys_state = SYS_IDLE;
+    evt.type = EVT_DOOR_LOCKED;
+    app_queue_send(system_evt_queue, &evt, 0);
+    break;
+  case DOOR_EVT_CLOSED_HELD:
+    // Giữ mở: cửa đóng nhưng chốt vẫn mở, báo như trạng thái chờ mở
+    LOG_I("[DOOR] Closed, latch held open");
+    sys_state = SYS_IDLE;
+    evt.type = EVT_DOOR_UNLOCKED_WAIT_OPEN;
+    app_queue_send(system_evt_queue, &evt, 0);
+    break;
+  case DOOR_EVT_FORCED_OPEN:
+    send_lcd_message(LCD_MSG_ERROR, "DOOR FORCED!", "Alarm sent", 5000);
+    LOG_W("[DOOR] ALARM: forced open while locked");
+    sys_state = SYS_DOOR_OPEN;
+    evt.type = EVT_DOOR_FORCED_OPEN;
+    app_queue_send(system_evt_queue, &evt, 0);
+    break;
+  case DOOR_EVT_HELD_OPEN:
+    send_lcd_message(LCD_MSG_ERROR, "Door held open", "Please close it", 5000);
+    LOG_W("[DOOR] ALARM: held open too long");
+    evt.type = EVT_DOOR_HELD_OPEN;
+    evt.value = config_get()->held_open_ms / 1000;
+    app_queue_send(system_evt_queue, &evt, 0);
+    break;
+  case DOOR_EVT_RECOVERED:
+    LOG_I("[DOOR] Recovered: %s", door_state_to_str(door_get_state()));
+    sys_state = (door_get_state() == DOOR_STATE_LOCKED) ? SYS_IDLE : SYS_DOOR_OPEN;
+    evt.type = EVT_DOOR_RECOVERED;
+    evt.value = door_get_state();
+    app_queue_send(system_evt_queue, &evt, 0);
+    break;
+  default:
+    break;
+  }
+}
+void network_event_handler(NetStateEvent_t evt)
+{
+  switch (evt)
+  {
+  case NET_CONNECTING:
+    LOG_I("[NET] Connecting...");
+    break;
+  case NET_CONNECTED:
+    boot_report_stage_end(BOOT_STAGE_WIFI);
+    boot_stage_begin(BOOT_STAGE_NTP);
+    boot_stage_begin(BOOT_STAGE_MQTT);
+    send_lcd_message(LCD_MSG_INFO, "WiFi Connected", network_get_ip(), 2000);
+    // Link lên: (re)start SNTP và đánh thức MQTT thay vì để chúng tự poll
+    timesync_notify_network(true);
+    mqtt_notify_network(true);
+    break;
+  case NET_DISCONNECTED:
+    send_lcd_message(LCD_MSG_ERROR, "WiFi Lost", "Reconnecting...", 2000);
+    timesync_notify_network(false);
+    mqtt_notify_network(false);
+    break;
+  case NET_CONNECT_FAILED:
+    LOG_W("[NET] Connect attempt failed");
+    break;
+  default:
+    break;
+  }
+}
+
+// config_set vừa đổi nhóm cấu hình: module đọc config_get() mỗi lần dùng (cửa,
+// chu kỳ heartbeat / memprof) tự thấy giá trị mới, chỉ cần đánh thức các module giữ kết nối
+void config_change_handler(uint32_t groups)
+{
+  if (groups & CFG_GROUP_WIFI)
+    network_reconfigure();
+  if (groups & CFG_GROUP_MQTT)
+    mqtt_reconfigure();
+  if (groups & CFG_GROUP_TIME)
+    timesync_reconfigure();
+  if (groups & CFG_GROUP_TELEMETRY)
+  {
+    telemetry_reset_interval();
+    memprof_request_report(); // lấy mẫu ngay rồi ngủ theo memprof_ms mới
+  }
+  if (groups & CFG_GROUP_REBOOT)
+    LOG_W("[CFG] Some settings apply after restart");
+}
+
+void mqtt_event_handler(MqttEvent_t evt)
+{
+  switch (evt)
+  {
+  case MQTT_NET_CONNECTED:
+    boot_report_stage_end(BOOT_STAGE_MQTT);
+    // Retained snapshot có thể cũ hơn trạng thái thật sau thời gian mất kết nối
+    device_state_mark_all();
+    // Image mới (sau OTA) chạy được tới khi lên broker: không rollback nữa
+    ota_confirm();
+    // WiFi / broker vừa đổi qua config_set dùng được: ghi vào NVS
+    config_confirm();
+    break;
+  case MQTT_NET_DISCONECTED:
+    LOG_W("[MQTT] Broker connection lost");
     break;
+  case MQTT_NET_CONNECT_FAIL:
   default:
     break;
   }
 }
+
+void timesync_event_handler(TimeSyncEvent_t evt)
+{
+  if (evt == TIME_EVT_SYNCED)
+  {
+    boot_report_stage_end(BOOT_STAGE_NTP);
+    device_state_set_tq(timesync_quality());
+  }
+}
+
 const char *fingerprint_enroll_fault_handler(int16_t err)
 {
   switch (err)
   {
   case -1:
-    Serial.println("[FP][ENROLL] Step 1: Failed to get image");
+    LOG_W("[FP][ENROLL] Step 1: Failed to get image");
     return "ENROLL_FAIL_STEP1_GET_IMAGE";
 
   case -2:
-    Serial.println("[FP][ENROLL] Step 1: image2Tz(1) failed");
+    LOG_W("[FP][ENROLL] Step 1: image2Tz(1) failed");
     return "ENROLL_FAIL_STEP1_IMAGE_CONVERT";
 
   case -3:
-    Serial.println("[FP][ENROLL] Step 2: Failed to get image");
+    LOG_W("[FP][ENROLL] Step 2: Failed to get image");
     return "ENROLL_FAIL_STEP2_GET_IMAGE";
 
   case -4:
-    Serial.println("[FP][ENROLL] Step 2: image2Tz(2) failed");
+    LOG_W("[FP][ENROLL] Step 2: image2Tz(2) failed");
     return "ENROLL_FAIL_STEP2_IMAGE_CONVERT";
 
   case -5:
-    Serial.println("[FP][ENROLL] createModel() failed");
+    LOG_W("[FP][ENROLL] createModel() failed");
     return "ENROLL_FAIL_CREATE_MODEL";
 
   case -6:
-    Serial.println("[FP][ENROLL] storeModel() failed");
+    LOG_W("[FP][ENROLL] storeModel() failed");
     return "ENROLL_FAIL_STORE_MODEL";
+  case -7:
+    LOG_W("[FP][ENROLL] Timed out waiting for finger");
+    return "ENROLL_FAIL_TIMEOUT";
   case -100:
-    Serial.println("[FP][ENROLL] Duplicate found");
+    LOG_I("[FP][ENROLL] Duplicate found");
     return "ENROLL_FAIL_DUPLICATE_FOUND";
   default:
-    Serial.print("[FP][ENROLL] Unknown error code: ");
-    Serial.println(err);
+    LOG_W("[FP][ENROLL] Unknown error code: %d", err);
     return "ENROLL_FAIL_UNKNOWN";
   }
 }
 
-void fingerprint_event_handler(FingerprintEvent_t res, int16_t id)
+void fingerprint_event_handler(FingerprintEvent_t res, int16_t id, uint32_t at_ms)
 {
   DoorRequest_t cmd;
-  SystemEvent_t evt;
+  SystemEvent_t evt = {};
+  event_stamp(&evt, at_ms);
   char buff[16];
   switch (res)
   {
   case FP_EVT_INIT_OK:
-    Serial.println("[FP] Sensor ready");
+    LOG_I("[FP] Sensor ready");
     break;
 
   case FP_EVT_INIT_FAIL:
-    Serial.println("[FP] Sensor init failed");
+    LOG_W("[FP] Sensor init failed");
     break;
 
   case FP_EVT_ENROLL_START:
     snprintf(buff, sizeof(buff), "Enroll ID: %d", id);
-    Serial.printf("[FP] Start enrolling finger id=%d\n", id);
+    LOG_I("[FP] Start enrolling finger id=%d", id);
     send_lcd_message(LCD_MSG_INFO, "Place Finger", buff, 0);
     break;
 
   case FP_EVT_ENROLL_STEP1_OK:
-    Serial.printf("[FP] Step 1 OK for finger id=%d. Please lift your finger.\n", id);
+    LOG_I("[FP] Step 1 OK for finger id=%d. Please lift your finger.", id);
     send_lcd_message(LCD_MSG_INFO, "Step 1 OK", "Lift Finger Now", 2000);
     break;
 
   case FP_EVT_ENROLL_STEP2_OK:
-    Serial.printf("[FP] Step 2 OK for finger id=%d. Creating model...\n", id);
+    LOG_I("[FP] Step 2 OK for finger id=%d. Creating model...", id);
     send_lcd_message(LCD_MSG_INFO, "Step 2 OK", "Processing...", 1000);
     break;
 
   case FP_EVT_ENROLL_DONE:
     if (id >= 0)
     {
-      Serial.printf("[FP] Enroll done for finger id=%d\n", id);
+      LOG_I("[FP] Enroll done for finger id=%d", id);
       send_lcd_message(LCD_MSG_SUCCESS, "Enroll Done!", "Success", 2000);
       evt.type = EVT_FP_ENROLL_SUCCESS;
       evt.value = id;
-      xQueueSend(system_evt_queue, &evt, 0);
+      app_queue_send(system_evt_queue, &evt, 0);
     }
     else
     {
-      Serial.printf("[FP] Enroll fail! ERROR Code: %d\n", id);
+      LOG_W("[FP] Enroll fail! ERROR Code: %d", id);
       send_lcd_message(LCD_MSG_ERROR, "Enroll Failed", "Error", 2000);
       evt.type = EVT_FP_ENROLL_FAIL;
-      xQueueSend(system_evt_queue, &evt, 0);
+      app_queue_send(system_evt_queue, &evt, 0);
     }
     // Gửi event lên MQTT nếu cần
     break;
 
   case FP_EVT_DELETE_DONE:
-    Serial.printf("[FP] Delete done for finger id=%d\n", id);
+    LOG_I("[FP] Delete done for finger id=%d", id);
     // Gửi event lên MQTT nếu cần
     break;
 
   case FP_EVT_SHOW_ALL_DONE:
-    Serial.println("[FP] Show all IDs done");
+    LOG_I("[FP] Show all IDs done");
     // Gửi event lên MQTT nếu cần
     evt.type = EVT_FP_SHOW_ALL_DONE;
     evt.value = id;
-    xQueueSend(system_evt_queue, &evt, 0);
+    app_queue_send(system_evt_queue, &evt, 0);
     break;
 
   case FP_EVT_SCAN_IDLE:
     if (is_scanning)
     {
-      Serial.println("Please scan your fingerprint");
+      LOG_I("[FP] Please scan your fingerprint");
       is_scanning = false;
     }
     break;
 
   case FP_EVT_SCAN_SUCCESS:
     snprintf(buff, sizeof(buff), "ID: %d", id);
-    Serial.printf("Access granted, id=%d\n", id);
+    LOG_I("[FP] Access granted, id=%d", id);
     send_lcd_message(LCD_MSG_SUCCESS, "Access Granted", buff, 3000);
     cmd = DOOR_REQUEST_UNLOCK;
-    xQueueSend(door_cmd_queue, &cmd, 0);
+    app_queue_send(door_cmd_queue, &cmd, 0);
     evt.type = EVT_FP_MATCH;
     evt.value = id;
-    xQueueSend(system_evt_queue, &evt, 0);
+    app_queue_send(system_evt_queue, &evt, 0);
     break;
 
   case FP_EVT_SCAN_NOT_MATCH:
-    Serial.println("Access denied");
+    LOG_W("[FP] Access denied");
     send_lcd_message(LCD_MSG_ERROR, "Access Denied", "Try Again", 2000);
     break;
 
   case FP_EVT_SCAN_ERROR:
-    Serial.println("Fingerprint error");
+    LOG_W("[FP] Fingerprint error");
     // Gửi event lên MQTT nếu cần
     break;
 
@@ -203,68 +339,137 @@ void fingerprint_event_handler(FingerprintEvent_t res, int16_t id)
   }
 }
 
+// Subscriber BUS_SUB_APP: fan-out event cửa / vân tay tới LCD, queue lệnh cửa
+// và system_evt_queue, chạy trong task riêng thay vì trong task của producer
+static void TaskApp(void *pvParameters)
+{
+  uint32_t match_ms = 0; // ts của lần khớp vân tay chưa thấy cửa mở, 0 = không có
+  for (;;)
+  {
+    supervisor_end(SUP_TASK_APP);
+    const BusEvent_t *evt = event_bus_receive(BUS_SUB_APP, portMAX_DELAY);
+    if (!evt)
+      continue;
+    supervisor_begin(SUP_TASK_APP);
+
+    switch (evt->type)
+    {
+    case BUS_EVT_DOOR:
+      // Độ trễ khớp vân tay -> chốt mở, tính bằng ts của hai event trên bus
+      if (evt->door.evt == DOOR_EVT_UNLOCKED && match_ms)
+      {
+        telemetry_note_unlock_latency(evt->ts_ms - match_ms);
+        match_ms = 0;
+      }
+      door_event_handler(evt->door.evt, evt->door.seq, evt->ts_ms);
+      break;
+    case BUS_EVT_FINGERPRINT:
+      if (evt->fp.evt == FP_EVT_SCAN_SUCCESS)
+        match_ms = evt->ts_ms ? evt->ts_ms : 1;
+      fingerprint_event_handler(evt->fp.evt, evt->fp.id, evt->ts_ms);
+      break;
+    default:
+      break;
+    }
+    event_bus_release(evt);
+  }
+}
+
+// Phần tử đi qua app_queue theo giá trị, app_queue_create từ chối phần tử lớn hơn
+static_assert(sizeof(DoorRequest_t) <= APP_QUEUE_MAX_ITEM, "DoorRequest_t too large for app_queue");
+static_assert(sizeof(FingerprintRequestMsg_t) <= APP_QUEUE_MAX_ITEM, "FingerprintRequestMsg_t too large for app_queue");
+static_assert(sizeof(SystemEvent_t) <= APP_QUEUE_MAX_ITEM, "SystemEvent_t too large for app_queue");
 
 void setup()
 {
   Serial.begin(115200);
-
-  // Create Queues
-  door_cmd_queue = xQueueCreate(5, sizeof(DoorRequest_t));
-  fp_request_queue = xQueueCreate(5, sizeof(FingerprintRequestMsg_t));
-  system_evt_queue = xQueueCreate(10, sizeof(SystemEvent_t));
-  mqtt_payload_queue = xQueueCreate(5, sizeof(MqttMsg));
-  lcd_queue = xQueueCreate(5, sizeof(LcdEvent_t));
-
-  // Init Door
-  door_register_event_callback(door_event_handler);
+  log_start_task(); // sớm nhất có thể: mọi log sau đây đi qua ring buffer
+  cpu_load_init();
+  LOG_I("[BOOT] Task profile: %s", TASK_PROFILE == TASK_PROFILE_DUAL_CORE ? "dual core" : "single core");
+  ota_init(); // image chờ xác nhận: đếm lần boot thử, quá hạn thì quay về image cũ
+  config_init(); // trước mọi module đọc config_get()
+  config_register_change_callback(config_change_handler);
+  supervisor_init(); // task nào làm reset lần trước (báo trong boot_report)
+
+  // Stage phụ thuộc nhau: CORE -> DOOR, DISPLAY, FP (cục bộ)
+  //                       CORE -> WIFI -> NTP, MQTT (chạy nền, không chặn setup)
+  boot_stage_begin(BOOT_STAGE_CORE);
+  door_cmd_queue = app_queue_create(QUEUE_DOOR_CMD, 5, sizeof(DoorRequest_t));
+  fp_request_queue = app_queue_create(QUEUE_FP_REQUEST, 5, sizeof(FingerprintRequestMsg_t));
+  system_evt_queue = app_queue_create(QUEUE_SYSTEM_EVT, 10, sizeof(SystemEvent_t));
+  mqtt_payload_queue = app_queue_create(QUEUE_MQTT_PAYLOAD, 5, sizeof(MqttMsg *)); // block từ POOL_MQTT_RX
+  if (!door_cmd_queue || !fp_request_queue || !system_evt_queue || !mqtt_payload_queue)
+  {
+    // Chỉ còn thiếu heap lúc boot (kích thước đã kiểm tra lúc build): mọi task
+    // phía sau dùng các queue này, khởi động lại thay vì chạy với handle NULL
+    LOG_E("[BOOT] Queue creation failed, restarting");
+    boot_stage_end(BOOT_STAGE_CORE, false);
+    delay(1000); // cho log task kịp in
+    esp_restart();
+  }
+  event_bus_init();
+  device_state_init(system_evt_queue);
+  attendance_init(); // chỉ đọc header các sector, không erase trong setup
+  attendance_start_task();
+  ota_start_task();
+  xTaskCreatePinnedToCore(TaskApp, "TaskApp", TASK_APP_STACK_SIZE, NULL, TASK_APP_PRIORITY, NULL, TASK_APP_CORE);
+  boot_stage_end(BOOT_STAGE_CORE);
+
+  // Cửa trước tiên: khôi phục trạng thái khoá sau reset
+  boot_stage_begin(BOOT_STAGE_DOOR);
   door_init();
   door_start_task(door_cmd_queue, system_evt_queue);
+  boot_stage_end(BOOT_STAGE_DOOR);
+
+  boot_stage_begin(BOOT_STAGE_DISPLAY);
+  display_start_task();
+  boot_stage_end(BOOT_STAGE_DISPLAY);
+
+  // Mạng: chỉ khởi động, WiFi / NTP / MQTT tự tiến triển trong task của chúng.
+  // Event cửa/vân tay trước khi có broker nằm chờ trong system_evt_queue.
+  boot_stage_begin(BOOT_STAGE_WIFI);
+  timesync_register_event_callback(timesync_event_handler);
+  timesync_init();
+  network_register_event_callback(network_event_handler);
+  network_init();
+
+  mqtt_register_event_callback(mqtt_event_handler);
+  if (mqtt_init())
+  {
+    mqtt_start_tasks(mqtt_payload_queue, system_evt_queue, door_cmd_queue, fp_request_queue);
+  }
+  else
+  {
+    LOG_E("[MQTT] Init failed");
+  }
 
-  fingerprint_register_event_callback(fingerprint_event_handler);
-
-  if (fingerprint_init())
+  // verifyPassword() chờ UART của cảm biến, chạy song song với WiFi đang kết nối
+  boot_stage_begin(BOOT_STAGE_FINGERPRINT);
+  bool fp_ok = fingerprint_init();
+  if (fp_ok)
   {
     fingerprint_start_task(fp_request_queue);
   }
-  display_start_task(lcd_queue);
-
-  // WiFi Connection qua lib/network
-  Serial.print("Connecting to WiFi");
-  send_lcd_message(LCD_MSG_INFO, "Connecting...", "WiFi Network", 0);
-  
-  if (network_init()) {
-    Serial.println("\nWiFi connected!");
-    Serial.print("Local IP: ");
-    Serial.println(network_get_ip());
-    send_lcd_message(LCD_MSG_INFO, "WiFi Connected", network_get_ip(), 2000);
+  boot_stage_end(BOOT_STAGE_FINGERPRINT, fp_ok);
 
-    // Sync NTP Time
-    Serial.println("Syncing time with NTP...");
-    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-    struct tm timeinfo;
-    if (getLocalTime(&timeinfo))
-    {
-      Serial.println("Time synced successfully!");
-      Serial.println(&timeinfo, "Current time: %A, %B %d %Y %H:%M:%S");
-    }
-    else
-    {
-      Serial.println("Time sync failed, will retry in background.");
-    }
+  memprof_start_task(system_evt_queue);
 
-    // Khởi tạo MQTT qua lib/mqtt
-    if (mqtt_init()) {
-      // Truyền vào các queue để task MQTT xử lý
-      mqtt_start_tasks(mqtt_payload_queue, system_evt_queue, door_cmd_queue, fp_request_queue);
-    } else {
-      Serial.println("MQTT Failed");
-    }
-  } else {
-    Serial.println("\nWiFi Failed!");
-    send_lcd_message(LCD_MSG_ERROR, "WiFi Failed", "Check Network", 2000);
-  }
+  // Lịch chờ có giờ rồi mới chạy, sau đó áp lại chế độ cửa / quét đang có hiệu lực
+  schedule_init();
+  schedule_start_task(door_cmd_queue, fp_request_queue);
+  supervisor_start_task(system_evt_queue);
+
+  local_ready_ms = millis();
+  LOG_I("[BOOT] Local access ready in %u ms", (unsigned)local_ready_ms);
+  // In ngay cả khi không bao giờ lên được WiFi / broker; stage mạng xong sau sẽ in lại
+  boot_print_report();
+  // Bản MQTT: event đầu tiên khi lên broker (mqtt.cpp), gửi lỗi thì thử lại lần kết nối sau
+  mqtt_request_boot_report(local_ready_ms);
 }
 
+// loopTask chỉ còn phục vụ console provisioning (khi chưa có SSID)
 void loop()
 {
+  provision_poll();
+  delay(PROVISION_POLL_MS);
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+// Unit test bảng chuyển trạng thái cửa (lib/door/door_fsm.cpp)
+// Chạy: pio test -e native -f test_door_fsm
+#include <unity.h>
+#include <stdio.h>
+
+#include "door_fsm.h"
+#include "door_fsm.cpp"
+
+static const char *state_name(DoorFSMState_t s)
+{
+    static const char *names[] = {"LOCKED", "UNLOCKED_WAIT_OPEN", "OPEN", "FORCED_OPEN"};
+    return s < DOOR_STATE_COUNT ? names[s] : "?";
+}
+
+// Trạng thái đi tới được từ LOCKED (trạng thái lúc cold boot)
+static void reachable_states(bool reach[DOOR_STATE_COUNT])
+{
+    for (int s = 0; s < DOOR_STATE_COUNT; s++)
+        reach[s] = false;
+    reach[DOOR_STATE_LOCKED] = true;
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int s = 0; s < DOOR_STATE_COUNT; s++)
+        {
+            if (!reach[s])
+                continue;
+            for (int in = 0; in < DOOR_IN_COUNT; in++)
+            {
+                DoorTransition_t t = door_fsm_next((DoorFSMState_t)s, (DoorInput_t)in);
+                if (!reach[t.to])
+                {
+                    reach[t.to] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+// Cửa vật lý đang mở ở trạng thái này
+static bool state_door_open(DoorFSMState_t s)
+{
+    return s == DOOR_STATE_OPEN || s == DOOR_STATE_FORCED_OPEN;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/* ===== bảng ===== */
+static void test_table_rows_valid(void)
+{
+    TEST_ASSERT_TRUE(door_fsm_table_size > 0);
+    for (uint8_t i = 0; i < door_fsm_table_size; i++)
+    {
+        const DoorTransition_t &t = door_fsm_table[i];
+        char msg[64];
+        snprintf(msg, sizeof(msg), "row %u out of range", i);
+        TEST_ASSERT_TRUE_MESSAGE(t.from < DOOR_STATE_COUNT, msg);
+        TEST_ASSERT_TRUE_MESSAGE(t.to < DOOR_STATE_COUNT, msg);
+        TEST_ASSERT_TRUE_MESSAGE(t.input < DOOR_IN_COUNT, msg);
+    }
+}
+
+static void test_no_duplicate_rows(void)
+{
+    for (uint8_t i = 0; i < door_fsm_table_size; i++)
+    {
+        for (uint8_t j = i + 1; j < door_fsm_table_size; j++)
+        {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "rows %u and %u have the same (state, input)", i, j);
+            TEST_ASSERT_FALSE_MESSAGE(door_fsm_table[i].from == door_fsm_table[j].from &&
+                                          door_fsm_table[i].input == door_fsm_table[j].input,
+                                      msg);
+        }
+    }
+}
+
+/* ===== mọi cặp (state, input) ===== */
+static void test_every_pair(void)
+{
+    for (int s = 0; s < DOOR_STATE_COUNT; s++)
+    {
+        for (int in = 0; in < DOOR_IN_COUNT; in++)
+        {
+            DoorTransition_t t = door_fsm_next((DoorFSMState_t)s, (DoorInput_t)in);
+            char msg[96];
+            snprintf(msg, sizeof(msg), "%s + input %d", state_name((DoorFSMState_t)s), in);
+
+            TEST_ASSERT_EQUAL_MESSAGE(s, t.from, msg);
+            TEST_ASSERT_EQUAL_MESSAGE(in, t.input, msg);
+            TEST_ASSERT_TRUE_MESSAGE(t.to < DOOR_STATE_COUNT, msg);
+
+            // Không có trong bảng: đứng yên, không hành động, không event
+            bool in_table = false;
+            for (uint8_t i = 0; i < door_fsm_table_size; i++)
+                if (door_fsm_table[i].from == s && door_fsm_table[i].input == in)
+                    in_table = true;
+            if (!in_table)
+            {
+                TEST_ASSERT_EQUAL_MESSAGE(s, t.to, msg);
+                TEST_ASSERT_EQUAL_MESSAGE(DOOR_ACT_NONE, t.action, msg);
+                TEST_ASSERT_EQUAL_MESSAGE(DOOR_EVT_NONE, t.event, msg);
+            }
+
+            // Chốt chỉ khoá khi tới LOCKED, chỉ mở khi rời LOCKED sang chờ mở
+            if (t.action == DOOR_ACT_LOCK)
+                TEST_ASSERT_EQUAL_MESSAGE(DOOR_STATE_LOCKED, t.to, msg);
+            if (t.action == DOOR_ACT_UNLOCK)
+            {
+                TEST_ASSERT_EQUAL_MESSAGE(DOOR_STATE_LOCKED, t.from, msg);
+                TEST_ASSERT_EQUAL_MESSAGE(DOOR_STATE_UNLOCKED_WAIT_OPEN, t.to, msg);
+            }
+            if (t.to == DOOR_STATE_LOCKED && t.from != DOOR_STATE_LOCKED)
+                TEST_ASSERT_EQUAL_MESSAGE(DOOR_ACT_LOCK, t.action, msg);
+        }
+    }
+}
+
+static void test_all_states_reachable(void)
+{
+    bool reach[DOOR_STATE_COUNT];
+    reachable_states(reach);
+    for (int s = 0; s < DOOR_STATE_COUNT; s++)
+        TEST_ASSERT_TRUE_MESSAGE(reach[s], state_name((DoorFSMState_t)s));
+}
+
+// Sau tín hiệu cảm biến, trạng thái phải khớp cửa vật lý ở mọi trạng thái đi tới được
+static void test_reachable_states_handle_sensor(void)
+{
+    bool reach[DOOR_STATE_COUNT];
+    reachable_states(reach);
+    for (int s = 0; s < DOOR_STATE_COUNT; s++)
+    {
+        if (!reach[s])
+            continue;
+        const char *name = state_name((DoorFSMState_t)s);
+
+        DoorTransition_t t = door_fsm_next((DoorFSMState_t)s, DOOR_IN_SENSOR_OPEN);
+        TEST_ASSERT_TRUE_MESSAGE(state_door_open(t.to), name);
+
+        t = door_fsm_next((DoorFSMState_t)s, DOOR_IN_SENSOR_CLOSED);
+        TEST_ASSERT_FALSE_MESSAGE(state_door_open(t.to), name);
+    }
+}
+
+/* ===== transition cụ thể ===== */
+static void expect(DoorFSMState_t from, DoorInput_t in, DoorFSMState_t to, DoorAction_t act, DoorEvent_t evt)
+{
+    DoorTransition_t t = door_fsm_next(from, in);
+    TEST_ASSERT_EQUAL(to, t.to);
+    TEST_ASSERT_EQUAL(act, t.action);
+    TEST_ASSERT_EQUAL(evt, t.event);
+}
+
+static void test_forced_open(void)
+{
+    expect(DOOR_STATE_LOCKED, DOOR_IN_SENSOR_OPEN, DOOR_STATE_FORCED_OPEN, DOOR_ACT_NONE, DOOR_EVT_FORCED_OPEN);
+    expect(DOOR_STATE_FORCED_OPEN, DOOR_IN_HELD_TIMEOUT, DOOR_STATE_FORCED_OPEN, DOOR_ACT_NONE, DOOR_EVT_HELD_OPEN);
+    expect(DOOR_STATE_FORCED_OPEN, DOOR_IN_SENSOR_CLOSED, DOOR_STATE_LOCKED, DOOR_ACT_LOCK, DOOR_EVT_CLOSED_AND_LOCKED);
+    // Lệnh mở khi cửa đang bị cạy: bỏ qua
+    expect(DOOR_STATE_FORCED_OPEN, DOOR_IN_UNLOCK_REQ, DOOR_STATE_FORCED_OPEN, DOOR_ACT_NONE, DOOR_EVT_NONE);
+}
+
+static void test_normal_cycle(void)
+{
+    expect(DOOR_STATE_LOCKED, DOOR_IN_UNLOCK_REQ, DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_ACT_UNLOCK, DOOR_EVT_UNLOCKED);
+    expect(DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_IN_SENSOR_OPEN, DOOR_STATE_OPEN, DOOR_ACT_NONE, DOOR_EVT_OPENED);
+    expect(DOOR_STATE_OPEN, DOOR_IN_SENSOR_CLOSED, DOOR_STATE_LOCKED, DOOR_ACT_LOCK, DOOR_EVT_CLOSED_AND_LOCKED);
+    expect(DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_IN_UNLOCK_TIMEOUT, DOOR_STATE_LOCKED, DOOR_ACT_LOCK,
+           DOOR_EVT_WAIT_TIME_END_AND_LOCKED);
+    expect(DOOR_STATE_OPEN, DOOR_IN_HELD_TIMEOUT, DOOR_STATE_OPEN, DOOR_ACT_NONE, DOOR_EVT_HELD_OPEN);
+}
+
+// Giữ mở theo lịch (DOOR_REQUEST_HOLD_UNLOCK / DOOR_REQUEST_LOCK)
+static void test_hold_and_lock_req(void)
+{
+    expect(DOOR_STATE_OPEN, DOOR_IN_CLOSED_HELD, DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_ACT_NONE, DOOR_EVT_CLOSED_HELD);
+    expect(DOOR_STATE_UNLOCKED_WAIT_OPEN, DOOR_IN_LOCK_REQ, DOOR_STATE_LOCKED, DOOR_ACT_LOCK, DOOR_EVT_LOCKED);
+    // Đã khoá / cửa đang mở: lệnh khoá không làm gì (door.cpp khoá khi cửa đóng)
+    expect(DOOR_STATE_LOCKED, DOOR_IN_LOCK_REQ, DOOR_STATE_LOCKED, DOOR_ACT_NONE, DOOR_EVT_NONE);
+    expect(DOOR_STATE_OPEN, DOOR_IN_LOCK_REQ, DOOR_STATE_OPEN, DOOR_ACT_NONE, DOOR_EVT_NONE);
+    // Đang bị cạy thì không có chế độ giữ mở
+    expect(DOOR_STATE_FORCED_OPEN, DOOR_IN_CLOSED_HELD, DOOR_STATE_FORCED_OPEN, DOOR_ACT_NONE, DOOR_EVT_NONE);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_table_rows_valid);
+    RUN_TEST(test_no_duplicate_rows);
+    RUN_TEST(test_every_pair);
+    RUN_TEST(test_all_states_reachable);
+    RUN_TEST(test_reachable_states_handle_sensor);
+    RUN_TEST(test_forced_open);
+    RUN_TEST(test_normal_cycle);
+    RUN_TEST(test_hold_and_lock_req);
+    return UNITY_END();
+}
@@ -0,0 +1,242 @@
+// Benchmark shadow framebuffer LCD (lib/display/lcd_shadow.h) với backend giả
+// Chạy: pio test -e native -f test_lcd_shadow -v   (-v để thấy bảng số liệu)
+//
+// Cùng một chuỗi màn hình được vẽ 2 cách lên cùng loại backend đếm I2C:
+//  - legacy: lcd.clear() + setCursor + print từng dòng (TaskLCD trước shadow)
+//  - shadow: set_line() + flush(), chỉ ghi ô thay đổi
+// Backend mô phỏng DDRAM HD44780 (con trỏ tự tăng) nên test cũng so nội dung
+// màn hình 2 cách sau mỗi frame.
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lcd_shadow.h"
+
+#define COLS 16
+#define ROWS 2
+
+// ================== BACKEND GIẢ ==================
+// Mỗi lệnh / ký tự HD44780 qua PCF8574 = LCD_I2C_BYTES_PER_OP byte I2C
+class CountingLcd
+{
+public:
+    uint32_t ops = 0;    // lệnh + ký tự gửi tới HD44780
+    uint32_t clears = 0; // lcd.clear() (mỗi lần chờ thêm LCD_CLEAR_DELAY_US)
+
+    CountingLcd() { clear(); ops = clears = 0; }
+
+    void clear()
+    {
+        memset(_ddram, ' ', sizeof(_ddram));
+        _addr = 0;
+        ops++;
+        clears++;
+    }
+
+    void setCursor(uint8_t col, uint8_t row)
+    {
+        _addr = (row ? 0x40 : 0x00) + col;
+        ops++;
+    }
+
+    size_t write(uint8_t ch)
+    {
+        _ddram[_addr & 0x7F] = ch;
+        _addr++;
+        ops++;
+        return 1;
+    }
+
+    size_t print(const char *s)
+    {
+        size_t n = 0;
+        for (; *s; s++)
+            n += write((uint8_t)*s);
+        return n;
+    }
+
+    uint32_t i2c_bytes() const { return ops * LCD_I2C_BYTES_PER_OP; }
+    uint32_t busy_us() const { return clears * LCD_CLEAR_DELAY_US; }
+
+    // Nội dung hiển thị dòng row (COLS ô đầu của dòng DDRAM)
+    void line(uint8_t row, char *out) const
+    {
+        memcpy(out, &_ddram[row ? 0x40 : 0x00], COLS);
+        out[COLS] = '\0';
+    }
+
+private:
+    uint8_t _ddram[0x80];
+    uint8_t _addr = 0;
+};
+
+// Cách vẽ cũ của TaskLCD
+static void legacy_draw(CountingLcd &lcd, const char *l1, const char *l2)
+{
+    lcd.clear();
+    lcd.setCursor(0, 0);
+    lcd.print(l1);
+    lcd.setCursor(0, 1);
+    lcd.print(l2);
+}
+
+struct Frame_t
+{
+    const char *l1;
+    const char *l2;
+};
+
+struct BenchResult_t
+{
+    uint32_t frames;
+    uint32_t legacy_ops, legacy_bytes, legacy_busy_us;
+    uint32_t shadow_ops, shadow_bytes;
+    uint32_t shadow_est_bytes; // cộng dồn LcdFrameStats_t::i2c_bytes
+    uint32_t legacy_est_bytes; // cộng dồn legacy_i2c_bytes()
+    bool screens_match;
+};
+
+static BenchResult_t run_bench(const Frame_t *frames, size_t n)
+{
+    CountingLcd legacy_lcd, shadow_lcd;
+    LcdShadow<CountingLcd, COLS, ROWS> shadow(shadow_lcd);
+    BenchResult_t r = {};
+    r.screens_match = true;
+
+    // Giống TaskLCD: một lần clear lúc khởi động rồi mọi thứ qua shadow
+    shadow_lcd.clear();
+    shadow.sync_cleared();
+    legacy_lcd.ops = legacy_lcd.clears = 0;
+    shadow_lcd.ops = shadow_lcd.clears = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        legacy_draw(legacy_lcd, frames[i].l1, frames[i].l2);
+        r.legacy_est_bytes += shadow.legacy_i2c_bytes(frames[i].l1, frames[i].l2);
+
+        shadow.set_line(0, frames[i].l1);
+        shadow.set_line(1, frames[i].l2);
+        r.shadow_est_bytes += shadow.flush().i2c_bytes;
+
+        for (uint8_t row = 0; row < ROWS; row++)
+        {
+            char a[COLS + 1], b[COLS + 1];
+            legacy_lcd.line(row, a);
+            shadow_lcd.line(row, b);
+            if (strcmp(a, b) != 0)
+            {
+                printf("  frame %u row %u: legacy \"%s\" shadow \"%s\"\n", (unsigned)i, row, a, b);
+                r.screens_match = false;
+            }
+        }
+    }
+
+    r.frames = n;
+    r.legacy_ops = legacy_lcd.ops;
+    r.legacy_bytes = legacy_lcd.i2c_bytes();
+    r.legacy_busy_us = legacy_lcd.busy_us();
+    r.shadow_ops = shadow_lcd.ops;
+    r.shadow_bytes = shadow_lcd.i2c_bytes();
+    return r;
+}
+
+static void report(const char *name, const BenchResult_t &r)
+{
+    printf("  %-14s %3u frames | legacy %5.1f ops %6.1f B/frame (+%u us clear) | shadow %5.1f ops %6.1f B/frame | %.1fx\n",
+           name, (unsigned)r.frames,
+           (double)r.legacy_ops / r.frames, (double)r.legacy_bytes / r.frames,
+           (unsigned)(r.legacy_busy_us / r.frames),
+           (double)r.shadow_ops / r.frames, (double)r.shadow_bytes / r.frames,
+           r.shadow_bytes ? (double)r.legacy_bytes / r.shadow_bytes : 0.0);
+}
+
+static void check(const char *name, const BenchResult_t &r)
+{
+    report(name, r);
+    TEST_ASSERT_TRUE_MESSAGE(r.screens_match, "shadow screen differs from legacy screen");
+    // Ước tính trong firmware (heartbeat lcd) khớp số đếm từ backend
+    TEST_ASSERT_EQUAL_MESSAGE(r.legacy_bytes, r.legacy_est_bytes, "legacy_i2c_bytes() estimate");
+    TEST_ASSERT_EQUAL_MESSAGE(r.shadow_bytes, r.shadow_est_bytes, "flush() i2c_bytes");
+    TEST_ASSERT_TRUE_MESSAGE(r.shadow_bytes < r.legacy_bytes, "shadow must send fewer bytes");
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/* ===== chuỗi màn hình ===== */
+// Một lượt quét vân tay: chờ -> kết quả -> cửa mở -> về chờ
+static void test_scan_sequence(void)
+{
+    static const Frame_t frames[] = {
+        {"System Booting..", ""},
+        {"IoT Smart Door", "Ready to scan..."},
+        {"Access Granted", "ID: 5"},
+        {"Door Open", "Welcome!"},
+        {"IoT Smart Door", "Please Scan..."},
+        {"Access Denied", "Unknown finger"},
+        {"IoT Smart Door", "Please Scan..."},
+        {"Access Granted", "ID: 12"},
+        {"Access Granted", "ID: 13"},
+        {"IoT Smart Door", "Please Scan..."},
+    };
+    check("scan", run_bench(frames, sizeof(frames) / sizeof(frames[0])));
+}
+
+// Màn hình chờ có đồng hồ: 1 frame / giây trong 2 phút
+static void test_idle_clock(void)
+{
+    static char clock[120][COLS + 1];
+    static Frame_t frames[120];
+    for (int i = 0; i < 120; i++)
+    {
+        int s = 59 * 60 + 30 + i; // 09:59:30 -> 10:01:29, có đổi cả giờ
+        snprintf(clock[i], sizeof(clock[i]), "%02d:%02d:%02d", 9 + s / 3600, (s / 60) % 60, s % 60);
+        frames[i].l1 = clock[i];
+        frames[i].l2 = "Please Scan...";
+    }
+    BenchResult_t r = run_bench(frames, 120);
+    check("idle clock", r);
+    // Mỗi giây chỉ đổi vài chữ số: trung bình dưới 4 lệnh / frame
+    TEST_ASSERT_TRUE_MESSAGE(r.shadow_ops < 4 * r.frames, "idle clock should rewrite only changed digits");
+}
+
+// Cùng nội dung lặp lại: shadow không ghi gì
+static void test_unchanged_frames(void)
+{
+    static const Frame_t frames[] = {
+        {"IoT Smart Door", "Please Scan..."},
+        {"IoT Smart Door", "Please Scan..."},
+        {"IoT Smart Door", "Please Scan..."},
+        {"IoT Smart Door", "Please Scan..."},
+    };
+    BenchResult_t r = run_bench(frames, 4);
+    check("unchanged", r);
+    // Chỉ frame đầu tiên tốn I2C
+    BenchResult_t first = run_bench(frames, 1);
+    TEST_ASSERT_EQUAL(first.shadow_bytes, r.shadow_bytes);
+}
+
+// Dòng dài hơn màn hình bị cắt giống nhau ở 2 cách vẽ
+static void test_long_lines(void)
+{
+    static const Frame_t frames[] = {
+        {"Enroll ID 7: place finger", "again please"},
+        {"Enroll ID 7: lift", "finger now"},
+        {"Enroll done", "ID: 7"},
+    };
+    // legacy print ghi tràn sang DDRAM ngoài màn hình, so chỉ COLS ô đầu
+    BenchResult_t r = run_bench(frames, 3);
+    report("long lines", r);
+    TEST_ASSERT_TRUE(r.screens_match);
+    TEST_ASSERT_TRUE(r.shadow_bytes < r.legacy_bytes);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_scan_sequence);
+    RUN_TEST(test_idle_clock);
+    RUN_TEST(test_unchanged_frames);
+    RUN_TEST(test_long_lines);
+    return UNITY_END();
+}
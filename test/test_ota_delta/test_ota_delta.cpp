@@ -0,0 +1,355 @@
+// Unit test bộ giải mã delta OTA (lib/ota/ota_delta.cpp) với delta do tool tạo
+// Chạy: pio test -e native -f test_ota_delta
+// Vector: python3 tools/ota_delta.py testvec (sinh lại khi đổi định dạng delta)
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ota_delta.h"
+#include "ota_delta.cpp"
+#include "ota_delta_vectors.h"
+
+#define TV_TARGET_SIZE sizeof(ota_tv_target)
+#define TV_HDR_SIZE (OTA_DELTA_FIXED_HDR + (ota_tv_delta[6] | (ota_tv_delta[7] << 8)))
+
+// ================== IO GIẢ ==================
+// Base sinh lại giống tv_images() trong tool, output ghi vào RAM
+struct MockIo_t
+{
+    uint8_t base[OTA_TV_BASE_SIZE];
+    uint8_t out[TV_TARGET_SIZE + 64];
+    size_t out_len;
+    bool reject_header;
+    int fail_write_after; // -1 = không bao giờ lỗi
+    int writes;
+    bool header_seen;
+    OtaDeltaHeader_t hdr;
+};
+
+static MockIo_t io_state;
+static OtaDelta_t dec;
+
+static uint32_t xorshift(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static bool mock_header(void *ctx, const OtaDeltaHeader_t *hdr)
+{
+    MockIo_t *m = (MockIo_t *)ctx;
+    m->header_seen = true;
+    m->hdr = *hdr;
+    return !m->reject_header;
+}
+
+static bool mock_read_base(void *ctx, uint32_t off, uint8_t *buf, size_t len)
+{
+    MockIo_t *m = (MockIo_t *)ctx;
+    if (off + len > sizeof(m->base))
+        return false;
+    memcpy(buf, m->base + off, len);
+    return true;
+}
+
+static bool mock_write(void *ctx, const uint8_t *buf, size_t len)
+{
+    MockIo_t *m = (MockIo_t *)ctx;
+    if (m->fail_write_after >= 0 && m->writes >= m->fail_write_after)
+        return false;
+    if (m->out_len + len > sizeof(m->out))
+        return false;
+    memcpy(m->out + m->out_len, buf, len);
+    m->out_len += len;
+    m->writes++;
+    return true;
+}
+
+static void start(void)
+{
+    OtaDeltaIo_t io = {&io_state, mock_header, mock_read_base, mock_write};
+    ota_delta_init(&dec, &io);
+}
+
+// Nạp cả buffer theo từng mảnh step byte (0 = một lần)
+static OtaDeltaResult_t feed_all(const uint8_t *data, size_t len, size_t step)
+{
+    OtaDeltaResult_t r = OTA_DELTA_MORE;
+    if (step == 0)
+        step = len;
+    for (size_t off = 0; off < len; off += step)
+        r = ota_delta_feed(&dec, data + off, len - off < step ? len - off : step);
+    return r;
+}
+
+// Delta tự dựng: header (kể cả chữ ký) của vector + các op tuỳ ý
+static uint8_t crafted[sizeof(ota_tv_delta) + 64];
+static size_t crafted_len;
+
+static void craft_begin(void)
+{
+    memcpy(crafted, ota_tv_delta, TV_HDR_SIZE);
+    crafted_len = TV_HDR_SIZE;
+}
+
+static void craft_u8(uint8_t v)
+{
+    crafted[crafted_len++] = v;
+}
+
+static void craft_u32(uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        craft_u8((uint8_t)(v >> (8 * i)));
+}
+
+static void expect_target(void)
+{
+    TEST_ASSERT_EQUAL(TV_TARGET_SIZE, io_state.out_len);
+    TEST_ASSERT_EQUAL_MEMORY(ota_tv_target, io_state.out, TV_TARGET_SIZE);
+}
+
+void setUp(void)
+{
+    memset(&io_state, 0, sizeof(io_state));
+    io_state.fail_write_after = -1;
+    uint32_t x = OTA_TV_SEED;
+    for (size_t i = 0; i < sizeof(io_state.base); i++)
+    {
+        x = xorshift(x);
+        io_state.base[i] = x & 0xFF;
+    }
+    start();
+}
+
+void tearDown(void) {}
+
+/* ===== delta hợp lệ ===== */
+static void test_vector_has_all_ops(void)
+{
+    TEST_ASSERT_TRUE(OTA_TV_COPY_OPS > 0);
+    TEST_ASSERT_TRUE(OTA_TV_ADD_OPS > 0);
+    TEST_ASSERT_TRUE(OTA_TV_RUN_OPS > 0);
+    // Target dài hơn base: COPY không đủ, phải có ADD / RUN ở cuối
+    TEST_ASSERT_TRUE(TV_TARGET_SIZE > OTA_TV_BASE_SIZE);
+}
+
+static void test_whole_delta(void)
+{
+    TEST_ASSERT_EQUAL(OTA_DELTA_DONE, feed_all(ota_tv_delta, sizeof(ota_tv_delta), 0));
+    TEST_ASSERT_TRUE(io_state.header_seen);
+    TEST_ASSERT_EQUAL(OTA_TV_BASE_SIZE, io_state.hdr.base_size);
+    TEST_ASSERT_EQUAL(TV_TARGET_SIZE, io_state.hdr.target_size);
+    expect_target();
+}
+
+// Ranh giới chunk rơi vào giữa header / chữ ký / tham số op / dữ liệu ADD
+static void test_chunk_sizes(void)
+{
+    static const size_t steps[] = {1, 2, 3, 7, 64, 79, 81, 150, 512};
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    {
+        setUp();
+        char msg[32];
+        snprintf(msg, sizeof(msg), "step %u", (unsigned)steps[i]);
+        TEST_ASSERT_EQUAL_MESSAGE(OTA_DELTA_DONE, feed_all(ota_tv_delta, sizeof(ota_tv_delta), steps[i]), msg);
+        expect_target();
+    }
+}
+
+static void test_random_chunks(void)
+{
+    for (uint32_t seed = 1; seed <= 20; seed++)
+    {
+        setUp();
+        uint32_t x = seed * 2654435761UL;
+        OtaDeltaResult_t r = OTA_DELTA_MORE;
+        for (size_t off = 0; off < sizeof(ota_tv_delta);)
+        {
+            x = xorshift(x);
+            size_t n = 1 + x % 96;
+            if (n > sizeof(ota_tv_delta) - off)
+                n = sizeof(ota_tv_delta) - off;
+            r = ota_delta_feed(&dec, ota_tv_delta + off, n);
+            off += n;
+        }
+        TEST_ASSERT_EQUAL(OTA_DELTA_DONE, r);
+        expect_target();
+    }
+}
+
+/* ===== header hỏng ===== */
+static void test_bad_magic(void)
+{
+    memcpy(crafted, ota_tv_delta, sizeof(ota_tv_delta));
+    crafted[0] ^= 0x01;
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_MAGIC, feed_all(crafted, sizeof(ota_tv_delta), 0));
+    TEST_ASSERT_FALSE(io_state.header_seen);
+}
+
+static void test_bad_version(void)
+{
+    memcpy(crafted, ota_tv_delta, sizeof(ota_tv_delta));
+    crafted[4] = OTA_DELTA_VERSION + 1;
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_MAGIC, feed_all(crafted, sizeof(ota_tv_delta), 0));
+}
+
+static void test_bad_sig_len(void)
+{
+    static const uint16_t lens[] = {0, OTA_DELTA_MAX_SIG + 1, 0xFFFF};
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++)
+    {
+        setUp();
+        memcpy(crafted, ota_tv_delta, sizeof(ota_tv_delta));
+        crafted[6] = lens[i] & 0xFF;
+        crafted[7] = lens[i] >> 8;
+        TEST_ASSERT_EQUAL(OTA_DELTA_ERR_HEADER, feed_all(crafted, sizeof(ota_tv_delta), 0));
+        TEST_ASSERT_FALSE(io_state.header_seen);
+    }
+}
+
+static void test_zero_target_size(void)
+{
+    memcpy(crafted, ota_tv_delta, sizeof(ota_tv_delta));
+    memset(crafted + 12, 0, 4);
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_HEADER, feed_all(crafted, sizeof(ota_tv_delta), 0));
+}
+
+// ota.cpp từ chối khi sha256 base không khớp image đang chạy
+static void test_header_rejected(void)
+{
+    io_state.reject_header = true;
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_HEADER, feed_all(ota_tv_delta, sizeof(ota_tv_delta), 0));
+    TEST_ASSERT_TRUE(io_state.header_seen);
+    TEST_ASSERT_EQUAL(0, io_state.out_len);
+}
+
+/* ===== op hỏng ===== */
+static void test_copy_out_of_base(void)
+{
+    struct
+    {
+        uint32_t src, len;
+    } cases[] = {
+        {OTA_TV_BASE_SIZE - 10, 11}, // vượt cuối base 1 byte
+        {OTA_TV_BASE_SIZE + 1, 0},   // src ngoài base
+        {0xFFFFFFF0UL, 0x20},        // src + len tràn uint32
+        {16, 0xFFFFFFFFUL},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        setUp();
+        craft_begin();
+        craft_u8(0x01);
+        craft_u32(cases[i].src);
+        craft_u32(cases[i].len);
+        char msg[32];
+        snprintf(msg, sizeof(msg), "case %u", (unsigned)i);
+        TEST_ASSERT_EQUAL_MESSAGE(OTA_DELTA_ERR_RANGE, feed_all(crafted, crafted_len, 0), msg);
+        TEST_ASSERT_EQUAL_MESSAGE(0, io_state.out_len, msg);
+    }
+}
+
+static void test_output_beyond_target(void)
+{
+    // ADD dài hơn target
+    craft_begin();
+    craft_u8(0x02);
+    craft_u32(TV_TARGET_SIZE + 1);
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_RANGE, feed_all(crafted, crafted_len, 0));
+
+    // RUN cộng dồn vượt target
+    setUp();
+    craft_begin();
+    craft_u8(0x03);
+    craft_u32(TV_TARGET_SIZE - 1);
+    craft_u8(0xFF);
+    craft_u8(0x03);
+    craft_u32(2);
+    craft_u8(0xFF);
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_RANGE, feed_all(crafted, crafted_len, 0));
+    TEST_ASSERT_EQUAL(TV_TARGET_SIZE - 1, io_state.out_len);
+}
+
+static void test_end_before_target(void)
+{
+    craft_begin();
+    craft_u8(0x01);
+    craft_u32(0);
+    craft_u32(100);
+    craft_u8(0x00);
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_RANGE, feed_all(crafted, crafted_len, 0));
+}
+
+static void test_unknown_op(void)
+{
+    craft_begin();
+    craft_u8(0x07);
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_OP, feed_all(crafted, crafted_len, 0));
+}
+
+static void test_data_after_end(void)
+{
+    TEST_ASSERT_EQUAL(OTA_DELTA_DONE, feed_all(ota_tv_delta, sizeof(ota_tv_delta), 0));
+    static const uint8_t extra = 0x00;
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_OP, ota_delta_feed(&dec, &extra, 1));
+}
+
+/* ===== input cụt / IO lỗi ===== */
+// Delta bị cắt ở mọi vị trí: không bao giờ DONE (kể cả khi chỉ thiếu END),
+// output là phần đầu của target
+static void test_truncated_input(void)
+{
+    for (size_t cut = 0; cut < sizeof(ota_tv_delta); cut++)
+    {
+        setUp();
+        OtaDeltaResult_t r = feed_all(ota_tv_delta, cut, 0);
+        char msg[32];
+        snprintf(msg, sizeof(msg), "cut at %u", (unsigned)cut);
+        TEST_ASSERT_EQUAL_MESSAGE(OTA_DELTA_MORE, r, msg);
+        TEST_ASSERT_TRUE_MESSAGE(io_state.out_len <= TV_TARGET_SIZE, msg);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(ota_tv_target, io_state.out, io_state.out_len, msg);
+    }
+}
+
+static void test_write_error(void)
+{
+    io_state.fail_write_after = 2;
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_IO, feed_all(ota_tv_delta, sizeof(ota_tv_delta), 0));
+}
+
+// Lỗi là trạng thái cuối: nạp tiếp dữ liệu đúng vẫn trả lỗi cũ, không ghi thêm
+static void test_error_is_sticky(void)
+{
+    craft_begin();
+    craft_u8(0x07);
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_OP, feed_all(crafted, crafted_len, 0));
+    const uint8_t *ops = ota_tv_delta + TV_HDR_SIZE;
+    TEST_ASSERT_EQUAL(OTA_DELTA_ERR_OP, ota_delta_feed(&dec, ops, sizeof(ota_tv_delta) - TV_HDR_SIZE));
+    TEST_ASSERT_EQUAL(0, io_state.out_len);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_vector_has_all_ops);
+    RUN_TEST(test_whole_delta);
+    RUN_TEST(test_chunk_sizes);
+    RUN_TEST(test_random_chunks);
+    RUN_TEST(test_bad_magic);
+    RUN_TEST(test_bad_version);
+    RUN_TEST(test_bad_sig_len);
+    RUN_TEST(test_zero_target_size);
+    RUN_TEST(test_header_rejected);
+    RUN_TEST(test_copy_out_of_base);
+    RUN_TEST(test_output_beyond_target);
+    RUN_TEST(test_end_before_target);
+    RUN_TEST(test_unknown_op);
+    RUN_TEST(test_data_after_end);
+    RUN_TEST(test_truncated_input);
+    RUN_TEST(test_write_error);
+    RUN_TEST(test_error_is_sticky);
+    return UNITY_END();
+}
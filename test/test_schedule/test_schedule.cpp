@@ -0,0 +1,225 @@
+// Unit test timer wheel và parse giờ của lịch (lib/schedule/timer_wheel.cpp, schedule_time.cpp)
+// Chạy: pio test -e native -f test_schedule
+#include <unity.h>
+#include <stdio.h>
+
+#include "timer_wheel.h"
+#include "timer_wheel.cpp"
+#include "schedule_time.h"
+#include "schedule_time.cpp"
+
+#define MAX_FIRED 16
+
+typedef struct
+{
+    TimerWheel_t *w;
+    TwTimer_t *timer[MAX_FIRED]; // theo thứ tự tới hạn
+    uint32_t tick[MAX_FIRED];    // tick lúc cb chạy
+    uint8_t n;
+    uint32_t period; // != 0: cb hẹn lại chính timer đó sau period tick
+} Fired_t;
+
+static TimerWheel_t wheel;
+static Fired_t fired;
+
+static void on_expire(TwTimer_t *t, void *ctx)
+{
+    Fired_t *f = (Fired_t *)ctx;
+    if (f->n < MAX_FIRED)
+    {
+        f->timer[f->n] = t;
+        f->tick[f->n] = f->w->now - 1; // tw_tick tăng now trước khi gọi cb
+        f->n++;
+    }
+    if (f->period)
+        tw_add(f->w, t, t->expires + f->period);
+}
+
+static void run_ticks(uint32_t n)
+{
+    while (n--)
+        tw_tick(&wheel, on_expire, &fired);
+}
+
+static void timer_init(TwTimer_t *t)
+{
+    t->next = NULL;
+    t->pprev = NULL;
+    t->expires = 0;
+}
+
+void setUp(void)
+{
+    tw_init(&wheel, 0);
+    fired = Fired_t();
+    fired.w = &wheel;
+}
+
+void tearDown(void) {}
+
+// ================== TIMER WHEEL ==================
+
+// Timer tầng 0 chạy đúng tick tới hạn, không sớm hơn
+static void test_wheel_expiry(void)
+{
+    TwTimer_t a, b;
+    timer_init(&a);
+    timer_init(&b);
+    tw_add(&wheel, &a, 5);
+    tw_add(&wheel, &b, 5);
+    TEST_ASSERT_TRUE(tw_pending(&a));
+
+    run_ticks(5); // tick 0..4
+    TEST_ASSERT_EQUAL(0, fired.n);
+    run_ticks(1); // tick 5
+    TEST_ASSERT_EQUAL(2, fired.n);
+    TEST_ASSERT_EQUAL(5, fired.tick[0]);
+    TEST_ASSERT_EQUAL(5, fired.tick[1]);
+    TEST_ASSERT_FALSE(tw_pending(&a));
+    TEST_ASSERT_FALSE(tw_pending(&b));
+
+    run_ticks(2 * TW_SLOTS); // ô đã quay lại: không chạy lần nữa
+    TEST_ASSERT_EQUAL(2, fired.n);
+}
+
+// expires đã qua -> tick kế tiếp; xa hơn TW_MAX_DELAY -> kẹp lại
+static void test_wheel_past_and_clamp(void)
+{
+    tw_init(&wheel, 1000);
+    TwTimer_t past, far;
+    timer_init(&past);
+    timer_init(&far);
+    tw_add(&wheel, &past, 10);
+    tw_add(&wheel, &far, 1000 + TW_MAX_DELAY + 500);
+    TEST_ASSERT_EQUAL(1000, past.expires);
+    TEST_ASSERT_EQUAL(1000 + TW_MAX_DELAY, far.expires);
+
+    run_ticks(1);
+    TEST_ASSERT_EQUAL(1, fired.n);
+    TEST_ASSERT_EQUAL_PTR(&past, fired.timer[0]);
+    TEST_ASSERT_EQUAL(1000, fired.tick[0]);
+}
+
+// Timer ở tầng 1, 2, 3 được đổ dần xuống tầng 0 và chạy đúng tick, kể cả khi
+// wheel bắt đầu ở tick không tròn vòng
+static void test_wheel_cascade_levels(void)
+{
+    const uint32_t start = 3 * TW_SLOTS * TW_SLOTS + 17;
+    const uint32_t delays[] = {
+        TW_SLOTS + 3,                       // tầng 1
+        TW_SLOTS * TW_SLOTS + 11,           // tầng 2
+        TW_SLOTS * TW_SLOTS * TW_SLOTS + 7, // tầng 3
+    };
+    tw_init(&wheel, start);
+    TwTimer_t t[3];
+    for (int i = 2; i >= 0; i--) // thêm ngược thứ tự tới hạn
+    {
+        timer_init(&t[i]);
+        tw_add(&wheel, &t[i], start + delays[i]);
+    }
+
+    run_ticks(delays[2] + 1);
+    TEST_ASSERT_EQUAL(3, fired.n);
+    for (int i = 0; i < 3; i++)
+    {
+        char msg[32];
+        snprintf(msg, sizeof(msg), "level %d", i + 1);
+        TEST_ASSERT_EQUAL_PTR_MESSAGE(&t[i], fired.timer[i], msg);
+        TEST_ASSERT_EQUAL_MESSAGE(start + delays[i], fired.tick[i], msg);
+    }
+}
+
+// tw_del gỡ timer ở tầng 0 và ở tầng trên trước khi được đổ xuống
+static void test_wheel_cancel(void)
+{
+    TwTimer_t near_a, near_b, far;
+    timer_init(&near_a);
+    timer_init(&near_b);
+    timer_init(&far);
+    tw_add(&wheel, &near_a, 20);
+    tw_add(&wheel, &near_b, 20); // cùng ô với near_a
+    tw_add(&wheel, &far, TW_SLOTS * TW_SLOTS + 5);
+
+    tw_del(&near_a);
+    tw_del(&near_a); // gỡ lần 2: không làm gì
+    TEST_ASSERT_FALSE(tw_pending(&near_a));
+    run_ticks(TW_SLOTS * 10);
+    tw_del(&far);
+    TEST_ASSERT_FALSE(tw_pending(&far));
+
+    run_ticks(TW_SLOTS * TW_SLOTS + TW_SLOTS);
+    TEST_ASSERT_EQUAL(1, fired.n);
+    TEST_ASSERT_EQUAL_PTR(&near_b, fired.timer[0]);
+    TEST_ASSERT_EQUAL(20, fired.tick[0]);
+}
+
+// cb hẹn lại chính timer (như rule lịch hẹn lần kế tiếp)
+static void test_wheel_rearm_in_callback(void)
+{
+    TwTimer_t t;
+    timer_init(&t);
+    fired.period = 100;
+    tw_add(&wheel, &t, 50);
+
+    run_ticks(351);
+    TEST_ASSERT_EQUAL(4, fired.n);
+    TEST_ASSERT_EQUAL(50, fired.tick[0]);
+    TEST_ASSERT_EQUAL(150, fired.tick[1]);
+    TEST_ASSERT_EQUAL(250, fired.tick[2]);
+    TEST_ASSERT_EQUAL(350, fired.tick[3]);
+    TEST_ASSERT_TRUE(tw_pending(&t));
+}
+
+// ================== PARSE GIỜ ==================
+
+static void test_parse_time_accept(void)
+{
+    static const struct
+    {
+        const char *s;
+        uint32_t sec;
+    } ok[] = {
+        {"07:30", 7 * 3600 + 30 * 60},
+        {"7:5", 7 * 3600 + 5 * 60},
+        {"00:00", 0},
+        {"23:59", 23 * 3600 + 59 * 60},
+        {"08:00:30", 8 * 3600 + 30},
+        {"23:59:59", 86399},
+    };
+    for (size_t i = 0; i < sizeof(ok) / sizeof(ok[0]); i++)
+    {
+        uint32_t sec = 12345;
+        TEST_ASSERT_TRUE_MESSAGE(schedule_parse_time(ok[i].s, &sec), ok[i].s);
+        TEST_ASSERT_EQUAL_MESSAGE(ok[i].sec, sec, ok[i].s);
+    }
+}
+
+static void test_parse_time_reject(void)
+{
+    static const char *const bad[] = {
+        "24:00", "07:60", "07:30:60", // ngoài khoảng
+        "07:30x", "07:30 ", " 07:30", "07:30:", "07:30:00:00", // ký tự thừa
+        "", "7", "07", ":30", "007:30", "07:030", "-1:00", "+7:30", "7.30",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        uint32_t sec = 12345;
+        TEST_ASSERT_FALSE_MESSAGE(schedule_parse_time(bad[i], &sec), bad[i]);
+        TEST_ASSERT_EQUAL_MESSAGE(12345, sec, bad[i]); // lỗi không ghi đè kết quả
+    }
+    uint32_t sec;
+    TEST_ASSERT_FALSE(schedule_parse_time(NULL, &sec));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_wheel_expiry);
+    RUN_TEST(test_wheel_past_and_clamp);
+    RUN_TEST(test_wheel_cascade_levels);
+    RUN_TEST(test_wheel_cancel);
+    RUN_TEST(test_wheel_rearm_in_callback);
+    RUN_TEST(test_parse_time_accept);
+    RUN_TEST(test_parse_time_reject);
+    return UNITY_END();
+}
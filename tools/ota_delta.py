@@ -0,0 +1,898 @@
+#!/usr/bin/env python3
+"""Tạo / kiểm tra / gửi delta firmware cho OTA qua MQTT (xem lib/ota).
+
+    python3 tools/ota_delta.py keygen -k ota_key.pem --header lib/ota/ota_key.h
+    python3 tools/ota_delta.py make old.bin new.bin -k ota_key.pem -o update.odlt
+    python3 tools/ota_delta.py apply old.bin update.odlt -o check.bin --header lib/ota/ota_key.h
+    python3 tools/ota_delta.py push update.odlt --host 192.168.1.10 \\
+        --prefix esp32/vmh-test/esp32-client-A1B2C3D4E5F6
+    python3 tools/ota_delta.py selftest            # broker + thiết bị giả, không cần board
+    python3 tools/ota_delta.py testvec -o test/test_ota_delta/ota_delta_vectors.h
+
+old.bin phải đúng là image đang chạy trên thiết bị (.pio/build/<env>/firmware.bin
+của bản đang cài). Định dạng delta: xem lib/ota/ota_delta.h.
+
+Cần: pip install cryptography paho-mqtt
+"""
+
+import argparse
+import hashlib
+import json
+import random
+import socketserver
+import struct
+import sys
+import threading
+import time
+
+MAGIC = b"ODLT"
+VERSION = 1
+OP_END, OP_COPY, OP_ADD, OP_RUN = range(4)
+
+BLOCK = 16     # độ dài khớp tối thiểu để tìm trong base
+MIN_RUN = 16   # RUN ngắn hơn thì để trong ADD
+MAX_CANDIDATES = 8
+
+
+# ---------------------------------------------------------------- khoá / chữ ký
+def load_private_key(path):
+    from cryptography.hazmat.primitives import serialization
+    with open(path, "rb") as f:
+        return serialization.load_pem_private_key(f.read(), password=None)
+
+
+def sign(key_path, target):
+    from cryptography.hazmat.primitives import hashes
+    from cryptography.hazmat.primitives.asymmetric import ec
+    return load_private_key(key_path).sign(target, ec.ECDSA(hashes.SHA256()))
+
+
+def public_pem_from_header(path):
+    text = open(path).read()
+    lines = [l.split('"')[1].replace("\\n", "\n") for l in text.splitlines() if l.strip().startswith('"')]
+    return "".join(lines).encode()
+
+
+def verify(pub_pem, sig, target):
+    from cryptography.hazmat.primitives import hashes, serialization
+    from cryptography.hazmat.primitives.asymmetric import ec
+    from cryptography.exceptions import InvalidSignature
+    key = serialization.load_pem_public_key(pub_pem)
+    try:
+        key.verify(sig, target, ec.ECDSA(hashes.SHA256()))
+        return True
+    except InvalidSignature:
+        return False
+
+
+def cmd_keygen(args):
+    from cryptography.hazmat.primitives import serialization
+    from cryptography.hazmat.primitives.asymmetric import ec
+    key = ec.generate_private_key(ec.SECP256R1())
+    with open(args.key, "wb") as f:
+        f.write(key.private_bytes(serialization.Encoding.PEM, serialization.PrivateFormat.PKCS8,
+                                  serialization.NoEncryption()))
+    pub = key.public_key().public_bytes(serialization.Encoding.PEM,
+                                        serialization.PublicFormat.SubjectPublicKeyInfo).decode()
+    body = "".join('    "%s\\n"\n' % l for l in pub.strip().splitlines())
+    header = ("#ifndef OTA_KEY_H_\n#define OTA_KEY_H_\n\n"
+              "// Khoá công khai ECDSA P-256 kiểm tra chữ ký firmware OTA.\n"
+              "// Sinh bằng: python3 tools/ota_delta.py keygen -k <private.pem> --header lib/ota/ota_key.h\n"
+              "// Private key giữ ngoài repo.\n"
+              "static const char OTA_PUBLIC_KEY_PEM[] =\n%s    ;\n\n#endif // OTA_KEY_H_\n" % body)
+    with open(args.header, "w") as f:
+        f.write(header)
+    print("private key -> %s, public key -> %s" % (args.key, args.header))
+
+
+# ---------------------------------------------------------------- tạo delta
+def build_index(base):
+    index = {}
+    for i in range(0, len(base) - BLOCK + 1):
+        lst = index.setdefault(base[i:i + BLOCK], [])
+        if len(lst) < MAX_CANDIDATES:
+            lst.append(i)
+    return index
+
+
+def match_len(base, b, target, t):
+    n = 0
+    limit = min(len(base) - b, len(target) - t)
+    # so từng khối 64 byte trước cho nhanh
+    while n + 64 <= limit and base[b + n:b + n + 64] == target[t + n:t + n + 64]:
+        n += 64
+    while n < limit and base[b + n] == target[t + n]:
+        n += 1
+    return n
+
+
+def run_len(target, t):
+    v = target[t]
+    n = 1
+    while t + n < len(target) and target[t + n] == v:
+        n += 1
+    return n
+
+
+def diff(base, target):
+    """Trả về list op: (OP_COPY, src, len) | (OP_ADD, bytes) | (OP_RUN, len, byte)."""
+    index = build_index(base)
+    ops, lit = [], bytearray()
+    t, next_src = 0, -1
+
+    def flush():
+        if lit:
+            ops.append((OP_ADD, bytes(lit)))
+            lit.clear()
+
+    while t < len(target):
+        best_src, best_len = -1, 0
+        # Ưu tiên nối tiếp COPY trước (code dịch chỗ giữ nguyên thứ tự)
+        if 0 <= next_src < len(base):
+            n = match_len(base, next_src, target, t)
+            if n >= BLOCK:
+                best_src, best_len = next_src, n
+        for cand in index.get(target[t:t + BLOCK], ()):
+            n = match_len(base, cand, target, t)
+            if n > best_len:
+                best_src, best_len = cand, n
+        rl = run_len(target, t)
+        if rl >= MIN_RUN and rl >= best_len:
+            flush()
+            ops.append((OP_RUN, rl, target[t]))
+            t += rl
+            continue
+        if best_len >= BLOCK:
+            flush()
+            ops.append((OP_COPY, best_src, best_len))
+            t += best_len
+            next_src = best_src + best_len
+            continue
+        lit.append(target[t])
+        t += 1
+        if next_src >= 0:
+            next_src += 1
+    flush()
+    return ops
+
+
+def encode(base, target, ops, sig):
+    out = bytearray()
+    out += MAGIC + struct.pack("<BBHII", VERSION, 0, len(sig), len(base), len(target))
+    out += hashlib.sha256(base).digest() + hashlib.sha256(target).digest() + sig
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, op[1], op[2])
+        elif op[0] == OP_ADD:
+            out += struct.pack("<BI", OP_ADD, len(op[1])) + op[1]
+        else:
+            out += struct.pack("<BIB", OP_RUN, op[1], op[2])
+    out.append(OP_END)
+    return bytes(out)
+
+
+def cmd_make(args):
+    base = open(args.base, "rb").read()
+    target = open(args.target, "rb").read()
+    ops = [(OP_ADD, target)] if args.full else diff(base, target)
+    delta = encode(base, target, ops, sign(args.key, target))
+    with open(args.output, "wb") as f:
+        f.write(delta)
+    copied = sum(op[2] for op in ops if op[0] == OP_COPY)
+    print("%s: %d B (target %d B, %.1f%%), %d op, %d B chép từ base" %
+          (args.output, len(delta), len(target), 100.0 * len(delta) / len(target), len(ops), copied))
+
+
+# ---------------------------------------------------------------- đọc / áp delta
+def parse_header(delta):
+    if delta[:4] != MAGIC or delta[4] != VERSION:
+        raise ValueError("không phải delta ODLT v%d" % VERSION)
+    _, _, sig_len, base_size, target_size = struct.unpack_from("<BBHII", delta, 4)
+    hdr = {
+        "base_size": base_size, "target_size": target_size,
+        "base_sha": delta[16:48], "target_sha": delta[48:80], "sig": delta[80:80 + sig_len],
+    }
+    return hdr, 80 + sig_len
+
+
+def apply(base, delta):
+    """Bản tham chiếu của ota_delta_feed (cùng kiểm tra biên)."""
+    hdr, p = parse_header(delta)
+    if len(base) != hdr["base_size"] or hashlib.sha256(base).digest() != hdr["base_sha"]:
+        raise ValueError("base không khớp image dùng để tạo delta")
+    out = bytearray()
+    while True:
+        op = delta[p]
+        p += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            src, n = struct.unpack_from("<II", delta, p)
+            p += 8
+            if src + n > len(base):
+                raise ValueError("COPY ngoài base")
+            out += base[src:src + n]
+        elif op == OP_ADD:
+            (n,) = struct.unpack_from("<I", delta, p)
+            p += 4
+            out += delta[p:p + n]
+            p += n
+        elif op == OP_RUN:
+            n, v = struct.unpack_from("<IB", delta, p)
+            p += 5
+            out += bytes([v]) * n
+        else:
+            raise ValueError("opcode lạ 0x%02x tại %d" % (op, p - 1))
+        if len(out) > hdr["target_size"]:
+            raise ValueError("output vượt target_size")
+    if p != len(delta) or len(out) != hdr["target_size"]:
+        raise ValueError("delta thừa / thiếu dữ liệu")
+    if hashlib.sha256(out).digest() != hdr["target_sha"]:
+        raise ValueError("sha256 của image mới sai")
+    return hdr, bytes(out)
+
+
+def cmd_apply(args):
+    base = open(args.base, "rb").read()
+    delta = open(args.delta, "rb").read()
+    hdr, out = apply(base, delta)
+    if args.header:
+        ok = verify(public_pem_from_header(args.header), hdr["sig"], out)
+        print("chữ ký: %s" % ("OK" if ok else "SAI"))
+        if not ok:
+            sys.exit(1)
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(out)
+    print("OK: %d B, sha256 %s" % (len(out), hdr["target_sha"].hex()))
+
+
+def cmd_info(args):
+    delta = open(args.delta, "rb").read()
+    hdr, p = parse_header(delta)
+    counts = {OP_COPY: 0, OP_ADD: 0, OP_RUN: 0}
+    add_bytes = 0
+    while delta[p] != OP_END:
+        op = delta[p]
+        counts[op] += 1
+        if op == OP_COPY:
+            p += 9
+        elif op == OP_ADD:
+            (n,) = struct.unpack_from("<I", delta, p + 1)
+            add_bytes += n
+            p += 5 + n
+        else:
+            p += 6
+    print(json.dumps({
+        "size": len(delta), "base_size": hdr["base_size"], "target_size": hdr["target_size"],
+        "base_sha": hdr["base_sha"].hex(), "target_sha": hdr["target_sha"].hex(),
+        "copy": counts[OP_COPY], "add": counts[OP_ADD], "add_bytes": add_bytes, "run": counts[OP_RUN],
+    }, indent=2))
+
+
+# ---------------------------------------------------------------- gửi qua MQTT
+def mqtt_client():
+    import paho.mqtt.client as mqtt
+    if hasattr(mqtt, "CallbackAPIVersion"):
+        return mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+    return mqtt.Client()
+
+
+def push_delta(delta, host, port, prefix, chunk=512, window=4, timeout=10.0, verbose=True):
+    """Gửi delta theo giao thức của lib/ota/ota.h, trả về (trạng thái cuối, thống kê)."""
+    state = {"acked": 0, "chunk": chunk, "window": window, "ready": False, "final": None}
+    stats = {"chunks": 0, "resends": 0}
+    cond = threading.Condition()
+
+    def on_message(client, userdata, msg):
+        st = json.loads(msg.payload)
+        with cond:
+            if st.get("state") in ("ready", "recv"):
+                state["ready"] = True
+                state["acked"] = max(state["acked"], st["off"])
+                state["chunk"] = st.get("chunk", state["chunk"])
+                state["window"] = st.get("window", state["window"])
+            elif st.get("state") in ("done", "error", "aborted"):
+                state["final"] = st
+            cond.notify()
+        if verbose:
+            print("<- %s" % msg.payload.decode(), file=sys.stderr)
+
+    client = mqtt_client()
+    client.on_message = on_message
+    client.connect(host, port)
+    client.subscribe(prefix + "/ota", qos=0)
+    client.loop_start()
+    time.sleep(0.5)
+    client.publish(prefix + "/command", json.dumps({"cmd": "ota_begin", "size": len(delta)}))
+    # Chờ thiết bị mở phiên (chunk / window lấy từ trạng thái "ready")
+    with cond:
+        cond.wait_for(lambda: state["ready"] or state["final"], timeout=timeout)
+        if not state["ready"]:
+            client.loop_stop()
+            return state["final"] or {"state": "no_answer"}, stats
+
+    sent = 0  # offset đã gửi tới (go-back-N: quay về acked khi quá hạn)
+    last_progress = time.time()
+    with cond:
+        while state["final"] is None:
+            acked = state["acked"]
+            while sent < len(delta) and sent - acked < state["window"] * state["chunk"]:
+                n = min(state["chunk"], len(delta) - sent)
+                client.publish(prefix + "/ota/data", struct.pack("<I", sent) + delta[sent:sent + n])
+                sent += n
+                stats["chunks"] += 1
+            before = state["acked"]
+            cond.wait(timeout=timeout)
+            if state["acked"] > before:
+                last_progress = time.time()
+            elif time.time() - last_progress > timeout:
+                if verbose:
+                    print("timeout, gửi lại từ %d" % state["acked"], file=sys.stderr)
+                sent = state["acked"]
+                stats["resends"] += 1
+                last_progress = time.time()
+            if state["acked"] >= len(delta) and state["final"] is None:
+                cond.wait(timeout=120)  # thiết bị kiểm tra sha / chữ ký rồi mới báo done
+                if state["final"] is None:
+                    break
+    client.loop_stop()
+    client.disconnect()
+    return state["final"] or {"state": "timeout"}, stats
+
+
+def cmd_push(args):
+    delta = open(args.delta, "rb").read()
+    t0 = time.time()
+    final, _ = push_delta(delta, args.host, args.port, args.prefix, args.chunk, args.window, args.timeout)
+    if final.get("state") == "no_answer":
+        print("thiết bị không trả lời ota_begin", file=sys.stderr)
+    print("%s sau %.1fs (%d B)" % (final.get("state"), time.time() - t0, len(delta)))
+    sys.exit(0 if final.get("state") == "done" else 1)
+
+
+# ---------------------------------------------------------------- test vector (test/test_ota_delta)
+# Base sinh bằng xorshift32 (test C sinh lại được, không phải nhúng), target sửa
+# từ base đủ để delta có cả COPY / ADD / RUN. Chữ ký giả: bộ giải mã không kiểm tra.
+TV_SEED = 0x2545F491
+TV_BASE_SIZE = 4096
+TV_DUMMY_SIG = b"\x30\x44" + bytes(range(68))
+
+
+def xorshift_bytes(seed, n):
+    x, out = seed, bytearray(n)
+    for i in range(n):
+        x ^= (x << 13) & 0xFFFFFFFF
+        x ^= x >> 17
+        x ^= (x << 5) & 0xFFFFFFFF
+        out[i] = x & 0xFF
+    return bytes(out)
+
+
+def tv_images():
+    base = xorshift_bytes(TV_SEED, TV_BASE_SIZE)
+    t = bytearray(base)
+    t[100:104] = b"\xde\xad\xbe\xef"                     # sửa vài byte
+    t[1000:1000] = bytes(range(200))                         # chèn: phần sau dịch chỗ
+    del t[2600:2700]                                         # xoá
+    t[3000:3300] = base[200:500]                             # chép từ chỗ khác của base
+    t += b"\xff" * 700                                       # padding dài hơn base
+    return base, bytes(t)
+
+
+def c_array(name, data):
+    rows = ["    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + "," for i in range(0, len(data), 16)]
+    return "static const uint8_t %s[%d] = {\n%s\n};\n" % (name, len(data), "\n".join(rows))
+
+
+def cmd_testvec(args):
+    base, target = tv_images()
+    ops = diff(base, target)
+    delta = encode(base, target, ops, TV_DUMMY_SIG)
+    hdr, out = apply(base, delta)
+    assert out == target
+    count = {op: sum(1 for o in ops if o[0] == op) for op in (OP_COPY, OP_ADD, OP_RUN)}
+    assert all(count.values()), "delta thiếu loại op"
+    text = ("// Sinh bằng: python3 tools/ota_delta.py testvec -o %s\n"
+            "// Base = xorshift32(OTA_TV_SEED), target sửa từ base (xem tv_images trong tools/ota_delta.py),\n"
+            "// delta = diff của tool, chữ ký giả (ota_delta không kiểm tra chữ ký).\n"
+            "#ifndef OTA_DELTA_VECTORS_H_\n#define OTA_DELTA_VECTORS_H_\n\n#include <stdint.h>\n\n"
+            "#define OTA_TV_SEED 0x%08XUL\n#define OTA_TV_BASE_SIZE %d\n"
+            "#define OTA_TV_COPY_OPS %d\n#define OTA_TV_ADD_OPS %d\n#define OTA_TV_RUN_OPS %d\n\n%s\n%s\n"
+            "#endif // OTA_DELTA_VECTORS_H_\n") % (
+        args.output, TV_SEED, TV_BASE_SIZE, count[OP_COPY], count[OP_ADD], count[OP_RUN],
+        c_array("ota_tv_target", target), c_array("ota_tv_delta", delta))
+    with open(args.output, "w") as f:
+        f.write(text)
+    print("%s: target %d B, delta %d B (%d copy, %d add, %d run)" %
+          (args.output, len(target), len(delta), count[OP_COPY], count[OP_ADD], count[OP_RUN]))
+
+
+# ---------------------------------------------------------------- selftest: broker + thiết bị giả
+class MiniBroker:
+    """Broker MQTT 3.1.1 tối giản cho selftest: QoS 0, không retained / will / session."""
+
+    def __init__(self, host="127.0.0.1", port=0):
+        self.subs = []  # (send, filter)
+        self.lock = threading.Lock()
+        broker = self
+
+        class Handler(socketserver.BaseRequestHandler):
+            def handle(self):
+                broker._serve(self.request)
+
+        socketserver.ThreadingTCPServer.allow_reuse_address = True
+        self.server = socketserver.ThreadingTCPServer((host, port), Handler)
+        self.server.daemon_threads = True
+        self.port = self.server.server_address[1]
+        threading.Thread(target=self.server.serve_forever, daemon=True).start()
+
+    def close(self):
+        self.server.shutdown()
+        self.server.server_close()
+
+    @staticmethod
+    def _varint(n):
+        out = bytearray()
+        while True:
+            b, n = n & 0x7F, n >> 7
+            out.append(b | (0x80 if n else 0))
+            if not n:
+                return bytes(out)
+
+    @staticmethod
+    def _match(flt, topic):
+        f, t = flt.split("/"), topic.split("/")
+        for i, part in enumerate(f):
+            if part == "#":
+                return True
+            if i >= len(t) or (part != "+" and part != t[i]):
+                return False
+        return len(f) == len(t)
+
+    def _route(self, topic, payload):
+        tb = topic.encode()
+        body = struct.pack(">H", len(tb)) + tb + payload
+        pkt = b"\x30" + self._varint(len(body)) + body
+        with self.lock:
+            targets = {id(send): send for send, flt in self.subs if self._match(flt, topic)}
+        for send in targets.values():
+            try:
+                send(pkt)
+            except OSError:
+                pass
+
+    def _serve(self, sock):
+        send_lock = threading.Lock()
+
+        def send(data):
+            with send_lock:
+                sock.sendall(data)
+
+        def recv_exact(n):
+            buf = bytearray()
+            while len(buf) < n:
+                part = sock.recv(n - len(buf))
+                if not part:
+                    raise ConnectionError
+                buf += part
+            return bytes(buf)
+
+        try:
+            while True:
+                first = recv_exact(1)[0]
+                length, shift = 0, 0
+                while True:
+                    b = recv_exact(1)[0]
+                    length |= (b & 0x7F) << shift
+                    shift += 7
+                    if not b & 0x80:
+                        break
+                body = recv_exact(length)
+                kind = first >> 4
+                if kind == 1:  # CONNECT
+                    send(b"\x20\x02\x00\x00")
+                elif kind == 3:  # PUBLISH
+                    (tl,) = struct.unpack_from(">H", body, 0)
+                    topic, p = body[2:2 + tl].decode(), 2 + tl
+                    if (first >> 1) & 3:
+                        send(b"\x40\x02" + body[p:p + 2])  # PUBACK cho QoS 1
+                        p += 2
+                    self._route(topic, body[p:])
+                elif kind == 8:  # SUBSCRIBE
+                    pid, p, granted = body[:2], 2, bytearray()
+                    while p < len(body):
+                        (tl,) = struct.unpack_from(">H", body, p)
+                        flt = body[p + 2:p + 2 + tl].decode()
+                        p += 3 + tl
+                        with self.lock:
+                            self.subs.append((send, flt))
+                        granted.append(0)
+                    send(b"\x90" + self._varint(2 + len(granted)) + pid + bytes(granted))
+                elif kind == 10:  # UNSUBSCRIBE
+                    send(b"\xb0\x02" + body[:2])
+                elif kind == 12:  # PINGREQ
+                    send(b"\xd0\x00")
+                elif kind == 14:  # DISCONNECT
+                    break
+        except (ConnectionError, OSError):
+            pass
+        finally:
+            with self.lock:
+                self.subs = [(s, f) for s, f in self.subs if s is not send]
+            sock.close()
+
+
+class FlashError(Exception):
+    pass
+
+
+class SimFlash:
+    """Flash NOR giả: xoá theo sector 4 KB về 0xFF, ghi chỉ xoá được bit 1 -> 0."""
+    SECTOR = 4096
+
+    def __init__(self, size, image=b""):
+        self.mem = bytearray(b"\xff" * size)
+        self.mem[:len(image)] = image
+        self.erased_sectors = 0
+        self.write_calls = 0
+
+    def erase(self, off, n):
+        if off % self.SECTOR:
+            raise FlashError("erase lệch sector")
+        n = (n + self.SECTOR - 1) // self.SECTOR * self.SECTOR
+        if off + n > len(self.mem):
+            raise FlashError("erase ngoài partition")
+        self.mem[off:off + n] = b"\xff" * n
+        self.erased_sectors += n // self.SECTOR
+
+    def write(self, off, data):
+        if off + len(data) > len(self.mem):
+            raise FlashError("ghi ngoài partition")
+        old = int.from_bytes(self.mem[off:off + len(data)], "little")
+        new = int.from_bytes(data, "little")
+        if old & new != new:
+            raise FlashError("ghi vào vùng chưa xoá tại 0x%x" % off)
+        self.mem[off:off + len(data)] = data
+        self.write_calls += 1
+
+    def read(self, off, n):
+        return bytes(self.mem[off:off + n])
+
+
+class StreamDecoder:
+    """Bản Python của máy trạng thái ota_delta_feed: nhận từng mảnh bất kỳ."""
+    COPY_BUF = 256
+
+    def __init__(self, on_header, read_base, write):
+        self.on_header, self.read_base, self.write = on_header, read_base, write
+        self.buf, self.need, self.state = bytearray(), 80, "header"
+        self.hdr, self.op, self.remaining, self.out = None, None, 0, 0
+        self.result = "more"
+
+    def _fits(self, n):
+        return n <= self.hdr["target_size"] - self.out
+
+    def _emit(self, data):
+        self.write(data)
+        self.out += len(data)
+
+    def _expect(self, state, need=0):
+        self.state, self.need, self.buf = state, need, bytearray()
+
+    def feed(self, data):
+        if self.result not in ("more", "done"):
+            return self.result
+        data = memoryview(data)
+        while len(data):
+            if self.state in ("header", "sig", "args"):
+                take = min(self.need - len(self.buf), len(data))
+                self.buf += data[:take]
+                data = data[take:]
+                if len(self.buf) < self.need:
+                    break
+            if self.state == "header":
+                if bytes(self.buf[:4]) != MAGIC or self.buf[4] != VERSION:
+                    return self._fail("bad_magic")
+                sig_len, base_size, target_size = struct.unpack_from("<HII", self.buf, 6)
+                if sig_len == 0 or sig_len > 80 or target_size == 0:
+                    return self._fail("bad_header")
+                self.hdr = {"base_size": base_size, "target_size": target_size,
+                            "base_sha": bytes(self.buf[16:48]), "target_sha": bytes(self.buf[48:80])}
+                self._expect("sig", sig_len)
+            elif self.state == "sig":
+                self.hdr["sig"] = bytes(self.buf)
+                if not self.on_header(self.hdr):
+                    return self._fail("bad_header")
+                self._expect("opcode")
+            elif self.state == "opcode":
+                self.op = data[0]
+                data = data[1:]
+                if self.op == OP_END:
+                    if self.out != self.hdr["target_size"]:
+                        return self._fail("bad_range")
+                    self.state, self.result = "end", "done"
+                elif self.op in (OP_COPY, OP_ADD, OP_RUN):
+                    self._expect("args", {OP_COPY: 8, OP_ADD: 4, OP_RUN: 5}[self.op])
+                else:
+                    return self._fail("bad_op")
+            elif self.state == "args":
+                if self.op == OP_COPY:
+                    src, n = struct.unpack_from("<II", self.buf)
+                    if src + n > self.hdr["base_size"] or not self._fits(n):
+                        return self._fail("bad_range")
+                    for o in range(0, n, self.COPY_BUF):
+                        self._emit(self.read_base(src + o, min(self.COPY_BUF, n - o)))
+                    self._expect("opcode")
+                elif self.op == OP_RUN:
+                    n, v = struct.unpack_from("<IB", self.buf)
+                    if not self._fits(n):
+                        return self._fail("bad_range")
+                    for o in range(0, n, self.COPY_BUF):
+                        self._emit(bytes([v]) * min(self.COPY_BUF, n - o))
+                    self._expect("opcode")
+                else:
+                    (self.remaining,) = struct.unpack_from("<I", self.buf)
+                    if not self._fits(self.remaining):
+                        return self._fail("bad_range")
+                    self._expect("add" if self.remaining else "opcode")
+            elif self.state == "add":
+                n = min(len(data), self.remaining)
+                self._emit(bytes(data[:n]))
+                data = data[n:]
+                self.remaining -= n
+                if not self.remaining:
+                    self._expect("opcode")
+            else:
+                return self._fail("bad_op")  # dữ liệu thừa sau END
+        return self.result
+
+    def _fail(self, err):
+        self.result = err
+        return err
+
+
+class FakeDevice:
+    """Thiết bị giả nói giao thức OTA của lib/ota/ota.cpp qua MQTT, flash mô phỏng.
+
+    Mỗi chunk .../ota/data bị bỏ với xác suất drop (mất message / hết block
+    POOL_OTA_RX): không ack, backend phải gửi lại từ offset đã ack.
+    """
+    PARTITION = 0x140000  # app0 / app1 trong partitions.csv
+
+    def __init__(self, host, port, prefix, base, pub_pem, drop=0.05, seed=1, chunk=512, window=4):
+        self.prefix, self.pub_pem, self.drop = prefix, pub_pem, drop
+        self.chunk, self.window = chunk, window
+        self.rng = random.Random(seed)
+        self.running = SimFlash(self.PARTITION, base)
+        self.update = SimFlash(self.PARTITION)
+        self.base_len = len(base)
+        self.stats = {"dropped": 0, "out_of_order": 0}
+        self.session = None
+        self.client = mqtt_client()
+        self.client.on_message = self._on_message
+        self.client.connect(host, port)
+        self.client.subscribe(prefix + "/command")
+        self.client.subscribe(prefix + "/ota/data")
+        self.client.loop_start()
+
+    def close(self):
+        self.client.loop_stop()
+        self.client.disconnect()
+
+    def _report(self, state, err=None):
+        s = self.session
+        if err:
+            msg = {"state": state, "err": err, "off": s["received"] if s else 0}
+        elif state == "ready":
+            msg = {"state": "ready", "off": 0, "chunk": self.chunk, "window": self.window}
+        elif state == "recv":
+            msg = {"state": "recv", "off": s["received"]}
+        else:
+            msg = {"state": state, "fw": "selftest"}
+        self.client.publish(self.prefix + "/ota", json.dumps(msg))
+
+    # esp_ota_begin / esp_ota_write trên flash giả
+    def _on_header(self, hdr):
+        base = self.running.read(0, hdr["base_size"])
+        if hdr["base_size"] > self.PARTITION or hashlib.sha256(base).digest() != hdr["base_sha"]:
+            return False
+        if hdr["target_size"] > self.PARTITION:
+            return False
+        self.update.erase(0, hdr["target_size"])
+        self.session["hdr"] = hdr
+        return True
+
+    def _write(self, data):
+        s = self.session
+        self.update.write(s["written"], data)
+        s["written"] += len(data)
+
+    def _on_message(self, client, userdata, msg):
+        if msg.topic.endswith("/command"):
+            cmd = json.loads(msg.payload)
+            if cmd.get("cmd") == "ota_begin":
+                self.session = {"size": cmd["size"], "received": 0, "written": 0, "hdr": None}
+                self.session["dec"] = StreamDecoder(self._on_header, self.running.read, self._write)
+                self._report("ready")
+            return
+
+        s = self.session
+        if s is None or len(msg.payload) <= 4 or len(msg.payload) - 4 > self.chunk:
+            return
+        if self.rng.random() < self.drop:
+            self.stats["dropped"] += 1
+            return
+        (off,) = struct.unpack_from("<I", msg.payload)
+        if off != s["received"]:
+            self.stats["out_of_order"] += 1
+            self._report("recv")
+            return
+        data = msg.payload[4:4 + s["size"] - s["received"]]
+        try:
+            r = s["dec"].feed(data)
+        except FlashError as e:
+            self.session = None
+            return self._report("error", "flash: %s" % e)
+        s["received"] += len(data)
+        if r not in ("more", "done"):
+            self._report("error", r)
+            self.session = None
+            return
+        if s["received"] < s["size"]:
+            return self._report("recv")
+        if r != "done":
+            self._report("error", "truncated")
+            self.session = None
+            return
+        self._report("recv")
+        # session_finish: sha256 image vừa ghi + chữ ký ECDSA
+        image = self.update.read(0, s["hdr"]["target_size"])
+        if hashlib.sha256(image).digest() != s["hdr"]["target_sha"]:
+            self._report("error", "sha_mismatch")
+        elif not verify(self.pub_pem, s["hdr"]["sig"], image):
+            self._report("error", "bad_signature")
+        else:
+            self.image = image
+            self._report("done")
+        self.session = None
+
+
+def synth_firmware(seed, size):
+    """Cặp image giống firmware: code ngẫu nhiên + padding 0xFF, bản mới có sửa / chèn / xoá."""
+    rng = random.Random(seed)
+    base = bytearray(rng.randbytes(size))
+    base[-size // 16:] = b"\xff" * (size // 16)
+    target = bytearray(base)
+    for _ in range(20):  # sửa lẻ tẻ (hằng số, địa chỉ)
+        pos = rng.randrange(len(target) - 64)
+        target[pos:pos + 4] = rng.randbytes(4)
+    pos = rng.randrange(len(target) // 2)
+    target[pos:pos] = rng.randbytes(12 * 1024)  # module mới, phần sau dịch chỗ
+    pos = rng.randrange(len(target) // 2, len(target) - 4096)
+    del target[pos:pos + 2048]
+    target[-4096:-4096] = b"\x00" * 512
+    return bytes(base), bytes(target)
+
+
+def ephemeral_key():
+    from cryptography.hazmat.primitives import serialization
+    from cryptography.hazmat.primitives.asymmetric import ec
+    key = ec.generate_private_key(ec.SECP256R1())
+    pem = key.public_key().public_bytes(serialization.Encoding.PEM,
+                                        serialization.PublicFormat.SubjectPublicKeyInfo)
+    return key, pem
+
+
+def cmd_selftest(args):
+    from cryptography.hazmat.primitives import hashes
+    from cryptography.hazmat.primitives.asymmetric import ec
+
+    if args.base and args.target:
+        base, target = open(args.base, "rb").read(), open(args.target, "rb").read()
+    else:
+        base, target = synth_firmware(args.seed, args.size)
+    key, pub_pem = ephemeral_key()
+    sig = key.sign(target, ec.ECDSA(hashes.SHA256()))
+
+    ops = diff(base, target)
+    delta = encode(base, target, ops, sig)
+    full = encode(base, target, [(OP_ADD, target)], sig)
+    # Sửa một byte dữ liệu ADD cuối: sha256 image mới phải sai
+    tampered = bytearray(delta)
+    tampered[-2] ^= 0x01
+    other_base = bytes(b ^ 0xFF for b in base[:4096]) + base[4096:]
+    print("base %d B, target %d B, delta %d B (%d op), full %d B" %
+          (len(base), len(target), len(delta), len(ops), len(full)))
+
+    broker = None
+    host, port = args.host, args.port
+    if host is None:
+        broker = MiniBroker()
+        host, port = "127.0.0.1", broker.port
+        print("broker cục bộ 127.0.0.1:%d" % port)
+
+    scenarios = [
+        ("delta", delta, base, "done"),
+        ("full image", full, base, "done"),
+        ("tampered", bytes(tampered), base, "sha_mismatch"),
+        ("wrong base", delta, other_base, "bad_header"),
+    ]
+    failed = 0
+    for i, (name, payload, running, expect) in enumerate(scenarios):
+        prefix = "selftest/dev%d" % i
+        dev = FakeDevice(host, port, prefix, running, pub_pem, args.drop, args.seed + i)
+        t0 = time.time()
+        final, st = push_delta(payload, host, port, prefix, timeout=args.timeout, verbose=args.verbose)
+        dev.close()
+        got = final.get("err") or final.get("state")
+        ok = got == expect and (expect != "done" or getattr(dev, "image", None) == target)
+        failed += not ok
+        print("%-4s %-10s %-12s %6d B  %3d chunk, %2d bị bỏ, %2d lần gửi lại, %d sector xoá, %.1fs" %
+              ("OK" if ok else "FAIL", name, got, len(payload), st["chunks"], dev.stats["dropped"],
+               st["resends"], dev.update.erased_sectors, time.time() - t0))
+    if broker:
+        broker.close()
+    sys.exit(1 if failed else 0)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("keygen", help="tạo cặp khoá ECDSA P-256")
+    p.add_argument("-k", "--key", required=True, help="file private key (PEM) sẽ tạo")
+    p.add_argument("--header", default="lib/ota/ota_key.h")
+    p.set_defaults(fn=cmd_keygen)
+
+    p = sub.add_parser("make", help="tạo delta old.bin -> new.bin")
+    p.add_argument("base")
+    p.add_argument("target")
+    p.add_argument("-k", "--key", required=True)
+    p.add_argument("-o", "--output", required=True)
+    p.add_argument("--full", action="store_true", help="không diff, gửi cả image (một ADD)")
+    p.set_defaults(fn=cmd_make)
+
+    p = sub.add_parser("apply", help="áp delta trên host để kiểm tra")
+    p.add_argument("base")
+    p.add_argument("delta")
+    p.add_argument("-o", "--output")
+    p.add_argument("--header", help="ota_key.h để kiểm tra chữ ký")
+    p.set_defaults(fn=cmd_apply)
+
+    p = sub.add_parser("info", help="in header và thống kê op")
+    p.add_argument("delta")
+    p.set_defaults(fn=cmd_info)
+
+    p = sub.add_parser("push", help="gửi delta tới thiết bị qua MQTT")
+    p.add_argument("delta")
+    p.add_argument("--host", default="localhost")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--prefix", required=True, help="<MQTT_TOPIC_BASE>/<client_id>")
+    p.add_argument("--chunk", type=int, default=512)
+    p.add_argument("--window", type=int, default=4)
+    p.add_argument("--timeout", type=float, default=10.0)
+    p.set_defaults(fn=cmd_push)
+
+    p = sub.add_parser("selftest", help="thử đầu-cuối: broker + thiết bị giả (flash mô phỏng, mất chunk)")
+    p.add_argument("--base", help="image cũ (mặc định: image giả sinh từ --seed)")
+    p.add_argument("--target", help="image mới")
+    p.add_argument("--size", type=int, default=128 * 1024, help="kích thước image giả")
+    p.add_argument("--seed", type=int, default=1)
+    p.add_argument("--drop", type=float, default=0.05, help="xác suất thiết bị bỏ một chunk")
+    p.add_argument("--host", help="dùng broker có sẵn thay vì broker cục bộ trong tool")
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--timeout", type=float, default=0.5, help="chờ ack trước khi gửi lại")
+    p.add_argument("-v", "--verbose", action="store_true")
+    p.set_defaults(fn=cmd_selftest)
+
+    p = sub.add_parser("testvec", help="sinh vector cho test/test_ota_delta")
+    p.add_argument("-o", "--output", default="test/test_ota_delta/ota_delta_vectors.h")
+    p.set_defaults(fn=cmd_testvec)
+
+    args = ap.parse_args()
+    args.fn(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Chuyển trace dump của firmware (lệnh MQTT {"cmd":"trace_dump"}) sang
+Chrome trace_event JSON, mở bằng chrome://tracing hoặc ui.perfetto.dev.
+
+    python3 tools/trace2chrome.py dump.txt -o trace.json
+    mosquitto_sub -t 'esp32/vmh-test/+/trace' | python3 tools/trace2chrome.py - -o trace.json
+
+Định dạng dump (xem lib/trace/trace.cpp):
+    Q <id> <queue name>
+    S <id> <span name>
+    K <task handle hex> <task name>
+    R <core> <ts_us> <task handle hex> <type> <id> <arg>
+"""
+
+import argparse
+import json
+import sys
+
+REC_TASK_SWITCH, REC_SPAN_BEGIN, REC_SPAN_END, REC_QUEUE_SEND, REC_QUEUE_DROP, REC_QUEUE_RECV = range(6)
+
+
+def parse(lines):
+    queues, spans, tasks, records = {}, {}, {}, []
+    for line in lines:
+        parts = line.strip().split(" ")
+        if not parts or parts[0] in ("", "#"):
+            continue
+        kind = parts[0]
+        if kind == "Q":
+            queues[int(parts[1])] = parts[2]
+        elif kind == "S":
+            spans[int(parts[1])] = parts[2]
+        elif kind == "K":
+            tasks[int(parts[1], 16)] = " ".join(parts[2:])
+        elif kind == "R" and len(parts) == 7:
+            core, ts, task, typ, rid, arg = parts[1:]
+            records.append((int(core), int(ts), int(task, 16), int(typ), int(rid), int(arg)))
+    return queues, spans, tasks, records
+
+
+def unwrap(records):
+    """ts_us là 32 bit thấp của esp_timer: nối lại theo từng core."""
+    out, last, offset = [], {}, {}
+    for core, ts, task, typ, rid, arg in records:
+        if core in last and ts < last[core] and last[core] - ts > 1 << 31:
+            offset[core] = offset.get(core, 0) + (1 << 32)
+        last[core] = ts
+        out.append((core, ts + offset.get(core, 0), task, typ, rid, arg))
+    out.sort(key=lambda r: r[1])
+    return out
+
+
+def convert(queues, spans, tasks, records):
+    events = []
+    pid = 1
+
+    def task_name(handle):
+        return tasks.get(handle, "task_%08x" % handle)
+
+    seen = set()
+    for _, _, task, _, _, _ in records:
+        if task not in seen:
+            seen.add(task)
+            events.append({"ph": "M", "name": "thread_name", "pid": pid, "tid": task,
+                           "args": {"name": task_name(task)}})
+    for core in (0, 1):
+        events.append({"ph": "M", "name": "thread_name", "pid": pid, "tid": "cpu%d" % core,
+                       "args": {"name": "CPU %d" % core}})
+
+    # Lịch CPU: task đổi giữa hai record liên tiếp trên cùng core = có context switch.
+    # Khi firmware có hook traceTASK_SWITCHED_IN thì record TASK_SWITCH cho mốc chính xác.
+    running = {}
+    for core, ts, task, typ, _, _ in records:
+        cur = running.get(core)
+        if cur is None or cur[0] != task:
+            if cur is not None:
+                events.append({"ph": "X", "name": task_name(cur[0]), "pid": pid, "tid": "cpu%d" % core,
+                               "ts": cur[1], "dur": max(ts - cur[1], 1)})
+            running[core] = (task, ts)
+    for core, (task, start) in running.items():
+        end = max(r[1] for r in records if r[0] == core)
+        events.append({"ph": "X", "name": task_name(task), "pid": pid, "tid": "cpu%d" % core,
+                       "ts": start, "dur": max(end - start, 1)})
+
+    # Flow send -> recv ghép theo thứ tự FIFO của từng queue
+    pending = {}
+    flow_id = 0
+    for core, ts, task, typ, rid, arg in records:
+        if typ == REC_SPAN_BEGIN:
+            events.append({"ph": "B", "name": spans.get(rid, "span%d" % rid), "pid": pid, "tid": task, "ts": ts})
+        elif typ == REC_SPAN_END:
+            events.append({"ph": "E", "name": spans.get(rid, "span%d" % rid), "pid": pid, "tid": task, "ts": ts})
+        elif typ in (REC_QUEUE_SEND, REC_QUEUE_DROP, REC_QUEUE_RECV):
+            qname = queues.get(rid, "q%d" % rid)
+            verb = {REC_QUEUE_SEND: "send", REC_QUEUE_DROP: "DROP", REC_QUEUE_RECV: "recv"}[typ]
+            events.append({"ph": "i", "s": "t", "name": "%s %s" % (verb, qname), "pid": pid, "tid": task,
+                           "ts": ts, "args": {"arg": arg, "core": core}})
+            if typ == REC_QUEUE_SEND:
+                flow_id += 1
+                pending.setdefault(rid, []).append(flow_id)
+                events.append({"ph": "s", "id": flow_id, "name": qname, "cat": "queue",
+                               "pid": pid, "tid": task, "ts": ts})
+            elif typ == REC_QUEUE_RECV and pending.get(rid):
+                events.append({"ph": "f", "bp": "e", "id": pending[rid].pop(0), "name": qname,
+                               "cat": "queue", "pid": pid, "tid": task, "ts": ts})
+        elif typ == REC_TASK_SWITCH:
+            events.append({"ph": "i", "s": "t", "name": "switch_in", "pid": pid, "tid": task, "ts": ts})
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("dump", help="file dump, '-' = stdin")
+    ap.add_argument("-o", "--output", default="-", help="file JSON, mặc định stdout")
+    args = ap.parse_args()
+
+    src = sys.stdin if args.dump == "-" else open(args.dump, encoding="utf-8")
+    with src:
+        queues, spans, tasks, records = parse(src)
+    trace = convert(queues, spans, tasks, unwrap(records))
+
+    dst = sys.stdout if args.output == "-" else open(args.output, "w", encoding="utf-8")
+    with dst:
+        json.dump(trace, dst)
+    print("%d records -> %d events" % (len(records), len(trace["traceEvents"])), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()